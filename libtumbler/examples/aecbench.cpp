@@ -0,0 +1,179 @@
+/*
+ * @file aecbench.cpp
+ * \~english
+ * @brief Benchmarks the acoustic echo canceller on recorded 18-channel raw files
+ * \~japanese
+ * @brief 録音した 18ch の raw ファイルでエコーキャンセラーを設定毎に評価するプログラム
+ * @details 使い方
+ *   aecbench <input> [output] [channels] : 48kHz 16bit 18ch インターリーブ形式の raw ファイル（hardware_api/microphone/rec.cpp の出力と同じ形式）を、
+ *                                         17ch を参照信号としてエコーキャンセラーで処理し、設定毎のチャネルあたりの CPU 時間と ERLE を出力します。
+ *                                         output を指定した場合は、既定の設定による 1ch〜channels ch の処理結果を 48kHz 16bit インターリーブ形式の raw ファイルとして書き出します。
+ * スピーカーで音声を再生しながら録音したファイルを与えてください。実機を必要としません。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <tumbler/audiokernels.h>
+#include <tumbler/echocanceller.h>
+#include <tumbler/microphone.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+
+using namespace tumbler;
+
+static const size_t k_chunk = 480;
+
+void usage()
+{
+	std::cerr << "usage: aecbench <input> [output] [channels]" << std::endl;
+}
+
+/**
+ * @brief 録音をチャネル毎に読み込む（マイク 16ch と参照信号 1ch）
+ */
+std::vector<std::vector<float> > load(const std::string& path)
+{
+	std::ifstream ifs(path.c_str(), std::ios::binary);
+	if(!ifs){
+		throw std::runtime_error("aecbench: cannot open " + path);
+	}
+	std::vector<std::vector<float> > channels(17);
+	std::vector<short> buffer(k_chunk * Microphone::k_channels_);
+	std::vector<float*> dst(17);
+	while(ifs){
+		ifs.read(reinterpret_cast<char*>(buffer.data()), buffer.size() * sizeof(short));
+		const size_t frames = static_cast<size_t>(ifs.gcount()) / sizeof(short) / Microphone::k_channels_;
+		if(frames == 0){
+			break;
+		}
+		for(size_t c=0;c<17;++c){
+			channels[c].resize(channels[c].size() + frames);
+			dst[c] = channels[c].data() + channels[c].size() - frames;
+		}
+		deinterleave(dst.data(), buffer.data(), frames, Microphone::k_channels_, Microphone::k_mic_mask_ | Microphone::k_reference_mask_, 1.0F);
+	}
+	return channels;
+}
+
+/**
+ * @brief 録音全体を k_chunk フレームずつ処理し、チャネルあたりの CPU 時間 [ms/s] を返す
+ */
+double run(EchoCanceller& aec, const std::vector<std::vector<float> >& input, std::vector<std::vector<float> >& output)
+{
+	const size_t frames = input[0].size();
+	const size_t channels = aec.channels();
+	output.assign(channels, std::vector<float>(frames + k_chunk, 0.0F));
+	std::vector<const float*> in(channels);
+	std::vector<float*> out(channels);
+	size_t produced = 0;
+	const std::clock_t begin = std::clock();
+	for(size_t done=0;done<frames;done+=k_chunk){
+		for(size_t c=0;c<channels;++c){
+			in[c] = input[c].data() + done;
+			out[c] = output[c].data() + produced;
+		}
+		produced += aec.process(in.data(), input[16].data() + done, std::min(k_chunk, frames - done), out.data());
+	}
+	const double cpu = static_cast<double>(std::clock() - begin) / CLOCKS_PER_SEC;
+	for(size_t c=0;c<channels;++c){
+		output[c].resize(produced);
+	}
+	return cpu * 1000.0 / (static_cast<double>(frames) / 48000) / channels;
+}
+
+void save(const std::string& path, const std::vector<std::vector<float> >& output)
+{
+	std::ofstream ofs(path.c_str(), std::ios::binary);
+	if(!ofs){
+		throw std::runtime_error("aecbench: cannot open " + path);
+	}
+	std::vector<short> frame(output.size());
+	for(size_t i=0;i<output[0].size();++i){
+		for(size_t c=0;c<output.size();++c){
+			frame[c] = static_cast<short>(std::max(-32768.0F, std::min(32767.0F, output[c][i])));
+		}
+		ofs.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(short));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 4){
+		usage();
+		return 1;
+	}
+	try{
+		const std::vector<std::vector<float> > input = load(argv[1]);
+		const size_t channels = argc == 4 ? static_cast<size_t>(std::atoi(argv[3])) : 16;
+		if(input[0].empty() || channels < 1 || channels > 16){
+			usage();
+			return 1;
+		}
+		std::cout << input[0].size() << " frames (" << input[0].size() / 48000.0 << " s), " << channels << " channels" << std::endl;
+
+		// 比較する設定（ブロック長とフィルタ長）
+		std::vector<std::pair<std::string, EchoCancellerConfig> > configs;
+		EchoCancellerConfig c;
+		configs.push_back(std::make_pair(std::string("default"), c));
+		c.filterLength_ = 2048;
+		configs.push_back(std::make_pair(std::string("short filter"), c));
+		c.block_ = 512;
+		c.filterLength_ = 8192;
+		configs.push_back(std::make_pair(std::string("long block+filter"), c));
+		c.block_ = 256;
+		c.filterLength_ = 4096;
+		c.referenceDelay_ = 0;
+		configs.push_back(std::make_pair(std::string("no delay compensation"), c));
+
+		std::vector<std::vector<float> > output;
+		std::vector<std::vector<float> > defaultOutput;
+		for(size_t i=0;i<configs.size();++i){
+			EchoCanceller aec(channels, configs[i].second);
+			const double cpu = run(aec, input, output);
+			float erle = 0;
+			for(size_t ch=0;ch<channels;++ch){
+				erle += aec.erle(ch) / channels;
+			}
+			std::cout << std::left << std::setw(24) << configs[i].first
+					<< " block=" << std::setw(4) << configs[i].second.block_
+					<< " taps=" << std::setw(5) << configs[i].second.filterLength_
+					<< std::fixed << std::setprecision(1)
+					<< " cpu=" << cpu << " ms/s per channel"
+					<< " erle(mean)=" << erle << " dB"
+					<< " latency=" << aec.latency() << " samples" << std::endl;
+			if(i == 0){
+				defaultOutput.swap(output);
+			}
+		}
+		if(argc >= 3){
+			save(argv[2], defaultOutput);
+		}
+	}catch(const std::runtime_error& e){
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * @file buttonsbench.cpp
+ * \~english
+ * @brief Records touch button traces on the device and benchmarks the detection algorithm offline
+ * \~japanese
+ * @brief タッチボタンのトレースを実機で記録し、記録したトレースで検出アルゴリズムをオフライン評価するプログラム
+ * @details 使い方
+ *   buttonsbench record <trace> <seconds>  : 実機で指定秒数の間トレースを記録します。記録中はボタンを操作してください。
+ *   buttonsbench replay <trace> [labels]   : 記録したトレースを検出設定毎に再生し、押下数、CPU 時間を出力します。
+ *                                            正解の押下区間を記したラベルファイルを指定した場合は、検出遅延、検出漏れ、誤検出も出力します。
+ * ラベルファイルは 1 行につき「ボタン番号 開始時刻 終了時刻」（トレースと同じ microsecond 単位）の形式です。replay は実機を必要としません。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <tumbler/buttons.h>
+#include <tumbler/buttontrace.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace tumbler;
+
+void usage()
+{
+	std::cerr << "usage: buttonsbench record <trace> <seconds>" << std::endl;
+	std::cerr << "       buttonsbench replay <trace> [labels]" << std::endl;
+}
+
+int record(const std::string& path, int seconds)
+{
+	Buttons& buttons = Buttons::getInstance();
+	buttons.startTrace(path);
+	buttons.start();
+	std::cout << seconds << " 秒間トレースを記録します。ボタンを操作してください..." << std::endl;
+	sleep(seconds);
+	buttons.stop();
+	buttons.stopTrace();
+	ButtonMonitorStats s = buttons.stats();
+	std::cout << s.cycles_ << " 計測を " << path << " に記録しました" << std::endl;
+	return 0;
+}
+
+void report(const std::string& name, const ButtonDetectionReport& r, bool labelled)
+{
+	std::cout << std::left << std::setw(24) << name
+			<< " presses=" << std::setw(5) << r.presses_;
+	if(labelled){
+		std::cout << " detected=" << r.detected_ << "/" << std::setw(4) << r.labelled_
+				<< " missed=" << std::setw(4) << r.missed_
+				<< " false=" << std::setw(4) << r.falsePresses_
+				<< std::fixed << std::setprecision(1)
+				<< " latency(mean/max)=" << r.meanLatencyMs_ << "/" << r.maxLatencyMs_ << " ms";
+	}
+	std::cout << std::fixed << std::setprecision(0) << " cpu=" << r.nsPerSample_ << " ns/sample" << std::endl;
+}
+
+int replay(const std::string& path, const std::string& labelPath)
+{
+	std::vector<ButtonTraceRecord> trace = loadButtonTrace(path);
+	std::vector<ButtonPressLabel> labels;
+	if(!labelPath.empty()){
+		labels = loadButtonPressLabels(labelPath);
+	}
+	if(trace.empty()){
+		std::cerr << path << " has no records" << std::endl;
+		return 1;
+	}
+	const double seconds = static_cast<double>(trace.back().timestamp_ - trace.front().timestamp_) / 1000000.0;
+	std::cout << trace.size() << " samples (" << seconds << " s), " << labels.size() << " labelled presses" << std::endl;
+
+	// 比較する検出設定
+	std::vector<std::pair<std::string, ButtonDetectionConfig>> configs;
+	ButtonDetectionConfig c;
+	configs.push_back(std::make_pair(std::string("fixed"), c));
+	c.adaptiveThreshold_ = true;
+	configs.push_back(std::make_pair(std::string("adaptive"), c));
+	c.ledInterferenceCompensation_ = false;
+	configs.push_back(std::make_pair(std::string("adaptive+blanking"), c));
+	c.adaptiveThreshold_ = false;
+	configs.push_back(std::make_pair(std::string("fixed+blanking"), c));
+
+	for(size_t i=0;i<configs.size();++i){
+		report(configs[i].first, replayButtonTrace(trace, labels, configs[i].second), !labels.empty());
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 3){
+		usage();
+		return 1;
+	}
+	const std::string mode = argv[1];
+	try{
+		if(mode == "record" && argc == 4){
+			return record(argv[2], std::atoi(argv[3]));
+		}else if(mode == "replay" && (argc == 3 || argc == 4)){
+			return replay(argv[2], argc == 4 ? argv[3] : "");
+		}
+	}catch(const std::runtime_error& e){
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	usage();
+	return 1;
+}
@@ -0,0 +1,131 @@
+/*
+ * @file prerollrec.cpp
+ * \~english
+ * @brief Records the microphones from a few seconds before each touch button press
+ * \~japanese
+ * @brief タッチボタンが押される度に、押される数秒前からのマイクの音声を録音するプログラム
+ * @details 使い方
+ *   prerollrec [before] [after] : タッチボタンが押された時刻の before 秒前（既定値 2 秒）から after 秒後（既定値 5 秒）までの 1ch〜16ch の音声を、
+ *                                 16kHz 16bit 16ch インターリーブ形式の raw ファイル（preroll_1.raw, preroll_2.raw, ...）として書き出します。
+ * 録音は起動時から常に行い、直近の音声を AudioHistory に保持しておくため、ボタンが押される前の音声も得られます。Ctrl+C で終了します。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <tumbler/tumbler.h>
+#include <tumbler/buttons.h>
+#include <tumbler/microphone.h>
+#include <tumbler/audiohistory.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <signal.h>
+
+using namespace tumbler;
+
+volatile sig_atomic_t e_flag_ = 0;
+void sig_handler_(int signum){ e_flag_ = 1; } // Ctrl+C のキャプチャ
+
+int main(int argc, char** argv)
+{
+	signal(SIGINT, sig_handler_);
+	const float before = argc >= 2 ? static_cast<float>(std::atof(argv[1])) : 2.0F;
+	const float after = argc >= 3 ? static_cast<float>(std::atof(argv[2])) : 5.0F;
+	if(argc > 3 || before < 0 || after <= 0){
+		std::cerr << "usage: prerollrec [before] [after]" << std::endl;
+		return 1;
+	}
+
+	// 1ch〜16ch を 16kHz に間引いて、before 秒より少し長く保持する
+	AudioHistoryConfig config;
+	config.mask_ = Microphone::k_mic_mask_;
+	config.seconds_ = before + 1.0F;
+	config.factor_ = 3;
+	AudioHistory history(config);
+
+	// ボタンが押された時刻を録音側に伝える（ハンドラはコールバック配送スレッドから呼ばれる）
+	std::atomic<uint64_t> pressed(0);
+	Buttons& buttons = Buttons::getInstance();
+	buttons.subscribe([&](const ButtonStateEvent& e){
+		for(int i=0;i<4;++i){
+			if(e.states_[i] == ButtonState::pushed_){
+				pressed.store(e.timestamp_);
+			}
+		}
+	});
+	buttons.start();
+
+	Microphone mic;
+	mic.start();
+	std::cout << "recording... touch a button to save " << before << " s before and " << after << " s after it (Ctrl+C to quit)" << std::endl;
+	std::vector<short> buf(480 * Microphone::k_channels_);
+	std::vector<short> clip(4800 * history.channels());
+	AudioHistoryReader reader;
+	FILE* fp = nullptr;
+	uint64_t end = 0;
+	int count = 0;
+	MicrophoneBlock block;
+	while(e_flag_ == 0){
+		const size_t n = mic.read(buf.data(), 480, block, 1000);
+		if(n == 0){
+			break;
+		}
+		history.write(buf.data(), n, block);
+
+		const uint64_t t = pressed.exchange(0);
+		if(t != 0 && fp == nullptr){
+			// 押された時刻から遡った位置を開く。履歴はこの時点でコピーされず、以降の読み出しで順に書き出される
+			std::stringstream path;
+			path << "preroll_" << ++count << ".raw";
+			fp = std::fopen(path.str().c_str(), "wb");
+			if(fp == nullptr){
+				std::cerr << "could not open " << path.str() << std::endl;
+				continue;
+			}
+			reader = history.open(t - static_cast<uint64_t>(before * 1000000.0F));
+			end = t + static_cast<uint64_t>(after * 1000000.0F);
+			std::cout << "saving " << path.str() << std::endl;
+		}
+		if(fp != nullptr){
+			while(reader.timestamp() < end){
+				const size_t rest = static_cast<size_t>((end - reader.timestamp()) * history.rate() / 1000000ULL) + 1;
+				const size_t m = reader.read(clip.data(), std::min(rest, clip.size() / history.channels()), 0);
+				if(m == 0){
+					break;
+				}
+				std::fwrite(clip.data(), sizeof(short), m * history.channels(), fp);
+			}
+			if(reader.timestamp() >= end){
+				std::fclose(fp);
+				fp = nullptr;
+				std::cout << "saved (" << reader.lost() << " frames lost)" << std::endl;
+			}
+		}
+	}
+	if(fp != nullptr){
+		std::fclose(fp);
+	}
+	mic.stop();
+	buttons.stop();
+	return 0;
+}
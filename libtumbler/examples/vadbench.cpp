@@ -0,0 +1,173 @@
+/*
+ * @file vadbench.cpp
+ * \~english
+ * @brief Benchmarks the voice activity detector on recorded 18-channel raw files
+ * \~japanese
+ * @brief 録音した 18ch の raw ファイルで音声区間検出器を設定毎に評価するプログラム
+ * @details 使い方
+ *   vadbench <input> [labels] [channel] : 48kHz 16bit 18ch インターリーブ形式の raw ファイル（hardware_api/microphone/rec.cpp の出力と同じ形式）の
+ *                                       channel ch（既定値は 1ch）を 16kHz に変換して音声区間検出器で処理し、設定毎の CPU 時間、音声区間の割合と数を出力します。
+ *                                       正解の発話区間を記したラベルファイルを指定した場合は、10ms 毎の適合率と再現率も出力します。
+ * ラベルファイルは 1 行につき「開始時刻 終了時刻」（録音の先頭からの秒数）の形式です。実機を必要としません。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <tumbler/decimator.h>
+#include <tumbler/microphone.h>
+#include <tumbler/voiceactivitydetector.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+
+using namespace tumbler;
+
+static const size_t k_chunk = 480;
+static const int k_rate = 16000;
+
+void usage()
+{
+	std::cerr << "usage: vadbench <input> [labels] [channel]" << std::endl;
+}
+
+/**
+ * @brief 録音の指定したチャネルを 16kHz に変換して読み込む
+ */
+std::vector<short> load(const std::string& path, int channel)
+{
+	std::ifstream ifs(path.c_str(), std::ios::binary);
+	if(!ifs){
+		throw std::runtime_error("vadbench: cannot open " + path);
+	}
+	Decimator decimator(1, Microphone::k_rate_ / k_rate);
+	std::vector<short> output;
+	std::vector<short> buffer(k_chunk * Microphone::k_channels_);
+	std::vector<short> converted(decimator.maxOutput(k_chunk));
+	short* dst = converted.data();
+	while(ifs){
+		ifs.read(reinterpret_cast<char*>(buffer.data()), buffer.size() * sizeof(short));
+		const size_t frames = static_cast<size_t>(ifs.gcount()) / sizeof(short) / Microphone::k_channels_;
+		if(frames == 0){
+			break;
+		}
+		const size_t n = decimator.process(buffer.data(), frames, Microphone::k_channels_, 1U << channel, &dst);
+		output.insert(output.end(), converted.begin(), converted.begin() + n);
+	}
+	return output;
+}
+
+/**
+ * @brief ラベルファイルを 10ms 毎の正解ラベルとして読み込む
+ */
+std::vector<bool> labels(const std::string& path, size_t frames)
+{
+	std::ifstream ifs(path.c_str());
+	if(!ifs){
+		throw std::runtime_error("vadbench: cannot open " + path);
+	}
+	std::vector<bool> result(frames, false);
+	double begin, end;
+	while(ifs >> begin >> end){
+		const size_t first = static_cast<size_t>(std::max(0.0, begin * 100));
+		const size_t last = std::min(frames, static_cast<size_t>(std::max(0.0, end * 100)));
+		for(size_t i=first;i<last;++i){
+			result[i] = true;
+		}
+	}
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 4){
+		usage();
+		return 1;
+	}
+	try{
+		const int channel = argc == 4 ? std::atoi(argv[3]) - 1 : 0;
+		if(channel < 0 || channel >= Microphone::k_channels_){
+			usage();
+			return 1;
+		}
+		const std::vector<short> input = load(argv[1], channel);
+		const size_t frames = input.size() / (k_rate / 100);
+		const std::vector<bool> truth = argc >= 3 ? labels(argv[2], frames) : std::vector<bool>();
+		std::cout << input.size() << " samples at 16kHz (" << input.size() / static_cast<double>(k_rate) << " s), channel " << channel + 1 << std::endl;
+
+		// 比較する設定
+		std::vector<std::pair<std::string, VoiceActivityDetectorConfig> > configs;
+		VoiceActivityDetectorConfig c;
+		configs.push_back(std::make_pair(std::string("default"), c));
+		c.threshold_ = 6.0F;
+		configs.push_back(std::make_pair(std::string("sensitive"), c));
+		c.threshold_ = 12.0F;
+		configs.push_back(std::make_pair(std::string("strict"), c));
+		c.threshold_ = 9.0F;
+		c.hangoverFrames_ = 10;
+		configs.push_back(std::make_pair(std::string("short hangover"), c));
+		c.hangoverFrames_ = 30;
+		c.minBandRatio_ = 0.0F;
+		c.maxZeroCrossing_ = 1.0F;
+		configs.push_back(std::make_pair(std::string("energy only"), c));
+
+		for(size_t i=0;i<configs.size();++i){
+			VoiceActivityDetector vad(1, configs[i].second);
+			std::vector<bool> decisions(frames, false);
+			size_t segments = 0;
+			bool previous = false;
+			const std::clock_t begin = std::clock();
+			for(size_t f=0;f<frames;++f){
+				const short* in = input.data() + f * (k_rate / 100);
+				decisions[f] = vad.process(&in, k_rate / 100);
+				segments += decisions[f] && !previous;
+				previous = decisions[f];
+			}
+			const double cpu = static_cast<double>(std::clock() - begin) / CLOCKS_PER_SEC * 1000.0 / (static_cast<double>(input.size()) / k_rate);
+			const size_t on = static_cast<size_t>(std::count(decisions.begin(), decisions.end(), true));
+			std::cout << std::left << std::setw(16) << configs[i].first
+					<< std::fixed << std::setprecision(3)
+					<< " cpu=" << cpu << " ms/s"
+					<< std::setprecision(1)
+					<< " active=" << 100.0 * on / std::max<size_t>(1, frames) << "%"
+					<< " segments=" << segments;
+			if(!truth.empty()){
+				size_t tp = 0, fp = 0, fn = 0;
+				for(size_t f=0;f<frames;++f){
+					tp += decisions[f] && truth[f];
+					fp += decisions[f] && !truth[f];
+					fn += !decisions[f] && truth[f];
+				}
+				std::cout << std::setprecision(3)
+						<< " precision=" << (tp + fp > 0 ? static_cast<double>(tp) / (tp + fp) : 0.0)
+						<< " recall=" << (tp + fn > 0 ? static_cast<double>(tp) / (tp + fn) : 0.0);
+			}
+			std::cout << std::endl;
+		}
+	}catch(const std::runtime_error& e){
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * @file audiohistory.h
+ * \~english
+ * @brief Time-indexed ring that retains the last seconds of selected capture channels for event-triggered recording with pre-roll
+ * \~japanese
+ * @brief イベントの前からの録音のために、指定したチャネルの直近の音声を録音時刻とともに保持するリングバッファ
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_AUDIOHISTORY_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_AUDIOHISTORY_H_
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/decimator.h"
+#include "tumbler/microphone.h"
+
+namespace tumbler{
+
+/**
+ * @class AudioHistoryConfig
+ * @brief 音声の履歴の設定
+ */
+class DLL_PUBLIC AudioHistoryConfig
+{
+public:
+	uint32_t mask_ = 1U;      //!< 保持するチャネルのビットマスク（Microphone::k_mic_mask_ 等。既定値は 1ch 目のみ）
+	float seconds_ = 5.0F;    //!< 保持する長さ [s]
+	int factor_ = 1;          //!< 保持する際の間引きの比（1 の場合は 48kHz のまま、2、3、6 の場合は Decimator で 24kHz、16kHz、8kHz に変換する）
+};
+
+class AudioHistory;
+
+/**
+ * @class AudioHistoryReader
+ * @brief AudioHistory::open() で指定した時刻から、保持している音声とそれに続けて書き込まれる音声を順に読み出すカーソル
+ * @details 読み出し位置を持つのみで、開いた時点で履歴をコピーしない。複数のスレッドから同時に開いた、異なるカーソルから読み出してよい。
+ * 読み出す前に履歴が上書きされた場合は、その分を読み飛ばして lost() に数える。カーソルは AudioHistory より先に破棄すること。
+ */
+class DLL_PUBLIC AudioHistoryReader
+{
+public:
+	/**
+	 * @brief どの履歴も指さないカーソルを作る（read() は常に 0 を返す）
+	 */
+	AudioHistoryReader() : history_(nullptr), position_(0), lost_(0) {}
+
+	/**
+	 * @brief 音声を読み出す
+	 * @details 読み出せる音声がない場合は、新たに書き込まれるまで最大 timeoutMs だけ待つ。
+	 * @param [out] out 出力先（AudioHistory::channels() チャネルのインターリーブ形式。frames * channels() サンプル以上の領域があること）
+	 * @param [in] frames 読み出す最大のフレーム数
+	 * @param [in] timeoutMs 待つ最大の時間 [ms]（0 の場合は待たない）
+	 * @return 読み出したフレーム数
+	 */
+	size_t read(short* out, size_t frames, int timeoutMs);
+
+	/**
+	 * @brief 次に読み出すフレームの推定録音時刻 [microsecond]（monotonicMicroseconds() と同じ時刻）を返す
+	 */
+	uint64_t timestamp() const;
+
+	/**
+	 * @brief 次に読み出すフレームの位置（AudioHistory に書き込まれたフレームの通し番号）を返す
+	 */
+	uint64_t position() const { return position_; }
+
+	/**
+	 * @brief 読み出す前に上書きされたため読み飛ばしたフレーム数を返す
+	 */
+	uint64_t lost() const { return lost_; }
+
+private:
+	friend class AudioHistory;
+	AudioHistoryReader(AudioHistory* history, uint64_t position) : history_(history), position_(position), lost_(0) {}
+
+	AudioHistory* history_;
+	uint64_t position_;
+	uint64_t lost_;
+};
+
+/**
+ * @class AudioHistory
+ * @brief 指定したチャネルの直近の音声を、録音時刻とともに保持するリングバッファ
+ * @details Microphone::read() で読み出した 18ch のブロックを write() で与えると、mask_ で指定したチャネルのみを（factor_ > 1 の場合は間引いて）
+ * short のチャネル毎の形式で直近 seconds_ 秒分保持する。保持する位置と録音時刻の対応は、ブロックの録音時刻から約 100ms 毎と不連続の箇所で記録する。
+ * タッチボタン、赤外線信号、音声区間検出等のイベントが起きた際に、別のスレッドからでも open() でイベントの時刻から遡った位置のカーソルを得て、
+ * そこから現在までの履歴と、それに続けて書き込まれる音声を途切れなく読み出すことができる。
+ * 書き込みと読み出しは 1 つの mutex で排他する（読み出しの 1 回あたりのフレーム数だけ書き込みを待たせる）。
+ */
+class DLL_PUBLIC AudioHistory
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] config 設定
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit AudioHistory(const AudioHistoryConfig& config = AudioHistoryConfig());
+
+	/**
+	 * @brief 録音したブロックを書き込む（書き込みは 1 つのスレッドから行うこと）
+	 * @param [in] in 18ch のインターリーブ形式のフレーム（Microphone::read(short* out, ...) の出力）
+	 * @param [in] frames フレーム数
+	 * @param [in] block ブロックの情報（録音時刻と不連続の有無を用いる）
+	 */
+	void write(const short* in, size_t frames, const MicrophoneBlock& block);
+
+	/**
+	 * @brief 指定した録音時刻から読み出すカーソルを返す（任意のスレッドから呼んでよい）
+	 * @details 保持している最も古いフレームより前の時刻の場合は最も古いフレームから、まだ書き込まれていない時刻の場合は次に書き込まれるフレームから読み出す。
+	 * @param [in] timestamp 録音時刻 [microsecond]（monotonicMicroseconds()、ButtonStateEvent::timestamp_、MicrophoneBlock::timestamp_ と同じ時刻）
+	 */
+	AudioHistoryReader open(uint64_t timestamp);
+
+	/**
+	 * @brief 現在から seconds 秒遡った時刻から読み出すカーソルを返す（任意のスレッドから呼んでよい）
+	 */
+	AudioHistoryReader since(float seconds);
+
+	/**
+	 * @brief 書き込まれたフレーム数（通し番号）を返す
+	 */
+	uint64_t written() const;
+
+	/**
+	 * @brief 保持している最も古いフレームの録音時刻 [microsecond] を返す（何も書き込まれていない場合は 0）
+	 */
+	uint64_t oldest() const;
+
+	size_t channels() const { return channels_; }
+	int rate() const { return rate_; }
+	size_t capacity() const { return capacity_; }
+
+	const AudioHistoryConfig& config() const { return config_; }
+
+	static const uint64_t k_record_interval_ = 100000; //!< 位置と録音時刻の対応を記録する間隔 [microsecond]
+
+private:
+	friend class AudioHistoryReader;
+	AudioHistory(const AudioHistory&);
+	AudioHistory &operator=(const AudioHistory&);
+	void append_(short* const* data, size_t frames);
+	void record_(uint64_t position, uint64_t timestamp, bool force);
+	uint64_t positionAt_(uint64_t timestamp) const;
+	uint64_t timestampAt_(uint64_t position) const;
+	uint64_t timestampOf_(uint64_t position) const;
+	size_t read_(AudioHistoryReader& reader, short* out, size_t frames, int timeoutMs);
+
+	/**
+	 * @class Record
+	 * @brief 位置と録音時刻の対応
+	 */
+	class Record
+	{
+	public:
+		uint64_t position_ = 0;   //!< フレームの通し番号
+		uint64_t timestamp_ = 0;  //!< そのフレームの推定録音時刻 [microsecond]
+	};
+
+	AudioHistoryConfig config_;
+	size_t channels_;
+	int rate_;                       //!< 保持する音声のサンプリングレート
+	size_t capacity_;                //!< チャネル毎に保持するフレーム数
+	AlignedBuffer<short> ring_;      //!< チャネル毎の循環バッファ（channels_ x capacity_）
+	std::vector<Record> records_;    //!< 位置と録音時刻の対応の循環バッファ（古い順に records_[(recordCount_ - n) % size]）
+	uint64_t recordCount_;           //!< 記録した対応の数（通し番号）
+	uint64_t written_;               //!< 書き込まれたフレーム数
+	std::unique_ptr<Decimator> decimator_;
+	uint64_t decimatorInput_;        //!< decimator_ を初期化してから与えた入力のフレーム数
+	uint64_t decimatorOutput_;       //!< decimator_ を初期化してから出力したフレーム数
+	AlignedBuffer<short> scratch_;   //!< 間引いた出力の作業領域（channels_ x (k_chunk_ / 2 + 1)）
+	bool discontinuous_;             //!< 不連続の箇所の対応をまだ記録していないか
+	mutable std::mutex mutex_;
+	std::condition_variable writtenCond_; //!< 書き込まれたことを読み出し側に通知する
+
+	static const size_t k_chunk_ = 480; //!< 間引く際に一度に処理する入力のフレーム数
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_AUDIOHISTORY_H_ */
@@ -0,0 +1,164 @@
+/*
+ * @file audiokernels.h
+ * \~english
+ * @brief SIMD kernels for audio sample processing
+ * \~japanese
+ * @brief 音声サンプル処理の SIMD カーネル
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_AUDIOKERNELS_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_AUDIOKERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include "tumbler/tumbler.h"
+
+namespace tumbler{
+
+/**
+ * @class AlignedBuffer
+ * @brief キャッシュライン境界に整列した固定長の領域
+ * @details 周期毎の処理で繰り返し用いる作業領域を、構築時に一度だけ確保するために用いる。
+ * @tparam T 要素型（トリビアルな型であること）
+ */
+template<typename T>
+class AlignedBuffer
+{
+public:
+	/**
+	 * @brief コンストラクタ。領域を確保し 0 で初期化する
+	 * @param [in] size 要素数
+	 */
+	explicit AlignedBuffer(size_t size) : data_(nullptr), size_(size)
+	{
+		void* p = nullptr;
+		if(posix_memalign(&p, k_alignment_, std::max<size_t>(1, size) * sizeof(T)) != 0){
+			throw std::bad_alloc();
+		}
+		data_ = static_cast<T*>(p);
+		std::fill(data_, data_ + size_, T());
+	}
+
+	~AlignedBuffer(){ free(data_); }
+
+	T* data(){ return data_; }
+	const T* data() const { return data_; }
+	size_t size() const { return size_; }
+	T& operator[](size_t i){ return data_[i]; }
+	const T& operator[](size_t i) const { return data_[i]; }
+
+	static const size_t k_alignment_ = 64; //!< 整列境界 [byte]
+
+private:
+	AlignedBuffer(const AlignedBuffer&);
+	AlignedBuffer &operator=(const AlignedBuffer&);
+
+	T* data_;
+	size_t size_;
+};
+
+/**
+ * @brief 音声サンプルの絶対値の最大値を返す
+ * @details -32768 の絶対値は 32767 として扱う。
+ * @param [in] src 音声サンプル
+ * @param [in] n サンプル数
+ */
+DLL_PUBLIC short peakAbsolute(const short* src, size_t n);
+
+/**
+ * @brief 一定のゲインを音声サンプルに乗じ、short の範囲に飽和させる
+ * @param [out] dst 出力先（src と同じでもよい）
+ * @param [in] src 入力の音声サンプル
+ * @param [in] n サンプル数
+ * @param [in] gain ゲイン
+ */
+DLL_PUBLIC void applyGain(short* dst, const short* src, size_t n, float gain);
+
+/**
+ * @brief 2 つのモノラル音声を L/R のインターリーブ形式のステレオ音声にする
+ * @param [out] dst 出力先（2 * n サンプル）
+ * @param [in] left 左チャネルの音声サンプル
+ * @param [in] right 右チャネルの音声サンプル（nullptr の場合は無音）
+ * @param [in] n フレーム数
+ */
+DLL_PUBLIC void interleaveStereo(short* dst, const short* left, const short* right, size_t n);
+
+/**
+ * @brief 音声サンプルを飽和加算する（dst[i] = saturate(dst[i] + src[i])）
+ * @details ビルド対象が NEON（Raspberry Pi）または SSE2 に対応する場合はそれぞれのベクトル命令で処理する。
+ * @param [in,out] dst 加算先
+ * @param [in] src 加算する音声サンプル
+ * @param [in] n サンプル数
+ */
+DLL_PUBLIC void mixSaturate(short* dst, const short* src, size_t n);
+
+/**
+ * @brief 線形に変化するゲインを音声サンプルに乗じる（フェードイン・フェードアウト）
+ * @details i 番目のサンプルには gainBegin + (gainEnd - gainBegin) * i / n を乗じ、short の範囲に飽和させる。gainBegin と gainEnd が等しい場合は applyGain() と同じ。
+ * @param [out] dst 出力先（src と同じでもよい）
+ * @param [in] src 入力の音声サンプル
+ * @param [in] n サンプル数
+ * @param [in] gainBegin 先頭サンプルのゲイン
+ * @param [in] gainEnd 末尾の次のサンプルのゲイン
+ */
+DLL_PUBLIC void applyGainRamp(short* dst, const short* src, size_t n, float gainBegin, float gainEnd);
+
+/**
+ * @brief インターリーブ形式の多チャネル音声から、指定したチャネルをチャネル毎の領域へ取り出す
+ * @details 入力を 1 回だけ走査し、8 フレーム x 8 チャネルの区画毎に転置して書き込む。
+ * ビルド対象が NEON（Raspberry Pi）または SSE2 に対応し、channels が 8 以上の場合はそれぞれのベクトル命令で処理する。
+ * サンプルは値を変えずに写す（ゲインを乗じる場合は float 版を用いる）。
+ * @param [out] dst 出力先の配列。mask で指定したチャネルを番号の小さい順に dst[0], dst[1], ... へ frames サンプルずつ書き込む
+ * @param [in] src インターリーブ形式の音声サンプル（frames * channels サンプル）
+ * @param [in] frames フレーム数
+ * @param [in] channels チャネル数（32 以下）
+ * @param [in] mask 取り出すチャネルのビットマスク（ビット c がチャネル c に対応する。0 始まり）
+ */
+DLL_PUBLIC void deinterleave(short* const* dst, const short* src, size_t frames, size_t channels, uint32_t mask);
+
+/**
+ * @brief インターリーブ形式の多チャネル音声から、指定したチャネルを単精度浮動小数点数に変換してチャネル毎の領域へ取り出す
+ * @details 各サンプルに gain を乗じる（1.0F / 32768 とすると [-1, 1) に正規化される）。その他は short 版の deinterleave() と同じ。
+ * @param [out] dst 出力先の配列。mask で指定したチャネルを番号の小さい順に dst[0], dst[1], ... へ frames サンプルずつ書き込む
+ * @param [in] src インターリーブ形式の音声サンプル（frames * channels サンプル）
+ * @param [in] frames フレーム数
+ * @param [in] channels チャネル数（32 以下）
+ * @param [in] mask 取り出すチャネルのビットマスク（ビット c がチャネル c に対応する。0 始まり）
+ * @param [in] gain ゲイン
+ */
+DLL_PUBLIC void deinterleave(float* const* dst, const short* src, size_t frames, size_t channels, uint32_t mask, float gain);
+
+/**
+ * @brief FIR フィルタの出力を加算する（acc[i] += Σ_k h[k] * x[i - k]）
+ * @details ビルド対象が NEON（Raspberry Pi）または SSE2 に対応する場合は 4 出力ずつそれぞれのベクトル命令で処理する。
+ * @param [in,out] acc 加算先（n 要素）
+ * @param [in] x 入力。x[-(taps - 1)]〜x[n - 1] を参照する
+ * @param [in] n 出力の要素数
+ * @param [in] h フィルタ係数（taps 要素）
+ * @param [in] taps タップ数
+ */
+DLL_PUBLIC void accumulateFir(float* acc, const float* x, size_t n, const float* h, size_t taps);
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_AUDIOKERNELS_H_ */
@@ -0,0 +1,174 @@
+/*
+ * @file beamformer.h
+ * \~english
+ * @brief Delay-and-sum and MVDR beamformer over the 16-microphone array
+ * \~japanese
+ * @brief 16ch マイクアレイによる遅延和・MVDR ビームフォーマー
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_BEAMFORMER_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_BEAMFORMER_H_
+
+#include <complex>
+#include <memory>
+#include <vector>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/microphonearray.h"
+#include "tumbler/stft.h"
+#include "tumbler/decimator.h"
+
+namespace tumbler{
+
+/**
+ * @brief ビームフォーミングの方式
+ */
+enum class BeamformerMethod
+{
+	delayAndSum_, //!< 遅延和（時間領域の非整数遅延 FIR フィルタで各マイクの到達時間差を補償して平均する。処理が軽い）
+	mvdr_         //!< MVDR（周波数領域で、目的方向の利得を 1 に保ったまま出力の電力を最小化する。他方向の雑音、干渉音をより強く抑える）
+};
+
+/**
+ * @class BeamformerConfig
+ * @brief ビームフォーマーの設定
+ */
+class DLL_PUBLIC BeamformerConfig
+{
+public:
+	BeamformerMethod method_ = BeamformerMethod::delayAndSum_; //!< 方式
+	float azimuth_ = 270.0F;        //!< ビームを向ける方位角 [degree]（向かって右が 0 度、正面が 270 度）
+	float elevation_ = 0.0F;        //!< ビームを向ける仰角 [degree]（x-y 平面が 0 度、上が正）
+	int outputRate_ = 48000;        //!< 出力のサンプリングレート（48000、24000、16000、8000 のいずれか）
+	size_t taps_ = 16;              //!< 遅延和：非整数遅延 FIR フィルタのタップ数（偶数）
+	size_t fftSize_ = 512;          //!< MVDR：フレーム長（2 のべき乗。シフト幅はその半分）
+	float smoothing_ = 0.97F;       //!< MVDR：空間相関行列の忘却係数（フレーム毎）
+	float diagonalLoading_ = 0.3F;  //!< MVDR：空間相関行列の対角成分に加える値（対角成分の平均に対する比。小さいほど干渉音を強く抑えるが、方向の僅かなずれで目的音も抑圧される）
+	size_t updateInterval_ = 16;    //!< MVDR：フィルタ係数を更新するフレーム間隔（係数の算出が処理量の大半を占める）
+};
+
+/**
+ * @class Beamformer
+ * @brief 指定した方向にビームを向け、16ch のマイク入力から 1ch の音声を得るビームフォーマー
+ * @details 入力は Microphone::read() でチャネル毎に取り出した 48kHz の float の音声（ゲイン 1、short の値域）とし、マイクアレイの配置に従って
+ * 指定した方向から到来する音声を強調したモノラル音声を、48kHz または Decimator で間引いた 24kHz、16kHz、8kHz の short で出力する。作業領域は構築時に一度だけ確保され、process() はヒープ確保を行わない。
+ * process() と steer() は同じスレッドから呼ぶこと。
+ */
+class DLL_PUBLIC Beamformer
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] array マイクアレイの配置（入力のチャネル数は array.size() となる）
+	 * @param [in] config 設定
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit Beamformer(const MicrophoneArray& array, const BeamformerConfig& config = BeamformerConfig());
+
+	/**
+	 * @brief ビームの方向を変更する
+	 * @param [in] azimuth 方位角 [degree]
+	 * @param [in] elevation 仰角 [degree]
+	 */
+	void steer(float azimuth, float elevation);
+
+	/**
+	 * @brief 入力を処理する
+	 * @param [in] in チャネル毎の入力（array.size() チャネル、各 frames サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @param [out] out 出力先（maxOutput(frames) サンプル以上の領域があること）
+	 * @return 出力したサンプル数（MVDR の場合はシフト幅単位で出力するため、入力のフレーム数とは一致しない）
+	 */
+	size_t process(const float* const* in, size_t frames, short* out);
+
+	/**
+	 * @brief 他の処理と共有する STFT のフレームを処理する（MVDR のみ）
+	 * @details DirectionEstimator 等と同じ StftAnalyzer のフレームを用いることで、チャネル毎の FFT を重複して行わずに済む。
+	 * フレームは array.size() チャネル、フレーム長 fftSize_、シフト幅 fftSize_ / 2、平方根ハン窓（StftWindow::sqrtHann_）であること。
+	 * 入力の全フレームをこの関数か process(in, frames, out) のいずれか一方のみで与えること。
+	 * @param [in] frame STFT のフレーム
+	 * @param [out] out 出力先（maxOutput(fftSize_ / 2) サンプル以上の領域があること）
+	 * @return 出力したサンプル数
+	 * @note MVDR でない場合、フレームの形式が異なる場合は std::invalid_argument 例外が送出される
+	 */
+	size_t process(const StftFrame& frame, short* out);
+
+	/**
+	 * @brief frames フレームの入力に対して出力され得る最大のサンプル数を返す
+	 */
+	size_t maxOutput(size_t frames) const;
+
+	/**
+	 * @brief 内部状態（入力の履歴、MVDR の空間相関行列）を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief 入力に対する出力の遅延 [48kHz のサンプル数] を返す（48kHz 以外で出力する場合の Decimator の遅延は含まない）
+	 */
+	float latency() const;
+
+	const BeamformerConfig& config() const { return config_; }
+
+	static const int k_rate_ = 48000;    //!< 入力のサンプリングレート
+	static const size_t k_block_ = 256;  //!< 遅延和：内部で一度に処理するフレーム数
+
+private:
+	Beamformer(const Beamformer&);
+	Beamformer &operator=(const Beamformer&);
+	void delayAndSum_(const float* const* in, size_t offset, size_t frames, float* out);
+	void mvdrFrame_(const StftFrame& frame, float* out);
+	void updateWeights_();
+	size_t emit_(const float* data, size_t n, short* out);
+
+	MicrophoneArray array_;
+	BeamformerConfig config_;
+	size_t channels_;
+	float offset_;                   //!< 全マイクの遅延を非負とするために加える遅延 [サンプル]
+
+	// 遅延和
+	size_t history_;                 //!< チャネル毎に保持する過去の入力のサンプル数
+	AlignedBuffer<float> buffer_;    //!< チャネル毎の入力の履歴と今回の入力（channels_ x (history_ + k_block_)）
+	AlignedBuffer<float> taps_;      //!< チャネル毎の非整数遅延フィルタ係数（channels_ x config_.taps_）
+	std::vector<size_t> delays_;     //!< チャネル毎の整数遅延 [サンプル]
+	AlignedBuffer<float> mixed_;     //!< 出力（k_block_ または fftSize_ サンプル）
+
+	// MVDR
+	std::unique_ptr<StftAnalyzer> analyzer_;
+	std::unique_ptr<StftSynthesizer> synthesizer_;
+	size_t hop_;
+	size_t bins_;                    //!< 処理する周波数ビンの数（出力のナイキスト周波数まで）
+	AlignedBuffer<float> outputRe_;  //!< 出力のスペクトルの実部（fftSize_ / 2 + 1）
+	AlignedBuffer<float> outputIm_;  //!< 同虚部
+	std::vector<std::complex<float> > spectra_;    //!< チャネル毎のスペクトル（channels_ x bins_）
+	std::vector<std::complex<float> > covariance_; //!< 周波数ビン毎の空間相関行列（bins_ x channels_ x channels_ の上三角）
+	std::vector<std::complex<float> > steering_;   //!< 周波数ビン毎のステアリングベクトル（bins_ x channels_）
+	std::vector<std::complex<float> > weights_;    //!< 周波数ビン毎のフィルタ係数（bins_ x channels_）
+	std::vector<std::complex<float> > cholesky_;   //!< フィルタ係数を求める際の作業領域（channels_ x channels_）
+	size_t framesSinceUpdate_;
+	size_t observed_;                //!< 空間相関行列に加えたフレーム数
+
+	// 48kHz 以外への変換
+	std::unique_ptr<Decimator> decimator_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_BEAMFORMER_H_ */
@@ -0,0 +1,145 @@
+/*
+ * @file buttondetector.h
+ * \~english
+ * @brief Touch button detection algorithm independent of the serial I/O loop
+ * \~japanese
+ * @brief 通信処理から独立したタッチボタン検出アルゴリズム
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_BUTTONDETECTOR_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_BUTTONDETECTOR_H_
+
+#include "tumbler/tumbler.h"
+#include "tumbler/buttons.h"
+
+namespace tumbler{
+
+/**
+ * @class ButtonDetector
+ * @brief 4 つのタッチボタンの生計測値の系列からボタンステートを判定するクラス
+ * @details ベースライン追跡、増分閾値による判定、マルチタッチ制御、LED リングによる干渉の補償、コールバック要否の決定までを行う。
+ * 通信や時刻取得を一切行わない純粋な処理であるため、記録された計測値の系列を実時間より高速に再生して評価することができる。
+ * Buttons クラスはこのクラスを計測スレッドで利用している。
+ */
+class DLL_PUBLIC ButtonDetector
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] config タッチボタン検出の設定
+	 */
+	explicit ButtonDetector(const ButtonDetectionConfig& config);
+
+	/**
+	 * @brief 内部状態を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief 1 計測分の生計測値を処理する
+	 * @param [in] values 4 つのタッチボタンの生計測値
+	 * @param [in] led 計測時点の LED リングの点灯状態
+	 * @param [in] timestamp 計測時刻 [microsecond]
+	 * @param [out] event 判定結果（返り値が true の場合のみ有効）
+	 * @return コールバック関数を呼ぶ必要がある場合 true
+	 */
+	bool process(const uint8_t values[4], const LEDRingBrightness& led, uint64_t timestamp, ButtonStateEvent& event);
+
+	/**
+	 * @brief 直前の process() が LED リング変化後の無判定区間であったかを返す
+	 * @details LED リング干渉モデルの学習が完了するまでは、LED リングの変化後 k_ledring_blanking_us_ の間は判定を行わない
+	 */
+	bool blanking() const { return blanking_; }
+
+	/**
+	 * @brief LED リング干渉モデルの学習が完了し、LED リング変化時も判定を行う状態であるかを返す
+	 */
+	bool ledCompensationReady() const;
+
+	/**
+	 * @brief 直前の process() で予測した LED リングによる計測値のオフセットを返す
+	 * @param [in] index ボタン番号 [0,3]
+	 */
+	float ledOffset(int index) const { return ledOffset_[index]; }
+
+	/**
+	 * @brief 操作中であるか（押下中、閾値近傍の補正済計測値、LED リング変化のいずれかがある）を返す
+	 */
+	bool active() const { return active_; }
+
+	/**
+	 * @brief 現在の押下判定の増分閾値を返す
+	 * @param [in] index ボタン番号 [0,3]
+	 */
+	int threshold(int index) const;
+
+	/**
+	 * @brief 非接触時の補正済計測値（ベースライン更新前の差分）の標準偏差の推定値を返す
+	 * @param [in] index ボタン番号 [0,3]
+	 */
+	float noiseSigma(int index) const;
+
+	/**
+	 * @brief 非接触時の補正済計測値の平均の推定値を返す
+	 * @param [in] index ボタン番号 [0,3]
+	 */
+	float noiseMean(int index) const { return noiseMean_[index]; }
+
+	static const int k_default_threshold_ = 30;        //!< 増分閾値の既定値
+	static const int k_noise_warmup_samples_ = 25;     //!< ノイズ推定を開始するまでの計測数（ベースラインの収束待ち）
+	static const int k_noise_init_samples_ = 25;       //!< 閾値の自動決定を開始するまでにノイズ推定に用いる計測数
+	static const uint64_t k_ledring_blanking_us_ = 300000; //!< LED リング変化後の無判定区間（干渉モデルの学習完了前のみ） [microsecond]
+	static const uint64_t k_baseline_time_constant_us_ = 28854; //!< ベースライン追跡の時定数（操作中の 20ms 周期で係数 0.5 となる 20ms / ln2） [microsecond]
+	static const int k_ledmodel_min_updates_ = 8;      //!< 干渉モデルの学習完了とみなすまでに必要な LED リング変化の観測数
+
+private:
+	bool adaptiveThresholdActive_() const;
+	bool pushedByThreshold_(int index, int corrected, bool pushed) const;
+	void updateNoiseEstimate_(const int corrected[4]);
+	void predictLEDOffset_(const LEDRingBrightness& led);
+	void updateLEDModel_(const float error[4], const float diff[LEDRingBrightness::k_num_segments_], float norm);
+
+	ButtonDetectionConfig config_;
+	ButtonState prevState_[4];
+	ButtonState currState_[4];
+	int baseline_[4];
+	int fixedThreshold_[4];
+	bool firstProcess_;
+	bool active_;
+	bool blanking_;
+	// LED リング干渉モデル：計測値のオフセット = Σ ledWeights_[i][s] * セグメント s の平均輝度
+	float ledWeights_[4][LEDRingBrightness::k_num_segments_];
+	float ledOffset_[4];
+	float ledModelError_[4]; //!< LED リング変化時の予測誤差の絶対値の指数移動平均
+	int ledModelUpdates_;
+	bool ledModelReady_;
+	float ledSegments_[LEDRingBrightness::k_num_segments_]; //!< 前回計測時の LED リングの点灯状態
+	uint32_t ledSequence_;
+	bool ledChangeObserved_;
+	uint64_t ledChangeTime_;
+	uint64_t lastTimestamp_; //!< 前回の process() の計測時刻
+	float noiseMean_[4];
+	float noiseVar_[4];
+	int noiseSamples_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_BUTTONDETECTOR_H_ */
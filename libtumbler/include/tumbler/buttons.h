@@ -27,10 +27,13 @@
 #define LIBTUMBLER_INCLUDE_TUMBLER_BUTTONS_H_
 
 #include "tumbler/tumbler.h"
+#include "tumbler/ringbuffer.h"
 
 #include <memory>
 #include <future>
 #include <vector>
+#include <functional>
+#include <semaphore.h>
 
 namespace tumbler
 {
@@ -58,6 +61,16 @@ public:
 	std::vector<int> corrValues_; //!< ベースライン補正値を減算した各タッチボタンの補正済計測値
 };
 
+/**
+ * @class ButtonEventOverflowPolicy
+ * @brief イベントキューが満杯のときの挙動
+ */
+enum class DLL_PUBLIC ButtonEventOverflowPolicy
+{
+	coalesce_,      //!< 未配送イベントをセンシングスレッド側で 1 つに統合して保持し、キューに空きができ次第配送する（released_ ステートは失われない）
+	discardNewest_, //!< 新しいイベントを破棄する
+};
+
 /**
  * @class ButtonDetectionConfig
  * @brief タッチボタン検出の設定
@@ -68,10 +81,77 @@ public:
 	bool multiTouchDetectionEnabled_ = true; //!< マルチタッチを有効にする（マルチタッチ無効の場合は、先に押されたボタンのみ有効。完全同時に押された場合は、より強く押された方のみ有効となる）
 	bool manualThreshold_ = false; //!< 補正済計測値からの増分閾値を以下に指定する指定値にする
 	int manualThresholdValues_[4]; //!< 増分閾値の指定
+	size_t eventQueueCapacity_ = 32; //!< センシングスレッドからコールバック配送スレッドへのイベントキュー長
+	ButtonEventOverflowPolicy overflowPolicy_ = ButtonEventOverflowPolicy::coalesce_; //!< イベントキューが満杯のときの挙動
+	int fastPollingIntervalMs_ = 20;  //!< 操作中（押下中、もしくは補正済計測値が閾値近傍にあるとき）の計測周期 [ms]
+	int slowPollingIntervalMs_ = 250; //!< 無操作時の計測周期 [ms]（fastPollingIntervalMs_ と同じ値にすると固定周期となる）
+	int fastPollingHoldMs_ = 2000;    //!< 最後に操作が検出されてから無操作時の計測周期に戻るまでの時間 [ms]
+	float nearThresholdRatio_ = 0.5F; //!< 補正済計測値が増分閾値のこの割合を超えたとき、閾値近傍にあるとみなす
+	bool adaptiveThreshold_ = false;  //!< 非接触時の補正済計測値のノイズ推定から増分閾値を各ボタン別に自動決定する（manualThreshold_ が true の場合は無効）
+	float adaptiveThresholdSigma_ = 6.0F; //!< 自動決定時の増分閾値（ノイズ平均 + 標準偏差のこの倍数）
+	int adaptiveThresholdMin_ = 12;   //!< 自動決定時の増分閾値の下限
+	int adaptiveThresholdMax_ = 60;   //!< 自動決定時の増分閾値の上限（ノイズ推定が揃うまではこの値を用いる）
+	float adaptiveReleaseRatio_ = 0.6F; //!< 自動決定時、押下中のボタンが離されたと判定する閾値の増分閾値に対する割合（ヒステリシス）
+	float noiseEstimationRate_ = 0.02F; //!< ノイズ推定の指数重み付き平均・分散の更新係数
+	bool ledInterferenceCompensation_ = true; //!< LED リングの点灯状態から各ボタンの計測値のオフセットを学習・予測して減算し、LED リング変化時も判定を継続する（false の場合は従来通り変化後の一定時間を無判定区間とする）
+	float ledCompensationRate_ = 0.5F; //!< LED リング干渉モデルの学習係数（正規化 LMS のステップサイズ、(0,1]）
+};
+
+/**
+ * @class ButtonStateEvent
+ * @brief 1 回分のボタンイベント（4 つのタッチボタンの状態と計測値）
+ * @details ヒープ確保を伴わない固定長の型であり、センシングスレッドからコールバック配送スレッドへロックフリーキューで受け渡された後、
+ * ButtonEventHandler へそのまま const 参照で渡される。イベントの発生からハンドラの呼び出しまで、ヒープ確保は一切発生しない。
+ */
+class DLL_PUBLIC ButtonStateEvent
+{
+public:
+	ButtonState states_[4];  //!< 各タッチボタンの状態
+	int baselines_[4];       //!< 各タッチボタンのベースライン補正値（非接触状態の測定値）
+	int corrValues_[4];      //!< ベースライン補正値を減算した各タッチボタンの補正済計測値
+	uint64_t timestamp_;     //!< 計測時刻（monotonicMicroseconds() による単調増加時刻 [microsecond]）
+};
+
+/**
+ * @class ButtonMonitorStats
+ * @brief ボタン監視の統計情報
+ */
+class DLL_PUBLIC ButtonMonitorStats
+{
+public:
+	uint64_t cycles_ = 0;          //!< センシング周回数
+	uint64_t events_ = 0;          //!< キューに投入されたイベント数
+	uint64_t dispatched_ = 0;      //!< コールバック配送済のイベント数
+	uint64_t droppedEvents_ = 0;   //!< キュー満杯により破棄されたイベント数
+	uint64_t coalescedEvents_ = 0; //!< キュー満杯により統合されたイベント数
+	uint64_t fastCycles_ = 0;      //!< 操作中の計測周期で計測した周回数
+	uint64_t slowCycles_ = 0;      //!< 無操作時の計測周期で計測した周回数
+	int currentIntervalMs_ = 0;    //!< 現在の計測周期の設定値 [ms]
+	float averageIntervalMs_ = 0;  //!< 実測した計測周期の指数移動平均 [ms]
+	int thresholds_[4] = {0,0,0,0};  //!< 各タッチボタンの現在の増分閾値
+	float noiseSigma_[4] = {0,0,0,0}; //!< 各タッチボタンの非接触時の補正済計測値の標準偏差の推定値
+	uint64_t ledBlankedCycles_ = 0; //!< LED リング変化による無判定区間として判定を行わなかった周回数
+	bool ledCompensationReady_ = false; //!< LED リング干渉モデルの学習が完了し、LED リング変化時も判定を行っている
 };
 
 using ButtonStateCallback = void (*)(std::vector<ButtonState>, ButtonInfo, void*);
 
+/**
+ * @brief タッチボタンのイベントを受け取るハンドラ
+ * @details Buttons::subscribe() により複数登録することができる。ハンドラはセンシングスレッドとは独立したコールバック配送スレッドから逐次呼び出されるため、
+ * ハンドラの処理に時間がかかってもセンシング周期やベースライン追跡には影響しない。
+ */
+using ButtonStateHandler = std::function<void(const std::vector<ButtonState>&, const ButtonInfo&)>;
+
+/**
+ * @brief タッチボタンのイベントを固定長のイベント型で受け取るハンドラ
+ * @details ButtonStateHandler と異なり、std::vector や ButtonInfo への変換を伴わないため、イベント毎のヒープ確保が発生しない。
+ * 高頻度のポーリングや多数のハンドラを登録する場合はこちらを推奨する。
+ */
+using ButtonEventHandler = std::function<void(const ButtonStateEvent&)>;
+
+class ButtonTraceWriter;
+
 /**
  * @class Buttons
  * @brief ４つのタッチボタンを表すクラス
@@ -79,24 +159,107 @@ using ButtonStateCallback = void (*)(std::vector<ButtonState>, ButtonInfo, void*
 class DLL_PUBLIC Buttons
 {
 public:
+	/**
+	 * @brief シングルトンインスタンスを取得する
+	 * @note 全てのオーバーロードは同一のインスタンスを返す。コールバック関数及び設定は最初に取得されたときのものが有効となる。
+	 * コールバック関数を後から追加したい場合は subscribe() を利用する。
+	 */
 	static Buttons& getInstance(ButtonStateCallback func, void* userdata);
 	static Buttons& getInstance(ButtonStateCallback func, const ButtonDetectionConfig &config, void* userdata);
+	static Buttons& getInstance();
+	static Buttons& getInstance(const ButtonDetectionConfig &config);
 
 	void start();
 	void stop();
 
+	/**
+	 * @brief イベントハンドラを登録する
+	 * @param [in] handler ハンドラ
+	 * @return 登録 ID（unsubscribe() に利用する）
+	 */
+	int subscribe(ButtonStateHandler handler);
+
+	/**
+	 * @brief イベントハンドラを登録する（固定長イベント型を const 参照で受け取る）
+	 * @param [in] handler ハンドラ
+	 * @return 登録 ID（unsubscribe() に利用する）
+	 */
+	int subscribe(ButtonEventHandler handler);
+
+	/**
+	 * @brief イベントハンドラの登録を解除する
+	 * @param [in] id subscribe() が返した登録 ID
+	 */
+	void unsubscribe(int id);
+
+	/**
+	 * @brief ボタン監視の統計情報を取得する
+	 * @return 統計情報
+	 */
+	ButtonMonitorStats stats() const;
+
+	/**
+	 * @brief 計測毎の生計測値、LED リングの点灯状態及び計測時刻のトレースファイルへの記録を開始する
+	 * @details 記録したトレースは loadButtonTrace() で読み込み、replayButtonTrace() で検出アルゴリズムをオフライン評価することができる（buttontrace.h）。
+	 * 既に記録中の場合は、記録中のファイルを閉じて新しいファイルへの記録を開始する。
+	 * @param [in] path 記録先のファイルパス
+	 * @note ファイルを開けなかった場合は std::runtime_error 例外が送出される
+	 */
+	void startTrace(const std::string& path);
+
+	/**
+	 * @brief トレースの記録を終了しファイルを閉じる
+	 */
+	void stopTrace();
+
 private:
-	Buttons(ButtonStateCallback, void*);
+	class Handler
+	{
+	public:
+		int id_ = 0;
+		ButtonStateHandler stateHandler_;
+		ButtonEventHandler eventHandler_;
+	};
+	using HandlerList = std::vector<Handler>;
+
 	Buttons(ButtonStateCallback, const ButtonDetectionConfig&, void*);
+	~Buttons();
 	Buttons(const Buttons&);
 	Buttons &operator=(const Buttons&);
+	int monitorImpl_();
+	void dispatchImpl_();
+	void enqueue_(const ButtonStateEvent& event);
+	bool flushPending_();
+	int subscribe_(Handler handler);
 	ArduinoSubsystem& subsystem_;
-	ButtonStateCallback callback_;
 	bool status_;
 	ButtonDetectionConfig config_;
 	std::future<int> monitor_;
+	std::future<void> dispatcher_;
 	std::atomic<bool> stopflag_;
-	void* userdata_;
+	std::atomic<bool> dispatchStopflag_;
+	RingBuffer<ButtonStateEvent> queue_;
+	sem_t queueSem_;
+	ButtonStateEvent pending_;
+	bool hasPending_;
+	std::mutex handlersMutex_;
+	std::shared_ptr<const HandlerList> handlers_;
+	int nextHandlerId_;
+	std::atomic<uint64_t> cycles_;
+	std::atomic<uint64_t> events_;
+	std::atomic<uint64_t> dispatched_;
+	std::atomic<uint64_t> droppedEvents_;
+	std::atomic<uint64_t> coalescedEvents_;
+	std::atomic<uint64_t> fastCycles_;
+	std::atomic<uint64_t> slowCycles_;
+	std::atomic<int> currentIntervalMs_;
+	std::atomic<uint32_t> averageIntervalUs_;
+	std::atomic<int> thresholds_[4];
+	std::atomic<float> noiseSigma_[4];
+	std::atomic<uint64_t> ledBlankedCycles_;
+	std::atomic<bool> ledCompensationReady_;
+	std::mutex traceMutex_;
+	std::unique_ptr<ButtonTraceWriter> trace_;
 };
 
 }
@@ -0,0 +1,156 @@
+/*
+ * @file buttontrace.h
+ * \~english
+ * @brief Recording and offline replay of touch button sensor traces
+ * \~japanese
+ * @brief タッチボタンの計測値系列（トレース）の記録と、オフライン再生による検出性能評価
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_BUTTONTRACE_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_BUTTONTRACE_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "tumbler/tumbler.h"
+#include "tumbler/buttons.h"
+
+namespace tumbler{
+
+/**
+ * @class ButtonTraceRecord
+ * @brief 1 計測分のトレース（生計測値、計測時点の LED リングの点灯状態、計測時刻）
+ */
+class DLL_PUBLIC ButtonTraceRecord
+{
+public:
+	uint64_t timestamp_;    //!< 計測時刻 [microsecond]
+	uint8_t values_[4];     //!< 4 つのタッチボタンの生計測値
+	LEDRingBrightness led_; //!< 計測時点の LED リングの点灯状態
+};
+
+/**
+ * @class ButtonPressLabel
+ * @brief 正解の押下区間（評価用ラベル）
+ */
+class DLL_PUBLIC ButtonPressLabel
+{
+public:
+	int pad_;        //!< ボタン番号 [0,3]
+	uint64_t begin_; //!< 押下の開始時刻 [microsecond]
+	uint64_t end_;   //!< 押下の終了時刻 [microsecond]
+};
+
+/**
+ * @class ButtonTraceWriter
+ * @brief トレースをバイナリファイルへ書き出すクラス
+ * @details ファイルは 12 byte のヘッダ（"TBTR"、版番号、1 レコードの byte 数）に続き、固定長のレコードが計測順に並ぶ。
+ * 書き込みは標準入出力ライブラリでバッファリングされるため、センシングスレッドから毎周期呼び出しても計測周期を律速しない。
+ */
+class DLL_PUBLIC ButtonTraceWriter
+{
+public:
+	ButtonTraceWriter() : fp_(nullptr) {}
+	~ButtonTraceWriter(){ close(); }
+
+	/**
+	 * @brief ファイルを開きヘッダを書き込む
+	 * @param [in] path 書き出し先のファイルパス
+	 * @note 開けなかった場合は std::runtime_error 例外が送出される
+	 */
+	void open(const std::string& path);
+
+	/**
+	 * @brief 1 計測分のレコードを書き込む
+	 * @param [in] record レコード
+	 */
+	void write(const ButtonTraceRecord& record);
+
+	/**
+	 * @brief ファイルを閉じる
+	 */
+	void close();
+
+	/**
+	 * @brief ファイルを開いているかを返す
+	 */
+	bool isOpen() const { return fp_ != nullptr; }
+
+	static const uint32_t k_version_ = 1;      //!< ファイル形式の版番号
+	static const uint32_t k_record_size_ = 41; //!< 1 レコードの byte 数
+
+private:
+	ButtonTraceWriter(const ButtonTraceWriter&);
+	ButtonTraceWriter &operator=(const ButtonTraceWriter&);
+	FILE* fp_;
+};
+
+/**
+ * @brief ButtonTraceWriter で書き出したトレースを読み込む
+ * @param [in] path トレースのファイルパス
+ * @return 計測順のレコード列
+ * @note 読み込めなかった場合、形式が異なる場合は std::runtime_error 例外が送出される
+ */
+DLL_PUBLIC std::vector<ButtonTraceRecord> loadButtonTrace(const std::string& path);
+
+/**
+ * @brief 正解の押下区間を記したテキストファイルを読み込む
+ * @details 1 行につき 1 つの押下区間を「ボタン番号 開始時刻 終了時刻」（時刻はトレースと同じ microsecond 単位）の形式で記す。# 以降はコメントとする。
+ * @param [in] path ラベルのファイルパス
+ * @return 押下区間の列
+ * @note 読み込めなかった場合、形式が異なる場合は std::runtime_error 例外が送出される
+ */
+DLL_PUBLIC std::vector<ButtonPressLabel> loadButtonPressLabels(const std::string& path);
+
+/**
+ * @class ButtonDetectionReport
+ * @brief トレースの再生による検出性能の評価結果
+ */
+class DLL_PUBLIC ButtonDetectionReport
+{
+public:
+	uint64_t samples_ = 0;       //!< 再生した計測数
+	int presses_ = 0;            //!< 検出された押下（pushed_ ステートの開始）の数
+	int labelled_ = 0;           //!< 正解の押下区間の数
+	int detected_ = 0;           //!< 正解の押下区間のうち検出された数
+	int missed_ = 0;             //!< 正解の押下区間のうち検出されなかった数
+	int falsePresses_ = 0;       //!< 正解の押下区間に対応しない押下の数（ラベルがない場合は 0）
+	double meanLatencyMs_ = 0;   //!< 押下の開始から検出までの平均時間 [ms]
+	double maxLatencyMs_ = 0;    //!< 押下の開始から検出までの最大時間 [ms]
+	double nsPerSample_ = 0;     //!< 1 計測あたりの検出処理の CPU 時間 [nanosecond]
+
+	static const uint64_t k_label_tolerance_us_ = 200000; //!< 押下区間の終了後、その押下区間に対応する押下とみなす時間 [microsecond]
+};
+
+/**
+ * @brief トレースを ButtonDetector で実時間より高速に再生し、検出性能を評価する
+ * @details 押下区間の終了後 ButtonDetectionReport::k_label_tolerance_us_ 以内に検出された押下は、その押下区間に対応するものとして誤検出としない。
+ * CPU 時間は、評価処理を含まない検出処理のみの再生を別途行って計測する。
+ * @param [in] trace トレース
+ * @param [in] labels 正解の押下区間（空の場合は押下数と CPU 時間のみを評価する）
+ * @param [in] config タッチボタン検出の設定
+ * @return 評価結果
+ */
+DLL_PUBLIC ButtonDetectionReport replayButtonTrace(const std::vector<ButtonTraceRecord>& trace, const std::vector<ButtonPressLabel>& labels,
+		const ButtonDetectionConfig& config);
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_BUTTONTRACE_H_ */
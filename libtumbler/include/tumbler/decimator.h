@@ -0,0 +1,121 @@
+/*
+ * @file decimator.h
+ * \~english
+ * @brief Integer-factor polyphase decimator for feeding 48kHz capture to speech recognition
+ * \~japanese
+ * @brief 48kHz の録音を音声認識等に与えるための整数比のポリフェーズ・デシメーター
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_DECIMATOR_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_DECIMATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+
+namespace tumbler{
+
+/**
+ * @class Decimator
+ * @brief 整数比 1/factor（2:1、3:1、6:1）のポリフェーズ・デシメーター
+ * @details 48kHz の入力を 24kHz、16kHz、8kHz に変換する。エイリアシングを防ぐ低域通過フィルタ（カイザー窓をかけた sinc 関数、
+ * 阻止域減衰 約 80dB、タップ数 64 * factor、阻止域端は出力のナイキスト周波数）は変換比毎にコンパイル時に設計した係数表を用いる。
+ * フィルタを factor 個の位相に分け、入力を位相毎の系列に振り分けながら、出力するサンプルのみを accumulateFir()（NEON/SSE2）で求める。
+ * インターリーブ形式の入力からは、指定したチャネルを位相毎の系列へ直接振り分けるため、チャネル毎に分けた 48kHz の中間データを作らない。
+ * 作業領域は構築時に一度だけ確保され、process() はヒープ確保を行わない。入力は任意の長さに分割して逐次与えることができ、分割の仕方によらず同じ出力が得られる。
+ */
+class DLL_PUBLIC Decimator
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] channels チャネル数（1 以上 32 以下）
+	 * @param [in] factor 変換比（2、3、6 のいずれか）
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit Decimator(size_t channels, int factor = 3);
+
+	/**
+	 * @brief インターリーブ形式の入力から、指定したチャネルを変換する
+	 * @details Microphone のリングバッファ上のフレームを、コピーせずに与えることを想定する（Microphone::read(Decimator&, ...)）。
+	 * @param [in] in インターリーブ形式の音声サンプル（frames * stride サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @param [in] stride 1 フレームのチャネル数（32 以下）
+	 * @param [in] mask 変換するチャネルのビットマスク（ビット c がチャネル c に対応する。立っているビットの数は channels() と等しいこと）
+	 * @param [out] out チャネル毎の出力先（mask で指定したチャネルの番号の小さい順。各 maxOutput(frames) サンプル以上の領域があること）
+	 * @return チャネル毎に出力したサンプル数
+	 */
+	size_t process(const short* in, size_t frames, size_t stride, uint32_t mask, short* const* out);
+
+	/**
+	 * @brief チャネル毎の入力を変換する
+	 * @param [in] in チャネル毎の入力（channels() チャネル、各 frames サンプル、short の値域の float）
+	 * @param [in] frames 入力のフレーム数
+	 * @param [out] out チャネル毎の出力先（各 maxOutput(frames) サンプル以上の領域があること）
+	 * @return チャネル毎に出力したサンプル数
+	 */
+	size_t process(const float* const* in, size_t frames, short* const* out);
+
+	/**
+	 * @brief frames フレームの入力に対して出力され得る最大のサンプル数を返す
+	 */
+	size_t maxOutput(size_t frames) const { return frames / factor_ + 1; }
+
+	/**
+	 * @brief 入力の履歴を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief 入力に対する出力の遅延 [入力のサンプル] を返す
+	 * @details 出力の n 番目のサンプルは、入力の (n + 1) * factor - 1 番目のサンプルまでから求められ、入力の (n + 1) * factor - 1 - delay() 番目のサンプルに対応する。
+	 */
+	float delay() const { return (taps() - 1) / 2.0F; }
+
+	size_t channels() const { return channels_; }
+	int factor() const { return factor_; }
+	int taps() const { return factor_ * k_taps_per_phase_; }
+	int outputRate() const { return k_rate_ / factor_; }
+
+	static const int k_rate_ = 48000;          //!< 入力のサンプリングレート
+	static const int k_taps_per_phase_ = 64;   //!< 位相毎のタップ数
+	static const size_t k_block_ = 256;        //!< 内部で一度に求める出力のサンプル数
+
+private:
+	Decimator(const Decimator&);
+	Decimator &operator=(const Decimator&);
+	template<typename Sample>
+	size_t process_(const Sample* const* in, size_t step, size_t frames, short* const* out);
+	void filter_(short* const* out, size_t offset);
+
+	size_t channels_;
+	int factor_;
+	size_t stride_;                  //!< 位相毎の系列の長さ（k_taps_per_phase_ + k_block_）
+	AlignedBuffer<float> coefs_;     //!< 位相毎のフィルタ係数（factor_ x k_taps_per_phase_）
+	AlignedBuffer<float> phases_;    //!< チャネル毎、位相毎の入力の系列（channels_ x factor_ x stride_。先頭の k_taps_per_phase_ - 1 サンプルは直前の入力）
+	AlignedBuffer<float> acc_;       //!< 出力の作業領域（k_block_）
+	int pending_;                    //!< 今回の出力サンプル分として振り分けた入力のサンプル数 [0, factor_)
+	size_t filled_;                  //!< 位相毎の系列に揃った出力サンプル分の数 [0, k_block_]
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_DECIMATOR_H_ */
@@ -0,0 +1,162 @@
+/*
+ * @file directionestimator.h
+ * \~english
+ * @brief SRP-PHAT direction-of-arrival estimator over the 16-microphone array
+ * \~japanese
+ * @brief 16ch マイクアレイによる SRP-PHAT 音源方向推定器
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_DIRECTIONESTIMATOR_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_DIRECTIONESTIMATOR_H_
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/microphonearray.h"
+#include "tumbler/stft.h"
+
+namespace tumbler{
+
+class AzimuthDisplay;
+
+/**
+ * @class DirectionEstimatorConfig
+ * @brief 音源方向推定器の設定
+ */
+class DLL_PUBLIC DirectionEstimatorConfig
+{
+public:
+	size_t fftSize_ = 1024;            //!< 分析フレーム長（2 のべき乗）
+	size_t hop_ = 960;                 //!< 推定の間隔 [サンプル]（fftSize_ 以下。960 で 50Hz、480 で 100Hz）
+	float minFrequency_ = 300.0F;      //!< 用いる周波数帯域の下限 [Hz]
+	float maxFrequency_ = 3500.0F;     //!< 用いる周波数帯域の上限 [Hz]
+	float azimuthStep_ = 5.0F;         //!< 探索する方位角の間隔 [degree]
+	std::vector<float> elevations_ = {0.0F, 30.0F}; //!< 探索する仰角 [degree]
+	float smoothing_ = 0.6F;           //!< 推定毎の空間スペクトルの平滑化係数 [0,1)（大きいほど安定するが追従が遅れる）
+	float minLevel_ = 100.0F;          //!< 推定を行う最小の入力レベル（全チャネルの RMS、short の値域）
+};
+
+/**
+ * @class DirectionEstimate
+ * @brief 音源方向の推定値
+ */
+class DLL_PUBLIC DirectionEstimate
+{
+public:
+	float azimuth_ = 0;     //!< 方位角 [degree]（向かって右が 0 度、正面が 270 度。[0,360)）
+	float elevation_ = 0;   //!< 仰角 [degree]（探索した仰角のいずれか）
+	float confidence_ = 0; //!< 信頼度 [0,1]（到来方向に揃えたチャネル間の位相の一致度。単一の平面波で 1、無相関な雑音で 0 に近い。入力レベルが小さい場合は 0）
+	uint64_t frame_ = 0;    //!< 推定に用いたフレームの末尾の、入力の先頭からの通し番号
+};
+
+/**
+ * @class DirectionEstimator
+ * @brief SRP-PHAT（位相変換で重み付けした相互相関 GCC-PHAT を全マイク対で足し合わせた、方向毎の応答）による音源方向推定器
+ * @details 入力は Microphone::read() でチャネル毎に取り出した 48kHz の float の音声とし、hop_ サンプル毎に直近 fftSize_ サンプルから 1 つの推定値を求める。
+ * 探索する方向の格子に対する各マイクのステアリングベクトルは構築時に一度だけ求めて保持し、FFT の作業領域も使い回すため、process() はヒープ確保を行わない。
+ * setDisplay() で AzimuthDisplay を与えると、推定値毎にその表示を更新する。
+ */
+class DLL_PUBLIC DirectionEstimator
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] array マイクアレイの配置（入力のチャネル数は array.size() となる）
+	 * @param [in] config 設定
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit DirectionEstimator(const MicrophoneArray& array, const DirectionEstimatorConfig& config = DirectionEstimatorConfig());
+
+	/**
+	 * @brief 入力を処理する
+	 * @param [in] in チャネル毎の入力（array.size() チャネル、各 frames サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @return この呼び出しで得られた推定値の数（入力レベルが小さく推定しなかったものを含む）
+	 */
+	size_t process(const float* const* in, size_t frames);
+
+	/**
+	 * @brief 他の処理と共有する STFT のフレームを処理する
+	 * @details Beamformer 等と同じ StftAnalyzer のフレームを用いることで、チャネル毎の FFT を重複して行わずに済む。
+	 * フレームは array.size() チャネル、フレーム長 fftSize_ であること（窓関数は問わない）。入力の先頭から fftSize_ サンプル以上で、
+	 * 直前の推定から hop_ サンプル以上進んだフレームでのみ推定するため、フレームのシフト幅が hop_ より短い場合は間引かれる。
+	 * 入力の全フレームをこの関数か process(in, frames) のいずれか一方のみで与えること。
+	 * @param [in] frame STFT のフレーム
+	 * @return 推定を行った場合は true（入力レベルが小さく推定しなかった場合を含む）
+	 * @note フレームの形式が異なる場合は std::invalid_argument 例外が送出される
+	 */
+	bool process(const StftFrame& frame);
+
+	/**
+	 * @brief 最新の推定値を返す
+	 */
+	const DirectionEstimate& estimate() const { return estimate_; }
+
+	/**
+	 * @brief 推定値毎に表示を更新する AzimuthDisplay を設定する
+	 * @param [in] display 表示（nullptr の場合は表示しない。DirectionEstimator より後に破棄すること）
+	 */
+	void setDisplay(AzimuthDisplay* display){ display_ = display; }
+
+	/**
+	 * @brief 内部状態を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief 探索する方向の数を返す
+	 */
+	size_t directions() const { return azimuths_.size(); }
+
+	const DirectionEstimatorConfig& config() const { return config_; }
+
+	static const int k_rate_ = 48000; //!< 入力のサンプリングレート
+
+private:
+	DirectionEstimator(const DirectionEstimator&);
+	DirectionEstimator &operator=(const DirectionEstimator&);
+	void estimateFrame_(const StftFrame& frame);
+
+	DirectionEstimatorConfig config_;
+	size_t channels_;
+	size_t firstBin_;                //!< 用いる周波数ビンの先頭
+	size_t bins_;                    //!< 用いる周波数ビンの数
+	size_t azimuthCount_;            //!< 方位角の格子の数
+	std::vector<float> azimuths_;    //!< 方向毎の方位角
+	std::vector<float> elevations_;  //!< 方向毎の仰角
+	AlignedBuffer<float> steeringRe_; //!< 方向毎、マイク毎、周波数ビン毎の exp(-j2πf a_m) の実部（directions x channels_ x bins_）
+	AlignedBuffer<float> steeringIm_; //!< 同虚部
+	StftAnalyzer analyzer_;          //!< process(in, frames) で用いる分析（ハン窓、シフト幅 hop_）
+	AlignedBuffer<float> phaseRe_;   //!< チャネル毎の位相のみのスペクトル（PHAT 重み付け）の実部（channels_ x bins_）
+	AlignedBuffer<float> phaseIm_;   //!< 同虚部
+	AlignedBuffer<float> sumRe_;     //!< 方向に揃えて足し合わせたスペクトルの実部（bins_）
+	AlignedBuffer<float> sumIm_;     //!< 同虚部
+	AlignedBuffer<float> map_;       //!< 平滑化した方向毎の応答
+	uint64_t lastEnd_;               //!< 直前に推定したフレームの末尾（StftFrame::end_）
+	bool primed_;                    //!< map_ に応答が入っているか
+	DirectionEstimate estimate_;
+	AzimuthDisplay* display_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_DIRECTIONESTIMATOR_H_ */
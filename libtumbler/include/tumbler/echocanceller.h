@@ -0,0 +1,143 @@
+/*
+ * @file echocanceller.h
+ * \~english
+ * @brief Acoustic echo canceller using the speaker feedback channel as the far-end reference
+ * \~japanese
+ * @brief スピーカーのフィードバック信号を参照信号とする音響エコーキャンセラー
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_ECHOCANCELLER_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_ECHOCANCELLER_H_
+
+#include <vector>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/fft.h"
+
+namespace tumbler{
+
+/**
+ * @class EchoCancellerConfig
+ * @brief エコーキャンセラーの設定
+ */
+class DLL_PUBLIC EchoCancellerConfig
+{
+public:
+	size_t block_ = 256;            //!< ブロック長 [サンプル]（2 のべき乗。FFT 長はその 2 倍で、出力はこの単位で遅延する）
+	size_t filterLength_ = 4096;    //!< 適応フィルタの長さ [サンプル]（block_ の倍数。推定できるエコーの経路の長さで、4096 で約 85ms）
+	size_t referenceDelay_ = 24;    //!< 参照信号のマイクに対する固定遅延 [サンプル]（T-01 の 17ch は 1ch〜16ch に対して約 500 マイクロ秒遅延する）
+	float stepSize_ = 0.5F;         //!< 適応の step size (0,1]（大きいほど速く収束するが、近端の音声による乱れが大きい）
+	float regularization_ = 0.01F;  //!< 正規化の分母に加える値（参照信号の平均電力に対する比）
+};
+
+/**
+ * @class EchoCanceller
+ * @brief 周波数領域のブロック分割適応フィルタ（PBFDAF、overlap-save）によるマルチチャネル音響エコーキャンセラー
+ * @details スピーカーのフィードバック信号（Microphone の 17ch、k_reference_mask_）を参照信号とし、各マイクの入力からスピーカーの再生音（エコー）を推定して差し引く。
+ * 参照信号の固定遅延は、マイクの入力を referenceDelay_ だけ遅らせて揃えることで補償する。
+ * 近端の話者の音声（ダブルトーク）による適応の乱れが出力に現れないよう、チャネル毎に適応させるフィルタ（background）と出力に用いるフィルタ（foreground）を持ち、
+ * background の誤差が十分小さい場合にのみ foreground に写す（two-path 方式）。参照信号の FFT と電力の推定は全チャネルで共有し、
+ * チャネル毎には FFT 5 回（2 つのフィルタによるエコーの推定、誤差、partition を 1 つずつ巡回させるフィルタの制約）をブロック毎に行う。
+ * 作業領域は構築時に一度だけ確保され、process() はヒープ確保を行わない。
+ */
+class DLL_PUBLIC EchoCanceller
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] channels 処理するマイクのチャネル数
+	 * @param [in] config 設定
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit EchoCanceller(size_t channels, const EchoCancellerConfig& config = EchoCancellerConfig());
+
+	/**
+	 * @brief 入力を処理する
+	 * @param [in] mics チャネル毎のマイク入力（channels チャネル、各 frames サンプル、48kHz、short の値域）
+	 * @param [in] reference 参照信号（frames サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @param [out] out チャネル毎の出力先（各チャネル maxOutput(frames) サンプル以上の領域があること。mics と同じ領域でもよい）
+	 * @return チャネル毎に出力したサンプル数（ブロック長単位で出力するため、入力のフレーム数とは一致しない）
+	 */
+	size_t process(const float* const* mics, const float* reference, size_t frames, float* const* out);
+
+	/**
+	 * @brief frames フレームの入力に対して出力され得る最大のサンプル数を返す
+	 */
+	size_t maxOutput(size_t frames) const;
+
+	/**
+	 * @brief 適応フィルタと入力の履歴を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief チャネル毎のエコー抑圧量 ERLE [dB]（マイク入力と出力の電力比の、ブロック毎の指数平滑値）を返す
+	 * @details 参照信号が無音の間は更新しない。近端の話者の音声が大きい間は小さくなる。
+	 * @param [in] channel チャネル番号
+	 */
+	float erle(size_t channel) const;
+
+	/**
+	 * @brief 入力に対する出力の遅延 [サンプル] を返す（最大でブロック長と referenceDelay_ の和）
+	 */
+	size_t latency() const { return config_.block_ + config_.referenceDelay_; }
+
+	size_t channels() const { return channels_; }
+
+	const EchoCancellerConfig& config() const { return config_; }
+
+private:
+	EchoCanceller(const EchoCanceller&);
+	EchoCanceller &operator=(const EchoCanceller&);
+	void processBlock_(float* const* out, size_t offset);
+
+	EchoCancellerConfig config_;
+	size_t channels_;
+	size_t block_;
+	size_t bins_;                    //!< 周波数ビンの数（block_ + 1）
+	size_t partitions_;              //!< 適応フィルタの partition の数（filterLength_ / block_）
+	FFT fft_;
+	AlignedBuffer<float> micPending_;  //!< チャネル毎の未処理のマイク入力（channels_ x (block_ + referenceDelay_)）
+	AlignedBuffer<float> refPending_;  //!< 未処理の参照信号と直前のブロック（2 x block_）
+	size_t refFill_;                 //!< refPending_ の後半に書き込んだサンプル数（micPending_ にはこれに referenceDelay_ を加えた数が入っている）
+	AlignedBuffer<float> refRe_;     //!< 参照信号のスペクトルの履歴の実部（partitions_ x bins_ の循環バッファ）
+	AlignedBuffer<float> refIm_;     //!< 同虚部
+	size_t newest_;                  //!< refRe_ の最新の partition の位置
+	AlignedBuffer<float> power_;     //!< 周波数ビン毎の参照信号の電力の平滑値
+	AlignedBuffer<float> weightRe_;  //!< チャネル毎の適応させるフィルタ（background）の実部（channels_ x partitions_ x bins_）
+	AlignedBuffer<float> weightIm_;  //!< 同虚部
+	AlignedBuffer<float> foregroundRe_; //!< チャネル毎の出力に用いるフィルタ（foreground）の実部（channels_ x partitions_ x bins_）
+	AlignedBuffer<float> foregroundIm_; //!< 同虚部
+	AlignedBuffer<float> accRe_;     //!< エコーのスペクトルの推定、誤差のスペクトル、正規化した step size の作業領域（bins_）
+	AlignedBuffer<float> accIm_;
+	AlignedBuffer<float> gain_;
+	AlignedBuffer<float> time_;      //!< 時間領域の作業領域（2 x block_）
+	AlignedBuffer<float> error_;     //!< background の誤差（block_）
+	std::vector<float> micPower_;    //!< チャネル毎のマイク入力の電力の平滑値
+	std::vector<float> errorPower_;  //!< チャネル毎の出力の電力の平滑値
+	std::vector<float> backgroundPower_; //!< チャネル毎の background の誤差の電力の平滑値
+	std::vector<float> foregroundPower_; //!< チャネル毎の foreground の誤差の電力の平滑値
+	size_t blocks_;                  //!< 処理したブロック数
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_ECHOCANCELLER_H_ */
@@ -0,0 +1,113 @@
+/*
+ * @file fft.h
+ * \~english
+ * @brief Real-input FFT with precomputed twiddle factors
+ * \~japanese
+ * @brief 回転因子を予め求めておく実数入力の高速フーリエ変換
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_FFT_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_FFT_H_
+
+#include <complex>
+#include <vector>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+
+namespace tumbler{
+
+/**
+ * @class FFT
+ * @brief 実数列の離散フーリエ変換
+ * @details 長さ N（2 のべき乗）の実数列を長さ N/2 の複素数列として基数 2 の FFT を行い、N/2 + 1 個の周波数ビンに分離する。
+ * 複素数列は実部と虚部を別の領域に置く（planar）形式で扱い、バタフライ演算はビルド対象が NEON（Raspberry Pi）または SSE2 に対応する場合はそれぞれのベクトル命令で 4 つずつ処理する。
+ * ビット反転の並べ替えの表と段毎の回転因子は構築時に一度だけ求め、変換中はヒープ確保を行わない。作業領域を持つため、1 つのインスタンスを複数のスレッドから同時に用いないこと。
+ */
+class DLL_PUBLIC FFT
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] size 変換長 N（4 以上の 2 のべき乗）
+	 * @note 変換長が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit FFT(size_t size);
+
+	/**
+	 * @brief 順変換 X[k] = Σ x[n] exp(-j2πkn/N)
+	 * @param [in] in 実数列（N 要素）
+	 * @param [out] re 周波数ビン 0〜N/2 の実部（N/2 + 1 要素）
+	 * @param [out] im 周波数ビン 0〜N/2 の虚部（N/2 + 1 要素）
+	 */
+	void forward(const float* in, float* re, float* im);
+
+	/**
+	 * @brief 逆変換 x[n] = (1/N) Σ X[k] exp(j2πkn/N)
+	 * @details 周波数ビン 0 と N/2 の虚部は無視する。
+	 * @param [in] re 周波数ビン 0〜N/2 の実部（N/2 + 1 要素）
+	 * @param [in] im 周波数ビン 0〜N/2 の虚部（N/2 + 1 要素）
+	 * @param [out] out 実数列（N 要素）
+	 */
+	void inverse(const float* re, const float* im, float* out);
+
+	/**
+	 * @brief 順変換（std::complex の配列に出力する）
+	 * @param [in] in 実数列（N 要素）
+	 * @param [out] out 周波数ビン 0〜N/2（N/2 + 1 要素）
+	 */
+	void forward(const float* in, std::complex<float>* out);
+
+	/**
+	 * @brief 逆変換（std::complex の配列から入力する）
+	 * @param [in] in 周波数ビン 0〜N/2（N/2 + 1 要素）
+	 * @param [out] out 実数列（N 要素）
+	 */
+	void inverse(const std::complex<float>* in, float* out);
+
+	/**
+	 * @brief 変換長 N を返す
+	 */
+	size_t size() const { return size_; }
+
+	/**
+	 * @brief 周波数ビンの数 N/2 + 1 を返す
+	 */
+	size_t bins() const { return size_ / 2 + 1; }
+
+private:
+	FFT(const FFT&);
+	FFT &operator=(const FFT&);
+	void transform_();
+
+	size_t size_;
+	std::vector<unsigned int> reverse_; //!< 長さ N/2 の複素 FFT のビット反転の並べ替え
+	AlignedBuffer<float> twiddleRe_;    //!< 段毎の回転因子 exp(-j2πk/(2h)) の実部（半分の長さ h の段の k 番目を h + k に置く）
+	AlignedBuffer<float> twiddleIm_;    //!< 同虚部
+	AlignedBuffer<float> splitRe_;      //!< 実数列への分離の回転因子 exp(-j2πk/N) の実部
+	AlignedBuffer<float> splitIm_;      //!< 同虚部
+	AlignedBuffer<float> workRe_;       //!< 長さ N/2 の複素数列の実部
+	AlignedBuffer<float> workIm_;       //!< 同虚部
+	AlignedBuffer<float> binsRe_;       //!< std::complex 版の変換の作業領域
+	AlignedBuffer<float> binsIm_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_FFT_H_ */
@@ -12,6 +12,7 @@
 #include <memory>
 #include <future>
 #include <vector>
+#include <atomic>
 
 namespace tumbler{
 
@@ -73,10 +74,41 @@ public:
 	 */
 	uint8_t toDataForTx(char* data) const;
 
+	/**
+	 * @brief フレームの点灯状態をセグメント毎の平均輝度に要約する
+	 * @param [in] rotating 組み込み回転アニメーションで点灯する場合 true（回転により平均化されるため、全セグメントをリング全周の平均輝度とする）
+	 * @return セグメント毎の平均輝度（sequence_ は 0）
+	 */
+	LEDRingBrightness brightness(bool rotating) const;
+
 	static const int k_num_leds_ = 18;
 	LED leds_[k_num_leds_];
 };
 
+/**
+ * @class AzimuthFrame
+ * @brief Tumbler 座標系における方位角（向かって右が 0 度、正面が 270 度）を指定した時、指定方位の LED を点灯させるフレーム
+ * @details LED は 18 個しかないため、ちょうど 18 で割り切れる方位以外は、2 つの LED の明度のバランスを取ることで表現している
+ */
+class DLL_PUBLIC AzimuthFrame : public Frame
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] azimuths 点灯させたい方向の方位角 [degree]（値域外の値は 360 を法として扱う）
+	 * @param [in] foreground 点灯させたい方向の LED 色
+	 * @param [in] background その他の LED 色
+	 */
+	AzimuthFrame(const std::vector<int>& azimuths, const LED& foreground, const LED& background);
+
+	/**
+	 * @brief 基準座標系における仮想 LED 番号（方位角 0 度から反時計回り）を物理 LED 番号に変換する
+	 * @param [in] vid 仮想 LED 番号 [0,17]
+	 * @return 物理 LED 番号
+	 */
+	static int virtualToPhysical(int vid);
+};
+
 /**
  * @class LEDRing
  * @brief LED リングを保持するシングルトンクラス。
@@ -189,6 +221,60 @@ private:
 	Frame currentFrame_;
 };
 
+/**
+ * @class AzimuthDisplay
+ * @brief 音源方向の推定値を LED リングに表示するクラス
+ * @details update() で与えられた最新の方位角を、専用の描画スレッドが一定の間隔で AzimuthFrame として LED リングに点灯させる。
+ * update() はロックを取らず LED リングとの通信も待たないため、音声処理のスレッドから推定値毎に呼ぶことができる。
+ * 信頼度が minConfidence 未満の推定値は表示を更新せず、holdMs の間更新がなければ背景色のみの表示に戻す。
+ */
+class DLL_PUBLIC AzimuthDisplay
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] foreground 音源方向の LED 色
+	 * @param [in] background その他の LED 色
+	 * @param [in] minConfidence 表示する推定値の最小の信頼度 [0,1]
+	 * @param [in] fps 描画の最大頻度 [frames/s]
+	 * @param [in] holdMs 推定値が得られない場合に直前の方向を表示し続ける時間 [ms]
+	 */
+	AzimuthDisplay(const LED& foreground, const LED& background, float minConfidence = 0.3F, int fps = 20, int holdMs = 1500);
+	~AzimuthDisplay();
+
+	/**
+	 * @brief 描画スレッドを開始する
+	 */
+	void start();
+
+	/**
+	 * @brief 描画スレッドを終了する（LED リングの表示はそのまま残る）
+	 */
+	void stop();
+
+	/**
+	 * @brief 方向の推定値を与える
+	 * @param [in] azimuth 方位角 [degree]
+	 * @param [in] confidence 信頼度 [0,1]
+	 */
+	void update(float azimuth, float confidence);
+
+private:
+	AzimuthDisplay(const AzimuthDisplay&);
+	AzimuthDisplay &operator=(const AzimuthDisplay&);
+	void renderImpl_();
+
+	const LED foreground_;
+	const LED background_;
+	const float minConfidence_;
+	const int fps_;
+	const int holdMs_;
+	std::atomic<float> azimuth_;
+	std::atomic<unsigned int> sequence_; //!< 表示すべき推定値を受け取る毎に増える
+	std::atomic<bool> stopflag_;
+	std::future<void> render_;
+};
+
 }
 
 #endif /* LIBTUMBLER_INCLUDE_TUMBLER_LEDRING_H_ */
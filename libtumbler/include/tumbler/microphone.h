@@ -0,0 +1,253 @@
+/*
+ * @file microphone.h
+ * \~english
+ * @brief Capture from the 18-channel microphone subsystem with a dedicated reader thread
+ * \~japanese
+ * @brief 18ch 録音デバイスからの録音を専用の読み出しスレッドで行うクラス
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_MICROPHONE_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_MICROPHONE_H_
+
+#include <string>
+#include <atomic>
+#include <future>
+#include <cstdint>
+#include <semaphore.h>
+#include "tumbler/tumbler.h"
+#include "tumbler/ringbuffer.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/decimator.h"
+
+namespace tumbler{
+
+/**
+ * @class MicrophoneConfig
+ * @brief 録音の設定
+ */
+class DLL_PUBLIC MicrophoneConfig
+{
+public:
+	std::string device_ = "/dev/ttyACM0"; //!< 録音デバイス。試験用に FIFO、raw ファイル（48kHz, 16bit, 18ch）のパスを与えることもできる
+	bool control_ = true;          //!< 録音デバイスに録音開始・終了命令を送るか（FIFO、raw ファイルの場合は false とすること）
+	size_t readFrames_ = 48;       //!< 読み出しスレッドが 1 回にまとめて受け取るフレーム数（大きすぎると録音デバイスのバッファが溢れる）
+	size_t ringFrames_ = 48000;    //!< リングバッファの容量（フレーム数）
+	int priority_ = 50;            //!< 読み出しスレッドの SCHED_FIFO 優先度（0 の場合、権限がない場合、raw ファイルの場合は通常のスケジューリング）
+	bool paced_ = false;           //!< raw ファイルを 48kHz の実時間に合わせて読み出すか（false の場合は可能な限り速く読み出す）
+	double gapToleranceMs_ = 20.0; //!< 受信したフレーム数が経過時間に対してこれ以上不足した場合に欠損とみなす [ms]（0 の場合は検出しない。読み出しが遅れてカーネルに受信済のフレームが溜まっている間は判定しない）
+};
+
+/**
+ * @class MicrophoneStats
+ * @brief 読み出しスレッドの統計
+ */
+class DLL_PUBLIC MicrophoneStats
+{
+public:
+	uint64_t frames_ = 0;        //!< 録音デバイスから受信したフレーム数
+	uint64_t chunks_ = 0;        //!< リングバッファへ書き込んだ回数
+	uint64_t overflows_ = 0;     //!< リングバッファが満杯のため受信したフレームを破棄した回数
+	uint64_t droppedFrames_ = 0; //!< リングバッファが満杯のため破棄したフレーム数
+	uint64_t gaps_ = 0;          //!< 録音デバイス側の欠損（受信したフレーム数の経過時間に対する不足）を検出した回数
+	uint64_t lostFrames_ = 0;    //!< 欠損したと推定したフレーム数
+	size_t maxFill_ = 0;         //!< リングバッファの最大使用フレーム数
+	bool realtime_ = false;      //!< 読み出しスレッドが SCHED_FIFO で動作しているか
+};
+
+/**
+ * @class MicrophoneBlock
+ * @brief read() で読み出したブロックの情報
+ */
+class DLL_PUBLIC MicrophoneBlock
+{
+public:
+	uint64_t frame_ = 0;         //!< 先頭フレームの通し番号（録音開始からの、破棄、欠損したフレームを含む番号）
+	uint64_t timestamp_ = 0;     //!< 先頭フレームの推定録音時刻 [microsecond]（std::chrono::steady_clock）
+	size_t frames_ = 0;          //!< フレーム数
+	bool discontinuous_ = false; //!< 直前に読み出したブロックとの間に破棄、欠損したフレームがあるか
+};
+
+/**
+ * @class Microphone
+ * @brief 18ch 録音デバイスから録音するクラス
+ * @details 専用の読み出しスレッドが録音デバイスから readFrames_ フレームずつ受け取り、受信時刻とともにロックフリーのリングバッファへ書き込む。
+ * 読み出しスレッドは利用側を待つことがなく、リングバッファが満杯の場合は受信したフレームを破棄して数える。
+ * 利用側は read() により、リングバッファから任意のフレーム数のブロックを録音時刻とともに読み出す。
+ * フレームは 18ch のインターリーブ形式（1ch〜16ch がマイク、17ch がスピーカーからのフィードバック信号、18ch が外部入力端子）である。
+ */
+class DLL_PUBLIC Microphone
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] config 録音の設定
+	 */
+	explicit Microphone(const MicrophoneConfig& config = MicrophoneConfig());
+	~Microphone();
+
+	/**
+	 * @brief 録音を開始する
+	 * @details 前回の録音でリングバッファに残っているフレームは破棄し、フレームの通し番号を 0 から振り直す。read() と並行して呼び出さないこと。
+	 * @note 録音デバイスを開けなかった場合は std::runtime_error 例外が送出される
+	 */
+	void start();
+
+	/**
+	 * @brief 録音を終了する
+	 * @details 録音デバイスに録音終了命令を送る。リングバッファに残っているフレームは引き続き read() で読み出すことができる。
+	 */
+	void stop();
+
+	/**
+	 * @brief 読み出しスレッドが動作中であるかを返す（raw ファイル、FIFO の末尾に達した場合は false となる）
+	 */
+	bool running() const { return running_.load(); }
+
+	/**
+	 * @brief リングバッファからブロックを読み出す
+	 * @details frames フレームが揃うまで最大 timeoutMs だけ待つ。ブロックは破棄、欠損したフレームを跨がず、その場合は手前までを返す
+	 * （次のブロックの discontinuous_ が true となる）。利用側のスレッドは 1 つとすること。
+	 * @param [out] out 出力先（frames * k_channels_ サンプル以上の領域があること）
+	 * @param [in] frames 読み出す最大のフレーム数
+	 * @param [out] block ブロックの情報
+	 * @param [in] timeoutMs 待つ最大の時間 [ms]（0 の場合は待たない）
+	 * @return 読み出したフレーム数
+	 */
+	size_t read(short* out, size_t frames, MicrophoneBlock& block, int timeoutMs);
+
+	/**
+	 * @brief リングバッファからブロックを読み出し、指定したチャネルをチャネル毎の領域へ取り出す
+	 * @details リングバッファ上のフレームを RingBuffer::consume() によりコピーせずに deinterleave() でチャネル毎に分けるため（リングバッファの末尾で折り返す
+	 * 1 フレームのみ一時領域に移す）、後段の処理（例えば音声認識は 1ch、ビームフォーミングは 16ch、エコーキャンセラーは 17ch のみを用いる）が
+	 * それぞれ 18ch のインターリーブ形式を走査せずに済む。サンプルは値を変えずに取り出す。ブロックの区切り方は read() と同じ。
+	 * @param [out] out 出力先の配列。mask で指定したチャネルを番号の小さい順に out[0], out[1], ... へ書き込む（各 frames サンプル以上の領域があること）
+	 * @param [in] mask 取り出すチャネルのビットマスク（k_mic_mask_ 等）
+	 * @param [in] frames 読み出す最大のフレーム数
+	 * @param [out] block ブロックの情報
+	 * @param [in] timeoutMs 待つ最大の時間 [ms]（0 の場合は待たない）
+	 * @return 読み出したフレーム数
+	 */
+	size_t read(short* const* out, uint32_t mask, size_t frames, MicrophoneBlock& block, int timeoutMs);
+
+	/**
+	 * @brief リングバッファからブロックを読み出し、指定したチャネルを単精度浮動小数点数に変換してチャネル毎の領域へ取り出す
+	 * @details 各サンプルに gain を乗じる（1.0F / 32768 とすると [-1, 1) に正規化される）。その他は short 版と同じ。
+	 * @param [out] out 出力先の配列。mask で指定したチャネルを番号の小さい順に out[0], out[1], ... へ書き込む（各 frames サンプル以上の領域があること）
+	 * @param [in] mask 取り出すチャネルのビットマスク（k_mic_mask_ 等）
+	 * @param [in] gain ゲイン
+	 * @param [in] frames 読み出す最大のフレーム数
+	 * @param [out] block ブロックの情報
+	 * @param [in] timeoutMs 待つ最大の時間 [ms]（0 の場合は待たない）
+	 * @return 読み出したフレーム数
+	 */
+	size_t read(float* const* out, uint32_t mask, float gain, size_t frames, MicrophoneBlock& block, int timeoutMs);
+
+	/**
+	 * @brief リングバッファからブロックを読み出し、指定したチャネルを decimator で変換してチャネル毎の領域へ取り出す
+	 * @details リングバッファ上のフレームを RingBuffer::consume() によりコピーせずに Decimator::process() へ与えるため、
+	 * 48kHz のインターリーブ形式やチャネル毎の中間データを作らない（リングバッファの末尾で折り返す 1 フレームのみ一時領域に移す）。
+	 * ブロックの区切り方は read() と同じで、block.frames_ は読み出した 48kHz のフレーム数となる。
+	 * 出力の時刻は、録音時刻 block.timestamp_ に対して decimator.delay() サンプル分だけ遅れる。
+	 * @param [in,out] decimator 変換に用いるデシメーター（channels() は mask で指定したチャネル数と等しいこと）
+	 * @param [in] mask 取り出すチャネルのビットマスク（k_mic_mask_ 等）
+	 * @param [out] out 出力先の配列。mask で指定したチャネルを番号の小さい順に out[0], out[1], ... へ書き込む（各 decimator.maxOutput(frames) サンプル以上の領域があること）
+	 * @param [in] frames 読み出す最大の（48kHz の）フレーム数
+	 * @param [out] block ブロックの情報
+	 * @param [in] timeoutMs 待つ最大の時間 [ms]（0 の場合は待たない）
+	 * @return チャネル毎に出力したサンプル数
+	 * @note decimator のチャネル数が mask と一致しない場合は std::invalid_argument 例外が送出される
+	 */
+	size_t read(Decimator& decimator, uint32_t mask, short* const* out, size_t frames, MicrophoneBlock& block, int timeoutMs);
+
+	/**
+	 * @brief リングバッファに読み出し可能なフレーム数を返す
+	 */
+	size_t available() const { return samples_.size() / k_channels_; }
+
+	/**
+	 * @brief 読み出しスレッドの統計を返す
+	 */
+	MicrophoneStats stats() const;
+
+	static const int k_rate_ = 48000;          //!< サンプリングレート
+	static const int k_channels_ = 18;         //!< チャネル数
+	static const int k_mic_channels_ = 16;     //!< マイクのチャネル数（1ch〜16ch）
+	static const int k_reference_channel_ = 16; //!< スピーカーからのフィードバック信号のチャネル番号（0 始まり、17ch）
+	static const int k_line_channel_ = 17;      //!< 外部入力端子のチャネル番号（0 始まり、18ch）
+	static const uint32_t k_mic_mask_ = 0xFFFFU;                          //!< マイクのチャネルのビットマスク
+	static const uint32_t k_reference_mask_ = 1U << k_reference_channel_; //!< スピーカーからのフィードバック信号のチャネルのビットマスク
+	static const uint32_t k_line_mask_ = 1U << k_line_channel_;           //!< 外部入力端子のチャネルのビットマスク
+
+private:
+	/**
+	 * @class Chunk
+	 * @brief リングバッファへ一度に書き込んだフレームの情報
+	 */
+	class Chunk
+	{
+	public:
+		uint64_t frame_ = 0;  //!< 先頭フレームの通し番号
+		size_t frames_ = 0;   //!< フレーム数
+		uint64_t time_ = 0;   //!< 受信時刻 [microsecond]
+	};
+
+	Microphone(const Microphone&);
+	Microphone &operator=(const Microphone&);
+	void captureImpl_();
+	void deliver_(const short* data, size_t frames, uint64_t time, bool late);
+	template<typename Consume>
+	size_t readImpl_(size_t frames, MicrophoneBlock& block, int timeoutMs, Consume consume);
+	template<typename Visit>
+	void consumeFrames_(size_t frames, Visit visit);
+
+	MicrophoneConfig config_;
+	int fd_;
+	int control_;
+	bool regular_;                  //!< device_ が通常のファイルであるか
+	RingBuffer<short> samples_;     //!< 受信したフレーム（インターリーブ形式）
+	RingBuffer<Chunk> chunks_;      //!< samples_ に書き込んだフレームの情報
+	sem_t dataSem_;                 //!< 書き込みを利用側に通知する
+	std::future<void> capture_;
+	std::atomic<bool> stopflag_;
+	std::atomic<bool> running_;
+
+	// 読み出しスレッド専用
+	uint64_t deviceFrames_;         //!< 次に受信するフレームの通し番号
+	uint64_t originTime_;           //!< 通し番号 0 のフレームの推定受信時刻 [microsecond]（欠損の検出用）
+	bool started_;
+
+	// 利用側専用
+	Chunk current_;                 //!< 読み出し中のフレームの情報
+	size_t currentUsed_;            //!< current_ のうち読み出したフレーム数
+	uint64_t nextFrame_;            //!< 次に読み出すフレームの通し番号（連続している場合）
+
+	std::atomic<uint64_t> frames_;
+	std::atomic<uint64_t> chunkCount_;
+	std::atomic<uint64_t> overflows_;
+	std::atomic<uint64_t> droppedFrames_;
+	std::atomic<uint64_t> gaps_;
+	std::atomic<uint64_t> lostFrames_;
+	std::atomic<size_t> maxFill_;
+	std::atomic<bool> realtime_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_MICROPHONE_H_ */
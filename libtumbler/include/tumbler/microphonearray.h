@@ -0,0 +1,112 @@
+/*
+ * @file microphonearray.h
+ * \~english
+ * @brief Geometry of the 16-microphone array and steering delays
+ * \~japanese
+ * @brief 16ch マイクアレイの配置と、到来方向に対する各マイクの到達時間差
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_MICROPHONEARRAY_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_MICROPHONEARRAY_H_
+
+#include <string>
+#include <vector>
+#include "tumbler/tumbler.h"
+
+namespace tumbler{
+
+/**
+ * @class MicrophonePosition
+ * @brief マイクの位置 [m]
+ * @details Tumbler 座標系（上から見た平面が x-y 平面、正面から見て左から右が x 軸、正面から後面が y 軸、下から上が z 軸、
+ * 原点は 16 個のマイクを頂点とする八角柱の重心）による。
+ */
+class DLL_PUBLIC MicrophonePosition
+{
+public:
+	MicrophonePosition() : x_(0), y_(0), z_(0) {}
+	MicrophonePosition(float x, float y, float z) : x_(x), y_(y), z_(z) {}
+	float x_;
+	float y_;
+	float z_;
+};
+
+/**
+ * @class MicrophoneArray
+ * @brief マイクアレイの配置
+ * @details 方位角は Tumbler 座標系において向かって右（x 軸の正の向き）を 0 度、後面を 90 度、正面を 270 度とし、
+ * 仰角は x-y 平面を 0 度、上を正とする（LED リングの AzimuthFrame と同じ方位角である）。音源は十分遠方にあり、平面波が到来するものとする。
+ */
+class DLL_PUBLIC MicrophoneArray
+{
+public:
+	/**
+	 * @brief Tumbler T-01 の 1ch〜16ch のマイクの配置を返す
+	 * @details hardware_api/microphone/microphone_positions/microphone_positions.txt と同じ値である。
+	 */
+	static MicrophoneArray tumbler();
+
+	/**
+	 * @brief マイクの配置をファイルから読み込む
+	 * @details microphone_positions.txt と同じ形式（1 行に 1 つのマイクの x y z を空白区切りでミリメートル単位で記し、# で始まる行は注釈）とする。
+	 * @param [in] path ファイルのパス
+	 * @note ファイルを開けない場合、形式が正しくない場合は std::runtime_error 例外が送出される
+	 */
+	static MicrophoneArray load(const std::string& path);
+
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] positions マイクの位置 [m]
+	 */
+	explicit MicrophoneArray(const std::vector<MicrophonePosition>& positions);
+
+	/**
+	 * @brief マイクの数を返す
+	 */
+	size_t size() const { return positions_.size(); }
+
+	/**
+	 * @brief マイクの位置 [m] を返す
+	 * @param [in] index マイクの番号（0 始まり、0 が 1ch）
+	 */
+	const MicrophonePosition& position(size_t index) const { return positions_[index]; }
+
+	/**
+	 * @brief 原点から最も遠いマイクまでの距離 [m] を返す
+	 */
+	float radius() const;
+
+	/**
+	 * @brief 指定した方向から到来する平面波が、原点に比べて各マイクに何秒早く到達するかを求める
+	 * @param [in] azimuth 方位角 [degree]
+	 * @param [in] elevation 仰角 [degree]
+	 * @param [out] advances 各マイクの到達時間の先行 [s]（size() 要素以上の領域があること。原点より遅れて到達するマイクは負となる）
+	 */
+	void advances(float azimuth, float elevation, float* advances) const;
+
+	static constexpr float k_speed_of_sound_ = 343.0F; //!< 音速 [m/s]
+
+private:
+	std::vector<MicrophonePosition> positions_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_MICROPHONEARRAY_H_ */
@@ -0,0 +1,114 @@
+/*
+ * @file resampler.h
+ * \~english
+ * @brief Polyphase sample rate converter with cached filter tables
+ * \~japanese
+ * @brief フィルタ係数表をキャッシュするポリフェーズ・サンプリングレート変換器
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_RESAMPLER_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_RESAMPLER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "tumbler/tumbler.h"
+
+namespace tumbler{
+
+/**
+ * @class Resampler
+ * @brief モノラル音声のサンプリングレートを有理数比 up/down で変換するポリフェーズ FIR 変換器
+ * @details 入力を up 倍にアップサンプルし、カイザー窓をかけた sinc 関数による低域通過フィルタを通して 1/down にダウンサンプルする処理を、
+ * 出力サンプル毎に必要な位相（k_taps_per_phase_ タップ、ダウンサンプルの場合は変換比に応じて増やす）の係数のみを用いて行う。フィルタ係数表は変換比毎に一度だけ作成され、
+ * 同じ変換比のインスタンス間で共有される。係数は出力サンプル毎に連続したメモリ上で入力との内積をとる順に並べてあり、コンパイラの自動ベクトル化が効く。
+ * 入力は任意の長さに分割して逐次与えることができ、分割の仕方によらず同じ出力が得られる。
+ */
+class DLL_PUBLIC Resampler
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] inputRate 入力のサンプリングレート
+	 * @param [in] outputRate 出力のサンプリングレート
+	 * @note レートが正でない場合は std::invalid_argument 例外が送出される
+	 */
+	Resampler(int inputRate, int outputRate);
+
+	/**
+	 * @brief 入力を変換する
+	 * @param [in] in 入力の音声サンプル
+	 * @param [in] n 入力のサンプル数
+	 * @param [out] out 出力先（maxOutput(n) サンプル以上の領域があること）
+	 * @return 出力したサンプル数
+	 */
+	size_t process(const short* in, size_t n, short* out);
+
+	/**
+	 * @brief フィルタの遅延分の無音を入力し、末尾の入力に対応する出力を取り出して内部状態を初期化する
+	 * @param [out] out 出力先（maxOutput(taps()) サンプル以上の領域があること）
+	 * @return 出力したサンプル数
+	 */
+	size_t flush(short* out);
+
+	/**
+	 * @brief 内部状態を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief n サンプルの入力に対して出力され得る最大のサンプル数を返す
+	 */
+	size_t maxOutput(size_t n) const { return n * up_ / down_ + 2; }
+
+	int inputRate() const { return inputRate_; }
+	int outputRate() const { return outputRate_; }
+
+	/**
+	 * @brief 1 出力サンプルあたりのフィルタのタップ数を返す
+	 */
+	int taps() const;
+
+	/**
+	 * @brief よく用いる入力レート（8k, 16k, 22.05k, 24k, 32k, 44.1k, 48k）から outputRate への係数表を予め作成する
+	 * @param [in] outputRate 出力のサンプリングレート
+	 */
+	static void precompute(int outputRate);
+
+	static const int k_taps_per_phase_ = 32;  //!< 1 出力サンプルあたりのフィルタのタップ数（アップサンプルの場合）
+	static const size_t k_block_ = 1024;      //!< 内部で一度に処理する入力のサンプル数
+
+private:
+	class Table;
+	static std::shared_ptr<const Table> cachedTable_(int up, int down, int inputRate, int outputRate);
+
+	int inputRate_;
+	int outputRate_;
+	int up_;
+	int down_;
+	std::shared_ptr<const Table> table_;
+	std::vector<float> work_; //!< 直前の入力の末尾（taps() - 1 サンプル）と今回の入力
+	int phase_;               //!< 次の出力の位相 [0, up_)
+	size_t offset_;           //!< 次の出力に対応する最新の入力の work_ 上の位置
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_RESAMPLER_H_ */
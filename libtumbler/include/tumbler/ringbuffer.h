@@ -0,0 +1,193 @@
+/*
+ * @file ringbuffer.h
+ * \~english
+ * @brief Lock-free single-producer single-consumer ring buffer
+ * \~japanese
+ * @brief ロックフリー単一生産者単一消費者（SPSC）リングバッファ
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_RINGBUFFER_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_RINGBUFFER_H_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+
+namespace tumbler{
+
+/**
+ * @class RingBuffer
+ * @brief 固定長のロックフリー SPSC リングバッファ
+ * @details 書き込み（push）はただ 1 つのスレッドから、読み出し（pop）はただ 1 つの別のスレッドから行うことを前提とする。
+ * 領域は構築時に一度だけ確保され、以降の push/pop ではヒープ確保もロックも発生しない。
+ * 容量は指定値以上の 2 の冪に切り上げられる。
+ * @tparam T 要素型（コピー代入可能であること。1 要素ずつ読み出す場合、読み出した要素はリングバッファからムーブされる）
+ */
+template<typename T>
+class RingBuffer
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] capacity 最低限保持したい要素数
+	 */
+	explicit RingBuffer(size_t capacity) : head_(0), tail_(0)
+	{
+		size_t c = 1;
+		while(c < capacity){
+			c <<= 1;
+		}
+		buffer_.resize(c);
+		mask_ = c - 1;
+	}
+
+	/**
+	 * @brief 要素を 1 つ書き込む（生産者スレッド専用）
+	 * @param [in] value 書き込む要素
+	 * @return 書き込めた場合 true、満杯の場合 false
+	 */
+	bool push(const T& value)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if(head - tail_.load(std::memory_order_acquire) == buffer_.size()){
+			return false; // 満杯
+		}
+		buffer_[head & mask_] = value;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief 要素を 1 つ読み出す（消費者スレッド専用）
+	 * @param [out] value 読み出した要素
+	 * @return 読み出せた場合 true、空の場合 false
+	 */
+	bool pop(T& value)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		if(head_.load(std::memory_order_acquire) == tail){
+			return false; // 空
+		}
+		value = std::move(buffer_[tail & mask_]); // std::shared_ptr 等の所有権を領域に残さない
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief 複数の要素をまとめて書き込む（生産者スレッド専用）
+	 * @param [in] values 書き込む要素の配列
+	 * @param [in] n 要素数
+	 * @return 書き込めた要素数（空き容量が不足している場合は先頭から空き容量分のみ書き込む）
+	 */
+	size_t push(const T* values, size_t n)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		const size_t space = buffer_.size() - (head - tail_.load(std::memory_order_acquire));
+		if(space < n){
+			n = space;
+		}
+		const size_t offset = head & mask_;
+		const size_t first = std::min(n, buffer_.size() - offset); // 末尾で折り返すまでの要素数
+		std::copy(values, values + first, buffer_.begin() + offset);
+		std::copy(values + first, values + n, buffer_.begin());
+		head_.store(head + n, std::memory_order_release);
+		return n;
+	}
+
+	/**
+	 * @brief 複数の要素をまとめて読み出す（消費者スレッド専用）
+	 * @param [out] values 読み出した要素の格納先
+	 * @param [in] n 読み出したい最大要素数
+	 * @return 読み出せた要素数
+	 */
+	size_t pop(T* values, size_t n)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		const size_t available = head_.load(std::memory_order_acquire) - tail;
+		if(available < n){
+			n = available;
+		}
+		const size_t offset = tail & mask_;
+		const size_t first = std::min(n, buffer_.size() - offset);
+		std::copy(buffer_.begin() + offset, buffer_.begin() + offset + first, values);
+		std::copy(buffer_.begin(), buffer_.begin() + (n - first), values + first);
+		tail_.store(tail + n, std::memory_order_release);
+		return n;
+	}
+
+	/**
+	 * @brief 複数の要素を、コピーせずにリングバッファ上の領域のまま読み出す（消費者スレッド専用）
+	 * @details 読み出す要素を、末尾で折り返すまでの連続した領域毎に visit(const T* values, size_t count) へ渡す（1 回または 2 回呼ばれる）。
+	 * visit から戻るまで、渡した領域は生産者に上書きされない。
+	 * @param [in] n 読み出したい最大要素数
+	 * @param [in] visit 連続した領域毎に呼ばれる関数
+	 * @return 読み出せた要素数
+	 */
+	template<typename Visit>
+	size_t consume(size_t n, Visit visit)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		const size_t available = head_.load(std::memory_order_acquire) - tail;
+		if(available < n){
+			n = available;
+		}
+		const size_t offset = tail & mask_;
+		const size_t first = std::min(n, buffer_.size() - offset);
+		if(first > 0){
+			visit(buffer_.data() + offset, first);
+		}
+		if(n > first){
+			visit(buffer_.data(), n - first);
+		}
+		tail_.store(tail + n, std::memory_order_release);
+		return n;
+	}
+
+	/**
+	 * @brief 現在保持している要素数を返す
+	 * @note 他方のスレッドが並行して操作している場合、返り値は近似値となる
+	 */
+	size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief 空であるかを返す
+	 */
+	bool empty() const { return size() == 0; }
+
+	/**
+	 * @brief 保持可能な最大要素数を返す
+	 */
+	size_t capacity() const { return buffer_.size(); }
+
+private:
+	RingBuffer(const RingBuffer&);
+	RingBuffer &operator=(const RingBuffer&);
+
+	std::vector<T> buffer_;
+	size_t mask_;
+	alignas(64) std::atomic<size_t> head_; //!< 次に書き込む位置（生産者のみが更新）
+	alignas(64) std::atomic<size_t> tail_; //!< 次に読み出す位置（消費者のみが更新）
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_RINGBUFFER_H_ */
@@ -0,0 +1,161 @@
+/*
+ * @file soundbank.h
+ * \~english
+ * @brief Preloaded sound cache with mmap-backed WAV/raw loader
+ * \~japanese
+ * @brief WAV/raw 音声ファイルを mmap で読み込み、再生可能な形式で保持する音声キャッシュ
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_SOUNDBANK_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_SOUNDBANK_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "tumbler/tumbler.h"
+
+namespace tumbler{
+
+/**
+ * @class Sound
+ * @brief 再生可能な形式（モノラル 16bit、SoundBank に指定したサンプリングレート）に変換済みの不変の音声
+ * @details ファイルが既にその形式である場合は mmap した領域をそのまま参照し（ゼロコピー）、そうでない場合は読み込み時に一度だけ変換した結果を保持する。
+ * インスタンスは SoundBank が作成し、std::shared_ptr で共有される。再生中の音声はその間保持されるため、SoundBank から取り除いても再生は継続する。
+ */
+class DLL_PUBLIC Sound
+{
+public:
+	~Sound();
+
+	/**
+	 * @brief 音声サンプルの先頭を返す
+	 */
+	const short* data() const { return data_; }
+
+	/**
+	 * @brief サンプル数を返す
+	 */
+	size_t size() const { return size_; }
+
+	/**
+	 * @brief サンプリングレートを返す
+	 */
+	int rate() const { return rate_; }
+
+	/**
+	 * @brief 読み込み時に求めた正規化ゲイン（Speaker::normalizationGain() と同じ）を返す
+	 */
+	float normalizationGain() const { return normalizationGain_; }
+
+	/**
+	 * @brief ファイルを mmap した領域をそのまま参照しているか（変換を要しなかったか）を返す
+	 */
+	bool mapped() const { return map_ != nullptr; }
+
+private:
+	friend class SoundBank;
+	Sound();
+	Sound(const Sound&);
+	Sound &operator=(const Sound&);
+
+	const short* data_;
+	size_t size_;
+	int rate_;
+	float normalizationGain_;
+	std::vector<short> converted_; //!< 変換した場合の音声
+	void* map_;                    //!< mmap した領域（変換した場合は nullptr）
+	size_t mapLength_;
+};
+
+/**
+ * @class SoundBank
+ * @brief 名前を付けた音声を予め読み込んで保持するクラス
+ * @details WAV ファイル（リニア PCM 8/16bit、モノラルまたはステレオ、WAVE_FORMAT_EXTENSIBLE を含む）及びヘッダのない 16bit リトルエンディアンの raw ファイルを読み込む。
+ * ヘッダの検証、ステレオのモノラルへのダウンミックス、サンプリングレートの変換、正規化ゲインの算出は読み込み時に一度だけ行われ、
+ * 以降は Speaker::play() にハンドルを与えるだけで、ファイルの読み込みや変換、複製を伴わずに再生できる。複数のスレッドから利用することができる。
+ */
+class DLL_PUBLIC SoundBank
+{
+public:
+	typedef std::shared_ptr<const Sound> Handle; //!< 音声のハンドル
+
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] rate 変換先のサンプリングレート（Speaker::rate() を与える）
+	 */
+	explicit SoundBank(int rate = 44100);
+
+	/**
+	 * @brief WAV ファイルを読み込み、名前を付けて保持する
+	 * @param [in] name 名前（既に同じ名前の音声がある場合は置き換える）
+	 * @param [in] path ファイルパス
+	 * @return ハンドル
+	 * @note 読み込めなかった場合、対応していない形式の場合は std::runtime_error 例外が送出される
+	 */
+	Handle loadWav(const std::string& name, const std::string& path);
+
+	/**
+	 * @brief raw ファイル（16bit リトルエンディアン、インターリーブ）を読み込み、名前を付けて保持する
+	 * @param [in] name 名前（既に同じ名前の音声がある場合は置き換える）
+	 * @param [in] path ファイルパス
+	 * @param [in] rate サンプリングレート
+	 * @param [in] channels チャネル数（1 または 2）
+	 * @return ハンドル
+	 * @note 読み込めなかった場合は std::runtime_error 例外が送出される
+	 */
+	Handle loadRaw(const std::string& name, const std::string& path, int rate, int channels);
+
+	/**
+	 * @brief 名前から音声のハンドルを返す
+	 * @return ハンドル（該当する音声がない場合は空）
+	 */
+	Handle get(const std::string& name) const;
+
+	/**
+	 * @brief 名前を付けた音声を取り除く
+	 */
+	void unload(const std::string& name);
+
+	/**
+	 * @brief 保持している音声の数を返す
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief 変換先のサンプリングレートを返す
+	 */
+	int rate() const { return rate_; }
+
+private:
+	SoundBank(const SoundBank&);
+	SoundBank &operator=(const SoundBank&);
+
+	Handle load_(const std::string& name, const std::string& path, bool wav, int rate, int channels);
+
+	int rate_;
+	mutable std::mutex mutex_;
+	std::map<std::string, Handle> sounds_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_SOUNDBANK_H_ */
@@ -27,18 +27,159 @@
 #define LIBTUMBLER_INCLUDE_TUMBLER_SPEAKER_H_
 
 #include "tumbler/tumbler.h"
+#include "tumbler/ringbuffer.h"
+#include "tumbler/resampler.h"
+#include "tumbler/soundbank.h"
+#include "tumbler/tonesynth.h"
 
 #include <memory>
+#include <string>
 #include <future>
+#include <functional>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <semaphore.h>
 #include <alsa/asoundlib.h>
 
 namespace tumbler{
 
+/**
+ * @class SpeakerConfig
+ * @brief PCM デバイスの設定
+ * @details 周期とバッファを小さくするほど、音声の再生要求から出力までの遅延は短くなるが、再生スレッドの起床頻度が上がりアンダーランし易くなる。
+ * 各フレーム数はドライバが対応する最も近い値に丸められ、実際の値は Speaker::periodFrames(), Speaker::bufferFrames() で確認できる。
+ */
+class DLL_PUBLIC SpeakerConfig
+{
+public:
+	std::string device_ = "default";       //!< PCM デバイス名（"null" や "file:FILE=out.raw,FORMAT=raw" 等の ALSA プラグインも指定できる）
+	snd_pcm_uframes_t periodFrames_ = 512;  //!< 周期のフレーム数（0 の場合はドライバの既定値。Speaker::k_period_frames_ を超える場合、再生スレッドは k_period_frames_ 毎に書き込む）
+	snd_pcm_uframes_t bufferFrames_ = 2048; //!< PCM デバイスのバッファのフレーム数（0 の場合はドライバの既定値）
+	snd_pcm_uframes_t startThreshold_ = 0;  //!< 再生を開始するまでに書き込むフレーム数（0 の場合は 1 周期分）
+	bool mmap_ = true; //!< MMAP_INTERLEAVED アクセスで PCM デバイスのバッファへ直接書き込む（デバイスが対応しない場合は RW_INTERLEAVED となる）
+};
+
+/**
+ * @class SpeakerRouting
+ * @brief 音声の出力先チャネル毎のゲイン
+ * @details 左チャネルはスピーカー、右チャネルは BT/USB オーディオサブシステムへの入力である。
+ * 既定ではスピーカーのみに出力する。両方のチャネルに異なるゲインで出力することもできる。
+ */
+class DLL_PUBLIC SpeakerRouting
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] left 左チャネル（スピーカー）のゲイン
+	 * @param [in] right 右チャネル（BT/USB オーディオサブシステム）のゲイン
+	 */
+	SpeakerRouting(float left = 1.0F, float right = 0.0F) : left_(left), right_(right) {}
+
+	/**
+	 * @brief 2 つの出力先が同じチャネルに出力するかを返す
+	 */
+	bool overlaps(const SpeakerRouting& other) const { return (left_ != 0 && other.left_ != 0) || (right_ != 0 && other.right_ != 0); }
+
+	float left_;  //!< 左チャネル（スピーカー）のゲイン
+	float right_; //!< 右チャネル（BT/USB オーディオサブシステム）のゲイン
+};
+
+class Speaker;
+
+/**
+ * @class Playback
+ * @brief batchPlay(), play() による 1 つの再生要求のハンドル
+ * @details 再生の完了は、音声の最後のフレームが PCM デバイスから出力された時点（snd_pcm_delay() から推定）とする。
+ * 完了は future() で待つか、onComplete() で登録したコールバック関数で受け取ることができる。コピーしたハンドルは同じ再生要求を指す。
+ */
+class DLL_PUBLIC Playback
+{
+public:
+	/**
+	 * @class Result
+	 * @brief 再生の結果
+	 */
+	enum class Result
+	{
+		completed_, //!< 最後まで再生した
+		cancelled_, //!< cancel() により停止した
+		stopped_,   //!< overwrite_ の再生要求により停止した、もしくは再生要求を受け付けられなかった
+	};
+
+	/**
+	 * @brief 再生要求を指さない空のハンドルを作成する
+	 */
+	Playback(){}
+
+	/**
+	 * @brief 再生要求を指すハンドルであるかを返す
+	 */
+	bool valid() const { return static_cast<bool>(state_); }
+
+	/**
+	 * @brief 再生の完了を待つ future を返す
+	 */
+	std::shared_future<Result> future() const;
+
+	/**
+	 * @brief 再生が完了したかを返す
+	 */
+	bool done() const;
+
+	/**
+	 * @brief 再生の完了を待ち、結果を返す
+	 */
+	Result wait() const;
+
+	/**
+	 * @brief 再生を停止する
+	 * @details 再生中の場合は Speaker::k_fade_frames_ でフェードアウトして停止し、再生待ちの場合は再生せずに破棄する。結果は Result::cancelled_ となる。
+	 * 完了後に呼び出した場合は何もしない。
+	 */
+	void cancel();
+
+	/**
+	 * @brief 再生が完了したときに呼び出すコールバック関数を登録する
+	 * @details コールバック関数は完了通知用のスレッドから呼び出される（既に完了している場合は呼び出し元のスレッドで直ちに呼び出される）。
+	 * 完了は PCM デバイスが音声を出力し終え、drain された後に通知されるため、コールバック関数の中で再生を要求した音声は PCM デバイスを
+	 * 再開してから再生され、先行する音声との間に隙間が生じる。隙間なく連続して再生する場合は Speaker::enqueue() を用いること。
+	 * コールバック関数の処理に時間がかかると、後続の再生要求の完了通知が遅れることに留意すること。
+	 * @param [in] callback コールバック関数（既に登録されている場合は置き換える）
+	 */
+	void onComplete(std::function<void(Result)> callback);
+
+	/**
+	 * @brief 現在出力されている位置を返す
+	 * @details PCM デバイスに書き込んだフレーム数と snd_pcm_delay() から推定した、出力済みの位置を再生を要求した音声上のサンプル位置で返す。
+	 * LED リング等の表示と音声の同期に用いることができる。
+	 * @return 再生を要求した音声の先頭からのサンプル数（再生開始前は 0）
+	 */
+	size_t position() const;
+
+	/**
+	 * @brief 再生を要求した音声のサンプル数を返す
+	 */
+	size_t length() const;
+
+private:
+	friend class Speaker;
+	class State;
+	explicit Playback(const std::shared_ptr<State>& state) : state_(state) {}
+	std::shared_ptr<State> state_;
+};
+
 /**
  * @class Speaker
  * @brief Speaker を保持するシングルトンクラス
- * @todo 書き換えが必要
+ * @details PCM デバイスは常駐する再生スレッドが専有し、再生する音声はロックフリーのリングバッファを経由して再生スレッドに渡される。
+ * write() で書き込まれた音声は、書き込み完了を待たずに 1 周期分（k_period_frames_）が揃い次第再生が開始されるため、
+ * 音声合成結果等を逐次書き込むことで、合成の完了を待たずに再生を開始することができる。
+ * batchPlay() で与えられた音声はボイスとして再生スレッドに渡され、write() による音声と周期毎に飽和加算でミキシングされる。
+ * PCM デバイスは k_device_rate_ で一度だけ開かれ、異なるサンプリングレートの音声は Resampler で変換して再生する。
+ * 各音声は SpeakerRouting に従って左右のチャネルに振り分けられ、1 回のインターリーブ書き込みで両チャネルが同時に出力される。
  */
 class DLL_PUBLIC Speaker
 {
@@ -56,38 +197,361 @@ public:
 
 	static Speaker& getInstance();
 
+	/**
+	 * @brief PCM デバイスの設定を指定してインスタンスを取得する
+	 * @param [in] config PCM デバイスの設定（最初に取得したときのみ有効）
+	 */
+	static Speaker& getInstance(const SpeakerConfig& config);
+
 	/**
 	 * @brief モノラル音声を再生する
+	 * @details 音声は呼び出し時に複製されるため、呼び出し元は直ちに audio を破棄してよい。スレッドの生成や PCM デバイスの再設定は行わず、直ちに返る。
+	 * normal_ は先行する normal_, overwrite_ の音声の再生終了を待って再生し、overlay_ は再生中の音声に重ねて直ちに再生し、
+	 * overwrite_ は再生中の batchPlay() による音声を k_fade_frames_ でフェードアウトさせて直ちに再生する。write() による音声はいずれのモードでも停止しない。
+	 * 再生の完了や位置は、返されるハンドルで知ることができる。
+	 * @param [in] audio 再生したいモノラル音声データ
+	 * @param [in] rate サンプリングレート（rate() と異なる場合は再生スレッドで変換しながら再生する）
+	 * @param [in] volume 再生ボリューム[0,1]
+	 * @param [in] mode プレイバックモード
+	 * @return 再生要求のハンドル
+	 */
+	Playback batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode);
+
+	/**
+	 * @brief 正規化の有無を指定してモノラル音声を再生する
+	 * @details normalize が true の場合は上記と同じく、音声の絶対値の最大値が volume となるよう正規化する（音声全体の走査が必要）。
+	 * false の場合は走査を行わず volume をそのままゲインとして乗じる。繰り返し再生する音声は normalizationGain() を予め一度だけ求め、
+	 * volume * normalizationGain() を与えて normalize を false とすることで、再生毎の走査を省くことができる。
 	 * @param [in] audio 再生したいモノラル音声データ
 	 * @param [in] rate サンプリングレート
+	 * @param [in] volume 再生ボリューム[0,1]（normalize が false の場合はゲイン）
+	 * @param [in] mode プレイバックモード
+	 * @param [in] normalize 正規化するか
+	 * @return 再生要求のハンドル
+	 */
+	Playback batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode, bool normalize);
+
+	/**
+	 * @brief 出力先チャネルを指定してモノラル音声を再生する
+	 * @details プレイバックモードは出力先のチャネルが重なる音声の間でのみ作用する。例えば右チャネルのみに出力する音声は、左チャネルのみに出力する音声の再生終了を待たず、停止もしない。
+	 * @param [in] audio 再生したいモノラル音声データ
+	 * @param [in] rate サンプリングレート
+	 * @param [in] volume 再生ボリューム[0,1]（normalize が false の場合はゲイン）
+	 * @param [in] mode プレイバックモード
+	 * @param [in] normalize 正規化するか
+	 * @param [in] routing 出力先チャネル毎のゲイン
+	 * @return 再生要求のハンドル
+	 */
+	Playback batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode, bool normalize, const SpeakerRouting& routing);
+
+	/**
+	 * @brief 音声の絶対値の最大値を最大振幅に合わせる正規化ゲインを返す
+	 * @param [in] audio モノラル音声データ
+	 * @param [in] n サンプル数
+	 * @return 正規化ゲイン（無音の場合は 0）
+	 */
+	static float normalizationGain(const short* audio, size_t n);
+
+	/**
+	 * @brief SoundBank に読み込んだ音声を再生する
+	 * @details 音声は複製されず、再生スレッドはハンドルを保持したまま SoundBank 上のサンプルを直接読み出す。
+	 * 正規化ゲインは読み込み時に求めたものを用いるため、再生毎の走査も行わない。プレイバックモードの挙動は batchPlay() と同じである。
+	 * @param [in] sound 音声のハンドル
+	 * @param [in] volume 再生ボリューム[0,1]
+	 * @param [in] mode プレイバックモード
+	 * @return 再生要求のハンドル
+	 */
+	Playback play(const SoundBank::Handle& sound, float volume, Speaker::PlayBackMode mode);
+
+	/**
+	 * @brief 出力先チャネルを指定して SoundBank に読み込んだ音声を再生する
+	 * @param [in] sound 音声のハンドル
+	 * @param [in] volume 再生ボリューム[0,1]
+	 * @param [in] mode プレイバックモード
+	 * @param [in] routing 出力先チャネル毎のゲイン
+	 * @return 再生要求のハンドル
+	 */
+	Playback play(const SoundBank::Handle& sound, float volume, Speaker::PlayBackMode mode, const SpeakerRouting& routing);
+
+	/**
+	 * @brief 通知音を合成して再生する
+	 * @details 通知音は音声データとして用意されず、再生スレッドが周期毎に必要な分だけを周期のバッファへ直接合成する（合成時のヒープ確保はない）。
+	 * 音声ファイルの読み込みやメモリを要さず、再生の都度パラメータを変えた通知音を再生することができる。プレイバックモードの挙動は batchPlay() と同じである。
+	 * 正規化は行わず、各トーンの振幅に volume を乗じる。
+	 * @param [in] earcon 通知音
+	 * @param [in] volume 再生ボリューム[0,1]
+	 * @param [in] mode プレイバックモード
+	 * @return 再生要求のハンドル
+	 * @note 通知音に rate() の半分以上の周波数のトーンが含まれる場合は std::invalid_argument 例外が送出される
+	 */
+	Playback play(const Earcon& earcon, float volume, Speaker::PlayBackMode mode);
+
+	/**
+	 * @brief 出力先チャネルを指定して通知音を合成して再生する
+	 * @param [in] earcon 通知音
 	 * @param [in] volume 再生ボリューム[0,1]
 	 * @param [in] mode プレイバックモード
+	 * @param [in] routing 出力先チャネル毎のゲイン
+	 * @return 再生要求のハンドル
+	 */
+	Playback play(const Earcon& earcon, float volume, Speaker::PlayBackMode mode, const SpeakerRouting& routing);
+
+	/**
+	 * @brief 再生キューの末尾にモノラル音声を追加する（隙間のない連続再生）
+	 * @details 追加した音声は normal_ と同じく先行する音声の再生終了を待って再生されるが、先行する音声の末尾のサンプルの直後から
+	 * PCM デバイスを止めずにサンプル単位で隙間なく続けて再生され、フェードインも行わない。文単位で合成した TTS の音声、複数の音声素片を
+	 * 連結して 1 つの発話とする場合に用いる。crossfadeFrames を与えた場合は、先行する音声の末尾 crossfadeFrames フレームと
+	 * この音声の先頭を重ね、線形にクロスフェードする（先行する音声が rate() で与えられたものである場合に限る）。
+	 * rate() と異なるサンプリングレートの音声は、呼び出し側のスレッドでこの時点で変換しておく（先行する音声の再生中に次の音声の変換を済ませる）。
+	 * 連結する音声同士の相対的な音量を保つため、正規化は行わない。
+	 * @param [in] audio モノラル音声データ
+	 * @param [in] rate サンプリングレート
+	 * @param [in] gain 音声に乗じるゲイン
+	 * @param [in] crossfadeFrames 先行する音声と重ねるフレーム数（0 の場合は重ねずに続けて再生する）
+	 * @return 再生要求のハンドル
+	 */
+	Playback enqueue(const std::vector<short>& audio, int rate, float gain, size_t crossfadeFrames);
+
+	/**
+	 * @brief 出力先チャネルを指定して再生キューの末尾にモノラル音声を追加する
+	 * @param [in] audio モノラル音声データ
+	 * @param [in] rate サンプリングレート
+	 * @param [in] gain 音声に乗じるゲイン
+	 * @param [in] crossfadeFrames 先行する音声と重ねるフレーム数
+	 * @param [in] routing 出力先チャネル毎のゲイン
+	 * @return 再生要求のハンドル
+	 */
+	Playback enqueue(const std::vector<short>& audio, int rate, float gain, size_t crossfadeFrames, const SpeakerRouting& routing);
+
+	/**
+	 * @brief 再生キューの末尾に SoundBank に読み込んだ音声を追加する
+	 * @details 挙動は上記と同じである。音声は複製されない（サンプリングレートが rate() と異なる場合を除く）。
+	 * 読み込み時の正規化ゲインは適用しないため、必要であれば gain に sound->normalizationGain() を乗じて与えること。
+	 * @param [in] sound 音声のハンドル
+	 * @param [in] gain 音声に乗じるゲイン
+	 * @param [in] crossfadeFrames 先行する音声と重ねるフレーム数
+	 * @return 再生要求のハンドル
+	 */
+	Playback enqueue(const SoundBank::Handle& sound, float gain, size_t crossfadeFrames);
+
+	/**
+	 * @brief 出力先チャネルを指定して再生キューの末尾に SoundBank に読み込んだ音声を追加する
+	 * @param [in] sound 音声のハンドル
+	 * @param [in] gain 音声に乗じるゲイン
+	 * @param [in] crossfadeFrames 先行する音声と重ねるフレーム数
+	 * @param [in] routing 出力先チャネル毎のゲイン
+	 * @return 再生要求のハンドル
+	 */
+	Playback enqueue(const SoundBank::Handle& sound, float gain, size_t crossfadeFrames, const SpeakerRouting& routing);
+
+	/**
+	 * @brief モノラル音声を逐次書き込む（ストリーミング再生）
+	 * @details 書き込まれた音声はリングバッファを経由して再生スレッドにより順次再生される。リングバッファが満杯の場合は空きができるまでブロックする。
+	 * 一連の音声を書き込み終えたら drain() を呼び出すこと。drain() を呼ばずに書き込みが途切れ、再生が追いつかなかった場合はアンダーランとして数えられる。
+	 * @param [in] audio モノラル音声データ（サンプリングレートは rate() とすること）
+	 * @param [in] n サンプル数
+	 */
+	void write(const short* audio, size_t n);
+
+	/**
+	 * @brief サンプリングレートを指定してモノラル音声を逐次書き込む
+	 * @details rate() と異なるサンプリングレートの音声は、書き込み側のスレッドで rate() に変換してから write() と同様に書き込む。
+	 * 一連の書き込みの途中でサンプリングレートを変えてもよい。
+	 * @param [in] audio モノラル音声データ
+	 * @param [in] n サンプル数
+	 * @param [in] rate サンプリングレート
+	 */
+	void write(const short* audio, size_t n, int rate);
+
+	/**
+	 * @brief write() で書き込んだ音声の再生が全て完了するまでブロックする
+	 */
+	void drain();
+
+	/**
+	 * @brief write() による音声の出力先チャネルを設定する
+	 * @details リングバッファに書き込み済みで未再生の音声にも直ちに適用される。例えば SpeakerRouting(0, 1) とすることで、
+	 * リモートの音声を write() で BT/USB オーディオサブシステムへ出力しながら、batchPlay(), play() による音声をスピーカーから出力することができる。
+	 * @param [in] routing 出力先チャネル毎のゲイン
 	 */
-	void batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode);
+	void setStreamRouting(const SpeakerRouting& routing);
+
+	/**
+	 * @brief write() による音声の出力先チャネルを返す
+	 */
+	SpeakerRouting streamRouting() const { return SpeakerRouting(streamLeftGain_.load(), streamRightGain_.load()); }
 
 	/**
 	 * @brief 音声再生中であるかを返す
+	 * @details 完了していない batchPlay(), play() による再生要求があるか、write() による書き込みが drain() の完了前である場合に true となる。
 	 * @return true if on play.
 	 */
-	bool state(){ return state_.load(); }
+	bool state(){ return activePlaybacks_.load() > 0 || streamActive_.load(); }
+
+	/**
+	 * @brief PCM デバイスのサンプリングレートを返す
+	 */
+	int rate() const { return rate_.load(); }
+
+	/**
+	 * @brief 再生中に書き込みが追いつかず、PCM デバイスがアンダーランした回数を返す
+	 * @details PCM デバイスへの書き込みが -EPIPE（XRUN 状態）で失敗し、デバイスを再準備した回数である。
+	 */
+	uint64_t underruns() const { return underruns_.load(); }
+
+	/**
+	 * @brief write() による書き込みが途切れた回数を返す
+	 * @details drain() を呼ばずに write() による書き込みが途切れ、他の音声の再生中に書き込み済みの音声が尽きた周期の数である。
+	 * 他の音声で PCM デバイスへの出力は継続しているため、underruns() には数えない。
+	 */
+	uint64_t starvations() const { return starvations_.load(); }
+
+	/**
+	 * @brief 出力遅延を計測して返す
+	 * @details PCM デバイスに書き込み済みで未出力のフレーム数（snd_pcm_delay()）を時間に換算したもの。
+	 * batchPlay(), play() による音声は概ねこの遅延に 1 周期分を加えた時間の後に出力され、write() による音声には更にリングバッファに滞留する分が加わる。
+	 * @return 出力遅延 [ms]
+	 */
+	double latencyMs();
+
+	/**
+	 * @brief PCM デバイスの周期のフレーム数を返す
+	 */
+	snd_pcm_uframes_t periodFrames() const { return periodFrames_; }
+
+	/**
+	 * @brief PCM デバイスのバッファのフレーム数を返す
+	 */
+	snd_pcm_uframes_t bufferFrames() const { return bufferFrames_; }
+
+	/**
+	 * @brief MMAP_INTERLEAVED アクセスで書き込んでいるかを返す
+	 */
+	bool mmap() const { return mmap_; }
+
+	static const size_t k_period_frames_ = 1024;  //!< 再生スレッドが 1 回に PCM デバイスへ書き込む最大フレーム数（実際は PCM デバイスの周期毎に書き込む）
+	static const size_t k_ring_frames_ = 16384;   //!< リングバッファの容量（フレーム数）
+	static const size_t k_fade_frames_ = 256;     //!< batchPlay() による音声のフェードイン、フェードアウトのフレーム数
+	static const size_t k_voice_queue_ = 64;      //!< 再生スレッドが受け取る前の batchPlay() 要求を保持できる数
+	static const size_t k_max_voices_ = 256;      //!< 再生スレッドが同時に保持できる再生中、再生待ちの音声の数（超えた分はキューに留め置く）
+	static const size_t k_completion_queue_ = 256; //!< 再生スレッドから完了通知用のスレッドへ渡す完了通知を保持できる数
+	static const int k_device_rate_ = 44100;      //!< PCM デバイスのサンプリングレート
 
 private:
 
-	const std::string device_name_ = "default";
-	void init(int rate);
+	/**
+	 * @class Voice
+	 * @brief batchPlay() で与えられた、ミキシング対象の 1 つの音声
+	 */
+	class Voice
+	{
+	public:
+		/**
+		 * @brief 再生し終えたかを返す
+		 */
+		bool finished() const { return position_ >= length_ && (!resampler_ || (flushed_ && convertedBegin_ == convertedEnd_)); }
+
+		/**
+		 * @brief 残りを再生せずに終了させる
+		 */
+		void finish(){ position_ = length_; flushed_ = true; convertedBegin_ = convertedEnd_ = 0; }
+
+		const short* samples_ = nullptr;    //!< ゲイン適用前のモノラル音声（synth_ で合成する場合は nullptr）
+		size_t length_ = 0;                 //!< samples_ のサンプル数
+		std::shared_ptr<const void> owner_; //!< samples_ の所有者（再生中に解放されないよう保持する）
+		size_t position_ = 0;       //!< 次に再生（変換）する samples_ 上のサンプル位置
+		size_t played_ = 0;         //!< 再生したフレーム数
+		float gain_ = 1.0F;         //!< ボイス毎のゲイン
+		SpeakerRouting routing_;    //!< 出力先チャネル毎のゲイン
+		std::shared_ptr<Playback::State> playback_; //!< 再生要求の状態
+		bool stopped_ = false;      //!< overwrite_ の再生要求により停止したか
+		PlayBackMode mode_ = PlayBackMode::normal_;
+		size_t fadeIn_ = k_fade_frames_;     //!< フェードインのフレーム数
+		size_t fadeLength_ = k_fade_frames_; //!< フェードアウト全体のフレーム数
+		size_t fadeOut_ = 0;        //!< フェードアウトの残りフレーム数
+		bool fadingOut_ = false;    //!< フェードアウト中であるか
+		size_t crossfade_ = 0;      //!< 先行する音声と重ねるフレーム数（enqueue() によるもの）
+		size_t release_ = 0;        //!< 現在の周期で後続の normal_ の音声の再生を許す、周期内のフレーム位置
+		std::unique_ptr<ToneSynth> synth_;     //!< play(const Earcon&, ...) による通知音の合成器
+		std::unique_ptr<Resampler> resampler_; //!< PCM デバイスとサンプリングレートが異なる場合の変換器
+		std::vector<short> converted_;         //!< 変換済みで未再生の音声
+		size_t convertedBegin_ = 0;
+		size_t convertedEnd_ = 0;
+		bool flushed_ = false;                 //!< 変換器から末尾の出力を取り出したか
+	};
+
+	void init(const SpeakerConfig& config);
 	void close();
+	void playbackImpl_();
+	void writeFrames_(const short* left, const short* right, size_t frames, short* stereo);
+	bool recover_(int errorno);
+	void writeLocked_(const short* audio, size_t n);
+	void drainLocked_();
+	void flushWriterResampler_();
+	void acceptVoices_();
+	size_t voiceOffset_(size_t index, size_t limit) const;
+	size_t crossfadePoint_(size_t index) const;
+	size_t voiceSource_(Voice& voice, short* out, size_t frames, const short*& source);
+	size_t renderVoice_(Voice& voice, short* out, size_t frames);
+	size_t mixPeriod_(short* left, short* right, short* work, short* gained);
+	Playback enqueueVoice_(Voice* voice, int rate);
+	Playback enqueueConverted_(const short* audio, size_t n, int rate, std::shared_ptr<const void> owner, float gain, size_t crossfadeFrames, const SpeakerRouting& routing);
+	void retireVoice_(Voice* voice);
+	void stopVoice_(Voice& voice);
+	void updatePosition_();
+	uint64_t playedFrames_();
+	void completePlaybacks_(bool all);
+	void dispatchImpl_();
 
-	Speaker();
+	explicit Speaker(const SpeakerConfig& config);
 	Speaker(const Speaker&);
 	~Speaker();
 	Speaker &operator=(const Speaker&);
+	friend class Playback;
 
-    std::mutex mutex_;
+	std::mutex mutex_;          //!< PCM デバイスの排他
+	std::mutex writerMutex_;    //!< リングバッファへの書き込み側（単一生産者）の排他
 	snd_pcm_t* pcm_handle_;
 	snd_pcm_hw_params_t* pcm_params_;
+	snd_pcm_uframes_t periodFrames_;  //!< PCM デバイスの周期のフレーム数
+	snd_pcm_uframes_t bufferFrames_;  //!< PCM デバイスのバッファのフレーム数
+	snd_pcm_uframes_t startThreshold_;
+	size_t mixFrames_;                //!< 再生スレッドが 1 回に書き込むフレーム数
+	bool mmap_;
 	std::atomic<int> rate_;
-	std::atomic<bool> state_;
 
+	RingBuffer<short> ring_;
+	std::future<void> playback_;
+	std::atomic<bool> stopflag_;
+	sem_t dataSem_;             //!< リングバッファへの書き込み及び drain 要求を再生スレッドに通知する
+	std::mutex spaceMutex_;
+	std::condition_variable spaceCond_; //!< リングバッファに空きができたことを書き込み側に通知する
+	std::mutex drainMutex_;
+	std::condition_variable drainCond_;
+	std::atomic<bool> drainRequested_;
+	std::atomic<uint64_t> underruns_;
+	std::atomic<uint64_t> starvations_; //!< write() による書き込みが途切れた周期の数
+	std::atomic<bool> streamActive_; //!< write() による書き込みが drain() されずに継続中であるか
+	std::atomic<float> streamLeftGain_;  //!< write() による音声の左チャネルのゲイン
+	std::atomic<float> streamRightGain_; //!< write() による音声の右チャネルのゲイン
+	std::unique_ptr<Resampler> writerResampler_; //!< write() に与えられた音声の変換器
+	std::vector<short> writerBuffer_;            //!< write() に与えられた音声の変換結果
+
+	std::mutex voiceMutex_;           //!< ボイスキューへの書き込み側（単一生産者）の排他
+	RingBuffer<Voice*> voiceQueue_;   //!< batchPlay() から再生スレッドへボイスを渡すキュー（所有権は再生スレッドへ移る）
+	std::vector<Voice*> voices_;      //!< 再生スレッドが保持するボイス（到着順、最大 k_max_voices_）
+	bool deviceActive_;               //!< PCM デバイスに書き込み、drain していないか（再生スレッド専用）
+
+	std::atomic<int> activePlaybacks_;     //!< 完了していない再生要求の数
+	std::atomic<uint64_t> framesWritten_;  //!< PCM デバイスに書き込んだ総フレーム数
+	std::mutex positionMutex_;
+	uint64_t positionFrames_;              //!< 最後に計測した時点で出力済みの総フレーム数
+	std::chrono::steady_clock::time_point positionTime_; //!< 最後に計測した時刻
+	std::vector<std::shared_ptr<Playback::State>> pending_; //!< 書き込みを終え、出力の完了を待っている再生要求（再生スレッド専用）
+	RingBuffer<std::shared_ptr<Playback::State>> completionQueue_; //!< 再生スレッドから完了通知用のスレッドへ渡す完了通知
+	sem_t completionSem_;
+	std::atomic<bool> dispatchStopflag_;
+	std::future<void> dispatcher_;
 };
 
 }
@@ -0,0 +1,236 @@
+/*
+ * @file stft.h
+ * \~english
+ * @brief Multichannel short-time Fourier transform shared between audio processing stages
+ * \~japanese
+ * @brief 音声処理の各段で共有する多チャネルの短時間フーリエ変換
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_STFT_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_STFT_H_
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/fft.h"
+
+namespace tumbler{
+
+/**
+ * @brief 短時間フーリエ変換の窓関数
+ */
+enum class StftWindow
+{
+	hann_,        //!< ハン窓（シフト幅がフレーム長の 1/2 以下で重畳加算すると一定となる）
+	sqrtHann_,    //!< 平方根ハン窓（分析と合成の両方にかけると、シフト幅がフレーム長の 1/2 でハン窓と同じになる）
+	rectangular_  //!< 矩形窓
+};
+
+/**
+ * @brief 窓関数の値を求める
+ * @param [out] dst 出力先（size 要素）
+ * @param [in] window 窓関数
+ * @param [in] size フレーム長
+ */
+DLL_PUBLIC void stftWindow(float* dst, StftWindow window, size_t size);
+
+/**
+ * @brief 窓関数の二乗平均（窓をかけたフレームの電力から、入力の電力を求めるために用いる）
+ * @param [in] window 窓関数
+ */
+DLL_PUBLIC float stftWindowPower(StftWindow window);
+
+/**
+ * @class StftFrame
+ * @brief 1 フレーム分の多チャネルのスペクトル
+ * @details チャネル毎の実部と虚部を、それぞれキャッシュライン境界に整列した別の領域に置く（planar 形式）。
+ * StftAnalyzer が求めたフレームを、DirectionEstimator、Beamformer 等の複数の処理で共有するために用いる。
+ */
+class DLL_PUBLIC StftFrame
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] channels チャネル数
+	 * @param [in] size フレーム長（FFT の変換長）
+	 * @param [in] hop シフト幅
+	 * @param [in] window 分析窓
+	 */
+	StftFrame(size_t channels, size_t size, size_t hop, StftWindow window);
+
+	float* re(size_t channel){ return re_.data() + channel * stride_; }
+	const float* re(size_t channel) const { return re_.data() + channel * stride_; }
+	float* im(size_t channel){ return im_.data() + channel * stride_; }
+	const float* im(size_t channel) const { return im_.data() + channel * stride_; }
+
+	size_t channels() const { return channels_; }
+	size_t size() const { return size_; }
+	size_t hop() const { return hop_; }
+	size_t bins() const { return size_ / 2 + 1; }
+	StftWindow window() const { return window_; }
+
+	uint64_t index_;  //!< フレーム番号（0 始まり）
+	uint64_t end_;    //!< フレームの末尾の次のサンプルの、入力の先頭からの通し番号
+
+private:
+	StftFrame(const StftFrame&);
+	StftFrame &operator=(const StftFrame&);
+
+	size_t channels_;
+	size_t size_;
+	size_t hop_;
+	size_t stride_;   //!< チャネル間の間隔 [要素]（整列境界の倍数）
+	StftWindow window_;
+	AlignedBuffer<float> re_;
+	AlignedBuffer<float> im_;
+};
+
+/**
+ * @class StftAnalyzer
+ * @brief 多チャネルの短時間フーリエ変換（分析）
+ * @details hop サンプル毎に、全チャネルの直近 size サンプルに分析窓をかけて FFT を行い、1 つの StftFrame とする。
+ * 入力の先頭では、それ以前の入力を 0 として扱う（最初のフレームは hop サンプルの入力で得られる）。窓関数と回転因子は構築時に一度だけ求め、process() はヒープ確保を行わない。
+ */
+class DLL_PUBLIC StftAnalyzer
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] channels チャネル数
+	 * @param [in] size フレーム長（4 以上の 2 のべき乗）
+	 * @param [in] hop シフト幅（1 以上 size 以下）
+	 * @param [in] window 分析窓
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	StftAnalyzer(size_t channels, size_t size, size_t hop, StftWindow window = StftWindow::hann_);
+
+	/**
+	 * @brief 入力を処理し、フレームが得られる毎に consume を呼ぶ
+	 * @param [in] in チャネル毎の入力（channels チャネル、各 frames サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @param [in] consume void(const StftFrame&) として呼び出せる関数オブジェクト（フレームは次のフレームが得られるまで有効）
+	 * @return 得られたフレームの数
+	 */
+	template<typename Consume>
+	size_t process(const float* const* in, size_t frames, Consume consume)
+	{
+		size_t count = 0;
+		size_t done = 0;
+		while(done < frames){
+			const size_t n = std::min(frames - done, hop_ - filled_);
+			for(size_t c=0;c<channels_;++c){
+				std::memcpy(history_.data() + c * size_ + size_ - hop_ + filled_, in[c] + done, n * sizeof(float));
+			}
+			filled_ += n;
+			done += n;
+			samples_ += n;
+			if(filled_ == hop_){
+				analyze_();
+				consume(static_cast<const StftFrame&>(frame_));
+				count++;
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * @brief 最後に得られたフレームを返す
+	 */
+	const StftFrame& frame() const { return frame_; }
+
+	/**
+	 * @brief 入力の履歴を初期化する
+	 */
+	void reset();
+
+	size_t channels() const { return channels_; }
+	size_t size() const { return size_; }
+	size_t hop() const { return hop_; }
+	StftWindow window() const { return frame_.window(); }
+
+private:
+	StftAnalyzer(const StftAnalyzer&);
+	StftAnalyzer &operator=(const StftAnalyzer&);
+	void analyze_();
+
+	size_t channels_;
+	size_t size_;
+	size_t hop_;
+	FFT fft_;
+	AlignedBuffer<float> window_;
+	AlignedBuffer<float> history_;  //!< チャネル毎の直近 size_ サンプル（channels_ x size_。末尾の hop_ サンプルに今回の入力を書き込む）
+	AlignedBuffer<float> work_;     //!< 窓をかけたフレーム
+	size_t filled_;                 //!< 今回のシフト分として書き込んだサンプル数
+	uint64_t samples_;              //!< 入力の先頭からのサンプル数
+	StftFrame frame_;
+};
+
+/**
+ * @class StftSynthesizer
+ * @brief 1 チャネルの短時間フーリエ逆変換（重畳加算による合成）
+ * @details フレーム毎に逆 FFT の結果に合成窓をかけて重畳加算し、hop サンプルずつ出力する。分析窓と合成窓の積の重畳加算が一定とならない組合せでも、
+ * 出力位置毎にその和で正規化するため、スペクトルを変更しなければ入力を size - hop サンプル遅延させたものに戻る。
+ */
+class DLL_PUBLIC StftSynthesizer
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] size フレーム長（4 以上の 2 のべき乗）
+	 * @param [in] hop シフト幅（1 以上 size 以下）
+	 * @param [in] analysis 分析に用いた窓
+	 * @param [in] synthesis 合成窓
+	 * @note 設定が正しくない場合、及び窓の積の重畳加算が 0 となる位置がある場合は std::invalid_argument 例外が送出される
+	 */
+	StftSynthesizer(size_t size, size_t hop, StftWindow analysis, StftWindow synthesis);
+
+	/**
+	 * @brief 1 フレーム分のスペクトルを合成する
+	 * @param [in] re 周波数ビン 0〜size/2 の実部
+	 * @param [in] im 周波数ビン 0〜size/2 の虚部
+	 * @param [out] out 出力先（hop サンプル）
+	 */
+	void synthesize(const float* re, const float* im, float* out);
+
+	/**
+	 * @brief 重畳加算中の出力を初期化する
+	 */
+	void reset();
+
+	size_t size() const { return size_; }
+	size_t hop() const { return hop_; }
+
+private:
+	StftSynthesizer(const StftSynthesizer&);
+	StftSynthesizer &operator=(const StftSynthesizer&);
+
+	size_t size_;
+	size_t hop_;
+	FFT fft_;
+	AlignedBuffer<float> window_;         //!< 合成窓に、出力位置毎の正規化係数を乗じたもの
+	AlignedBuffer<float> overlap_;        //!< 重畳加算中の出力（size_ サンプル）
+	AlignedBuffer<float> work_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_STFT_H_ */
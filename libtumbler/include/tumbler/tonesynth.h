@@ -0,0 +1,249 @@
+/*
+ * @file tonesynth.h
+ * \~english
+ * @brief Allocation-free tone and earcon synthesizer
+ * \~japanese
+ * @brief 通知音（イヤコン）をヒープ確保なしで合成するトーン合成器
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_TONESYNTH_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_TONESYNTH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "tumbler/tumbler.h"
+
+namespace tumbler{
+
+/**
+ * @class ToneWaveform
+ * @brief トーンの波形
+ */
+enum class ToneWaveform
+{
+	sine_,   //!< 正弦波
+	square_, //!< 矩形波（PolyBLEP により折り返し雑音を抑える）
+};
+
+/**
+ * @class ToneEnvelope
+ * @brief トーンの ADSR エンベロープ
+ * @details アタックで 0 から 1 まで、ディケイで sustain_ まで線形に変化し、トーンの末尾 releaseMs_ で 0 まで線形に減衰する。
+ * トーンがアタック、ディケイ、リリースの合計より短い場合は、リリースはその時点のレベルから始まる。
+ */
+class DLL_PUBLIC ToneEnvelope
+{
+public:
+	ToneEnvelope(float attackMs = 5.0F, float decayMs = 0.0F, float sustain = 1.0F, float releaseMs = 20.0F) :
+		attackMs_(attackMs), decayMs_(decayMs), sustain_(sustain), releaseMs_(releaseMs) {}
+
+	float attackMs_;  //!< アタック時間 [ms]
+	float decayMs_;   //!< ディケイ時間 [ms]
+	float sustain_;   //!< サステインレベル [0,1]
+	float releaseMs_; //!< リリース時間 [ms]
+};
+
+/**
+ * @class Tone
+ * @brief 1 つのトーン
+ * @details endFrequency_ を frequency_ と異なる値とした場合は、トーンの長さの間に周波数を指数的に（音程が一定の速さで変わるように）掃引する。
+ */
+class DLL_PUBLIC Tone
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] waveform 波形
+	 * @param [in] frequency 周波数 [Hz]
+	 * @param [in] durationMs 長さ（リリースを含む）[ms]
+	 * @param [in] amplitude 最大振幅 [0,1]
+	 */
+	Tone(ToneWaveform waveform = ToneWaveform::sine_, float frequency = 880.0F, float durationMs = 100.0F, float amplitude = 0.5F) :
+		waveform_(waveform), frequency_(frequency), endFrequency_(frequency), durationMs_(durationMs), amplitude_(amplitude) {}
+
+	/**
+	 * @brief 終了時の周波数を設定する（周波数の掃引）
+	 * @param [in] frequency 終了時の周波数 [Hz]
+	 * @return このトーン
+	 */
+	Tone& sweep(float frequency){ endFrequency_ = frequency; return *this; }
+
+	/**
+	 * @brief エンベロープを設定する
+	 * @param [in] envelope エンベロープ
+	 * @return このトーン
+	 */
+	Tone& envelope(const ToneEnvelope& envelope){ envelope_ = envelope; return *this; }
+
+	ToneWaveform waveform_; //!< 波形
+	float frequency_;       //!< 開始時の周波数 [Hz]
+	float endFrequency_;    //!< 終了時の周波数 [Hz]
+	float durationMs_;      //!< 長さ（リリースを含む）[ms]
+	float amplitude_;       //!< 最大振幅 [0,1]
+	ToneEnvelope envelope_; //!< エンベロープ
+};
+
+/**
+ * @class Earcon
+ * @brief 複数のトーンを時間軸上に並べた通知音
+ * @details トーンは固定長の配列に保持され、ヒープ確保を行わない。値として複製して用いることができるため、音量の段階に応じて音程を変える等、
+ * 再生の都度パラメータを変えた通知音を作ることができる。開始時刻の重なるトーンは加算される。
+ */
+class DLL_PUBLIC Earcon
+{
+public:
+	Earcon() : size_(0) {}
+
+	/**
+	 * @brief 開始時刻を指定してトーンを追加する
+	 * @param [in] tone トーン
+	 * @param [in] startMs 通知音の先頭からの開始時刻 [ms]
+	 * @return この通知音
+	 * @note k_max_tones_ を超えて追加した場合は std::runtime_error 例外が送出される
+	 */
+	Earcon& add(const Tone& tone, float startMs);
+
+	/**
+	 * @brief これまでに追加したトーンが全て終了した後にトーンを追加する
+	 * @param [in] tone トーン
+	 * @param [in] gapMs 直前のトーンの終了からの無音の長さ [ms]
+	 * @return この通知音
+	 * @note k_max_tones_ を超えて追加した場合は std::runtime_error 例外が送出される
+	 */
+	Earcon& append(const Tone& tone, float gapMs = 0.0F);
+
+	/**
+	 * @brief トーンの数を返す
+	 */
+	size_t size() const { return size_; }
+
+	/**
+	 * @brief トーンを返す
+	 */
+	const Tone& tone(size_t i) const { return tones_[i]; }
+
+	/**
+	 * @brief トーンの開始時刻 [ms] を返す
+	 */
+	float startMs(size_t i) const { return starts_[i]; }
+
+	/**
+	 * @brief 通知音の長さ（最後に終了するトーンの終了時刻）[ms] を返す
+	 */
+	float durationMs() const;
+
+	static const size_t k_max_tones_ = 16; //!< 1 つの通知音に含めることができるトーンの最大数
+
+private:
+	Tone tones_[k_max_tones_];
+	float starts_[k_max_tones_];
+	size_t size_;
+};
+
+/**
+ * @class ToneSynth
+ * @brief Earcon を指定したサンプリングレートのモノラル音声として逐次合成する
+ * @details 正弦波は 1 周期を k_table_size_ 点で表した表を位相累算器で線形補間して読み出す（表は全インスタンスで共有し、初回の使用時に一度だけ作成する）。
+ * 合成はヒープ確保を行わず、任意の長さに分割して呼び出すことができ、分割の仕方によらず同じ出力が得られる。
+ * Speaker は再生スレッドで周期毎に必要な分だけを周期のバッファへ直接合成する。
+ */
+class DLL_PUBLIC ToneSynth
+{
+public:
+	/**
+	 * @brief コンストラクタ（無音）
+	 */
+	ToneSynth();
+
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] earcon 通知音
+	 * @param [in] rate サンプリングレート
+	 * @note 周波数が (0, rate/2) の範囲にないトーンを含む場合は std::invalid_argument 例外が送出される
+	 */
+	ToneSynth(const Earcon& earcon, int rate);
+
+	/**
+	 * @brief 続きを合成する
+	 * @param [out] out 出力先
+	 * @param [in] frames 合成する最大のフレーム数
+	 * @return 合成したフレーム数（末尾に達した場合は frames より小さい）
+	 */
+	size_t render(short* out, size_t frames);
+
+	/**
+	 * @brief 先頭に戻す
+	 */
+	void reset();
+
+	/**
+	 * @brief 通知音全体のフレーム数を返す
+	 */
+	size_t length() const { return length_; }
+
+	/**
+	 * @brief 次に合成するフレーム位置を返す
+	 */
+	size_t position() const { return position_; }
+
+	/**
+	 * @brief 末尾まで合成したかを返す
+	 */
+	bool finished() const { return position_ >= length_; }
+
+	static const int k_table_bits_ = 12;                   //!< 正弦波の表のサイズの 2 の対数
+	static const size_t k_table_size_ = 1 << k_table_bits_; //!< 正弦波の表の 1 周期あたりの点数
+	static const size_t k_block_ = 256;                      //!< 1 回に加算するフレーム数（スタック上の作業領域の大きさ）
+
+private:
+	/**
+	 * @class Oscillator
+	 * @brief 1 つのトーンの合成状態
+	 */
+	class Oscillator
+	{
+	public:
+		ToneWaveform waveform_ = ToneWaveform::sine_;
+		size_t begin_ = 0;        //!< 開始フレーム
+		size_t length_ = 0;       //!< フレーム数
+		float amplitude_ = 0;
+		double increment0_ = 0;   //!< 開始時の 1 フレームあたりの位相の増分（1 周期を 2^32 とする）
+		double ratio_ = 1;        //!< 1 フレーム毎に位相の増分に乗じる比（掃引）
+		size_t attack_ = 0;       //!< アタックのフレーム数
+		size_t decay_ = 0;        //!< ディケイのフレーム数
+		size_t release_ = 0;      //!< リリースのフレーム数
+		float sustain_ = 1;
+		float releaseLevel_ = 1;  //!< リリース開始時のレベル
+		uint32_t phase_ = 0;      //!< 位相
+		double increment_ = 0;    //!< 現在の位相の増分
+		size_t done_ = 0;         //!< 合成したフレーム数
+	};
+
+	void renderOscillator_(Oscillator& osc, float* acc, size_t frames);
+
+	Oscillator oscillators_[Earcon::k_max_tones_];
+	size_t count_;
+	size_t length_;
+	size_t position_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_TONESYNTH_H_ */
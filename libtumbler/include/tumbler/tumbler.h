@@ -15,6 +15,8 @@
 #include <mutex>
 #include <stdexcept>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 
 namespace tumbler
 {
@@ -34,6 +36,44 @@ namespace tumbler
 		int errorno_;
 	};
 
+	/**
+	 * @class LEDRingBrightness
+	 * @brief LED リングの点灯状態を、タッチボタンへの干渉の推定に必要な粒度で要約したデータクラス
+	 * @details LED リングの 18 個の LED を連続する 3 個ずつの 6 セグメントに分け、各セグメントの平均輝度を保持する。
+	 * 点灯状態が変化する度に sequence_ が増加するため、読み出し側は sequence_ の比較により変化を検知できる。
+	 */
+	class DLL_PUBLIC LEDRingBrightness
+	{
+	public:
+		LEDRingBrightness() : rotating_(false), sequence_(0)
+		{
+			for(int i=0;i<k_num_segments_;++i){
+				segments_[i] = 0;
+			}
+		}
+
+		/**
+		 * @brief 点灯状態が等しいか（sequence_ を除く）を返す
+		 */
+		bool sameState(const LEDRingBrightness& rhs) const
+		{
+			if(rotating_ != rhs.rotating_){
+				return false;
+			}
+			for(int i=0;i<k_num_segments_;++i){
+				if(segments_[i] != rhs.segments_[i]){
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static const int k_num_segments_ = 6;
+		float segments_[k_num_segments_]; //!< 各セグメントの平均輝度 [0,1]
+		bool rotating_;      //!< 組み込み回転アニメーション中である（このとき segments_ はリング全周の平均輝度となる）
+		uint32_t sequence_;  //!< 点灯状態の変化毎に増加する番号
+	};
+
 	/**
 	 * @class ArduinoSubsystem
 	 * @brief Arduino Subsystem へのシリアル通信路を保持するシングルトンクラスであり、送受信を排他制御する
@@ -90,10 +130,17 @@ namespace tumbler
 		std::mutex global_lock_;
 
 		/**
-		 * @brief LED リングの変化状態の共有ステータス
-		 * @details LEDRing クラスで書き込まれ、Button クラスでチェック後書き換えられる
+		 * @brief LED リングの点灯状態を更新する
+		 * @details global_lock_ を取得した状態で、LED リングへの送信と同時に呼ぶこと。点灯状態が変化した場合のみ sequence_ を増加させる。
+		 * @param [in] brightness LED リングの点灯状態（sequence_ は無視される）
+		 */
+		void updateLEDRingBrightness(const LEDRingBrightness& brightness);
+
+		/**
+		 * @brief LED リングの点灯状態の共有ステータス
+		 * @details LEDRing クラスで書き込まれ、Buttons クラスで LED リングによるタッチボタンへの干渉の補償に用いられる。global_lock_ を取得して読み書きすること。
 		 */
-		std::atomic<bool> c_status_ledringChange_;
+		LEDRingBrightness c_status_ledringBrightness_;
 
 	private:
 		ArduinoSubsystem();
@@ -106,6 +153,16 @@ namespace tumbler
 		int serial_;
 	};
 
+	/**
+	 * @brief 単調増加時刻を返す
+	 * @details システム時刻の変更の影響を受けないため、イベント間の時間差の計測に用いる
+	 * @return std::chrono::steady_clock による時刻 [microsecond]
+	 */
+	inline uint64_t monotonicMicroseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
 	/**
 	 * @class Timer
 	 * \~english
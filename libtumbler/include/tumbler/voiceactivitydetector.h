@@ -0,0 +1,310 @@
+/*
+ * @file voiceactivitydetector.h
+ * \~english
+ * @brief Energy / zero-crossing / band-energy voice activity detector and a pre-roll gate for downstream processing
+ * \~japanese
+ * @brief エネルギー、ゼロ交差数、帯域エネルギーによる音声区間検出器と、後段の処理を止めるための先行区間付きゲート
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LIBTUMBLER_INCLUDE_TUMBLER_VOICEACTIVITYDETECTOR_H_
+#define LIBTUMBLER_INCLUDE_TUMBLER_VOICEACTIVITYDETECTOR_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+
+namespace tumbler{
+
+/**
+ * @class VoiceActivityDetectorConfig
+ * @brief 音声区間検出器の設定
+ */
+class DLL_PUBLIC VoiceActivityDetectorConfig
+{
+public:
+	int rate_ = 16000;              //!< 入力のサンプリングレート（8000 以上 48000 以下）
+	float frameMs_ = 10.0F;         //!< 判定の単位とするフレーム長 [ms]
+	float threshold_ = 9.0F;        //!< 音声とみなす帯域エネルギーの雑音レベルに対する比 [dB]
+	float minLevel_ = -60.0F;       //!< 音声とみなす帯域エネルギーの下限 [dBFS]（無音に近い録音で雑音の揺らぎを音声としない）
+	float minBandRatio_ = 0.5F;     //!< 音声とみなす、300Hz 以上の成分のうち音声帯域（300Hz〜3400Hz）が占めるエネルギーの比の下限（広帯域の雑音を除く）
+	float maxZeroCrossing_ = 0.4F;  //!< 音声とみなすゼロ交差率（サンプルあたり、300Hz 以上の成分）の上限（白色雑音は約 0.5）
+	size_t onsetFrames_ = 3;        //!< 音声区間の開始とみなすまでに連続して音声と判定されるフレーム数
+	size_t hangoverFrames_ = 30;    //!< 音声と判定されなくなってから音声区間の終了とみなすまでのフレーム数
+	float noiseRise_ = 3.0F;        //!< 雑音レベルの推定値を引き上げる速さ [dB/s]（音声と判定したフレームではその 1/10）
+};
+
+/**
+ * @class VoiceActivityDetector
+ * @brief 1ch または数チャネルの入力から音声区間を検出する軽量な音声区間検出器（VAD）
+ * @details フレーム毎に、300Hz〜3400Hz の帯域エネルギーの雑音レベルに対する比、300Hz 以上の成分に占める帯域エネルギーの比、ゼロ交差率を求め、
+ * いずれも音声らしい場合にそのフレームを音声と判定する。onsetFrames_ フレーム連続して音声と判定されると音声区間を開始し、
+ * hangoverFrames_ フレームの間音声と判定されないと終了する。雑音レベルは帯域エネルギーの最小値を追従し、定常的な雑音の増加には noiseRise_ の速さで追従する。
+ * 複数チャネルの場合はチャネル毎のエネルギー、ゼロ交差率を平均する。帯域の分離は 2 次の IIR フィルタ 2 段で行い、FFT を用いない。
+ * 作業領域は構築時に一度だけ確保され、process() はヒープ確保を行わない。
+ * ビームフォーミング、音源方向推定、音声認識等の処理量の大きい後段を、VoiceActivityGate により音声区間のみ動作させることを想定する。
+ */
+class DLL_PUBLIC VoiceActivityDetector
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] channels チャネル数
+	 * @param [in] config 設定
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	explicit VoiceActivityDetector(size_t channels = 1, const VoiceActivityDetectorConfig& config = VoiceActivityDetectorConfig());
+
+	/**
+	 * @brief 入力を処理する
+	 * @param [in] in チャネル毎の入力（channels() チャネル、各 frames サンプル）
+	 * @param [in] frames 入力のフレーム数（任意の長さに分割してよい）
+	 * @return 処理後に音声区間であるか（active() と同じ）
+	 */
+	bool process(const short* const* in, size_t frames);
+
+	/**
+	 * @brief 入力を処理する（short の値域の float）
+	 * @param [in] in チャネル毎の入力（channels() チャネル、各 frames サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @return 処理後に音声区間であるか（active() と同じ）
+	 */
+	bool process(const float* const* in, size_t frames);
+
+	/**
+	 * @brief 判定と雑音レベルの推定値を初期化する
+	 */
+	void reset();
+
+	/**
+	 * @brief 音声区間であるかを返す
+	 */
+	bool active() const { return active_; }
+
+	/**
+	 * @brief 音声区間の開始とみなした位置 [入力のサンプル]（最後に開始した区間の、連続して音声と判定された最初のフレームの先頭。reset() からの通し番号）
+	 * @details 音声区間の開始は、この位置から onsetFrames_ フレーム分遅れて判定される。
+	 */
+	uint64_t onset() const { return onset_; }
+
+	/**
+	 * @brief 処理した入力のサンプル数（reset() からの通し番号）
+	 */
+	uint64_t position() const { return position_; }
+
+	/**
+	 * @brief 直前のフレームの帯域エネルギー [dBFS]
+	 */
+	float level() const { return level_; }
+
+	/**
+	 * @brief 雑音レベルの推定値 [dBFS]
+	 */
+	float noiseLevel() const { return noise_; }
+
+	size_t channels() const { return channels_; }
+	size_t frameSize() const { return frameSize_; }
+
+	const VoiceActivityDetectorConfig& config() const { return config_; }
+
+private:
+	VoiceActivityDetector(const VoiceActivityDetector&);
+	VoiceActivityDetector &operator=(const VoiceActivityDetector&);
+	template<typename Sample>
+	bool process_(const Sample* const* in, size_t frames);
+	void decide_();
+
+	/**
+	 * @class Biquad
+	 * @brief 2 次の IIR フィルタの係数（直接形 II 転置型）
+	 */
+	class Biquad
+	{
+	public:
+		float b0_ = 1.0F;
+		float b1_ = 0.0F;
+		float b2_ = 0.0F;
+		float a1_ = 0.0F;
+		float a2_ = 0.0F;
+	};
+
+	VoiceActivityDetectorConfig config_;
+	size_t channels_;
+	size_t frameSize_;               //!< フレーム長 [サンプル]
+	Biquad highpass_;                //!< 300Hz の高域通過フィルタ
+	Biquad lowpass_;                 //!< 3400Hz の低域通過フィルタ
+	std::vector<float> state_;       //!< チャネル毎のフィルタの状態（channels_ x 4）
+	std::vector<float> previous_;    //!< チャネル毎の直前の高域通過フィルタの出力（ゼロ交差の検出用）
+	size_t filled_;                  //!< 現在のフレームに加えたサンプル数
+	double highEnergy_;              //!< 現在のフレームの 300Hz 以上の成分のエネルギー（全チャネルの和）
+	double bandEnergy_;              //!< 現在のフレームの 300Hz〜3400Hz の成分のエネルギー（全チャネルの和）
+	size_t crossings_;               //!< 現在のフレームのゼロ交差数（全チャネルの和）
+	float level_;
+	float noise_;
+	float riseStep_;                 //!< フレームあたりの雑音レベルの推定値の引き上げ幅 [dB]
+	bool initialized_;               //!< 雑音レベルの推定値を初期化したか
+	size_t run_;                     //!< 連続して音声と判定されたフレーム数
+	size_t silence_;                 //!< 音声区間中に連続して音声と判定されなかったフレーム数
+	bool active_;
+	uint64_t onset_;
+	uint64_t position_;
+};
+
+/**
+ * @class VoiceActivityGate
+ * @brief 音声区間検出の結果に従って、後段の処理に入力を渡すか止めるかを切り替えるゲート
+ * @details ゲートが閉じている間は、入力の直近 preRoll フレームをチャネル毎に保持するのみで後段を呼ばない。
+ * ゲートが開くと、保持していた先行区間を渡してから入力を渡すため、後段は音声区間の開始判定の遅れ（onsetFrames_）と語頭の弱い音声を取りこぼさない。
+ * ゲートが開いている間は、入力をコピーせずそのまま渡す。
+ * @tparam T サンプルの型（short、float 等）
+ */
+template<typename T>
+class VoiceActivityGate
+{
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param [in] channels チャネル数（1 以上 32 以下）
+	 * @param [in] preRoll 保持する先行区間のフレーム数
+	 * @note 設定が正しくない場合は std::invalid_argument 例外が送出される
+	 */
+	VoiceActivityGate(size_t channels, size_t preRoll) :
+		channels_(channels), preRoll_(preRoll), history_(channels * preRoll), head_(0), filled_(0), open_(false)
+	{
+		if(channels < 1 || channels > 32){
+			std::stringstream ss;
+			ss << "VoiceActivityGate: " << channels << " channels is not supported (1-32 channels)";
+			throw std::invalid_argument(ss.str());
+		}
+	}
+
+	/**
+	 * @brief 入力を処理する
+	 * @details open が true の場合、consume(const T* const* data, size_t frames, bool resumed) を 1 回以上呼ぶ。
+	 * ゲートが閉じた状態から開いた場合、最初の呼び出しは先行区間（最大 2 回に分かれる）で、その resumed が true となる。
+	 * 後段は resumed が true の場合に、前回の音声区間からの内部状態を初期化するとよい。
+	 * @param [in] in チャネル毎の入力（channels() チャネル、各 frames サンプル）
+	 * @param [in] frames 入力のフレーム数
+	 * @param [in] open ゲートを開くか（通常は VoiceActivityDetector::process() の返り値）
+	 * @param [in] consume 後段の処理
+	 * @return 後段に渡したフレーム数（先行区間を含む）
+	 */
+	template<typename Consume>
+	size_t process(const T* const* in, size_t frames, bool open, Consume consume)
+	{
+		if(!open){
+			open_ = false;
+			keep_(in, frames);
+			return 0;
+		}
+		size_t passed = 0;
+		if(!open_){
+			open_ = true;
+			bool resumed = true;
+			if(filled_ > 0){
+				// 保持している先行区間は、循環バッファの (head_ - filled_) から head_ まで
+				const T* src[32];
+				const size_t begin = (head_ + preRoll_ - filled_) % preRoll_;
+				const size_t first = std::min(filled_, preRoll_ - begin);
+				for(size_t c=0;c<channels_;++c){
+					src[c] = history_.data() + c * preRoll_ + begin;
+				}
+				consume(src, first, resumed);
+				resumed = false;
+				if(filled_ > first){
+					for(size_t c=0;c<channels_;++c){
+						src[c] = history_.data() + c * preRoll_;
+					}
+					consume(src, filled_ - first, false);
+				}
+				passed += filled_;
+				filled_ = 0;
+			}
+			if(frames > 0){
+				consume(in, frames, resumed);
+			}
+		}else if(frames > 0){
+			consume(in, frames, false);
+		}
+		return passed + frames;
+	}
+
+	/**
+	 * @brief ゲートを閉じ、保持している先行区間を破棄する
+	 */
+	void reset()
+	{
+		head_ = 0;
+		filled_ = 0;
+		open_ = false;
+	}
+
+	/**
+	 * @brief ゲートが開いているかを返す
+	 */
+	bool open() const { return open_; }
+
+	/**
+	 * @brief 保持している先行区間のフレーム数を返す
+	 */
+	size_t buffered() const { return filled_; }
+
+	size_t channels() const { return channels_; }
+	size_t preRoll() const { return preRoll_; }
+
+private:
+	VoiceActivityGate(const VoiceActivityGate&);
+	VoiceActivityGate &operator=(const VoiceActivityGate&);
+
+	/**
+	 * @brief 入力の末尾の preRoll_ フレームまでを循環バッファに加える
+	 */
+	void keep_(const T* const* in, size_t frames)
+	{
+		if(preRoll_ == 0){
+			return;
+		}
+		const size_t skip = frames > preRoll_ ? frames - preRoll_ : 0;
+		const size_t n = frames - skip;
+		const size_t first = std::min(n, preRoll_ - head_);
+		for(size_t c=0;c<channels_;++c){
+			T* dst = history_.data() + c * preRoll_;
+			std::memcpy(dst + head_, in[c] + skip, first * sizeof(T));
+			std::memcpy(dst, in[c] + skip + first, (n - first) * sizeof(T));
+		}
+		head_ = (head_ + n) % preRoll_;
+		filled_ = std::min(preRoll_, filled_ + n);
+	}
+
+	size_t channels_;
+	size_t preRoll_;
+	AlignedBuffer<T> history_;  //!< チャネル毎の直近の入力の循環バッファ（channels_ x preRoll_）
+	size_t head_;               //!< 次に書き込む位置
+	size_t filled_;             //!< 保持しているフレーム数
+	bool open_;
+};
+
+}
+
+#endif /* LIBTUMBLER_INCLUDE_TUMBLER_VOICEACTIVITYDETECTOR_H_ */
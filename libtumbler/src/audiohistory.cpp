@@ -0,0 +1,309 @@
+/*
+ * @file audiohistory.cpp
+ * \~english
+ * @brief Time-indexed ring that retains the last seconds of selected capture channels for event-triggered recording with pre-roll
+ * \~japanese
+ * @brief イベントの前からの録音のために、指定したチャネルの直近の音声を録音時刻とともに保持するリングバッファの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/audiohistory.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+const uint64_t AudioHistory::k_record_interval_;
+const size_t AudioHistory::k_chunk_;
+
+static const AudioHistoryConfig& AudioHistory_validate_(const AudioHistoryConfig& config)
+{
+	std::stringstream ss;
+	if(config.mask_ == 0 || (config.mask_ >> Microphone::k_channels_) != 0){
+		ss << "AudioHistory: mask 0x" << std::hex << config.mask_ << " does not select capture channels";
+	}else if(!(config.seconds_ > 0.0F) || config.seconds_ > 600.0F){
+		ss << "AudioHistory: " << config.seconds_ << " seconds is not supported (0-600 seconds)";
+	}else if(config.factor_ != 1 && config.factor_ != 2 && config.factor_ != 3 && config.factor_ != 6){
+		ss << "AudioHistory: factor " << config.factor_ << " is not supported (1, 2, 3 or 6)";
+	}else{
+		return config;
+	}
+	throw std::invalid_argument(ss.str());
+}
+
+static size_t AudioHistory_channels_(uint32_t mask)
+{
+	size_t count = 0;
+	for(int c=0;c<Microphone::k_channels_;++c){
+		if(mask & (1U << c)){
+			count++;
+		}
+	}
+	return count;
+}
+
+AudioHistory::AudioHistory(const AudioHistoryConfig& config) :
+		config_(AudioHistory_validate_(config)),
+		channels_(AudioHistory_channels_(config.mask_)),
+		rate_(Microphone::k_rate_ / config.factor_),
+		capacity_(std::max<size_t>(1, static_cast<size_t>(config.seconds_ * rate_))),
+		ring_(channels_ * capacity_),
+		records_(static_cast<size_t>(config.seconds_ * 1000000.0F / k_record_interval_) + 64),
+		recordCount_(0),
+		written_(0),
+		decimatorInput_(0),
+		decimatorOutput_(0),
+		scratch_(config.factor_ > 1 ? channels_ * (k_chunk_ / 2 + 1) : 0),
+		discontinuous_(false)
+{
+	if(config_.factor_ > 1){
+		decimator_.reset(new Decimator(channels_, config_.factor_));
+	}
+}
+
+void AudioHistory::write(const short* in, size_t frames, const MicrophoneBlock& block)
+{
+	if(frames == 0){
+		return;
+	}
+	if(!decimator_){
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			record_(written_, block.timestamp_, block.discontinuous_);
+			short* dst[Microphone::k_channels_];
+			size_t done = 0;
+			while(done < frames){
+				const size_t offset = written_ % capacity_;
+				const size_t n = std::min(frames - done, capacity_ - offset);
+				for(size_t c=0;c<channels_;++c){
+					dst[c] = ring_.data() + c * capacity_ + offset;
+				}
+				deinterleave(dst, in + done * Microphone::k_channels_, n, Microphone::k_channels_, config_.mask_);
+				done += n;
+				written_ += n;
+			}
+		}
+		writtenCond_.notify_all();
+		return;
+	}
+
+	// 間引く場合は、位相の揃わない前後のブロックと混ぜないよう、不連続の箇所で Decimator を初期化する
+	if(block.discontinuous_){
+		decimator_->reset();
+		decimatorInput_ = 0;
+		decimatorOutput_ = 0;
+		discontinuous_ = true;
+	}
+	const size_t stride = k_chunk_ / 2 + 1;
+	short* dst[Microphone::k_channels_];
+	for(size_t c=0;c<channels_;++c){
+		dst[c] = scratch_.data() + c * stride;
+	}
+	const double delay = decimator_->delay();
+	for(size_t done=0;done<frames;){
+		const size_t n = std::min(k_chunk_, frames - done);
+		const uint64_t first = decimatorOutput_;
+		const size_t m = decimator_->process(in + done * Microphone::k_channels_, n, Microphone::k_channels_, config_.mask_, dst);
+		if(m > 0){
+			// 出力の k 番目は、Decimator を初期化してからの入力の (k + 1) * factor - 1 - delay() 番目に対応する
+			const double input = static_cast<double>((first + 1) * config_.factor_) - 1.0 - delay;
+			const double offset = (input - static_cast<double>(decimatorInput_)) * 1000000.0 / Microphone::k_rate_;
+			const uint64_t chunkTime = block.timestamp_ + done * 1000000ULL / Microphone::k_rate_;
+			const uint64_t timestamp = static_cast<uint64_t>(std::max(0.0, static_cast<double>(chunkTime) + offset));
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				record_(written_, timestamp, discontinuous_);
+				append_(dst, m);
+			}
+			discontinuous_ = false;
+			writtenCond_.notify_all();
+		}
+		decimatorInput_ += n;
+		decimatorOutput_ += m;
+		done += n;
+	}
+}
+
+void AudioHistory::append_(short* const* data, size_t frames)
+{
+	size_t done = 0;
+	while(done < frames){
+		const size_t offset = written_ % capacity_;
+		const size_t n = std::min(frames - done, capacity_ - offset);
+		for(size_t c=0;c<channels_;++c){
+			std::copy(data[c] + done, data[c] + done + n, ring_.data() + c * capacity_ + offset);
+		}
+		done += n;
+		written_ += n;
+	}
+}
+
+void AudioHistory::record_(uint64_t position, uint64_t timestamp, bool force)
+{
+	if(recordCount_ > 0){
+		Record& last = records_[(recordCount_ - 1) % records_.size()];
+		if(last.position_ == position){
+			last.timestamp_ = timestamp; // まだフレームを書き込んでいない対応は置き換える
+			return;
+		}
+		if(!force && timestamp < last.timestamp_ + k_record_interval_){
+			return;
+		}
+	}
+	Record& r = records_[recordCount_ % records_.size()];
+	r.position_ = position;
+	r.timestamp_ = timestamp;
+	recordCount_++;
+}
+
+uint64_t AudioHistory::positionAt_(uint64_t timestamp) const
+{
+	if(recordCount_ == 0){
+		return written_;
+	}
+	const size_t size = records_.size();
+	const uint64_t begin = recordCount_ > size ? recordCount_ - size : 0;
+	// timestamp 以前の最も新しい対応を探す
+	uint64_t lo = begin;
+	uint64_t hi = recordCount_;
+	while(lo < hi){
+		const uint64_t mid = lo + (hi - lo) / 2;
+		if(records_[mid % size].timestamp_ <= timestamp){
+			lo = mid + 1;
+		}else{
+			hi = mid;
+		}
+	}
+	uint64_t position;
+	if(lo == begin){
+		// 記録している最も古い対応より前の時刻は、そこから遡って求める
+		const Record& r = records_[begin % size];
+		const uint64_t back = (r.timestamp_ - timestamp) * rate_ / 1000000ULL;
+		position = r.position_ > back ? r.position_ - back : 0;
+	}else{
+		const Record& r = records_[(lo - 1) % size];
+		position = r.position_ + (timestamp - r.timestamp_) * rate_ / 1000000ULL;
+		if(lo < recordCount_){
+			position = std::min(position, records_[lo % size].position_);
+		}
+	}
+	const uint64_t oldest = written_ > capacity_ ? written_ - capacity_ : 0;
+	return std::min(written_, std::max(oldest, position));
+}
+
+uint64_t AudioHistory::timestampAt_(uint64_t position) const
+{
+	if(recordCount_ == 0){
+		return 0;
+	}
+	const size_t size = records_.size();
+	const uint64_t begin = recordCount_ > size ? recordCount_ - size : 0;
+	uint64_t lo = begin;
+	uint64_t hi = recordCount_;
+	while(lo < hi){
+		const uint64_t mid = lo + (hi - lo) / 2;
+		if(records_[mid % size].position_ <= position){
+			lo = mid + 1;
+		}else{
+			hi = mid;
+		}
+	}
+	if(lo == begin){
+		const Record& r = records_[begin % size];
+		const uint64_t back = (r.position_ - position) * 1000000ULL / rate_;
+		return r.timestamp_ > back ? r.timestamp_ - back : 0;
+	}
+	const Record& r = records_[(lo - 1) % size];
+	return r.timestamp_ + (position - r.position_) * 1000000ULL / rate_;
+}
+
+uint64_t AudioHistory::timestampOf_(uint64_t position) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return timestampAt_(position);
+}
+
+AudioHistoryReader AudioHistory::open(uint64_t timestamp)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return AudioHistoryReader(this, positionAt_(timestamp));
+}
+
+AudioHistoryReader AudioHistory::since(float seconds)
+{
+	const uint64_t now = monotonicMicroseconds();
+	const uint64_t back = static_cast<uint64_t>(std::max(0.0F, seconds) * 1000000.0F);
+	return open(now > back ? now - back : 0);
+}
+
+uint64_t AudioHistory::written() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return written_;
+}
+
+uint64_t AudioHistory::oldest() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return timestampAt_(written_ > capacity_ ? written_ - capacity_ : 0);
+}
+
+size_t AudioHistory::read_(AudioHistoryReader& reader, short* out, size_t frames, int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if(reader.position_ >= written_ && timeoutMs > 0){
+		writtenCond_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]{ return written_ > reader.position_; });
+	}
+	const uint64_t oldest = written_ > capacity_ ? written_ - capacity_ : 0;
+	if(reader.position_ < oldest){
+		reader.lost_ += oldest - reader.position_;
+		reader.position_ = oldest;
+	}
+	const size_t n = static_cast<size_t>(std::min<uint64_t>(frames, written_ - reader.position_));
+	size_t done = 0;
+	while(done < n){
+		const size_t offset = (reader.position_ + done) % capacity_;
+		const size_t m = std::min(n - done, capacity_ - offset);
+		for(size_t c=0;c<channels_;++c){
+			const short* src = ring_.data() + c * capacity_ + offset;
+			short* dst = out + done * channels_ + c;
+			for(size_t i=0;i<m;++i){
+				dst[i * channels_] = src[i];
+			}
+		}
+		done += m;
+	}
+	reader.position_ += n;
+	return n;
+}
+
+size_t AudioHistoryReader::read(short* out, size_t frames, int timeoutMs)
+{
+	return history_ ? history_->read_(*this, out, frames, timeoutMs) : 0;
+}
+
+uint64_t AudioHistoryReader::timestamp() const
+{
+	return history_ ? history_->timestampOf_(position_) : 0;
+}
+
+}
@@ -0,0 +1,423 @@
+/*
+ * @file audiokernels.cpp
+ * \~english
+ * @brief SIMD kernels for audio sample processing
+ * \~japanese
+ * @brief 音声サンプル処理の SIMD カーネルの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/audiokernels.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TUMBLER_AUDIOKERNELS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TUMBLER_AUDIOKERNELS_SSE2
+#endif
+
+namespace tumbler{
+
+static inline short AudioKernels_saturate_(float v)
+{
+	if(v > 32767.0F){
+		return 32767;
+	}else if(v < -32768.0F){
+		return -32768;
+	}
+	return static_cast<short>(lrintf(v));
+}
+
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+/**
+ * @brief 最近接偶数丸めで 32bit 整数に変換する（lrintf(), _mm_cvtps_epi32() と同じ丸め）
+ * @details ARMv8 では vcvtnq_s32_f32 を用いる。ARMv7 では 1.5 * 2^23 を加減して仮数部の小数を丸め落とす（|v| < 2^22 に限る）。
+ */
+static inline int32x4_t AudioKernels_roundNeon_(float32x4_t v)
+{
+#if defined(__ARM_FEATURE_DIRECTED_ROUNDING)
+	return vcvtnq_s32_f32(v);
+#else
+	const float32x4_t magic = vdupq_n_f32(12582912.0F);
+	return vcvtq_s32_f32(vsubq_f32(vaddq_f32(v, magic), magic));
+#endif
+}
+#endif
+
+void mixSaturate(short* dst, const short* src, size_t n)
+{
+	size_t i = 0;
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+	for(;i+8<=n;i+=8){
+		vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vld1q_s16(src + i)));
+	}
+#elif defined(TUMBLER_AUDIOKERNELS_SSE2)
+	for(;i+8<=n;i+=8){
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epi16(a, b));
+	}
+#endif
+	for(;i<n;++i){
+		const int v = static_cast<int>(dst[i]) + static_cast<int>(src[i]);
+		dst[i] = static_cast<short>(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+	}
+}
+
+short peakAbsolute(const short* src, size_t n)
+{
+	size_t i = 0;
+	short peak = 0;
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+	int16x8_t m = vdupq_n_s16(0);
+	for(;i+8<=n;i+=8){
+		m = vmaxq_s16(m, vqabsq_s16(vld1q_s16(src + i)));
+	}
+	int16x4_t m4 = vmax_s16(vget_low_s16(m), vget_high_s16(m));
+	m4 = vpmax_s16(m4, m4);
+	m4 = vpmax_s16(m4, m4);
+	peak = vget_lane_s16(m4, 0);
+#elif defined(TUMBLER_AUDIOKERNELS_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i m = zero;
+	for(;i+8<=n;i+=8){
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		m = _mm_max_epi16(m, _mm_max_epi16(x, _mm_subs_epi16(zero, x))); // |x|（-32768 は 32767 に飽和）
+	}
+	m = _mm_max_epi16(m, _mm_srli_si128(m, 8));
+	m = _mm_max_epi16(m, _mm_srli_si128(m, 4));
+	m = _mm_max_epi16(m, _mm_srli_si128(m, 2));
+	peak = static_cast<short>(_mm_extract_epi16(m, 0));
+#endif
+	for(;i<n;++i){
+		const short a = src[i] == -32768 ? 32767 : static_cast<short>(src[i] < 0 ? -src[i] : src[i]);
+		if(peak < a){
+			peak = a;
+		}
+	}
+	return peak;
+}
+
+void applyGain(short* dst, const short* src, size_t n, float gain)
+{
+	size_t i = 0;
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+	const float32x4_t g = vdupq_n_f32(gain);
+	const float32x4_t upper = vdupq_n_f32(32767.0F);
+	const float32x4_t lower = vdupq_n_f32(-32768.0F);
+	for(;i+8<=n;i+=8){
+		const int16x8_t x = vld1q_s16(src + i);
+		const float32x4_t lo = vmaxq_f32(vminq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), g), upper), lower);
+		const float32x4_t hi = vmaxq_f32(vminq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), g), upper), lower);
+		vst1q_s16(dst + i, vcombine_s16(vmovn_s32(AudioKernels_roundNeon_(lo)), vmovn_s32(AudioKernels_roundNeon_(hi))));
+	}
+#elif defined(TUMBLER_AUDIOKERNELS_SSE2)
+	const __m128 g = _mm_set1_ps(gain);
+	const __m128 upper = _mm_set1_ps(32767.0F);
+	const __m128 lower = _mm_set1_ps(-32768.0F);
+	for(;i+8<=n;i+=8){
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		// 符号拡張して 32bit 整数とし、単精度浮動小数点数でゲインを乗じる
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+		const __m128i ylo = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), g), upper), lower));
+		const __m128i yhi = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), g), upper), lower));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(ylo, yhi));
+	}
+#endif
+	for(;i<n;++i){
+		dst[i] = AudioKernels_saturate_(static_cast<float>(src[i]) * gain);
+	}
+}
+
+void interleaveStereo(short* dst, const short* left, const short* right, size_t n)
+{
+	size_t i = 0;
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+	int16x8x2_t lr;
+	lr.val[1] = vdupq_n_s16(0);
+	for(;i+8<=n;i+=8){
+		lr.val[0] = vld1q_s16(left + i);
+		if(right != nullptr){
+			lr.val[1] = vld1q_s16(right + i);
+		}
+		vst2q_s16(dst + 2 * i, lr);
+	}
+#elif defined(TUMBLER_AUDIOKERNELS_SSE2)
+	for(;i+8<=n;i+=8){
+		const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+		const __m128i r = right != nullptr ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i)) : _mm_setzero_si128();
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+	}
+#endif
+	for(;i<n;++i){
+		dst[2*i] = left[i];
+		dst[2*i+1] = right != nullptr ? right[i] : 0;
+	}
+}
+
+void applyGainRamp(short* dst, const short* src, size_t n, float gainBegin, float gainEnd)
+{
+	if(gainBegin == gainEnd){
+		applyGain(dst, src, n, gainBegin);
+		return;
+	}
+	if(n == 0){
+		return;
+	}
+	const float step = (gainEnd - gainBegin) / static_cast<float>(n);
+	float gain = gainBegin;
+	for(size_t i=0;i<n;++i){
+		dst[i] = AudioKernels_saturate_(static_cast<float>(src[i]) * gain);
+		gain += step;
+	}
+}
+
+// short への取り出しはゲインを適用せずにそのまま写す（ゲインは float への取り出しのみ）
+static inline void AudioKernels_put_(short* dst, short v, float /* gain */)
+{
+	*dst = v;
+}
+
+static inline void AudioKernels_put_(float* dst, short v, float gain)
+{
+	*dst = static_cast<float>(v) * gain;
+}
+
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+/**
+ * @brief 8 フレーム x 8 チャネルの区画を転置する（r[f] のレーン c が、r[c] のレーン f となる）
+ */
+static inline void AudioKernels_transpose8x8_(int16x8_t* r)
+{
+	const int16x8x2_t t0 = vtrnq_s16(r[0], r[1]);
+	const int16x8x2_t t1 = vtrnq_s16(r[2], r[3]);
+	const int16x8x2_t t2 = vtrnq_s16(r[4], r[5]);
+	const int16x8x2_t t3 = vtrnq_s16(r[6], r[7]);
+	const int32x4x2_t u0 = vtrnq_s32(vreinterpretq_s32_s16(t0.val[0]), vreinterpretq_s32_s16(t1.val[0])); // チャネル 0, 4 と 2, 6 のフレーム 0〜3
+	const int32x4x2_t u1 = vtrnq_s32(vreinterpretq_s32_s16(t0.val[1]), vreinterpretq_s32_s16(t1.val[1])); // チャネル 1, 5 と 3, 7 のフレーム 0〜3
+	const int32x4x2_t u2 = vtrnq_s32(vreinterpretq_s32_s16(t2.val[0]), vreinterpretq_s32_s16(t3.val[0])); // チャネル 0, 4 と 2, 6 のフレーム 4〜7
+	const int32x4x2_t u3 = vtrnq_s32(vreinterpretq_s32_s16(t2.val[1]), vreinterpretq_s32_s16(t3.val[1])); // チャネル 1, 5 と 3, 7 のフレーム 4〜7
+	r[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u0.val[0]), vget_low_s32(u2.val[0])));
+	r[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u1.val[0]), vget_low_s32(u3.val[0])));
+	r[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u0.val[1]), vget_low_s32(u2.val[1])));
+	r[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u1.val[1]), vget_low_s32(u3.val[1])));
+	r[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u0.val[0]), vget_high_s32(u2.val[0])));
+	r[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u1.val[0]), vget_high_s32(u3.val[0])));
+	r[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u0.val[1]), vget_high_s32(u2.val[1])));
+	r[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u1.val[1]), vget_high_s32(u3.val[1])));
+}
+
+static inline int16x8_t AudioKernels_load_(const short* src){ return vld1q_s16(src); }
+
+static inline void AudioKernels_putVector_(short* dst, int16x8_t v, float /* gain */)
+{
+	vst1q_s16(dst, v);
+}
+
+static inline void AudioKernels_putVector_(float* dst, int16x8_t v, float gain)
+{
+	const float32x4_t g = vdupq_n_f32(gain);
+	vst1q_f32(dst, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), g));
+	vst1q_f32(dst + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), g));
+}
+typedef int16x8_t AudioKernels_Vector_;
+#elif defined(TUMBLER_AUDIOKERNELS_SSE2)
+/**
+ * @brief 8 フレーム x 8 チャネルの区画を転置する（r[f] のレーン c が、r[c] のレーン f となる）
+ */
+static inline void AudioKernels_transpose8x8_(__m128i* r)
+{
+	const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]); // フレーム 0, 1 のチャネル 0〜3
+	const __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]); // フレーム 0, 1 のチャネル 4〜7
+	const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+	const __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+	const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+	const __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+	const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+	const __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+	const __m128i b0 = _mm_unpacklo_epi32(a0, a2); // フレーム 0〜3 のチャネル 0, 1
+	const __m128i b1 = _mm_unpackhi_epi32(a0, a2); // フレーム 0〜3 のチャネル 2, 3
+	const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	const __m128i b4 = _mm_unpacklo_epi32(a4, a6); // フレーム 4〜7 のチャネル 0, 1
+	const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+	r[0] = _mm_unpacklo_epi64(b0, b4);
+	r[1] = _mm_unpackhi_epi64(b0, b4);
+	r[2] = _mm_unpacklo_epi64(b1, b5);
+	r[3] = _mm_unpackhi_epi64(b1, b5);
+	r[4] = _mm_unpacklo_epi64(b2, b6);
+	r[5] = _mm_unpackhi_epi64(b2, b6);
+	r[6] = _mm_unpacklo_epi64(b3, b7);
+	r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static inline __m128i AudioKernels_load_(const short* src){ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+
+static inline void AudioKernels_putVector_(short* dst, __m128i v, float /* gain */)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+}
+
+static inline void AudioKernels_putVector_(float* dst, __m128i v, float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	_mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), g));
+	_mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), g));
+}
+typedef __m128i AudioKernels_Vector_;
+#endif
+
+template<typename T>
+static void AudioKernels_deinterleave_(T* const* dst, const short* src, size_t frames, size_t channels, uint32_t mask, float gain)
+{
+	if(channels > 32){
+		channels = 32;
+	}
+	// 取り出すチャネルの番号と、チャネル番号から出力先への対応
+	unsigned char selected[32];
+	T* out[32];
+	size_t count = 0;
+	for(size_t c=0;c<channels;++c){
+		out[c] = nullptr;
+		if(mask & (1U << c)){
+			out[c] = dst[count];
+			selected[count++] = static_cast<unsigned char>(c);
+		}
+	}
+	if(count == 0){
+		return;
+	}
+	size_t i = 0;
+#if defined(TUMBLER_AUDIOKERNELS_NEON) || defined(TUMBLER_AUDIOKERNELS_SSE2)
+	if(channels >= 8){
+		for(;i+8<=frames;i+=8){
+			const short* frame = src + i * channels;
+			for(size_t b=0;b<channels;b+=8){
+				// 末尾の区画は channels - 8 から始めて入力の範囲に収め、先行する区画と重なるチャネルは書き込まない
+				const size_t begin = std::min(b, channels - 8);
+				if(((mask >> b) & 0xFFU) == 0){
+					continue;
+				}
+				AudioKernels_Vector_ r[8];
+				for(size_t f=0;f<8;++f){
+					r[f] = AudioKernels_load_(frame + f * channels + begin);
+				}
+				AudioKernels_transpose8x8_(r);
+				for(size_t j=b-begin;j<8;++j){
+					if(out[begin + j] != nullptr){
+						AudioKernels_putVector_(out[begin + j] + i, r[j], gain);
+					}
+				}
+			}
+		}
+	}
+#endif
+	for(;i<frames;++i){
+		const short* frame = src + i * channels;
+		for(size_t k=0;k<count;++k){
+			AudioKernels_put_(out[selected[k]] + i, frame[selected[k]], gain);
+		}
+	}
+}
+
+void deinterleave(short* const* dst, const short* src, size_t frames, size_t channels, uint32_t mask)
+{
+	AudioKernels_deinterleave_(dst, src, frames, channels, mask, 1.0F);
+}
+
+void deinterleave(float* const* dst, const short* src, size_t frames, size_t channels, uint32_t mask, float gain)
+{
+	AudioKernels_deinterleave_(dst, src, frames, channels, mask, gain);
+}
+
+
+void accumulateFir(float* acc, const float* x, size_t n, const float* h, size_t taps)
+{
+	size_t i = 0;
+	// 加算の依存関係で待たないよう、16 出力ずつ 4 つの独立したベクトルに累積する（出力毎の加算の順序は変わらない）
+#if defined(TUMBLER_AUDIOKERNELS_NEON)
+	for(;i+16<=n;i+=16){
+		float32x4_t s0 = vld1q_f32(acc + i);
+		float32x4_t s1 = vld1q_f32(acc + i + 4);
+		float32x4_t s2 = vld1q_f32(acc + i + 8);
+		float32x4_t s3 = vld1q_f32(acc + i + 12);
+		for(size_t k=0;k<taps;++k){
+			const float* p = x + i - k;
+			s0 = vmlaq_n_f32(s0, vld1q_f32(p), h[k]);
+			s1 = vmlaq_n_f32(s1, vld1q_f32(p + 4), h[k]);
+			s2 = vmlaq_n_f32(s2, vld1q_f32(p + 8), h[k]);
+			s3 = vmlaq_n_f32(s3, vld1q_f32(p + 12), h[k]);
+		}
+		vst1q_f32(acc + i, s0);
+		vst1q_f32(acc + i + 4, s1);
+		vst1q_f32(acc + i + 8, s2);
+		vst1q_f32(acc + i + 12, s3);
+	}
+	for(;i+4<=n;i+=4){
+		float32x4_t sum = vld1q_f32(acc + i);
+		for(size_t k=0;k<taps;++k){
+			sum = vmlaq_n_f32(sum, vld1q_f32(x + i - k), h[k]);
+		}
+		vst1q_f32(acc + i, sum);
+	}
+#elif defined(TUMBLER_AUDIOKERNELS_SSE2)
+	for(;i+16<=n;i+=16){
+		__m128 s0 = _mm_loadu_ps(acc + i);
+		__m128 s1 = _mm_loadu_ps(acc + i + 4);
+		__m128 s2 = _mm_loadu_ps(acc + i + 8);
+		__m128 s3 = _mm_loadu_ps(acc + i + 12);
+		for(size_t k=0;k<taps;++k){
+			const float* p = x + i - k;
+			const __m128 c = _mm_set1_ps(h[k]);
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(p), c));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(p + 4), c));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(p + 8), c));
+			s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(p + 12), c));
+		}
+		_mm_storeu_ps(acc + i, s0);
+		_mm_storeu_ps(acc + i + 4, s1);
+		_mm_storeu_ps(acc + i + 8, s2);
+		_mm_storeu_ps(acc + i + 12, s3);
+	}
+	for(;i+4<=n;i+=4){
+		__m128 sum = _mm_loadu_ps(acc + i);
+		for(size_t k=0;k<taps;++k){
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i - k), _mm_set1_ps(h[k])));
+		}
+		_mm_storeu_ps(acc + i, sum);
+	}
+#endif
+	for(;i<n;++i){
+		float sum = acc[i];
+		for(size_t k=0;k<taps;++k){
+			sum += h[k] * *(x + i - k);
+		}
+		acc[i] = sum;
+	}
+}
+
+}
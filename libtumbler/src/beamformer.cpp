@@ -0,0 +1,363 @@
+/*
+ * @file beamformer.cpp
+ * \~english
+ * @brief Delay-and-sum and MVDR beamformer over the 16-microphone array
+ * \~japanese
+ * @brief 16ch マイクアレイによる遅延和・MVDR ビームフォーマーの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/beamformer.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+const int Beamformer::k_rate_;
+const size_t Beamformer::k_block_;
+
+static const BeamformerConfig& Beamformer_validate_(const MicrophoneArray& array, const BeamformerConfig& config)
+{
+	std::stringstream ss;
+	if(array.size() == 0){
+		ss << "Beamformer: the microphone array is empty";
+	}else if(config.outputRate_ != 48000 && config.outputRate_ != 24000 && config.outputRate_ != 16000 && config.outputRate_ != 8000){
+		ss << "Beamformer: output rate " << config.outputRate_ << " is not supported (48000, 24000, 16000 or 8000)";
+	}else if(config.taps_ < 2 || config.taps_ % 2 != 0){
+		ss << "Beamformer: taps " << config.taps_ << " must be an even number >= 2";
+	}else if(config.method_ == BeamformerMethod::mvdr_ && (config.fftSize_ < 16 || (config.fftSize_ & (config.fftSize_ - 1)) != 0)){
+		ss << "Beamformer: FFT size " << config.fftSize_ << " must be a power of two >= 16";
+	}else{
+		return config;
+	}
+	throw std::invalid_argument(ss.str());
+}
+
+/**
+ * @brief 全マイクの遅延を非負とするために加える遅延 [サンプル]
+ */
+static float Beamformer_offset_(const MicrophoneArray& array)
+{
+	return array.radius() / MicrophoneArray::k_speed_of_sound_ * Beamformer::k_rate_;
+}
+
+/**
+ * @brief 遅延和で保持する過去の入力のサンプル数（最大の整数遅延とフィルタのタップ数の和）
+ */
+static size_t Beamformer_history_(const MicrophoneArray& array, const BeamformerConfig& config)
+{
+	return static_cast<size_t>(std::ceil(2.0F * Beamformer_offset_(array))) + config.taps_;
+}
+
+/**
+ * @brief 0 次の第 1 種変形ベッセル関数
+ */
+static double Beamformer_besselI0_(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for(int k=1;k<32;++k){
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+Beamformer::Beamformer(const MicrophoneArray& array, const BeamformerConfig& config) :
+		array_(array),
+		config_(Beamformer_validate_(array, config)),
+		channels_(array.size()),
+		offset_(Beamformer_offset_(array)),
+		history_(Beamformer_history_(array, config)),
+		buffer_(array.size() * (Beamformer_history_(array, config) + k_block_)),
+		taps_(array.size() * config.taps_),
+		delays_(array.size()),
+		mixed_(std::max(k_block_, config.fftSize_)),
+		hop_(config.fftSize_ / 2),
+		bins_(0),
+		outputRe_(config.method_ == BeamformerMethod::mvdr_ ? config.fftSize_ / 2 + 1 : 0),
+		outputIm_(config.method_ == BeamformerMethod::mvdr_ ? config.fftSize_ / 2 + 1 : 0),
+		framesSinceUpdate_(0),
+		observed_(0)
+{
+	if(config_.method_ == BeamformerMethod::mvdr_){
+		analyzer_.reset(new StftAnalyzer(channels_, config_.fftSize_, hop_, StftWindow::sqrtHann_));
+		synthesizer_.reset(new StftSynthesizer(config_.fftSize_, hop_, StftWindow::sqrtHann_, StftWindow::sqrtHann_));
+		// 出力のナイキスト周波数を超える周波数ビンは出力のレートへの変換で除かれるため処理しない
+		bins_ = std::min(config_.fftSize_ / 2 + 1, static_cast<size_t>(std::ceil(static_cast<double>(config_.outputRate_) / 2 * config_.fftSize_ / k_rate_)) + 1);
+		spectra_.resize(channels_ * bins_);
+		covariance_.resize(bins_ * channels_ * channels_);
+		steering_.resize(bins_ * channels_);
+		weights_.resize(bins_ * channels_);
+		cholesky_.resize(channels_ * channels_);
+	}
+	if(config_.outputRate_ != k_rate_){
+		decimator_.reset(new Decimator(1, k_rate_ / config_.outputRate_));
+	}
+	steer(config_.azimuth_, config_.elevation_);
+	reset();
+}
+
+void Beamformer::steer(float azimuth, float elevation)
+{
+	config_.azimuth_ = azimuth;
+	config_.elevation_ = elevation;
+	std::vector<float> advances(channels_);
+	array_.advances(azimuth, elevation, advances.data());
+	if(config_.method_ == BeamformerMethod::delayAndSum_){
+		// 早く到達するマイクほど大きく遅延させて揃える。遅延 D を整数部と、カイザー窓をかけた sinc 関数による非整数部のフィルタに分ける
+		const size_t taps = config_.taps_;
+		const double beta = 6.0;
+		for(size_t m=0;m<channels_;++m){
+			const double delay = offset_ + advances[m] * k_rate_;
+			const double integer = std::floor(delay);
+			const double center = taps / 2 - 1 + (delay - integer); // フィルタの中心 [タップ]
+			delays_[m] = static_cast<size_t>(integer);
+			float* h = taps_.data() + m * taps;
+			double sum = 0;
+			for(size_t k=0;k<taps;++k){
+				const double t = k - center;
+				const double sinc = std::abs(t) < 1e-9 ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+				const double r = t / (taps / 2);
+				const double window = std::abs(r) >= 1.0 ? 0.0 : Beamformer_besselI0_(beta * std::sqrt(1.0 - r * r)) / Beamformer_besselI0_(beta);
+				h[k] = static_cast<float>(sinc * window);
+				sum += h[k];
+			}
+			for(size_t k=0;k<taps;++k){
+				h[k] = static_cast<float>(h[k] / sum / channels_); // 直流の利得を 1 とし、チャネル間で平均する
+			}
+		}
+	}else{
+		// x_m(f) = S(f) exp(j2πf a_m) であるため、ステアリングベクトルは d_m = exp(j2πf a_m) となる
+		for(size_t k=0;k<bins_;++k){
+			const double f = static_cast<double>(k) * k_rate_ / config_.fftSize_;
+			for(size_t m=0;m<channels_;++m){
+				steering_[k * channels_ + m] = std::polar(1.0F, static_cast<float>(2.0 * M_PI * f * advances[m]));
+			}
+		}
+		if(observed_ == 0){
+			// 空間相関行列が得られるまでは遅延和とする
+			for(size_t i=0;i<weights_.size();++i){
+				weights_[i] = steering_[i] / static_cast<float>(channels_);
+			}
+		}else{
+			updateWeights_();
+		}
+	}
+}
+
+void Beamformer::reset()
+{
+	std::fill(buffer_.data(), buffer_.data() + buffer_.size(), 0.0F);
+	std::fill(covariance_.begin(), covariance_.end(), std::complex<float>());
+	if(analyzer_){
+		analyzer_->reset();
+		synthesizer_->reset();
+	}
+	framesSinceUpdate_ = 0;
+	observed_ = 0;
+	for(size_t i=0;i<weights_.size();++i){
+		weights_[i] = steering_[i] / static_cast<float>(channels_);
+	}
+	if(decimator_){
+		decimator_->reset();
+	}
+}
+
+float Beamformer::latency() const
+{
+	if(config_.method_ == BeamformerMethod::delayAndSum_){
+		return offset_ + config_.taps_ / 2 - 1;
+	}
+	return static_cast<float>(config_.fftSize_ - hop_);
+}
+
+size_t Beamformer::maxOutput(size_t frames) const
+{
+	const size_t n = config_.method_ == BeamformerMethod::delayAndSum_ ? frames : frames + hop_;
+	return decimator_ ? decimator_->maxOutput(n) : n;
+}
+
+size_t Beamformer::emit_(const float* data, size_t n, short* out)
+{
+	if(decimator_){
+		return decimator_->process(&data, n, &out);
+	}
+	for(size_t i=0;i<n;++i){
+		const float v = data[i];
+		out[i] = static_cast<short>(v > 32767.0F ? 32767.0F : (v < -32768.0F ? -32768.0F : (v < 0 ? v - 0.5F : v + 0.5F)));
+	}
+	return n;
+}
+
+void Beamformer::delayAndSum_(const float* const* in, size_t offset, size_t frames, float* out)
+{
+	std::fill(out, out + frames, 0.0F);
+	const size_t stride = history_ + k_block_;
+	for(size_t m=0;m<channels_;++m){
+		float* buffer = buffer_.data() + m * stride;
+		std::memcpy(buffer + history_, in[m] + offset, frames * sizeof(float));
+		accumulateFir(out, buffer + history_ - delays_[m], frames, taps_.data() + m * config_.taps_, config_.taps_);
+		std::memmove(buffer, buffer + frames, history_ * sizeof(float));
+	}
+}
+
+size_t Beamformer::process(const float* const* in, size_t frames, short* out)
+{
+	size_t produced = 0;
+	if(config_.method_ == BeamformerMethod::delayAndSum_){
+		for(size_t done=0;done<frames;){
+			const size_t n = std::min(k_block_, frames - done);
+			delayAndSum_(in, done, n, mixed_.data());
+			produced += emit_(mixed_.data(), n, out + produced);
+			done += n;
+		}
+		return produced;
+	}
+	analyzer_->process(in, frames, [&](const StftFrame& frame){
+		mvdrFrame_(frame, mixed_.data());
+		produced += emit_(mixed_.data(), hop_, out + produced);
+	});
+	return produced;
+}
+
+size_t Beamformer::process(const StftFrame& frame, short* out)
+{
+	if(config_.method_ != BeamformerMethod::mvdr_ || frame.channels() != channels_ || frame.size() != config_.fftSize_ || frame.hop() != hop_ || frame.window() != StftWindow::sqrtHann_){
+		std::stringstream ss;
+		ss << "Beamformer: the STFT frame (" << frame.channels() << " channels, size " << frame.size() << ", hop " << frame.hop()
+				<< ") does not match the MVDR beamformer (" << channels_ << " channels, size " << config_.fftSize_ << ", hop " << hop_ << ", square-root Hann window)";
+		throw std::invalid_argument(ss.str());
+	}
+	mvdrFrame_(frame, mixed_.data());
+	return emit_(mixed_.data(), hop_, out);
+}
+
+void Beamformer::mvdrFrame_(const StftFrame& frame, float* out)
+{
+	const size_t M = channels_;
+	for(size_t m=0;m<M;++m){
+		const float* re = frame.re(m);
+		const float* im = frame.im(m);
+		std::complex<float>* x = spectra_.data() + m * bins_;
+		for(size_t k=0;k<bins_;++k){
+			x[k] = std::complex<float>(re[k], im[k]);
+		}
+	}
+	// 空間相関行列の更新（上三角のみ）
+	const float lambda = config_.smoothing_;
+	for(size_t k=0;k<bins_;++k){
+		std::complex<float>* R = covariance_.data() + k * M * M;
+		for(size_t i=0;i<M;++i){
+			const std::complex<float> xi = spectra_[i * bins_ + k];
+			for(size_t j=i;j<M;++j){
+				R[i * M + j] = lambda * R[i * M + j] + (1.0F - lambda) * xi * std::conj(spectra_[j * bins_ + k]);
+			}
+		}
+	}
+	observed_++;
+	if(++framesSinceUpdate_ >= config_.updateInterval_){
+		updateWeights_();
+	}
+	// y = w^H x（処理しない周波数ビンは 0 とする）
+	for(size_t k=0;k<bins_;++k){
+		std::complex<float> y;
+		const std::complex<float>* w = weights_.data() + k * M;
+		for(size_t m=0;m<M;++m){
+			y += std::conj(w[m]) * spectra_[m * bins_ + k];
+		}
+		outputRe_[k] = y.real();
+		outputIm_[k] = y.imag();
+	}
+	// 合成窓をかけて重畳加算し、シフト幅分を出力する
+	synthesizer_->synthesize(outputRe_.data(), outputIm_.data(), out);
+}
+
+void Beamformer::updateWeights_()
+{
+	// 周波数ビン毎に (R + δI) v = d をコレスキー分解で解き、w = v / (d^H v) とする
+	const size_t M = channels_;
+	std::complex<float>* L = cholesky_.data();
+	framesSinceUpdate_ = 0;
+	for(size_t k=0;k<bins_;++k){
+		const std::complex<float>* R = covariance_.data() + k * M * M;
+		const std::complex<float>* d = steering_.data() + k * M;
+		std::complex<float>* w = weights_.data() + k * M;
+		float trace = 0;
+		for(size_t i=0;i<M;++i){
+			trace += R[i * M + i].real();
+		}
+		const float loading = config_.diagonalLoading_ * trace / M + 1e-6F;
+		bool ok = true;
+		for(size_t j=0;j<M && ok;++j){
+			float diag = R[j * M + j].real() + loading;
+			for(size_t p=0;p<j;++p){
+				diag -= std::norm(L[j * M + p]);
+			}
+			if(diag <= 0){
+				ok = false;
+				break;
+			}
+			const float ljj = std::sqrt(diag);
+			L[j * M + j] = ljj;
+			for(size_t i=j+1;i<M;++i){
+				std::complex<float> a = std::conj(R[j * M + i]); // A[i][j]（下三角は上三角の共役）
+				for(size_t p=0;p<j;++p){
+					a -= L[i * M + p] * std::conj(L[j * M + p]);
+				}
+				L[i * M + j] = a / ljj;
+			}
+		}
+		if(!ok){
+			continue; // 数値的に解けない場合は直前の係数を用いる
+		}
+		// L z = d、L^H v = z
+		for(size_t i=0;i<M;++i){
+			std::complex<float> z = d[i];
+			for(size_t p=0;p<i;++p){
+				z -= L[i * M + p] * w[p];
+			}
+			w[i] = z / L[i * M + i].real();
+		}
+		for(size_t i=M;i-->0;){
+			std::complex<float> v = w[i];
+			for(size_t p=i+1;p<M;++p){
+				v -= std::conj(L[p * M + i]) * w[p];
+			}
+			w[i] = v / L[i * M + i].real();
+		}
+		std::complex<float> denominator;
+		for(size_t i=0;i<M;++i){
+			denominator += std::conj(d[i]) * w[i];
+		}
+		if(std::abs(denominator) < 1e-20F){
+			continue;
+		}
+		const std::complex<float> scale = 1.0F / denominator; // w^H d = 1 となるよう正規化する
+		for(size_t i=0;i<M;++i){
+			w[i] *= scale;
+		}
+	}
+}
+
+}
@@ -0,0 +1,447 @@
+/*
+ * @file buttondetector.cpp
+ * \~english
+ * @brief Touch button detection algorithm independent of the serial I/O loop
+ * \~japanese
+ * @brief 通信処理から独立したタッチボタン検出アルゴリズムの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/buttondetector.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+//#define SENSOR_VALUE_OUTPUT_DEBUG
+
+namespace tumbler{
+
+ButtonDetector::ButtonDetector(const ButtonDetectionConfig& config) : config_(config)
+{
+	for(int i=0;i<4;++i){
+		fixedThreshold_[i] = k_default_threshold_; // 増分閾値
+		if(config_.manualThreshold_){
+			fixedThreshold_[i] = config_.manualThresholdValues_[i];
+		}
+	}
+	reset();
+}
+
+void ButtonDetector::reset()
+{
+	for(int i=0;i<4;++i){
+		prevState_[i] = ButtonState::none_;
+		currState_[i] = ButtonState::none_;
+		baseline_[i] = 0; // ベースラインは 4 ボタン別々とする
+		noiseMean_[i] = 0;
+		noiseVar_[i] = 0;
+	}
+	firstProcess_ = true; // 初回のセンシング処理例外のためのフラグ
+	active_ = false;
+	blanking_ = false;
+	noiseSamples_ = 0;
+	for(int i=0;i<4;++i){
+		for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+			ledWeights_[i][s] = 0;
+		}
+		ledOffset_[i] = 0;
+		ledModelError_[i] = 0;
+	}
+	for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+		ledSegments_[s] = 0;
+	}
+	ledModelUpdates_ = 0;
+	ledModelReady_ = false;
+	ledSequence_ = 0;
+	ledChangeObserved_ = false;
+	ledChangeTime_ = 0;
+	lastTimestamp_ = 0;
+}
+
+bool ButtonDetector::ledCompensationReady() const
+{
+	return config_.ledInterferenceCompensation_ && ledModelReady_;
+}
+
+void ButtonDetector::predictLEDOffset_(const LEDRingBrightness& led)
+{
+	for(int i=0;i<4;++i){
+		float offset = 0;
+		for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+			offset += ledWeights_[i][s] * led.segments_[s];
+		}
+		ledOffset_[i] = offset;
+	}
+}
+
+void ButtonDetector::updateLEDModel_(const float error[4], const float diff[LEDRingBrightness::k_num_segments_], float norm)
+{
+	// ベースラインは変化前の点灯状態における補償済計測値に追従しているため、変化直後の計測値の予測誤差は
+	// （真の係数 - 推定係数）・（点灯状態の差分）となる。これを点灯状態の差分方向に正規化 LMS で修正する。
+	const float a = 0.25F;
+	for(int i=0;i<4;++i){
+		const float e = error[i];
+		ledModelError_[i] = ledModelUpdates_ == 0 ? std::abs(e) : (1.0F - a) * ledModelError_[i] + a * std::abs(e);
+		// 接触による変化を誤って学習した場合の影響を抑えるため、修正量は増分閾値で頭打ちにする。
+		// 学習完了後に増分閾値を超える予測誤差は、検出されなかった接触（もしくはその解除）によるものとみなして学習に用いない
+		// （予測誤差の平均には含めるため、モデルが環境に合わなくなった場合は学習未完了に戻る）
+		const float th = static_cast<float>(threshold(i));
+		if(ledModelReady_ && th < std::abs(e)){
+			continue;
+		}
+		const float g = config_.ledCompensationRate_ * std::max(-th, std::min(th, e)) / norm;
+		for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+			ledWeights_[i][s] += g * diff[s];
+		}
+	}
+	ledModelUpdates_++;
+
+	// 学習完了の判定：予測誤差が全ボタンで閾値近傍未満となったら完了とし、いずれかで増分閾値に達したら
+	// モデルが環境に合っていないため未完了に戻す（無判定区間による従来動作とする）
+	if(!ledModelReady_){
+		if(k_ledmodel_min_updates_ <= ledModelUpdates_){
+			ledModelReady_ = true;
+			for(int i=0;i<4;++i){
+				if(static_cast<float>(threshold(i)) * config_.nearThresholdRatio_ <= ledModelError_[i]){
+					ledModelReady_ = false;
+					break;
+				}
+			}
+		}
+	}else{
+		for(int i=0;i<4;++i){
+			if(static_cast<float>(threshold(i)) <= ledModelError_[i]){
+				ledModelReady_ = false;
+				break;
+			}
+		}
+	}
+}
+
+bool ButtonDetector::adaptiveThresholdActive_() const
+{
+	return config_.adaptiveThreshold_ && !config_.manualThreshold_ && k_noise_warmup_samples_ + k_noise_init_samples_ <= noiseSamples_;
+}
+
+int ButtonDetector::threshold(int index) const
+{
+	if(!adaptiveThresholdActive_()){
+		if(config_.adaptiveThreshold_ && !config_.manualThreshold_){
+			return config_.adaptiveThresholdMax_; // ノイズ推定が揃うまでは誤検出を避けるため最も保守的な閾値とする
+		}
+		return fixedThreshold_[index];
+	}
+	// 非接触時の補正済計測値の分布から、平均 + k * 標準偏差を閾値とする
+	float th = noiseMean_[index] + config_.adaptiveThresholdSigma_ * noiseSigma(index);
+	int ith = static_cast<int>(std::ceil(th));
+	if(ith < config_.adaptiveThresholdMin_){
+		ith = config_.adaptiveThresholdMin_;
+	}else if(config_.adaptiveThresholdMax_ < ith){
+		ith = config_.adaptiveThresholdMax_;
+	}
+	return ith;
+}
+
+float ButtonDetector::noiseSigma(int index) const
+{
+	return std::sqrt(noiseVar_[index]);
+}
+
+bool ButtonDetector::pushedByThreshold_(int index, int corrected, bool pushed) const
+{
+	int th = threshold(index);
+	if(pushed && adaptiveThresholdActive_()){
+		// 閾値自動決定時はヒステリシスを持たせ、押下中は低い閾値で離されたかを判定する
+		th = static_cast<int>(static_cast<float>(th) * config_.adaptiveReleaseRatio_);
+	}
+	return th < corrected;
+}
+
+void ButtonDetector::updateNoiseEstimate_(const int corrected[4])
+{
+	noiseSamples_++;
+	if(noiseSamples_ <= k_noise_warmup_samples_){
+		return; // ベースラインの収束を待つ
+	}
+	if(noiseSamples_ <= k_noise_warmup_samples_ + k_noise_init_samples_){
+		// 初期推定：単純な平均・分散（Welford 法）
+		const float n = static_cast<float>(noiseSamples_ - k_noise_warmup_samples_);
+		for(int i=0;i<4;++i){
+			const float x = static_cast<float>(corrected[i]);
+			const float d = x - noiseMean_[i];
+			noiseMean_[i] += d / n;
+			noiseVar_[i] += (d * (x - noiseMean_[i]) - noiseVar_[i]) / n;
+		}
+		return;
+	}
+	// 以降は指数重み付きの平均・分散（オンライン推定）で環境変化に追従する
+	const float a = config_.noiseEstimationRate_;
+	for(int i=0;i<4;++i){
+		const float x = static_cast<float>(corrected[i]);
+		if(static_cast<float>(threshold(i)) * config_.nearThresholdRatio_ < x){
+			continue; // 閾値近傍の計測値は接触の立ち上がりである可能性があるため、ノイズ推定に用いない
+		}
+		const float d = x - noiseMean_[i];
+		noiseMean_[i] += a * d;
+		noiseVar_[i] = (1.0F - a) * (noiseVar_[i] + a * d * d);
+	}
+}
+
+bool ButtonDetector::process(const uint8_t values[4], const LEDRingBrightness& led, uint64_t timestamp, ButtonStateEvent& event)
+{
+	bool all_none_state = true;
+	for(int i=0;i<4;++i){
+		if(prevState_[i] != ButtonState::none_){
+			all_none_state = false;
+			break;
+		}
+	}
+
+	// LED リングの点灯状態の変化の検知
+	bool ledRingChanged = false;
+	float diff[LEDRingBrightness::k_num_segments_];
+	float norm = 0;
+	for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+		diff[s] = led.segments_[s] - ledSegments_[s];
+		norm += diff[s] * diff[s];
+		ledSegments_[s] = led.segments_[s];
+	}
+	if(!firstProcess_ && led.sequence_ != ledSequence_){
+		ledRingChanged = true;
+		ledChangeObserved_ = true;
+		ledChangeTime_ = timestamp;
+	}
+	ledSequence_ = led.sequence_;
+
+	// LED リング干渉モデルによるオフセットの予測（学習は判定後に行う）
+	predictLEDOffset_(led);
+	// 学習完了前は、LED リングの変化後の一定時間を無判定区間とする
+	blanking_ = !ledCompensationReady() && ledChangeObserved_ && timestamp - ledChangeTime_ <= k_ledring_blanking_us_;
+
+	// LED リングによるオフセットを減算した計測値（補償済計測値）
+	int compensated[4];
+	for(int i=0;i<4;++i){
+		compensated[i] = static_cast<int>(std::lround(static_cast<float>(values[i]) - ledOffset_[i]));
+	}
+
+	// 閾値自動決定の設定時は、ベースライン更新前の計測値との差分（イノベーション）で判定及びノイズ推定を行う
+	// （更新後の差分はベースライン追跡によりノイズが約半分に圧縮され、ベースラインを固定した押下中の差分と分布が揃わないため）
+	const bool adaptive_config = config_.adaptiveThreshold_ && !config_.manualThreshold_;
+	const bool adaptive = adaptiveThresholdActive_();
+	int innovation[4];
+	float ledInnovation[4]; // LED リング干渉モデルの予測誤差
+	for(int i=0;i<4;++i){
+		innovation[i] = compensated[i] - baseline_[i];
+		ledInnovation[i] = static_cast<float>(values[i]) - ledOffset_[i] - static_cast<float>(baseline_[i]);
+	}
+
+	// ベースライン補正処理
+	// 計測周期は操作の有無により変わるため、追跡の係数を前回の計測からの経過時間に応じて決め、時定数を一定とする
+	const float elapsed = firstProcess_ ? 0.0F : static_cast<float>(timestamp - lastTimestamp_);
+	const float alpha = 1.0F - std::exp(-elapsed / static_cast<float>(k_baseline_time_constant_us_));
+	lastTimestamp_ = timestamp;
+	if(all_none_state || blanking_){ // 全ボタンが none_ ステートもしくは LED リング変化後の無判定区間のとき
+		// ベースライン追跡処理を行う
+		if(firstProcess_){
+			// 初回は計測値をそのままベースラインとする（0 からの追跡では、初回の補正済計測値が計測値の半分となり、
+			// 計測値が大きい環境では起動直後に押下と判定されてベースラインが固定されてしまうため）
+			for(int i=0;i<4;++i){
+				baseline_[i] = compensated[i];
+				innovation[i] = 0;
+			}
+			firstProcess_ = false;
+		}else{
+			for(int i=0;i<4;++i){
+				int p = compensated[i];
+				if(!blanking_ && adaptive && threshold(i) * config_.nearThresholdRatio_ < innovation[i]){
+					// 閾値自動決定時は、接触の立ち上がりと思われる計測値をベースラインに取り込まない
+					continue;
+				}
+				float new_baseline_candidate = static_cast<float>(baseline_[i]) * (1.0F - alpha) + p * alpha;
+				if(blanking_){
+					// 無判定区間では急制動制約を外す
+					baseline_[i] = static_cast<int>(new_baseline_candidate);
+				}else{
+					// 急制動制約、1 ステップで前回のベースラインから閾値以上の急変動を採用しない
+					if(std::abs(new_baseline_candidate - static_cast<float>(baseline_[i])) <= static_cast<float>(baseline_[i]) * 0.66F){
+						// baseline の変動が 66% 以下である
+						baseline_[i] = static_cast<int>(new_baseline_candidate);
+					}
+				}
+			}
+		}
+	}
+
+	int corrected[4];
+	for(int i=0;i<4;++i){
+		corrected[i] = compensated[i] - baseline_[i]; // ベースラインをサブトラクション（ここで負の値になることもある）
+		if(adaptive_config){
+			corrected[i] = innovation[i];
+		}
+	}
+
+	if(blanking_){
+		// 判定を行わない
+#ifdef SENSOR_VALUE_OUTPUT_DEBUG
+		for(int i=0;i<4;++i){
+			std::cout << "baseline[" << i << "] = " << baseline_[i] << " [ LED STATUS CHANGE ]" << std::endl;
+		}
+#endif
+	}else{
+		if(all_none_state){
+			// 非接触状態の補正済計測値からノイズを推定する
+			updateNoiseEstimate_(corrected);
+		}
+		// 判定を行う
+#ifdef SENSOR_VALUE_OUTPUT_DEBUG
+		for(int i=0;i<4;++i){
+			std::cout << "baseline[" << i << "] = " << baseline_[i] << std::endl;
+		}
+#endif
+		if(config_.multiTouchDetectionEnabled_){
+			// マルチタッチ有効（デフォルト）
+			for(int i=0;i<4;++i){
+#ifdef SENSOR_VALUE_OUTPUT_DEBUG
+				std::cout << "#" << i << " corrected_p = " << corrected[i] << std::endl;
+#endif
+				if(pushedByThreshold_(i, corrected[i], currState_[i] == ButtonState::pushed_)){
+					currState_[i] = ButtonState::pushed_;
+				}else{
+					currState_[i] = ButtonState::none_;
+				}
+			}
+		}else{
+			// マルチタッチ無効
+			// 完全同時押し対応のため
+			int maxSensedValue = -1000;
+			int maxSensedButton = 0;
+			// 先押し優先のため
+			int hasPushedButton = false;
+			int pushedButton = 0;
+			int pushedButtonSensedValue = 0;
+			for(int i=0;i<4;++i){
+#ifdef SENSOR_VALUE_OUTPUT_DEBUG
+				std::cout << "#" << i << " corrected_p = " << corrected[i] << std::endl;
+#endif
+				// 最大の測定値を求める
+				if(maxSensedValue < corrected[i]){
+					maxSensedValue = corrected[i];
+					maxSensedButton = i;
+				}
+				if(currState_[i] == ButtonState::pushed_){
+					hasPushedButton = true;
+					pushedButton = i;
+					pushedButtonSensedValue = corrected[i];
+				}
+			}
+			for(int i=0;i<4;++i){
+				currState_[i] = ButtonState::none_; // クリア
+			}
+
+			if(hasPushedButton){
+				// 1 つ押されている状態のとき
+				if(pushedByThreshold_(pushedButton, pushedButtonSensedValue, true)){
+					currState_[pushedButton] = ButtonState::pushed_;
+				}else{
+					currState_[pushedButton] = ButtonState::none_;
+				}
+			}else{
+				// 1 つも押されていない状態なので、最大値を取ったボタンが増分閾値を超えていたら pushed_ 判定として良い
+				if(pushedByThreshold_(maxSensedButton, maxSensedValue, false)){
+					currState_[maxSensedButton] = ButtonState::pushed_;
+				}else{
+					currState_[maxSensedButton] = ButtonState::none_;
+				}
+			}
+		}
+	}
+
+	// コールバックを呼ぶかどうかの決定
+	// 全ボタンが none_ だったときは呼ばない、ただし、前回がそうではないときのみ 1 回だけ呼ぶ（released_ ステート）
+	bool call_callback = false;
+
+	bool prev_has_pushed_state = false; // 前回に pushed_ ステートがあるかどうか
+	for(int i=0;i<4;++i){
+		if(prevState_[i] == ButtonState::pushed_){
+			prev_has_pushed_state = true; // 前回に pushed_ ステートがあった
+			break;
+		}
+	}
+	if(prev_has_pushed_state){
+		// 前回 pushed_ ステートがあったときは、今回がどのようなステートでもコールバック関数を呼ぶ必要があり、今回が
+		// none_ ステート（すなわち pushed_ -> none_ 変化）だったときは none_ を release_ ステートと変換する
+		call_callback = true;
+		// pushed_->none_ 変化が存在する場合は、released_ ステートへ変換する
+		for(int i=0;i<4;++i){
+			if(prevState_[i] == ButtonState::pushed_ && currState_[i] == ButtonState::none_){
+				currState_[i] = ButtonState::released_;
+			}
+		}
+	}else{
+		// 前回 pushed_ ステートがなかったとき、すなわち全て none_（もしくは release_）ステートだったときは、今回が
+		// pushed_ ステートを含まない限り、コールバック関数を呼ぶ必要はない
+		for(int i=0;i<4;++i){
+			if(currState_[i] == ButtonState::pushed_){
+				call_callback = true; // コールバック関数を呼ばなければならない
+				break;
+			}
+		}
+	}
+
+	if(call_callback){
+		for(int i=0;i<4;++i){
+			event.states_[i] = currState_[i];
+			event.baselines_[i] = static_cast<int>(std::lround(static_cast<float>(baseline_[i]) + ledOffset_[i])); // 生計測値の尺度で返す
+			event.corrValues_[i] = corrected[i];
+		}
+		event.timestamp_ = timestamp;
+	}
+
+	// 活動状態の判定：押下中、閾値近傍の補正済計測値、LED リング変化のいずれかがあれば操作中とする
+	active_ = ledRingChanged || blanking_;
+	for(int i=0;i<4;++i){
+		if(currState_[i] == ButtonState::pushed_ || static_cast<float>(threshold(i)) * config_.nearThresholdRatio_ < corrected[i]){
+			active_ = true;
+			break;
+		}
+	}
+
+	// LED リング干渉モデルの学習：前回及び今回とも非接触状態で、点灯状態が変化したときのみ行う（接触による変化を学習しないため）
+	if(config_.ledInterferenceCompensation_ && ledRingChanged && all_none_state && 1e-6F < norm){
+		bool curr_none_state = true;
+		for(int i=0;i<4;++i){
+			if(currState_[i] == ButtonState::pushed_){
+				curr_none_state = false;
+				break;
+			}
+		}
+		if(curr_none_state){
+			updateLEDModel_(ledInnovation, diff, norm);
+		}
+	}
+
+	// 過去ステートを記録する
+	for(int i=0;i<4;++i){
+		prevState_[i] = currState_[i];
+	}
+	return call_callback;
+}
+
+}
@@ -25,41 +25,48 @@
  */
 
 #include "tumbler/buttons.h"
+#include "tumbler/buttondetector.h"
+#include "tumbler/buttontrace.h"
 #include <unistd.h>
 #include <mutex>
 #include <future>
 #include <thread>
 #include <iostream>
-#include <cmath>
+#include <type_traits>
 #include <syslog.h>
 
-//#define SENSOR_VALUE_OUTPUT_DEBUG
-
 namespace tumbler{
 
-int monitorAsync_(ButtonStateCallback func, ButtonDetectionConfig config, void* userdata, std::atomic<bool>* stopflag)
+static_assert(std::is_trivially_copyable<ButtonStateEvent>::value, "ButtonStateEvent must be trivially copyable");
+
+int Buttons::monitorImpl_()
 {
+	const ButtonDetectionConfig& config = config_;
 	int errorno = 0;
-	ButtonInfo binfo;
+	ButtonStateEvent event;
 	uint8_t buttonValue[4];
-	std::vector<ButtonState> prevState(4);
-	std::vector<ButtonState> currState(4);
-	for(int i=0;i<4;++i){
-		prevState[i] = ButtonState::none_;
-	}
-	bool first_process = true; // 初回のセンシング処理例外のためのフラグ
-	std::vector<int> baseline = {0,0,0,0}; // ベースラインは 4 ボタン別々とする
-	int localCounterFromLEDRingChange = 0; // LED リング変化後にボタンステートへの影響が出るまでの遅延をカバーする
+	LEDRingBrightness ledBrightness;
+	ButtonDetector detector(config);
 
-	int incThresholdValue[4] = {30,30,30,30}; // 増分閾値
-	if(config.manualThreshold_){
-		for(int i=0;i<4;++i){
-			incThresholdValue[i] = config.manualThresholdValues_[i];
+	// 適応的ポーリング周期
+	const std::chrono::milliseconds fastInterval(config.fastPollingIntervalMs_);
+	const std::chrono::milliseconds slowInterval(config.slowPollingIntervalMs_);
+	const std::chrono::milliseconds fastHold(config.fastPollingHoldMs_);
+	std::chrono::steady_clock::time_point lastActiveTime = std::chrono::steady_clock::now(); // 開始直後は高速周期とする
+	std::chrono::steady_clock::time_point prevCycleStart;
+	bool first_cycle = true;
+
+	while(stopflag_.load() == false){
+		const std::chrono::steady_clock::time_point cycleStart = std::chrono::steady_clock::now();
+		if(!first_cycle){
+			// 実際の計測周期を指数移動平均で記録する
+			uint32_t measured = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(cycleStart - prevCycleStart).count());
+			uint32_t avg = averageIntervalUs_.load();
+			averageIntervalUs_.store(avg == 0 ? measured : static_cast<uint32_t>(avg * 0.9F + measured * 0.1F));
 		}
-	}
-	bool multiTouchEnabled = config.multiTouchDetectionEnabled_;
+		prevCycleStart = cycleStart;
+		first_cycle = false;
 
-	while(stopflag->load() == false){
 		// 通信（グローバルサブシステムロック）
 		ArduinoSubsystem& subsystem = ArduinoSubsystem::getInstance();
 		{
@@ -79,187 +86,152 @@ int monitorAsync_(ButtonStateCallback func, ButtonDetectionConfig config, void*
 			for(int i=0;i<4;++i){
 				readlen = subsystem.read(reinterpret_cast<char*>(&buttonValue[i]), 1);
 			}
+			ledBrightness = subsystem.c_status_ledringBrightness_; // 計測時点の LED リングの点灯状態
 		}
 		if(errorno != 0){
 			break;
 		}
 
-		// ベースライン補正処理
-		bool all_none_state = true;
-		for(int i=0;i<4;++i){
-			if(prevState[i] != ButtonState::none_){
-				all_none_state = false;
-				break;
-			}
-		}
-		if(all_none_state || subsystem.c_status_ledringChange_.load()){ // 全ボタンが none_ ステートもしくは LED リングが変化したとき
-			// ベースライン追跡処理を行う
-			if(first_process){
-				// 初回は必ず更新する
+		// 判定（判定アルゴリズムは ButtonDetector クラスに実装されている）
+		const uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(cycleStart.time_since_epoch()).count();
+		{
+			std::lock_guard<std::mutex> lock(traceMutex_);
+			if(trace_){
+				// トレースの記録（オフライン評価用）
+				ButtonTraceRecord record;
+				record.timestamp_ = timestamp;
 				for(int i=0;i<4;++i){
-					unsigned short p = static_cast<unsigned short>(buttonValue[i]);
-					baseline[i] = static_cast<float>(baseline[i]) * 0.5F + p * 0.5F;
-				}
-				first_process = false;
-			}else{
-				for(int i=0;i<4;++i){
-					unsigned short p = static_cast<unsigned short>(buttonValue[i]);
-					float new_baseline_candidate = static_cast<float>(baseline[i]) * 0.5F + p * 0.5F;
-					if(subsystem.c_status_ledringChange_.load()){
-						// LED リングが変化したときは急制動制約を外す
-						baseline[i] = static_cast<int>(new_baseline_candidate);
-					}else{
-						// LED リングが無変化のときは急制動制約、1 ステップで前回のベースラインから閾値以上の急変動を採用しない
-						if(std::abs(new_baseline_candidate - static_cast<float>(baseline[i])) <= static_cast<float>(baseline[i]) * 0.66F){
-							// baseline の変動が 66% 以下である
-							baseline[i] = static_cast<int>(new_baseline_candidate);
-						}
-					}
+					record.values_[i] = buttonValue[i];
 				}
+				record.led_ = ledBrightness;
+				trace_->write(record);
 			}
 		}
-
-		if(subsystem.c_status_ledringChange_.load()){
-			// 判定を行わない
-#ifdef SENSOR_VALUE_OUTPUT_DEBUG
-			for(int i=0;i<4;++i){
-				std::cout << "baseline[" << i << "] = " << baseline[i] << " [ LED STATUS CHANGE ]" << std::endl;
-			}
-#endif
-			localCounterFromLEDRingChange++;
-			if(3 < localCounterFromLEDRingChange){ // 3 計測分は無判定区間とする
-				subsystem.c_status_ledringChange_.store(false); // 消費したので false を記録
-				localCounterFromLEDRingChange = 0;
-			}
+		if(detector.process(buttonValue, ledBrightness, timestamp, event)){
+			// コールバック関数は配送スレッドから呼ばれる、ここではキューに投入するのみでセンシングを律速しない
+			enqueue_(event);
 		}else{
-			// 判定を行う
-#ifdef SENSOR_VALUE_OUTPUT_DEBUG
-			for(int i=0;i<4;++i){
-				std::cout << "baseline[" << i << "] = " << baseline[i] << std::endl;
-			}
-#endif
-			if(multiTouchEnabled){
-				// マルチタッチ有効（デフォルト）
-				for(int i=0;i<4;++i){
-					unsigned short p = static_cast<unsigned short>(buttonValue[i]);
-					int corrected_p = static_cast<int>(p) - baseline[i]; // ベースラインをサブトラクション（ここで負の値になることもある）
-#ifdef SENSOR_VALUE_OUTPUT_DEBUG
-					std::cout << "#" << i << " corrected_p = " << corrected_p << std::endl;
-#endif
-					if(incThresholdValue[i] < corrected_p){
-						currState[i] = ButtonState::pushed_;
-					}else{
-						currState[i] = ButtonState::none_;
-					}
-				}
-			}else{
-				// マルチタッチ無効
-				// 完全同時押し対応のため
-				int maxSensedValue = -1000;
-				int maxSensedButton = 0;
-				// 先押し優先のため
-				int hasPushedButton = false;
-				int pushedButton = 0;
-				int pushedButtonSensedValue = 0;
-				for(int i=0;i<4;++i){
-					unsigned short p = static_cast<unsigned short>(buttonValue[i]);
-					int corrected_p = static_cast<int>(p) - baseline[i]; // ベースラインをサブトラクション（ここで負の値になることもある）
-#ifdef SENSOR_VALUE_OUTPUT_DEBUG
-					std::cout << "#" << i << " corrected_p = " << corrected_p << std::endl;
-#endif
-					// 最大の測定値を求める
-					if(maxSensedValue < corrected_p){
-						maxSensedValue = corrected_p;
-						maxSensedButton = i;
-					}
-					if(currState[i] == ButtonState::pushed_){
-						hasPushedButton = true;
-						pushedButton = i;
-						pushedButtonSensedValue = corrected_p;
-					}
-				}
-				for(int i=0;i<4;++i){
-					currState[i] = ButtonState::none_; // クリア
-				}
-
-				if(hasPushedButton){
-					// 1 つ押されている状態のとき
-					if(incThresholdValue[pushedButton] < pushedButtonSensedValue){
-						currState[pushedButton] = ButtonState::pushed_;
-					}else{
-						currState[pushedButton] = ButtonState::none_;
-					}
-				}else{
-					// 1 つも押されていない状態なので、最大値を取ったボタンが増分閾値を超えていたら pushed_ 判定として良い
-					if(incThresholdValue[maxSensedButton] < maxSensedValue){
-						currState[maxSensedButton] = ButtonState::pushed_;
-					}else{
-						currState[maxSensedButton] = ButtonState::none_;
-					}
-				}
-			}
+			flushPending_(); // 統合保持中のイベントがあれば配送を試みる
 		}
-
-		// コールバックを呼ぶかどうかの決定
-		// 全ボタンが none_ だったときは呼ばない、ただし、前回がそうではないときのみ 1 回だけ呼ぶ（released_ ステート）
-		bool call_callback = false;
-
-		bool prev_has_pushed_state = false; // 前回に pushed_ ステートがあるかどうか
 		for(int i=0;i<4;++i){
-			if(prevState[i] == ButtonState::pushed_){
-				prev_has_pushed_state = true; // 前回に pushed_ ステートがあった
-				break;
-			}
+			thresholds_[i].store(detector.threshold(i));
+			noiseSigma_[i].store(detector.noiseSigma(i));
 		}
-		if(prev_has_pushed_state){
-			// 前回 pushed_ ステートがあったときは、今回がどのようなステートでもコールバック関数を呼ぶ必要があり、今回が
-			// none_ ステート（すなわち pushed_ -> none_ 変化）だったときは none_ を release_ ステートと変換する
-			call_callback = true;
-			// pushed_->none_ 変化が存在する場合は、released_ ステートへ変換する
-			for(int i=0;i<4;++i){
-				if(prevState[i] == ButtonState::pushed_ && currState[i] == ButtonState::none_){
-					currState[i] = ButtonState::released_;
-				}
-			}
+		if(detector.blanking()){
+			ledBlankedCycles_++;
+		}
+		ledCompensationReady_.store(detector.ledCompensationReady());
+		cycles_++;
+
+		// 次の計測開始時刻まで待つ（通信時間を含めた計測周期が指定周期となるようにする）
+		if(detector.active()){
+			lastActiveTime = cycleStart;
+		}
+		if(cycleStart - lastActiveTime < fastHold){
+			currentIntervalMs_.store(config.fastPollingIntervalMs_);
+			fastCycles_++;
+			std::this_thread::sleep_until(cycleStart + fastInterval);
 		}else{
-			// 前回 pushed_ ステートがなかったとき、すなわち全て none_（もしくは release_）ステートだったときは、今回が
-			// pushed_ ステートを含まない限り、コールバック関数を呼ぶ必要はない
+			currentIntervalMs_.store(config.slowPollingIntervalMs_);
+			slowCycles_++;
+			std::this_thread::sleep_until(cycleStart + slowInterval);
+		}
+	}
+	flushPending_(); // 終了前に統合保持中のイベントの配送を試みる
+	return errorno;
+}
+
+bool Buttons::flushPending_()
+{
+	if(!hasPending_){
+		return true;
+	}
+	if(queue_.push(pending_)){
+		hasPending_ = false;
+		events_++;
+		sem_post(&queueSem_);
+		return true;
+	}
+	return false;
+}
+
+void Buttons::enqueue_(const ButtonStateEvent& event)
+{
+	if(hasPending_){
+		// 統合保持中のイベントを先に配送する
+		if(!flushPending_()){
+			// まだ満杯であるので、新しいイベントを保持中のイベントに統合する
 			for(int i=0;i<4;++i){
-				if(currState[i] == ButtonState::pushed_){
-					call_callback = true; // コールバック関数を呼ばなければならない
-					break;
+				// pushed_->released_ の変化を失わないよう、released_ の後の none_ は released_ のまま保持する
+				if(!(pending_.states_[i] == ButtonState::released_ && event.states_[i] == ButtonState::none_)){
+					pending_.states_[i] = event.states_[i];
 				}
+				pending_.baselines_[i] = event.baselines_[i];
+				pending_.corrValues_[i] = event.corrValues_[i];
 			}
+			coalescedEvents_++;
+			return;
 		}
+	}
+	if(queue_.push(event)){
+		events_++;
+		sem_post(&queueSem_);
+		return;
+	}
+	if(config_.overflowPolicy_ == ButtonEventOverflowPolicy::coalesce_){
+		pending_ = event;
+		hasPending_ = true;
+		coalescedEvents_++;
+	}else{
+		droppedEvents_++;
+	}
+}
 
-		if(call_callback){
-			// コールバック関数を呼ぶ
-			binfo.baselines_.clear();
-			binfo.corrValues_.clear();
-			for(int i=0;i<4;++i){
-				unsigned short p = static_cast<unsigned short>(buttonValue[i]);
-				int corrected_p = static_cast<int>(p) - baseline[i]; // ベースラインをサブトラクション（ここで負の値になることもある）
-				binfo.baselines_.push_back(baseline[i]);
-				binfo.corrValues_.push_back(corrected_p);
+void Buttons::dispatchImpl_()
+{
+	// ButtonStateHandler 向けの受け渡し領域は配送スレッドで一度だけ確保し、以降は再利用する
+	std::vector<ButtonState> states(4);
+	ButtonInfo binfo;
+	binfo.baselines_.resize(4);
+	binfo.corrValues_.resize(4);
+	ButtonStateEvent event;
+	while(true){
+		sem_wait(&queueSem_);
+		if(!queue_.pop(event)){
+			if(dispatchStopflag_.load()){
+				break; // 停止要求、かつキューが空
 			}
-			func(currState, binfo, userdata);
+			continue;
 		}
-
-		// 過去ステートを記録する
-		for(int i=0;i<4;++i){
-			prevState[i] = currState[i];
+		std::shared_ptr<const HandlerList> handlers;
+		{
+			std::lock_guard<std::mutex> lock(handlersMutex_);
+			handlers = handlers_;
 		}
-
-		// 仮に 1/100 秒のウェイトを置くが、このウェイトはループスピードを律速しない
-		usleep(1000*100*1);
+		bool converted = false;
+		for(size_t i=0;i<handlers->size();++i){
+			const Handler& h = (*handlers)[i];
+			if(h.eventHandler_){
+				h.eventHandler_(event);
+			}else if(h.stateHandler_){
+				if(!converted){
+					for(int j=0;j<4;++j){
+						states[j] = event.states_[j];
+						binfo.baselines_[j] = event.baselines_[j];
+						binfo.corrValues_[j] = event.corrValues_[j];
+					}
+					converted = true;
+				}
+				h.stateHandler_(states, binfo);
+			}
+		}
+		dispatched_++;
 	}
-	return errorno;
 }
 
 Buttons& Buttons::getInstance(ButtonStateCallback func, void* userdata)
 {
-	static Buttons instance(func, userdata);
-	return instance;
+	return getInstance(func, ButtonDetectionConfig(), userdata);
 }
 
 Buttons& Buttons::getInstance(ButtonStateCallback func, const ButtonDetectionConfig &config, void* userdata)
@@ -268,39 +240,157 @@ Buttons& Buttons::getInstance(ButtonStateCallback func, const ButtonDetectionCon
 	return instance;
 }
 
+Buttons& Buttons::getInstance()
+{
+	return getInstance(nullptr, ButtonDetectionConfig(), nullptr);
+}
 
-Buttons::Buttons(ButtonStateCallback func, void* userdata) :
-		subsystem_(ArduinoSubsystem::getInstance()),
-		callback_(func),
-		status_(false),
-		stopflag_(false),
-		userdata_(userdata)
-{}
+Buttons& Buttons::getInstance(const ButtonDetectionConfig &config)
+{
+	return getInstance(nullptr, config, nullptr);
+}
 
 Buttons::Buttons(ButtonStateCallback func, const ButtonDetectionConfig &config, void* userdata) :
 		subsystem_(ArduinoSubsystem::getInstance()),
-		callback_(func),
 		status_(false),
 		config_(config),
 		stopflag_(false),
-		userdata_(userdata)
-{}
+		dispatchStopflag_(false),
+		queue_(config.eventQueueCapacity_),
+		hasPending_(false),
+		handlers_(std::make_shared<HandlerList>()),
+		nextHandlerId_(0),
+		cycles_(0),
+		events_(0),
+		dispatched_(0),
+		droppedEvents_(0),
+		coalescedEvents_(0),
+		fastCycles_(0),
+		slowCycles_(0),
+		currentIntervalMs_(0),
+		averageIntervalUs_(0),
+		ledBlankedCycles_(0),
+		ledCompensationReady_(false)
+{
+	sem_init(&queueSem_, 0, 0);
+	for(int i=0;i<4;++i){
+		thresholds_[i].store(ButtonDetector::k_default_threshold_);
+		noiseSigma_[i].store(0);
+	}
+	if(func != nullptr){
+		// 従来の C 関数ポインタによるコールバックは、ハンドラの一つとして登録する
+		subscribe([func, userdata](const std::vector<ButtonState>& state, const ButtonInfo& info){
+			func(state, info, userdata);
+		});
+	}
+}
+
+Buttons::~Buttons()
+{
+	if(status_){
+		stop();
+	}
+	stopTrace();
+	sem_destroy(&queueSem_);
+}
+
+void Buttons::startTrace(const std::string& path)
+{
+	std::unique_ptr<ButtonTraceWriter> writer(new ButtonTraceWriter());
+	writer->open(path); // 開けなかった場合は例外が送出され、記録中のトレースは継続する
+	std::lock_guard<std::mutex> lock(traceMutex_);
+	trace_ = std::move(writer); // 記録中のトレースがあれば閉じられる
+}
+
+void Buttons::stopTrace()
+{
+	std::lock_guard<std::mutex> lock(traceMutex_);
+	trace_.reset();
+}
 
 void Buttons::start()
 {
+	if(status_){
+		return;
+	}
 	status_ = true;
-	monitor_ = std::async(std::launch::async, monitorAsync_, callback_, config_, userdata_, &stopflag_);
+	stopflag_.store(false);
+	dispatchStopflag_.store(false);
+	hasPending_ = false;
+	dispatcher_ = std::async(std::launch::async, &Buttons::dispatchImpl_, this);
+	monitor_ = std::async(std::launch::async, &Buttons::monitorImpl_, this);
 	syslog(LOG_INFO, "Button monitor started");
 }
 
 void Buttons::stop()
 {
+	if(!status_){
+		return;
+	}
 	status_ = false;
 	stopflag_.store(true);
-	int ret = monitor_.get();
+	int ret = monitor_.get(); // センシングスレッドの終了を待つ
+	dispatchStopflag_.store(true);
+	sem_post(&queueSem_); // 配送スレッドを起こし、キューに残ったイベントを配送させて終了させる
+	dispatcher_.get();
 	syslog(LOG_DEBUG,"Button monitor returns %d, stopped", ret);
 }
 
+int Buttons::subscribe(ButtonStateHandler handler)
+{
+	Handler h;
+	h.stateHandler_ = handler;
+	return subscribe_(h);
+}
+
+int Buttons::subscribe(ButtonEventHandler handler)
+{
+	Handler h;
+	h.eventHandler_ = handler;
+	return subscribe_(h);
+}
+
+int Buttons::subscribe_(Handler handler)
+{
+	std::lock_guard<std::mutex> lock(handlersMutex_);
+	std::shared_ptr<HandlerList> handlers = std::make_shared<HandlerList>(*handlers_);
+	handler.id_ = nextHandlerId_++;
+	handlers->push_back(handler);
+	handlers_ = handlers;
+	return handler.id_;
+}
+
+void Buttons::unsubscribe(int id)
+{
+	std::lock_guard<std::mutex> lock(handlersMutex_);
+	std::shared_ptr<HandlerList> handlers = std::make_shared<HandlerList>();
+	for(size_t i=0;i<handlers_->size();++i){
+		if((*handlers_)[i].id_ != id){
+			handlers->push_back((*handlers_)[i]);
+		}
+	}
+	handlers_ = handlers;
 }
 
+ButtonMonitorStats Buttons::stats() const
+{
+	ButtonMonitorStats s;
+	s.cycles_ = cycles_.load();
+	s.events_ = events_.load();
+	s.dispatched_ = dispatched_.load();
+	s.droppedEvents_ = droppedEvents_.load();
+	s.coalescedEvents_ = coalescedEvents_.load();
+	s.fastCycles_ = fastCycles_.load();
+	s.slowCycles_ = slowCycles_.load();
+	s.currentIntervalMs_ = currentIntervalMs_.load();
+	s.averageIntervalMs_ = static_cast<float>(averageIntervalUs_.load()) / 1000.0F;
+	for(int i=0;i<4;++i){
+		s.thresholds_[i] = thresholds_[i].load();
+		s.noiseSigma_[i] = noiseSigma_[i].load();
+	}
+	s.ledBlankedCycles_ = ledBlankedCycles_.load();
+	s.ledCompensationReady_ = ledCompensationReady_.load();
+	return s;
+}
 
+}
@@ -0,0 +1,227 @@
+/*
+ * @file buttontrace.cpp
+ * \~english
+ * @brief Recording and offline replay of touch button sensor traces
+ * \~japanese
+ * @brief タッチボタンの計測値系列（トレース）の記録と、オフライン再生による検出性能評価の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/buttontrace.h"
+#include "tumbler/buttondetector.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+
+namespace tumbler{
+
+static const char k_trace_magic_[4] = {'T','B','T','R'};
+
+// レコードは構造体のパディングに依存しないよう、フィールド毎に詰めて保存する（Raspberry Pi と同じリトルエンディアンの処理系を前提とする）
+static void ButtonTrace_pack_(const ButtonTraceRecord& record, char* buf)
+{
+	char* p = buf;
+	std::memcpy(p, &record.timestamp_, 8); p += 8;
+	std::memcpy(p, record.values_, 4); p += 4;
+	std::memcpy(p, record.led_.segments_, 4 * LEDRingBrightness::k_num_segments_); p += 4 * LEDRingBrightness::k_num_segments_;
+	*p = record.led_.rotating_ ? 1 : 0; p += 1;
+	std::memcpy(p, &record.led_.sequence_, 4);
+}
+
+static void ButtonTrace_unpack_(const char* buf, ButtonTraceRecord& record)
+{
+	const char* p = buf;
+	std::memcpy(&record.timestamp_, p, 8); p += 8;
+	std::memcpy(record.values_, p, 4); p += 4;
+	std::memcpy(record.led_.segments_, p, 4 * LEDRingBrightness::k_num_segments_); p += 4 * LEDRingBrightness::k_num_segments_;
+	record.led_.rotating_ = (*p != 0); p += 1;
+	std::memcpy(&record.led_.sequence_, p, 4);
+}
+
+void ButtonTraceWriter::open(const std::string& path)
+{
+	close();
+	fp_ = std::fopen(path.c_str(), "wb");
+	if(fp_ == nullptr){
+		std::stringstream ss;
+		ss << "ButtonTraceWriter::open(): could not open " << path;
+		throw std::runtime_error(ss.str());
+	}
+	const uint32_t version = k_version_;
+	const uint32_t record_size = k_record_size_;
+	std::fwrite(k_trace_magic_, 1, 4, fp_);
+	std::fwrite(&version, 4, 1, fp_);
+	std::fwrite(&record_size, 4, 1, fp_);
+}
+
+void ButtonTraceWriter::write(const ButtonTraceRecord& record)
+{
+	if(fp_ == nullptr){
+		return;
+	}
+	char buf[k_record_size_];
+	ButtonTrace_pack_(record, buf);
+	std::fwrite(buf, 1, k_record_size_, fp_);
+}
+
+void ButtonTraceWriter::close()
+{
+	if(fp_ != nullptr){
+		std::fclose(fp_);
+		fp_ = nullptr;
+	}
+}
+
+std::vector<ButtonTraceRecord> loadButtonTrace(const std::string& path)
+{
+	std::ifstream ifs(path.c_str(), std::ios::binary);
+	if(!ifs){
+		std::stringstream ss;
+		ss << "loadButtonTrace(): could not open " << path;
+		throw std::runtime_error(ss.str());
+	}
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t record_size = 0;
+	ifs.read(magic, 4);
+	ifs.read(reinterpret_cast<char*>(&version), 4);
+	ifs.read(reinterpret_cast<char*>(&record_size), 4);
+	if(!ifs || std::memcmp(magic, k_trace_magic_, 4) != 0 || version != ButtonTraceWriter::k_version_ || record_size != ButtonTraceWriter::k_record_size_){
+		std::stringstream ss;
+		ss << "loadButtonTrace(): " << path << " is not a button trace (version " << version << ", record size " << record_size << ")";
+		throw std::runtime_error(ss.str());
+	}
+	std::vector<ButtonTraceRecord> trace;
+	char buf[ButtonTraceWriter::k_record_size_];
+	while(ifs.read(buf, ButtonTraceWriter::k_record_size_)){
+		ButtonTraceRecord record;
+		ButtonTrace_unpack_(buf, record);
+		trace.push_back(record);
+	}
+	return trace; // 書き込み中に中断された末尾の不完全なレコードは無視する
+}
+
+std::vector<ButtonPressLabel> loadButtonPressLabels(const std::string& path)
+{
+	std::ifstream ifs(path.c_str());
+	if(!ifs){
+		std::stringstream ss;
+		ss << "loadButtonPressLabels(): could not open " << path;
+		throw std::runtime_error(ss.str());
+	}
+	std::vector<ButtonPressLabel> labels;
+	std::string line;
+	int lineno = 0;
+	while(std::getline(ifs, line)){
+		lineno++;
+		const size_t comment = line.find('#');
+		if(comment != std::string::npos){
+			line = line.substr(0, comment);
+		}
+		if(line.find_first_not_of(" \t\r") == std::string::npos){
+			continue; // 空行
+		}
+		std::istringstream is(line);
+		ButtonPressLabel label;
+		if(!(is >> label.pad_ >> label.begin_ >> label.end_) || label.pad_ < 0 || 3 < label.pad_ || label.end_ < label.begin_){
+			std::stringstream ss;
+			ss << "loadButtonPressLabels(): invalid label at " << path << ":" << lineno;
+			throw std::runtime_error(ss.str());
+		}
+		labels.push_back(label);
+	}
+	return labels;
+}
+
+ButtonDetectionReport replayButtonTrace(const std::vector<ButtonTraceRecord>& trace, const std::vector<ButtonPressLabel>& labels,
+		const ButtonDetectionConfig& config)
+{
+	ButtonDetectionReport r;
+	r.samples_ = trace.size();
+	r.labelled_ = static_cast<int>(labels.size());
+
+	// 検出性能の評価
+	{
+		ButtonDetector detector(config);
+		ButtonStateEvent event;
+		std::vector<bool> detected(labels.size(), false);
+		bool pushed[4] = {false, false, false, false};
+		double latency_sum = 0;
+		for(size_t n=0;n<trace.size();++n){
+			const uint64_t ts = trace[n].timestamp_;
+			bool curr[4] = {false, false, false, false};
+			if(detector.process(trace[n].values_, trace[n].led_, ts, event)){
+				for(int i=0;i<4;++i){
+					curr[i] = (event.states_[i] == ButtonState::pushed_);
+				}
+			}
+			for(int i=0;i<4;++i){
+				if(curr[i] && !pushed[i]){
+					// 押下の開始を検出した
+					r.presses_++;
+					if(!labels.empty()){
+						bool matched = false;
+						for(size_t k=0;k<labels.size();++k){
+							const ButtonPressLabel& l = labels[k];
+							if(l.pad_ == i && l.begin_ <= ts && ts < l.end_ + ButtonDetectionReport::k_label_tolerance_us_){
+								if(!detected[k]){
+									detected[k] = true;
+									r.detected_++;
+									const double latency = static_cast<double>(ts - l.begin_) / 1000.0;
+									latency_sum += latency;
+									if(r.maxLatencyMs_ < latency){
+										r.maxLatencyMs_ = latency;
+									}
+								}
+								matched = true;
+								break;
+							}
+						}
+						if(!matched){
+							r.falsePresses_++;
+						}
+					}
+				}
+				pushed[i] = curr[i];
+			}
+		}
+		r.missed_ = r.labelled_ - r.detected_;
+		r.meanLatencyMs_ = r.detected_ == 0 ? 0 : latency_sum / r.detected_;
+	}
+
+	// CPU 時間の計測（評価処理を含まない検出処理のみ）
+	{
+		ButtonDetector detector(config);
+		ButtonStateEvent event;
+		const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		for(size_t n=0;n<trace.size();++n){
+			detector.process(trace[n].values_, trace[n].led_, trace[n].timestamp_, event);
+		}
+		const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		if(!trace.empty()){
+			r.nsPerSample_ = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / trace.size();
+		}
+	}
+	return r;
+}
+
+}
@@ -0,0 +1,274 @@
+/*
+ * @file decimator.cpp
+ * \~english
+ * @brief Integer-factor polyphase decimator for feeding 48kHz capture to speech recognition
+ * \~japanese
+ * @brief 48kHz の録音を音声認識等に与えるための整数比のポリフェーズ・デシメーターの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/decimator.h"
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+// フィルタ係数のコンパイル時の設計
+// C++11 の constexpr 関数は return 文のみからなるため、繰り返しは再帰で書く
+
+static constexpr double k_Decimator_pi_ = 3.14159265358979323846;
+static constexpr double k_Decimator_attenuation_ = 80.0;  //!< 阻止域減衰 [dB]
+static constexpr double k_Decimator_beta_ = 0.1102 * (k_Decimator_attenuation_ - 8.7); //!< 阻止域減衰に対するカイザー窓のパラメータ
+
+/**
+ * @brief x を [-π, π] に畳み込む
+ */
+static constexpr double Decimator_wrap_(double x)
+{
+	return x > k_Decimator_pi_ ? Decimator_wrap_(x - 2.0 * k_Decimator_pi_) : (x < -k_Decimator_pi_ ? Decimator_wrap_(x + 2.0 * k_Decimator_pi_) : x);
+}
+
+static constexpr double Decimator_sinSeries_(double x2, double term, double sum, int k)
+{
+	return k > 30 ? sum : Decimator_sinSeries_(x2, -term * x2 / ((2.0 * k) * (2.0 * k + 1.0)), sum + term, k + 1);
+}
+
+static constexpr double Decimator_sin_(double x)
+{
+	return Decimator_sinSeries_(Decimator_wrap_(x) * Decimator_wrap_(x), Decimator_wrap_(x), 0.0, 1);
+}
+
+static constexpr double Decimator_sqrtNewton_(double x, double g, int k)
+{
+	return k == 0 ? g : Decimator_sqrtNewton_(x, 0.5 * (g + x / g), k - 1);
+}
+
+static constexpr double Decimator_sqrt_(double x)
+{
+	return x <= 0.0 ? 0.0 : Decimator_sqrtNewton_(x, x > 1.0 ? x : 1.0, 60);
+}
+
+static constexpr double Decimator_besselI0Series_(double q, double term, double sum, int k)
+{
+	return k > 60 ? sum : Decimator_besselI0Series_(q, term * q / (static_cast<double>(k) * k), sum + term, k + 1);
+}
+
+/**
+ * @brief 0 次の第 1 種変形ベッセル関数
+ */
+static constexpr double Decimator_besselI0_(double x)
+{
+	return Decimator_besselI0Series_(x * x / 4.0, 1.0, 0.0, 1);
+}
+
+/**
+ * @brief 遮断周波数（入力のサンプリングレートに対する比）。阻止域端が出力のナイキスト周波数となるよう、遷移帯域幅の半分だけ下げる
+ * @details 遷移帯域幅はカイザーの経験式 Δω = (A - 8) / (2.285 N) による。
+ */
+static constexpr double Decimator_cutoff_(int factor, int taps)
+{
+	return 0.5 / factor - 0.5 * (k_Decimator_attenuation_ - 8.0) / (2.285 * 2.0 * k_Decimator_pi_ * taps);
+}
+
+/**
+ * @brief m 番目のタップの係数（カイザー窓をかけた sinc 関数。正規化前）
+ */
+static constexpr double Decimator_coef_(int factor, int taps, double m)
+{
+	return (2.0 * Decimator_cutoff_(factor, taps)
+			* (Decimator_sin_(2.0 * k_Decimator_pi_ * Decimator_cutoff_(factor, taps) * (m - (taps - 1) / 2.0))
+					/ (2.0 * k_Decimator_pi_ * Decimator_cutoff_(factor, taps) * (m - (taps - 1) / 2.0))))
+			* Decimator_besselI0_(k_Decimator_beta_ * Decimator_sqrt_(1.0 - (2.0 * m / (taps - 1) - 1.0) * (2.0 * m / (taps - 1) - 1.0)))
+			/ Decimator_besselI0_(k_Decimator_beta_);
+}
+
+template<size_t... I>
+struct Decimator_indices_
+{
+};
+
+template<size_t N, size_t... I>
+struct Decimator_makeIndices_ : Decimator_makeIndices_<N - 1, N - 1, I...>
+{
+};
+
+template<size_t... I>
+struct Decimator_makeIndices_<0, I...>
+{
+	typedef Decimator_indices_<I...> type;
+};
+
+/**
+ * @brief 変換比毎の係数表（タップは入力の古い順）
+ */
+template<size_t N>
+struct Decimator_table_
+{
+	float h_[N];
+};
+
+template<int Factor, size_t... I>
+static constexpr Decimator_table_<sizeof...(I)> Decimator_design_(Decimator_indices_<I...>)
+{
+	return Decimator_table_<sizeof...(I)>{{ static_cast<float>(Decimator_coef_(Factor, static_cast<int>(sizeof...(I)), static_cast<double>(I)))... }};
+}
+
+static constexpr Decimator_table_<2 * Decimator::k_taps_per_phase_> k_Decimator_half_ =
+		Decimator_design_<2>(Decimator_makeIndices_<2 * Decimator::k_taps_per_phase_>::type());
+static constexpr Decimator_table_<3 * Decimator::k_taps_per_phase_> k_Decimator_third_ =
+		Decimator_design_<3>(Decimator_makeIndices_<3 * Decimator::k_taps_per_phase_>::type());
+static constexpr Decimator_table_<6 * Decimator::k_taps_per_phase_> k_Decimator_sixth_ =
+		Decimator_design_<6>(Decimator_makeIndices_<6 * Decimator::k_taps_per_phase_>::type());
+
+static_assert(k_Decimator_third_.h_[3 * Decimator::k_taps_per_phase_ / 2] > 0.28F && k_Decimator_third_.h_[3 * Decimator::k_taps_per_phase_ / 2] < 0.31F,
+		"the central taps of the 3:1 anti-alias filter must be close to 2 * cutoff");
+
+static int Decimator_validate_(size_t channels, int factor)
+{
+	if(channels < 1 || channels > 32 || (factor != 2 && factor != 3 && factor != 6)){
+		std::stringstream ss;
+		ss << "Decimator: " << channels << " channels with factor " << factor << " is not supported (1-32 channels, factor 2, 3 or 6)";
+		throw std::invalid_argument(ss.str());
+	}
+	return factor;
+}
+
+Decimator::Decimator(size_t channels, int factor) :
+		channels_(channels),
+		factor_(Decimator_validate_(channels, factor)),
+		stride_(k_taps_per_phase_ + k_block_),
+		coefs_(factor * k_taps_per_phase_),
+		phases_(channels * factor * (k_taps_per_phase_ + k_block_)),
+		acc_(k_block_),
+		pending_(0),
+		filled_(0)
+{
+	const float* h = factor == 2 ? k_Decimator_half_.h_ : (factor == 3 ? k_Decimator_third_.h_ : k_Decimator_sixth_.h_);
+	const int taps = factor * k_taps_per_phase_;
+	double sum = 0;
+	for(int m=0;m<taps;++m){
+		sum += h[m];
+	}
+	// 出力の n 番目は y[n] = Σ_k h[k] x[(n+1)F-1-k]。k = jF + q とすると x[(n-j)F + (F-1-q)] となるため、
+	// 入力の位相 p = F-1-q の系列 v_p[m] = x[mF + p] に係数 h[jF + q] の FIR フィルタをかけて足し合わせればよい
+	for(int p=0;p<factor;++p){
+		for(int j=0;j<k_taps_per_phase_;++j){
+			coefs_[p * k_taps_per_phase_ + j] = static_cast<float>(h[j * factor + (factor - 1 - p)] / sum);
+		}
+	}
+}
+
+void Decimator::reset()
+{
+	std::fill(phases_.data(), phases_.data() + phases_.size(), 0.0F);
+	pending_ = 0;
+	filled_ = 0;
+}
+
+void Decimator::filter_(short* const* out, size_t offset)
+{
+	const size_t history = k_taps_per_phase_ - 1;
+	for(size_t c=0;c<channels_;++c){
+		float* acc = acc_.data();
+		std::fill(acc, acc + filled_, 0.0F);
+		for(int p=0;p<factor_;++p){
+			float* phase = phases_.data() + (c * factor_ + p) * stride_;
+			accumulateFir(acc, phase + history, filled_, coefs_.data() + p * k_taps_per_phase_, k_taps_per_phase_);
+			// 直前の入力と、振り分け途中の出力サンプル分を先頭へ移す
+			std::memmove(phase, phase + filled_, (history + 1) * sizeof(float));
+		}
+		short* dst = out[c] + offset;
+		for(size_t i=0;i<filled_;++i){
+			const float v = acc[i];
+			dst[i] = static_cast<short>(v > 32767.0F ? 32767.0F : (v < -32768.0F ? -32768.0F : (v < 0 ? v - 0.5F : v + 0.5F)));
+		}
+	}
+	filled_ = 0;
+}
+
+size_t Decimator::process(const short* in, size_t frames, size_t stride, uint32_t mask, short* const* out)
+{
+	int channels[32];
+	size_t count = 0;
+	for(size_t c=0;c<stride && c<32;++c){
+		if((mask >> c) & 1U){
+			channels[count++] = static_cast<int>(c);
+		}
+	}
+	if(count != channels_ || stride > 32){
+		std::stringstream ss;
+		ss << "Decimator: the mask selects " << count << " of " << stride << " channels, but the decimator has " << channels_ << " channels";
+		throw std::invalid_argument(ss.str());
+	}
+	const short* src[32];
+	for(size_t c=0;c<count;++c){
+		src[c] = in + channels[c];
+	}
+	return process_(src, stride, frames, out);
+}
+
+size_t Decimator::process(const float* const* in, size_t frames, short* const* out)
+{
+	return process_(in, 1, frames, out);
+}
+
+template<typename Sample>
+size_t Decimator::process_(const Sample* const* in, size_t step, size_t frames, short* const* out)
+{
+	const size_t history = k_taps_per_phase_ - 1;
+	size_t produced = 0;
+	size_t done = 0;
+	while(done < frames){
+		// k_block_ 出力サンプル分まで、チャネル毎に入力を位相毎の系列へ振り分ける
+		const size_t n = std::min(frames - done, (k_block_ - filled_) * factor_ - pending_);
+		int pending = pending_;
+		size_t filled = filled_;
+		for(size_t c=0;c<channels_;++c){
+			const Sample* src = in[c] + done * step;
+			float* base = phases_.data() + c * factor_ * stride_ + history;
+			pending = pending_;
+			filled = filled_;
+			for(size_t i=0;i<n;++i){
+				base[pending * stride_ + filled] = src[i * step];
+				if(++pending == factor_){
+					pending = 0;
+					filled++;
+				}
+			}
+		}
+		pending_ = pending;
+		filled_ = filled;
+		done += n;
+		if(filled_ == k_block_){
+			filter_(out, produced);
+			produced += k_block_;
+		}
+	}
+	if(filled_ > 0){
+		const size_t n = filled_;
+		filter_(out, produced);
+		produced += n;
+	}
+	return produced;
+}
+
+}
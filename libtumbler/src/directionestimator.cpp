@@ -0,0 +1,246 @@
+/*
+ * @file directionestimator.cpp
+ * \~english
+ * @brief SRP-PHAT direction-of-arrival estimator over the 16-microphone array
+ * \~japanese
+ * @brief 16ch マイクアレイによる SRP-PHAT 音源方向推定器の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/directionestimator.h"
+#include "tumbler/ledring.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+static const DirectionEstimatorConfig& DirectionEstimator_validate_(const MicrophoneArray& array, const DirectionEstimatorConfig& config)
+{
+	std::stringstream ss;
+	if(array.size() < 2){
+		ss << "DirectionEstimator: at least two microphones are required";
+	}else if(config.fftSize_ < 16 || (config.fftSize_ & (config.fftSize_ - 1)) != 0){
+		ss << "DirectionEstimator: FFT size " << config.fftSize_ << " must be a power of two >= 16";
+	}else if(config.hop_ == 0 || config.hop_ > config.fftSize_){
+		ss << "DirectionEstimator: hop " << config.hop_ << " must be in [1," << config.fftSize_ << "]";
+	}else if(!(config.minFrequency_ >= 0) || !(config.maxFrequency_ > config.minFrequency_) || config.maxFrequency_ > DirectionEstimator::k_rate_ / 2){
+		ss << "DirectionEstimator: frequency range [" << config.minFrequency_ << "," << config.maxFrequency_ << "] is invalid";
+	}else if(!(config.azimuthStep_ > 0) || config.azimuthStep_ > 180){
+		ss << "DirectionEstimator: azimuth step " << config.azimuthStep_ << " must be in (0,180]";
+	}else if(config.elevations_.empty()){
+		ss << "DirectionEstimator: no elevation is given";
+	}else if(!(config.smoothing_ >= 0 && config.smoothing_ < 1)){
+		ss << "DirectionEstimator: smoothing " << config.smoothing_ << " must be in [0,1)";
+	}else{
+		return config;
+	}
+	throw std::invalid_argument(ss.str());
+}
+
+static size_t DirectionEstimator_firstBin_(const DirectionEstimatorConfig& config)
+{
+	return std::max<size_t>(1, static_cast<size_t>(std::ceil(config.minFrequency_ * config.fftSize_ / DirectionEstimator::k_rate_)));
+}
+
+static size_t DirectionEstimator_bins_(const DirectionEstimatorConfig& config)
+{
+	const size_t last = std::min(config.fftSize_ / 2, static_cast<size_t>(std::floor(config.maxFrequency_ * config.fftSize_ / DirectionEstimator::k_rate_)));
+	const size_t first = DirectionEstimator_firstBin_(config);
+	if(last < first){
+		std::stringstream ss;
+		ss << "DirectionEstimator: no frequency bin in [" << config.minFrequency_ << "," << config.maxFrequency_ << "] with FFT size " << config.fftSize_;
+		throw std::invalid_argument(ss.str());
+	}
+	return last - first + 1;
+}
+
+static size_t DirectionEstimator_azimuths_(const DirectionEstimatorConfig& config)
+{
+	return static_cast<size_t>(std::ceil(360.0F / config.azimuthStep_ - 1e-3F));
+}
+
+DirectionEstimator::DirectionEstimator(const MicrophoneArray& array, const DirectionEstimatorConfig& config) :
+		config_(DirectionEstimator_validate_(array, config)),
+		channels_(array.size()),
+		firstBin_(DirectionEstimator_firstBin_(config)),
+		bins_(DirectionEstimator_bins_(config)),
+		azimuthCount_(DirectionEstimator_azimuths_(config)),
+		steeringRe_(DirectionEstimator_azimuths_(config) * config.elevations_.size() * array.size() * DirectionEstimator_bins_(config)),
+		steeringIm_(DirectionEstimator_azimuths_(config) * config.elevations_.size() * array.size() * DirectionEstimator_bins_(config)),
+		analyzer_(array.size(), config.fftSize_, config.hop_, StftWindow::hann_),
+		phaseRe_(array.size() * DirectionEstimator_bins_(config)),
+		phaseIm_(array.size() * DirectionEstimator_bins_(config)),
+		sumRe_(DirectionEstimator_bins_(config)),
+		sumIm_(DirectionEstimator_bins_(config)),
+		map_(DirectionEstimator_azimuths_(config) * config.elevations_.size()),
+		display_(nullptr)
+{
+	// 探索する方向の格子（仰角毎に方位角 0 度から azimuthStep_ 刻み）と、各方向の到達時間差を打ち消すステアリングベクトル
+	std::vector<float> advances(channels_);
+	for(size_t e=0;e<config_.elevations_.size();++e){
+		for(size_t a=0;a<azimuthCount_;++a){
+			const size_t d = azimuths_.size();
+			azimuths_.push_back(a * config_.azimuthStep_);
+			elevations_.push_back(config_.elevations_[e]);
+			array.advances(azimuths_.back(), elevations_.back(), advances.data());
+			for(size_t m=0;m<channels_;++m){
+				float* re = steeringRe_.data() + (d * channels_ + m) * bins_;
+				float* im = steeringIm_.data() + (d * channels_ + m) * bins_;
+				for(size_t k=0;k<bins_;++k){
+					const double phase = -2.0 * M_PI * static_cast<double>(firstBin_ + k) * k_rate_ / config_.fftSize_ * advances[m];
+					re[k] = static_cast<float>(std::cos(phase));
+					im[k] = static_cast<float>(std::sin(phase));
+				}
+			}
+		}
+	}
+	reset();
+}
+
+void DirectionEstimator::reset()
+{
+	analyzer_.reset();
+	std::fill(map_.data(), map_.data() + map_.size(), 0.0F);
+	lastEnd_ = 0;
+	primed_ = false;
+	estimate_ = DirectionEstimate();
+}
+
+size_t DirectionEstimator::process(const float* const* in, size_t frames)
+{
+	size_t count = 0;
+	analyzer_.process(in, frames, [&](const StftFrame& frame){
+		if(process(frame)){
+			count++;
+		}
+	});
+	return count;
+}
+
+bool DirectionEstimator::process(const StftFrame& frame)
+{
+	if(frame.channels() != channels_ || frame.size() != config_.fftSize_){
+		std::stringstream ss;
+		ss << "DirectionEstimator: the STFT frame (" << frame.channels() << " channels, size " << frame.size()
+				<< ") does not match the estimator (" << channels_ << " channels, size " << config_.fftSize_ << ")";
+		throw std::invalid_argument(ss.str());
+	}
+	// 入力の先頭の、それ以前を 0 としたフレームでは推定しない
+	if(frame.end_ < config_.fftSize_ || frame.end_ - lastEnd_ < config_.hop_){
+		return false;
+	}
+	lastEnd_ = frame.end_;
+	estimateFrame_(frame);
+	return true;
+}
+
+void DirectionEstimator::estimateFrame_(const StftFrame& frame)
+{
+	const size_t size = config_.fftSize_;
+	const size_t directions = azimuths_.size();
+	// チャネル毎のスペクトルを振幅で正規化して位相のみを残す（PHAT 重み付け）
+	// 入力の電力は Parseval の定理により全周波数ビンから求め、窓関数の二乗平均で補正する
+	double energy = 0;
+	for(size_t m=0;m<channels_;++m){
+		const float* xr = frame.re(m);
+		const float* xi = frame.im(m);
+		float power = 0;
+		for(size_t k=1;k<size/2;++k){
+			power += xr[k] * xr[k] + xi[k] * xi[k];
+		}
+		energy += 2.0 * power + static_cast<double>(xr[0]) * xr[0] + static_cast<double>(xr[size/2]) * xr[size/2];
+		float* re = phaseRe_.data() + m * bins_;
+		float* im = phaseIm_.data() + m * bins_;
+		for(size_t k=0;k<bins_;++k){
+			const float r = xr[firstBin_ + k];
+			const float i = xi[firstBin_ + k];
+			const float magnitude = std::sqrt(r * r + i * i);
+			const float scale = magnitude > 1e-12F ? 1.0F / magnitude : 0.0F;
+			re[k] = r * scale;
+			im[k] = i * scale;
+		}
+	}
+	energy /= static_cast<double>(size) * stftWindowPower(frame.window());
+	estimate_.frame_ = frame.end_;
+	if(std::sqrt(energy / (channels_ * size)) < config_.minLevel_){
+		// 入力レベルが小さい場合は空間スペクトルを更新せず、直前の方向を信頼度 0 で返す
+		estimate_.confidence_ = 0;
+		if(display_ != nullptr){
+			display_->update(estimate_.azimuth_, 0);
+		}
+		return;
+	}
+
+	// 方向毎に、到達時間差を打ち消したスペクトルを全マイクで足し合わせ、その電力を周波数ビンについて合計する
+	// （全マイク対の GCC-PHAT をその方向の時間差で評価して合計したものと、定数を除いて等しい）
+	const float alpha = primed_ ? config_.smoothing_ : 0.0F;
+	const float norm = 1.0F / (static_cast<float>(channels_) * channels_ * bins_);
+	float* sumRe = sumRe_.data();
+	float* sumIm = sumIm_.data();
+	for(size_t d=0;d<directions;++d){
+		std::fill(sumRe, sumRe + bins_, 0.0F);
+		std::fill(sumIm, sumIm + bins_, 0.0F);
+		for(size_t m=0;m<channels_;++m){
+			const float* sr = steeringRe_.data() + (d * channels_ + m) * bins_;
+			const float* si = steeringIm_.data() + (d * channels_ + m) * bins_;
+			const float* xr = phaseRe_.data() + m * bins_;
+			const float* xi = phaseIm_.data() + m * bins_;
+			for(size_t k=0;k<bins_;++k){
+				sumRe[k] += xr[k] * sr[k] - xi[k] * si[k];
+				sumIm[k] += xr[k] * si[k] + xi[k] * sr[k];
+			}
+		}
+		float power = 0;
+		for(size_t k=0;k<bins_;++k){
+			power += sumRe[k] * sumRe[k] + sumIm[k] * sumIm[k];
+		}
+		map_[d] = alpha * map_[d] + (1.0F - alpha) * power * norm;
+	}
+	primed_ = true;
+
+	// 最大の方向を求め、同じ仰角の隣接する方位角との放物線補間で格子より細かく求める
+	const size_t best = static_cast<size_t>(std::max_element(map_.data(), map_.data() + directions) - map_.data());
+	const size_t row = best / azimuthCount_ * azimuthCount_;
+	const size_t column = best % azimuthCount_;
+	float azimuth = azimuths_[best];
+	if(azimuthCount_ * config_.azimuthStep_ > 359.9F){
+		const float left = map_[row + (column + azimuthCount_ - 1) % azimuthCount_];
+		const float right = map_[row + (column + 1) % azimuthCount_];
+		const float center = map_[best];
+		const float denominator = left - 2.0F * center + right;
+		if(denominator < 0){
+			azimuth += std::max(-0.5F, std::min(0.5F, 0.5F * (left - right) / denominator)) * config_.azimuthStep_;
+		}
+	}
+	azimuth = std::fmod(azimuth + 360.0F, 360.0F);
+	// 無相関な入力での期待値 1/M を 0、全マイクの位相が揃った場合を 1 とする
+	const float floor = 1.0F / channels_;
+	estimate_.azimuth_ = azimuth;
+	estimate_.elevation_ = elevations_[best];
+	estimate_.confidence_ = std::max(0.0F, std::min(1.0F, (map_[best] - floor) / (1.0F - floor)));
+	if(display_ != nullptr){
+		display_->update(estimate_.azimuth_, estimate_.confidence_);
+	}
+}
+
+}
@@ -0,0 +1,285 @@
+/*
+ * @file echocanceller.cpp
+ * \~english
+ * @brief Acoustic echo canceller using the speaker feedback channel as the far-end reference
+ * \~japanese
+ * @brief スピーカーのフィードバック信号を参照信号とする音響エコーキャンセラーの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/echocanceller.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+static const EchoCancellerConfig& EchoCanceller_validate_(size_t channels, const EchoCancellerConfig& config)
+{
+	std::stringstream ss;
+	if(channels == 0){
+		ss << "EchoCanceller: no channel is given";
+	}else if(config.block_ < 16 || (config.block_ & (config.block_ - 1)) != 0){
+		ss << "EchoCanceller: block " << config.block_ << " must be a power of two >= 16";
+	}else if(config.filterLength_ == 0 || config.filterLength_ % config.block_ != 0){
+		ss << "EchoCanceller: filter length " << config.filterLength_ << " must be a positive multiple of the block " << config.block_;
+	}else if(!(config.stepSize_ > 0 && config.stepSize_ <= 1)){
+		ss << "EchoCanceller: step size " << config.stepSize_ << " must be in (0,1]";
+	}else if(!(config.regularization_ >= 0)){
+		ss << "EchoCanceller: regularization " << config.regularization_ << " must be non-negative";
+	}else{
+		return config;
+	}
+	throw std::invalid_argument(ss.str());
+}
+
+static const float k_EchoCanceller_powerSmoothing_ = 0.7F;  //!< 参照信号の電力の平滑化係数（ブロック毎）
+static const float k_EchoCanceller_erleSmoothing_ = 0.95F;  //!< ERLE の平滑化係数（ブロック毎）
+static const float k_EchoCanceller_pathSmoothing_ = 0.6F;   //!< background と foreground の誤差の電力の平滑化係数（ブロック毎）
+static const float k_EchoCanceller_copyRatio_ = 2.0F;       //!< background の誤差がこの比以上小さい場合に foreground に写す
+static const float k_EchoCanceller_resetRatio_ = 4.0F;      //!< background の誤差がこの比以上大きい場合に foreground の係数に戻す
+
+/**
+ * @brief エコーのスペクトルの推定 Y = Σ W_p X_p（X_p は p ブロック前の参照信号のスペクトル）
+ */
+static void EchoCanceller_estimate_(const float* wr, const float* wi, const float* refRe, const float* refIm, size_t newest, size_t partitions, size_t bins,
+		float* yr, float* yi)
+{
+	std::fill(yr, yr + bins, 0.0F);
+	std::fill(yi, yi + bins, 0.0F);
+	for(size_t p=0;p<partitions;++p){
+		const size_t slot = (newest + p) % partitions;
+		const float* ar = refRe + slot * bins;
+		const float* ai = refIm + slot * bins;
+		const float* br = wr + p * bins;
+		const float* bi = wi + p * bins;
+		for(size_t k=0;k<bins;++k){
+			yr[k] += br[k] * ar[k] - bi[k] * ai[k];
+			yi[k] += br[k] * ai[k] + bi[k] * ar[k];
+		}
+	}
+}
+
+EchoCanceller::EchoCanceller(size_t channels, const EchoCancellerConfig& config) :
+		config_(EchoCanceller_validate_(channels, config)),
+		channels_(channels),
+		block_(config.block_),
+		bins_(config.block_ + 1),
+		partitions_(config.filterLength_ / config.block_),
+		fft_(2 * config.block_),
+		micPending_(channels * (config.block_ + config.referenceDelay_)),
+		refPending_(2 * config.block_),
+		refFill_(0),
+		refRe_(config.filterLength_ / config.block_ * (config.block_ + 1)),
+		refIm_(config.filterLength_ / config.block_ * (config.block_ + 1)),
+		newest_(0),
+		power_(config.block_ + 1),
+		weightRe_(channels * config.filterLength_ / config.block_ * (config.block_ + 1)),
+		weightIm_(channels * config.filterLength_ / config.block_ * (config.block_ + 1)),
+		foregroundRe_(channels * config.filterLength_ / config.block_ * (config.block_ + 1)),
+		foregroundIm_(channels * config.filterLength_ / config.block_ * (config.block_ + 1)),
+		accRe_(config.block_ + 1),
+		accIm_(config.block_ + 1),
+		gain_(config.block_ + 1),
+		time_(2 * config.block_),
+		error_(config.block_),
+		micPower_(channels),
+		errorPower_(channels),
+		backgroundPower_(channels),
+		foregroundPower_(channels),
+		blocks_(0)
+{
+	reset();
+}
+
+void EchoCanceller::reset()
+{
+	std::fill(micPending_.data(), micPending_.data() + micPending_.size(), 0.0F);
+	std::fill(refPending_.data(), refPending_.data() + refPending_.size(), 0.0F);
+	std::fill(refRe_.data(), refRe_.data() + refRe_.size(), 0.0F);
+	std::fill(refIm_.data(), refIm_.data() + refIm_.size(), 0.0F);
+	std::fill(power_.data(), power_.data() + power_.size(), 0.0F);
+	std::fill(weightRe_.data(), weightRe_.data() + weightRe_.size(), 0.0F);
+	std::fill(weightIm_.data(), weightIm_.data() + weightIm_.size(), 0.0F);
+	std::fill(foregroundRe_.data(), foregroundRe_.data() + foregroundRe_.size(), 0.0F);
+	std::fill(foregroundIm_.data(), foregroundIm_.data() + foregroundIm_.size(), 0.0F);
+	std::fill(micPower_.begin(), micPower_.end(), 0.0F);
+	std::fill(errorPower_.begin(), errorPower_.end(), 0.0F);
+	std::fill(backgroundPower_.begin(), backgroundPower_.end(), 0.0F);
+	std::fill(foregroundPower_.begin(), foregroundPower_.end(), 0.0F);
+	refFill_ = 0;
+	newest_ = 0;
+	blocks_ = 0;
+}
+
+size_t EchoCanceller::maxOutput(size_t frames) const
+{
+	return (refFill_ + frames) / block_ * block_;
+}
+
+float EchoCanceller::erle(size_t channel) const
+{
+	if(channel >= channels_ || errorPower_[channel] <= 0){
+		return 0;
+	}
+	return 10.0F * std::log10(micPower_[channel] / errorPower_[channel]);
+}
+
+size_t EchoCanceller::process(const float* const* mics, const float* reference, size_t frames, float* const* out)
+{
+	const size_t delay = config_.referenceDelay_;
+	const size_t stride = block_ + delay;
+	size_t produced = 0;
+	size_t done = 0;
+	while(done < frames){
+		// 参照信号は refPending_ の後半に、マイク入力は遅延分の後に書き込む
+		const size_t n = std::min(frames - done, block_ - refFill_);
+		std::memcpy(refPending_.data() + block_ + refFill_, reference + done, n * sizeof(float));
+		for(size_t c=0;c<channels_;++c){
+			std::memcpy(micPending_.data() + c * stride + delay + refFill_, mics[c] + done, n * sizeof(float));
+		}
+		refFill_ += n;
+		done += n;
+		if(refFill_ == block_){
+			processBlock_(out, produced);
+			produced += block_;
+			refFill_ = 0;
+			// 次のブロックのために、参照信号の今回のブロックを前半へ、マイク入力の未処理の遅延分を先頭へ移す
+			std::memcpy(refPending_.data(), refPending_.data() + block_, block_ * sizeof(float));
+			for(size_t c=0;c<channels_ && delay > 0;++c){
+				float* pending = micPending_.data() + c * stride;
+				std::memmove(pending, pending + block_, delay * sizeof(float));
+			}
+		}
+	}
+	return produced;
+}
+
+void EchoCanceller::processBlock_(float* const* out, size_t offset)
+{
+	const size_t bins = bins_;
+	const size_t stride = block_ + config_.referenceDelay_;
+
+	// 参照信号の直前と今回のブロック（2 x block_）のスペクトルを履歴に加え、周波数ビン毎の電力を平滑化する
+	newest_ = (newest_ + partitions_ - 1) % partitions_;
+	float* xr = refRe_.data() + newest_ * bins;
+	float* xi = refIm_.data() + newest_ * bins;
+	fft_.forward(refPending_.data(), xr, xi);
+	float mean = 0;
+	for(size_t k=0;k<bins;++k){
+		power_[k] = k_EchoCanceller_powerSmoothing_ * power_[k] + (1.0F - k_EchoCanceller_powerSmoothing_) * (xr[k] * xr[k] + xi[k] * xi[k]);
+		mean += power_[k];
+	}
+	mean /= bins;
+	// 正規化した step size。partition の数だけ推定値が足し合わされるため、参照信号の電力の partition 数倍で正規化する
+	// 無音の参照信号で発散しないよう、分母には平均電力に比例する値と 1LSB 相当の値を加える
+	const float floor = config_.regularization_ * mean * partitions_ + 2.0F * block_;
+	for(size_t k=0;k<bins;++k){
+		gain_[k] = config_.stepSize_ / (partitions_ * power_[k] + floor);
+	}
+	const bool active = mean > 2.0F * block_;
+	const size_t constrained = blocks_ % partitions_;
+
+	for(size_t c=0;c<channels_;++c){
+		float* wr = weightRe_.data() + c * partitions_ * bins;
+		float* wi = weightIm_.data() + c * partitions_ * bins;
+		float* fr = foregroundRe_.data() + c * partitions_ * bins;
+		float* fi = foregroundIm_.data() + c * partitions_ * bins;
+		const float* mic = micPending_.data() + c * stride;
+		float* dst = out[c] + offset;
+		float* error = error_.data();
+
+		// 適応させるフィルタ（background）と出力に用いるフィルタ（foreground）それぞれでエコーを推定し、誤差 e = d - y を求める
+		float micEnergy = 0;
+		float backgroundEnergy = 0;
+		float foregroundEnergy = 0;
+		EchoCanceller_estimate_(wr, wi, refRe_.data(), refIm_.data(), newest_, partitions_, bins, accRe_.data(), accIm_.data());
+		fft_.inverse(accRe_.data(), accIm_.data(), time_.data());
+		for(size_t i=0;i<block_;++i){
+			error[i] = mic[i] - time_[block_ + i];
+			micEnergy += mic[i] * mic[i];
+			backgroundEnergy += error[i] * error[i];
+		}
+		EchoCanceller_estimate_(fr, fi, refRe_.data(), refIm_.data(), newest_, partitions_, bins, accRe_.data(), accIm_.data());
+		fft_.inverse(accRe_.data(), accIm_.data(), time_.data());
+		for(size_t i=0;i<block_;++i){
+			dst[i] = mic[i] - time_[block_ + i];
+			foregroundEnergy += dst[i] * dst[i];
+		}
+
+		// background の誤差が十分小さい間はその係数を foreground に写し、近端の音声で乱れて誤差が大きくなった場合は foreground の係数に戻す
+		backgroundPower_[c] = k_EchoCanceller_pathSmoothing_ * backgroundPower_[c] + (1.0F - k_EchoCanceller_pathSmoothing_) * backgroundEnergy;
+		foregroundPower_[c] = k_EchoCanceller_pathSmoothing_ * foregroundPower_[c] + (1.0F - k_EchoCanceller_pathSmoothing_) * foregroundEnergy;
+		bool adapt = true;
+		if(backgroundPower_[c] * k_EchoCanceller_copyRatio_ < foregroundPower_[c]){
+			std::memcpy(fr, wr, partitions_ * bins * sizeof(float));
+			std::memcpy(fi, wi, partitions_ * bins * sizeof(float));
+			std::memcpy(dst, error, block_ * sizeof(float));
+			foregroundEnergy = backgroundEnergy;
+			foregroundPower_[c] = backgroundPower_[c];
+		}else if(backgroundPower_[c] > k_EchoCanceller_resetRatio_ * foregroundPower_[c] + block_){
+			std::memcpy(wr, fr, partitions_ * bins * sizeof(float));
+			std::memcpy(wi, fi, partitions_ * bins * sizeof(float));
+			backgroundPower_[c] = foregroundPower_[c];
+			adapt = false;
+		}
+		if(active){
+			micPower_[c] = k_EchoCanceller_erleSmoothing_ * micPower_[c] + (1.0F - k_EchoCanceller_erleSmoothing_) * micEnergy;
+			errorPower_[c] = k_EchoCanceller_erleSmoothing_ * errorPower_[c] + (1.0F - k_EchoCanceller_erleSmoothing_) * foregroundEnergy;
+		}
+		if(!adapt){
+			continue;
+		}
+
+		// 前半を 0 とした background の誤差のスペクトルから、W_p += μ E conj(X_p) / (P |X|^2 + δ) と更新する
+		std::fill(time_.data(), time_.data() + block_, 0.0F);
+		std::memcpy(time_.data() + block_, error, block_ * sizeof(float));
+		fft_.forward(time_.data(), accRe_.data(), accIm_.data());
+		for(size_t k=0;k<bins;++k){
+			accRe_[k] *= gain_[k];
+			accIm_[k] *= gain_[k];
+		}
+		for(size_t p=0;p<partitions_;++p){
+			const size_t slot = (newest_ + p) % partitions_;
+			const float* ar = refRe_.data() + slot * bins;
+			const float* ai = refIm_.data() + slot * bins;
+			const float* er = accRe_.data();
+			const float* ei = accIm_.data();
+			float* br = wr + p * bins;
+			float* bi = wi + p * bins;
+			for(size_t k=0;k<bins;++k){
+				br[k] += er[k] * ar[k] + ei[k] * ai[k];
+				bi[k] += ei[k] * ar[k] - er[k] * ai[k];
+			}
+		}
+
+		// 制約：巡回畳み込みの成分を除くため、1 つの partition のみ時間領域で後半を 0 とする（partition を巡回させて全体に行き渡らせる）
+		float* cr = wr + constrained * bins;
+		float* ci = wi + constrained * bins;
+		fft_.inverse(cr, ci, time_.data());
+		std::fill(time_.data() + block_, time_.data() + 2 * block_, 0.0F);
+		fft_.forward(time_.data(), cr, ci);
+	}
+	blocks_++;
+}
+
+}
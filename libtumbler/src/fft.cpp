@@ -0,0 +1,251 @@
+/*
+ * @file fft.cpp
+ * \~english
+ * @brief Real-input FFT with precomputed twiddle factors
+ * \~japanese
+ * @brief 回転因子を予め求めておく実数入力の高速フーリエ変換の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/fft.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TUMBLER_FFT_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TUMBLER_FFT_SSE2
+#endif
+
+namespace tumbler{
+
+static size_t FFT_validate_(size_t size)
+{
+	if(size < 4 || (size & (size - 1)) != 0){
+		std::stringstream ss;
+		ss << "FFT: size " << size << " is not a power of two (>= 4)";
+		throw std::invalid_argument(ss.str());
+	}
+	return size;
+}
+
+FFT::FFT(size_t size) :
+		size_(FFT_validate_(size)),
+		twiddleRe_(size / 2),
+		twiddleIm_(size / 2),
+		splitRe_(size / 2 + 1),
+		splitIm_(size / 2 + 1),
+		workRe_(size / 2),
+		workIm_(size / 2),
+		binsRe_(size / 2 + 1),
+		binsIm_(size / 2 + 1)
+{
+	const size_t m = size / 2;
+	size_t bits = 0;
+	while((static_cast<size_t>(1) << bits) < m){
+		bits++;
+	}
+	reverse_.resize(m);
+	for(size_t i=0;i<m;++i){
+		unsigned int r = 0;
+		for(size_t b=0;b<bits;++b){
+			if(i & (static_cast<size_t>(1) << b)){
+				r |= 1U << (bits - 1 - b);
+			}
+		}
+		reverse_[i] = r;
+	}
+	// 各段の回転因子を連続して置き、バタフライ演算で順に読めるようにする
+	for(size_t half=1;half<m;half*=2){
+		for(size_t k=0;k<half;++k){
+			twiddleRe_[half + k] = static_cast<float>(std::cos(-M_PI * k / half));
+			twiddleIm_[half + k] = static_cast<float>(std::sin(-M_PI * k / half));
+		}
+	}
+	for(size_t k=0;k<=m;++k){
+		splitRe_[k] = static_cast<float>(std::cos(-2.0 * M_PI * k / size));
+		splitIm_[k] = static_cast<float>(std::sin(-2.0 * M_PI * k / size));
+	}
+}
+
+/**
+ * @brief 半分の長さ half の段のバタフライ演算（half は 4 の倍数）
+ */
+static void FFT_stage_(float* re, float* im, size_t m, size_t half, const float* twRe, const float* twIm)
+{
+	for(size_t begin=0;begin<m;begin+=2*half){
+		float* ar = re + begin;
+		float* ai = im + begin;
+		float* br = re + begin + half;
+		float* bi = im + begin + half;
+		size_t k = 0;
+#if defined(TUMBLER_FFT_NEON)
+		for(;k+4<=half;k+=4){
+			const float32x4_t wr = vld1q_f32(twRe + k);
+			const float32x4_t wi = vld1q_f32(twIm + k);
+			const float32x4_t xr = vld1q_f32(br + k);
+			const float32x4_t xi = vld1q_f32(bi + k);
+			const float32x4_t tr = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+			const float32x4_t ti = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+			const float32x4_t yr = vld1q_f32(ar + k);
+			const float32x4_t yi = vld1q_f32(ai + k);
+			vst1q_f32(ar + k, vaddq_f32(yr, tr));
+			vst1q_f32(ai + k, vaddq_f32(yi, ti));
+			vst1q_f32(br + k, vsubq_f32(yr, tr));
+			vst1q_f32(bi + k, vsubq_f32(yi, ti));
+		}
+#elif defined(TUMBLER_FFT_SSE2)
+		for(;k+4<=half;k+=4){
+			const __m128 wr = _mm_load_ps(twRe + k);
+			const __m128 wi = _mm_load_ps(twIm + k);
+			const __m128 xr = _mm_load_ps(br + k);
+			const __m128 xi = _mm_load_ps(bi + k);
+			const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+			const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+			const __m128 yr = _mm_load_ps(ar + k);
+			const __m128 yi = _mm_load_ps(ai + k);
+			_mm_store_ps(ar + k, _mm_add_ps(yr, tr));
+			_mm_store_ps(ai + k, _mm_add_ps(yi, ti));
+			_mm_store_ps(br + k, _mm_sub_ps(yr, tr));
+			_mm_store_ps(bi + k, _mm_sub_ps(yi, ti));
+		}
+#endif
+		for(;k<half;++k){
+			const float tr = br[k] * twRe[k] - bi[k] * twIm[k];
+			const float ti = br[k] * twIm[k] + bi[k] * twRe[k];
+			br[k] = ar[k] - tr;
+			bi[k] = ai[k] - ti;
+			ar[k] += tr;
+			ai[k] += ti;
+		}
+	}
+}
+
+void FFT::transform_()
+{
+	// ビット反転の順に並んだ workRe_, workIm_ を順変換する。最初の 2 段（回転因子が 1 と -j）は基数 4 のバタフライとしてまとめる
+	const size_t m = size_ / 2;
+	float* re = workRe_.data();
+	float* im = workIm_.data();
+	if(m == 2){
+		const float r0 = re[0], i0 = im[0], r1 = re[1], i1 = im[1];
+		re[0] = r0 + r1;
+		im[0] = i0 + i1;
+		re[1] = r0 - r1;
+		im[1] = i0 - i1;
+		return;
+	}
+	for(size_t b=0;b<m;b+=4){
+		const float r0 = re[b] + re[b + 1], i0 = im[b] + im[b + 1];
+		const float r1 = re[b] - re[b + 1], i1 = im[b] - im[b + 1];
+		const float r2 = re[b + 2] + re[b + 3], i2 = im[b + 2] + im[b + 3];
+		const float r3 = re[b + 2] - re[b + 3], i3 = im[b + 2] - im[b + 3];
+		re[b] = r0 + r2;
+		im[b] = i0 + i2;
+		re[b + 2] = r0 - r2;
+		im[b + 2] = i0 - i2;
+		// (r3 + j i3) * (-j) = i3 - j r3
+		re[b + 1] = r1 + i3;
+		im[b + 1] = i1 - r3;
+		re[b + 3] = r1 - i3;
+		im[b + 3] = i1 + r3;
+	}
+	for(size_t half=4;half<m;half*=2){
+		FFT_stage_(re, im, m, half, twiddleRe_.data() + half, twiddleIm_.data() + half);
+	}
+}
+
+void FFT::forward(const float* in, float* re, float* im)
+{
+	// 偶数番目を実部、奇数番目を虚部とする長さ N/2 の複素数列 z として変換する
+	const size_t m = size_ / 2;
+	float* zr = workRe_.data();
+	float* zi = workIm_.data();
+	for(size_t i=0;i<m;++i){
+		zr[reverse_[i]] = in[2 * i];
+		zi[reverse_[i]] = in[2 * i + 1];
+	}
+	transform_();
+	// X[k] = (Z[k] + conj(Z[m-k])) / 2 - j exp(-j2πk/N) (Z[k] - conj(Z[m-k])) / 2
+	const float r0 = zr[0];
+	const float i0 = zi[0];
+	for(size_t k=1;k<m;++k){
+		const float er = 0.5F * (zr[k] + zr[m - k]);
+		const float ei = 0.5F * (zi[k] - zi[m - k]);
+		const float or_ = 0.5F * (zi[k] + zi[m - k]);
+		const float oi = -0.5F * (zr[k] - zr[m - k]);
+		re[k] = er + splitRe_[k] * or_ - splitIm_[k] * oi;
+		im[k] = ei + splitRe_[k] * oi + splitIm_[k] * or_;
+	}
+	re[0] = r0 + i0;
+	im[0] = 0;
+	re[m] = r0 - i0;
+	im[m] = 0;
+}
+
+void FFT::inverse(const float* re, const float* im, float* out)
+{
+	// forward() の分離の逆を行い、長さ N/2 の複素数列の逆変換を、共役の順変換の共役として求める
+	const size_t m = size_ / 2;
+	float* zr = workRe_.data();
+	float* zi = workIm_.data();
+	for(size_t k=0;k<m;++k){
+		const float ar = re[k];
+		const float ai = k == 0 ? 0.0F : im[k];
+		const float br = re[m - k];
+		const float bi = k == 0 ? 0.0F : -im[m - k];
+		const float dr = ar - br;
+		const float di = ai - bi;
+		// odd = (a - b) conj(exp(-j2πk/N))、z = (a + b) + j odd
+		const float or_ = dr * splitRe_[k] + di * splitIm_[k];
+		const float oi = di * splitRe_[k] - dr * splitIm_[k];
+		zr[reverse_[k]] = ar + br - oi;
+		zi[reverse_[k]] = -(ai + bi + or_);
+	}
+	transform_();
+	const float scale = 1.0F / size_;
+	for(size_t i=0;i<m;++i){
+		out[2 * i] = zr[i] * scale;
+		out[2 * i + 1] = -zi[i] * scale;
+	}
+}
+
+void FFT::forward(const float* in, std::complex<float>* out)
+{
+	forward(in, binsRe_.data(), binsIm_.data());
+	for(size_t k=0;k<bins();++k){
+		out[k] = std::complex<float>(binsRe_[k], binsIm_[k]);
+	}
+}
+
+void FFT::inverse(const std::complex<float>* in, float* out)
+{
+	for(size_t k=0;k<bins();++k){
+		binsRe_[k] = in[k].real();
+		binsIm_[k] = in[k].imag();
+	}
+	inverse(binsRe_.data(), binsIm_.data(), out);
+}
+
+}
@@ -10,7 +10,10 @@
 #include <mutex>
 #include <future>
 #include <thread>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
 
 namespace tumbler{
 
@@ -62,6 +65,64 @@ uint8_t Frame::toDataForTx(char* data) const
 	return c;
 }
 
+LEDRingBrightness Frame::brightness(bool rotating) const
+{
+	LEDRingBrightness b;
+	const int leds_per_segment = k_num_leds_ / LEDRingBrightness::k_num_segments_;
+	float total = 0;
+	for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+		float sum = 0;
+		for(int i=s*leds_per_segment;i<(s+1)*leds_per_segment;++i){
+			sum += static_cast<float>(leds_[i].r_ + leds_[i].g_ + leds_[i].b_) / (3.0F * 255.0F);
+		}
+		b.segments_[s] = sum / leds_per_segment;
+		total += b.segments_[s];
+	}
+	if(rotating){
+		for(int s=0;s<LEDRingBrightness::k_num_segments_;++s){
+			b.segments_[s] = total / LEDRingBrightness::k_num_segments_;
+		}
+	}
+	b.rotating_ = rotating;
+	return b;
+}
+
+AzimuthFrame::AzimuthFrame(const std::vector<int>& azimuths, const LED& foreground, const LED& background) : Frame(background)
+{
+	// LED は 18 個あり、20 度ごとの角度で配置されている
+	for(size_t i=0;i<azimuths.size();++i){
+		int caz = azimuths[i] % 360; // 値域対応
+		if(caz < 0){
+			caz += 360;
+		}
+		// 角度からセグメントを計算（[10,29] -> 1, [30,49] -> 2, ..., [330,349] -> 17、それ以外は端点）
+		int node0Idx, node1Idx; // 反時計回りの始点と終点
+		if(caz < 10 || 350 <= caz){
+			node0Idx = 17;
+			node1Idx = 0;
+		}else{
+			const int segment = (caz + 10) / 20;
+			node0Idx = segment - 1;
+			node1Idx = segment;
+		}
+		// 明度バランス（セグメント内の角度 [0,19] に応じて 2 つの LED に配分する）
+		const int ida = (caz + 10) % 20;
+		const float node0 = 1.0F - ida * 0.05F;
+		const float node1 = ida * 0.05F;
+		setLED(virtualToPhysical(node0Idx), LED(foreground.r_ * node0, foreground.g_ * node0, foreground.b_ * node0));
+		setLED(virtualToPhysical(node1Idx), LED(foreground.r_ * node1, foreground.g_ * node1, foreground.b_ * node1));
+	}
+}
+
+int AzimuthFrame::virtualToPhysical(int vid)
+{
+	static const int k_map[k_num_leds_] = {4, 3, 2, 1, 0, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5};
+	if(vid < 0 || k_num_leds_ <= vid){
+		throw std::runtime_error("AzimuthFrame::virtualToPhysical(), index out of range.");
+	}
+	return k_map[vid];
+}
+
 LEDRing& LEDRing::getInstance()
 {
 	static LEDRing instance;
@@ -73,9 +134,9 @@ static int LEDRing_resetImpl_()
 	char ack[8];
 	int readlen = 0;
 	ArduinoSubsystem& subsystem = ArduinoSubsystem::getInstance();
-	subsystem.c_status_ledringChange_.store(true);
 	{
 		std::lock_guard<std::mutex> lock(subsystem.global_lock_);
+		subsystem.updateLEDRingBrightness(LEDRingBrightness()); // 消灯
 		subsystem.write("LEDR",4);
 		const uint8_t subtype = 0; // v1.0 ではデフォルト回転、v1.1 から消灯へ
 		const uint8_t length  = 0;
@@ -98,11 +159,12 @@ static int LEDRing_showImpl_(const std::vector<Frame>& frames, int fps)
 	char ack[8];
 	int readlen = 0;
 	ArduinoSubsystem& subsystem = ArduinoSubsystem::getInstance();
-	subsystem.c_status_ledringChange_.store(true);
 	for(size_t i=0;i<frames.size();++i){
 		const uint8_t length = frames[i].toDataForTx(txdata);
+		const LEDRingBrightness brightness = frames[i].brightness(false);
 		{
 			std::lock_guard<std::mutex> lock(subsystem.global_lock_);
+			subsystem.updateLEDRingBrightness(brightness);
 			subsystem.write("LEDR", 4);
 			const uint8_t subtype = 8; // 外部制御アニメーションモード
 			subsystem.write(reinterpret_cast<const char*>(&subtype), 1);
@@ -133,9 +195,10 @@ static int LEDRing_motionImpl_(uint8_t motion, const Frame& frame)
 	const uint8_t data_length = frame.toDataForTx(txdata);
 	const uint8_t comm_length = data_length + 1;
 	ArduinoSubsystem& subsystem = ArduinoSubsystem::getInstance();
-	subsystem.c_status_ledringChange_.store(true);
+	const LEDRingBrightness brightness = frame.brightness(motion != 0); // 0:停止以外は回転
 	{
 		std::lock_guard<std::mutex> lock(subsystem.global_lock_);
+		subsystem.updateLEDRingBrightness(brightness);
 		subsystem.write("LEDR",4);
 		const uint8_t subtype = 1; // v1.1 から新設、組み込みアニメーションモード
 		subsystem.write(reinterpret_cast<const char*>(&subtype), 1);
@@ -235,9 +298,77 @@ int LEDRing::setOne(bool async, uint8_t index, uint8_t r, uint8_t g, uint8_t b)
 	return motion(async, static_cast<uint8_t>(0), currentFrame_); // １点点灯固定
 }
 
+AzimuthDisplay::AzimuthDisplay(const LED& foreground, const LED& background, float minConfidence, int fps, int holdMs) :
+		foreground_(foreground),
+		background_(background),
+		minConfidence_(minConfidence),
+		fps_(fps > 0 ? fps : 1),
+		holdMs_(holdMs),
+		azimuth_(0),
+		sequence_(0),
+		stopflag_(false)
+{
+}
 
+AzimuthDisplay::~AzimuthDisplay()
+{
+	stop();
+}
 
+void AzimuthDisplay::start()
+{
+	if(render_.valid()){
+		return;
+	}
+	stopflag_.store(false);
+	render_ = std::async(std::launch::async, &AzimuthDisplay::renderImpl_, this);
 }
 
+void AzimuthDisplay::stop()
+{
+	if(!render_.valid()){
+		return;
+	}
+	stopflag_.store(true);
+	render_.get();
+}
 
+void AzimuthDisplay::update(float azimuth, float confidence)
+{
+	if(confidence < minConfidence_){
+		return;
+	}
+	azimuth_.store(azimuth);
+	sequence_++;
+}
+
+void AzimuthDisplay::renderImpl_()
+{
+	LEDRing& ring = LEDRing::getInstance();
+	const std::chrono::milliseconds interval(1000 / fps_);
+	unsigned int shownSequence = sequence_.load();
+	int shownAzimuth = -1; // 背景色のみを表示している場合は -1
+	std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+	while(!stopflag_.load()){
+		std::this_thread::sleep_for(interval);
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		const unsigned int sequence = sequence_.load();
+		if(sequence != shownSequence){
+			shownSequence = sequence;
+			last = now;
+			int azimuth = static_cast<int>(std::lround(azimuth_.load())) % 360;
+			if(azimuth < 0){
+				azimuth += 360;
+			}
+			if(azimuth != shownAzimuth){ // 同じ表示となる場合は送らない
+				ring.motion(false, 0, AzimuthFrame({azimuth}, foreground_, background_));
+				shownAzimuth = azimuth;
+			}
+		}else if(shownAzimuth >= 0 && now - last > std::chrono::milliseconds(holdMs_)){
+			ring.motion(false, 0, Frame(background_));
+			shownAzimuth = -1;
+		}
+	}
+}
 
+}
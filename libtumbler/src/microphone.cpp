@@ -0,0 +1,425 @@
+/*
+ * @file microphone.cpp
+ * \~english
+ * @brief Capture from the 18-channel microphone subsystem with a dedicated reader thread
+ * \~japanese
+ * @brief 18ch 録音デバイスからの録音を専用の読み出しスレッドで行うクラスの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/microphone.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <time.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <wiringSerial.h>
+
+namespace tumbler{
+
+static const size_t k_frame_bytes_ = Microphone::k_channels_ * sizeof(short);
+
+static uint64_t Microphone_now_()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief mask で指定したチャネルのうち、実在するチャネルの数を返す
+ */
+static size_t Microphone_selected_(uint32_t mask)
+{
+	size_t count = 0;
+	for(int c=0;c<Microphone::k_channels_;++c){
+		if(mask & (1U << c)){
+			count++;
+		}
+	}
+	return count;
+}
+
+Microphone::Microphone(const MicrophoneConfig& config) :
+		config_(config),
+		fd_(-1),
+		control_(-1),
+		regular_(false),
+		samples_(config.ringFrames_ * k_channels_),
+		chunks_(config.ringFrames_ / std::max(config.readFrames_, static_cast<size_t>(1)) + 16),
+		stopflag_(false),
+		running_(false),
+		deviceFrames_(0),
+		originTime_(0),
+		started_(false),
+		currentUsed_(0),
+		nextFrame_(0),
+		frames_(0),
+		chunkCount_(0),
+		overflows_(0),
+		droppedFrames_(0),
+		gaps_(0),
+		lostFrames_(0),
+		maxFill_(0),
+		realtime_(false)
+{
+	if(config_.readFrames_ == 0){
+		config_.readFrames_ = 1;
+	}
+	sem_init(&dataSem_, 0, 0);
+}
+
+Microphone::~Microphone()
+{
+	stop();
+	sem_destroy(&dataSem_);
+}
+
+void Microphone::start()
+{
+	if(capture_.valid()){
+		return; // 録音中
+	}
+	if(config_.control_){
+		// 録音デバイスを raw モードのシリアル通信として開く（録音データの読み出しにも適用される）
+		control_ = serialOpen(config_.device_.c_str(), 9600);
+		if(control_ < 0){
+			std::stringstream ss;
+			ss << "Microphone::start(): could not open " << config_.device_ << " for control";
+			throw std::runtime_error(ss.str());
+		}
+	}
+	fd_ = ::open(config_.device_.c_str(), O_RDONLY | O_NOCTTY); // FIFO の場合は書き込み側が開くまでブロックする
+	if(fd_ < 0){
+		std::stringstream ss;
+		ss << "Microphone::start(): could not open " << config_.device_ << " (" << std::strerror(errno) << ")";
+		if(control_ >= 0){
+			serialClose(control_);
+			control_ = -1;
+		}
+		throw std::runtime_error(ss.str());
+	}
+	struct stat st;
+	regular_ = (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode));
+	// 前回の録音の読み残しを破棄し、通し番号を 0 から振り直す（読み出しスレッドは停止しているため利用側から読み捨てる）
+	Chunk chunk;
+	while(chunks_.pop(chunk)){
+	}
+	samples_.consume(samples_.size(), [](const short* /* values */, size_t /* count */){});
+	current_ = Chunk();
+	currentUsed_ = 0;
+	nextFrame_ = 0;
+	deviceFrames_ = 0;
+	started_ = false;
+	stopflag_.store(false);
+	running_.store(true);
+	if(control_ >= 0){
+		serialPutchar(control_, '1'); // 録音開始命令
+	}
+	capture_ = std::async(std::launch::async, &Microphone::captureImpl_, this);
+	syslog(LOG_INFO, "Microphone: capture started on %s", config_.device_.c_str());
+}
+
+void Microphone::stop()
+{
+	if(!capture_.valid()){
+		return;
+	}
+	stopflag_.store(true);
+	capture_.get();
+	if(control_ >= 0){
+		serialPutchar(control_, '0'); // 録音終了命令（送らずに終了すると録音デバイスは録音を続ける）
+		serialClose(control_);
+		control_ = -1;
+	}
+	::close(fd_);
+	fd_ = -1;
+	syslog(LOG_INFO, "Microphone: capture stopped");
+}
+
+void Microphone::captureImpl_()
+{
+	if(config_.priority_ > 0 && !regular_){ // raw ファイルは待たずに読み出せるため、実時間優先度では他のスレッドを妨げる
+		struct sched_param param;
+		param.sched_priority = config_.priority_;
+		const int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if(ret != 0){
+			syslog(LOG_WARNING, "Microphone: could not set SCHED_FIFO priority %d (%s), capture runs with normal scheduling", config_.priority_, std::strerror(ret));
+		}
+		realtime_.store(ret == 0);
+	}
+	// 領域はループの前に確保し、ループ中はヒープ確保を行わない
+	const size_t chunkBytes = config_.readFrames_ * k_frame_bytes_;
+	std::vector<short> buffer(config_.readFrames_ * k_channels_);
+	char* bytes = reinterpret_cast<char*>(buffer.data());
+	size_t filled = 0;
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	while(!stopflag_.load()){
+		struct pollfd p;
+		p.fd = fd_;
+		p.events = POLLIN;
+		const int r = poll(&p, 1, 100); // 録音デバイスからの受信が途絶えても stop() に応じられるよう一定時間毎に起きる
+		if(r < 0 && errno != EINTR){
+			syslog(LOG_ERR, "Microphone: poll() failed (%s)", std::strerror(errno));
+			break;
+		}
+		if(r <= 0){
+			continue;
+		}
+		const ssize_t n = ::read(fd_, bytes + filled, chunkBytes - filled);
+		if(n < 0){
+			if(errno == EINTR || errno == EAGAIN){
+				continue;
+			}
+			syslog(LOG_ERR, "Microphone: read() failed (%s)", std::strerror(errno));
+			break;
+		}
+		if(n == 0){
+			break; // raw ファイル、FIFO の末尾
+		}
+		filled += n;
+		if(filled < chunkBytes){
+			continue; // 1 回分のフレームが揃うまで受信する
+		}
+		// 読み出しが遅れた場合はカーネルに受信済のフレームが溜まっており、受信時刻から録音時刻を推定できない
+		int queued = 0;
+		const bool late = !regular_ && ioctl(fd_, FIONREAD, &queued) == 0 && static_cast<size_t>(queued) >= chunkBytes;
+		deliver_(buffer.data(), config_.readFrames_, Microphone_now_(), late);
+		filled = 0;
+		if(regular_ && config_.paced_){
+			std::this_thread::sleep_until(begin + std::chrono::microseconds(deviceFrames_ * 1000000 / k_rate_));
+		}
+	}
+	if(filled >= k_frame_bytes_){
+		deliver_(buffer.data(), filled / k_frame_bytes_, Microphone_now_(), false); // 末尾の端数（フレームに満たない byte は捨てる）
+	}
+	running_.store(false);
+	sem_post(&dataSem_);
+}
+
+void Microphone::deliver_(const short* data, size_t frames, uint64_t time, bool late)
+{
+	frames_ += frames;
+	if(late && started_){
+		// カーネルに溜まっていたフレームは、受信が遅れたのみで欠損していない。受信時刻は基準からの通し番号で推定し、欠損の判定は溜まっていたフレームを
+		// 受信し終えてから行う（まだ受信していないフレームを欠損とみなさない）
+		time = std::min<uint64_t>(time, originTime_ + (deviceFrames_ + frames) * 1000000ULL / k_rate_);
+	}
+	// 録音デバイス側の欠損の検出。受信したフレーム数（破棄、欠損したものを含む）が経過時間に対して不足していれば、不足分が欠損したものとみなす
+	const uint64_t arrival = time - frames * 1000000ULL / k_rate_; // このチャンクの先頭フレームの推定受信時刻
+	if(!started_){
+		originTime_ = arrival;
+		started_ = true;
+	}else if(!late && !regular_ && config_.gapToleranceMs_ > 0){
+		const uint64_t elapsed = arrival > originTime_ ? arrival - originTime_ : 0;
+		const uint64_t expected = elapsed * k_rate_ / 1000000ULL;
+		if(expected > deviceFrames_ + static_cast<uint64_t>(config_.gapToleranceMs_ * k_rate_ / 1000.0)){
+			const uint64_t lost = expected - deviceFrames_;
+			gaps_++;
+			lostFrames_ += lost;
+			deviceFrames_ += lost;
+			syslog(LOG_WARNING, "Microphone: about %llu frames seem to be lost", static_cast<unsigned long long>(lost));
+		}else if(expected < deviceFrames_){
+			// 受信が経過時間より進んでいる（一時的な受信の遅れを取り戻した、または録音デバイスのクロックが速い）ため基準を改める
+			originTime_ = arrival - deviceFrames_ * 1000000ULL / k_rate_;
+		}
+	}
+	// リングバッファへ書き込む。満杯の場合は収まらない分を破棄し、利用側を待たない
+	Chunk chunk;
+	chunk.frame_ = deviceFrames_;
+	chunk.time_ = time;
+	size_t fit = std::min(frames, (samples_.capacity() - samples_.size()) / k_channels_);
+	if(fit > 0 && chunks_.size() < chunks_.capacity()){
+		samples_.push(data, fit * k_channels_);
+		chunk.frames_ = fit;
+		chunk.time_ = time - (frames - fit) * 1000000ULL / k_rate_;
+		chunks_.push(chunk);
+		chunkCount_++;
+	}else{
+		fit = 0;
+	}
+	if(fit < frames){
+		overflows_++;
+		droppedFrames_ += frames - fit;
+	}
+	deviceFrames_ += frames;
+	const size_t fill = samples_.size() / k_channels_;
+	if(maxFill_.load() < fill){
+		maxFill_.store(fill);
+	}
+	sem_post(&dataSem_);
+}
+
+template<typename Consume>
+size_t Microphone::readImpl_(size_t frames, MicrophoneBlock& block, int timeoutMs, Consume consume)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	const long long ns = deadline.tv_nsec + static_cast<long long>(timeoutMs) * 1000000LL;
+	deadline.tv_sec += ns / 1000000000LL;
+	deadline.tv_nsec = ns % 1000000000LL;
+
+	block = MicrophoneBlock();
+	size_t done = 0;
+	while(done < frames){
+		if(currentUsed_ == current_.frames_){
+			Chunk next;
+			if(!chunks_.pop(next)){
+				if(!running_.load() && chunks_.empty()){
+					break; // 録音を終了した
+				}
+				if(timeoutMs <= 0 || sem_timedwait(&dataSem_, &deadline) != 0){
+					if(!chunks_.empty()){
+						continue; // 待っている間に書き込まれた
+					}
+					break;
+				}
+				continue;
+			}
+			current_ = next;
+			currentUsed_ = 0;
+		}
+		const uint64_t frame = current_.frame_ + currentUsed_;
+		if(done == 0){
+			block.frame_ = frame;
+			block.timestamp_ = current_.time_ - (current_.frames_ - currentUsed_) * 1000000ULL / k_rate_;
+			block.discontinuous_ = (frame != nextFrame_);
+		}else if(frame != nextFrame_){
+			break; // 破棄、欠損したフレームの手前で区切る
+		}
+		const size_t n = std::min(frames - done, current_.frames_ - currentUsed_);
+		consume(done, n);
+		done += n;
+		currentUsed_ += n;
+		nextFrame_ = frame + n;
+	}
+	block.frames_ = done;
+	return done;
+}
+
+size_t Microphone::read(short* out, size_t frames, MicrophoneBlock& block, int timeoutMs)
+{
+	return readImpl_(frames, block, timeoutMs, [&](size_t done, size_t n){
+		samples_.pop(out + done * k_channels_, n * k_channels_);
+	});
+}
+
+template<typename Visit>
+void Microphone::consumeFrames_(size_t frames, Visit visit)
+{
+	// リングバッファの容量は 2 の冪のため、末尾で折り返す位置がフレームの途中となり得る。折り返すフレームのみ写して渡す
+	short straddle[k_channels_];
+	size_t partial = 0;
+	samples_.consume(frames * k_channels_, [&](const short* data, size_t size){
+		if(partial > 0){
+			const size_t rest = k_channels_ - partial;
+			std::copy(data, data + rest, straddle + partial);
+			visit(straddle, 1);
+			data += rest;
+			size -= rest;
+			partial = 0;
+		}
+		const size_t whole = size / k_channels_;
+		if(whole > 0){
+			visit(data, whole);
+		}
+		partial = size - whole * k_channels_;
+		std::copy(data + whole * k_channels_, data + size, straddle);
+	});
+}
+
+size_t Microphone::read(short* const* out, uint32_t mask, size_t frames, MicrophoneBlock& block, int timeoutMs)
+{
+	const size_t count = Microphone_selected_(mask);
+	short* dst[k_channels_];
+	return readImpl_(frames, block, timeoutMs, [&](size_t done, size_t n){
+		// リングバッファから写さずに、チャネル毎の出力先へ直接取り出す
+		consumeFrames_(n, [&](const short* in, size_t m){
+			for(size_t k=0;k<count;++k){
+				dst[k] = out[k] + done;
+			}
+			deinterleave(dst, in, m, k_channels_, mask);
+			done += m;
+		});
+	});
+}
+
+size_t Microphone::read(float* const* out, uint32_t mask, float gain, size_t frames, MicrophoneBlock& block, int timeoutMs)
+{
+	const size_t count = Microphone_selected_(mask);
+	float* dst[k_channels_];
+	return readImpl_(frames, block, timeoutMs, [&](size_t done, size_t n){
+		consumeFrames_(n, [&](const short* in, size_t m){
+			for(size_t k=0;k<count;++k){
+				dst[k] = out[k] + done;
+			}
+			deinterleave(dst, in, m, k_channels_, mask, gain);
+			done += m;
+		});
+	});
+}
+
+size_t Microphone::read(Decimator& decimator, uint32_t mask, short* const* out, size_t frames, MicrophoneBlock& block, int timeoutMs)
+{
+	const size_t count = Microphone_selected_(mask);
+	if(count != decimator.channels()){
+		std::stringstream ss;
+		ss << "Microphone: the mask selects " << count << " channels, but the decimator has " << decimator.channels() << " channels";
+		throw std::invalid_argument(ss.str());
+	}
+	short* dst[k_channels_];
+	size_t produced = 0;
+	const auto decimate = [&](const short* in, size_t n){
+		for(size_t k=0;k<count;++k){
+			dst[k] = out[k] + produced;
+		}
+		produced += decimator.process(in, n, k_channels_, mask, dst);
+	};
+	readImpl_(frames, block, timeoutMs, [&](size_t /* done */, size_t n){
+		consumeFrames_(n, decimate);
+	});
+	return produced;
+}
+
+MicrophoneStats Microphone::stats() const
+{
+	MicrophoneStats s;
+	s.frames_ = frames_.load();
+	s.chunks_ = chunkCount_.load();
+	s.overflows_ = overflows_.load();
+	s.droppedFrames_ = droppedFrames_.load();
+	s.gaps_ = gaps_.load();
+	s.lostFrames_ = lostFrames_.load();
+	s.maxFill_ = maxFill_.load();
+	s.realtime_ = realtime_.load();
+	return s;
+}
+
+}
@@ -0,0 +1,116 @@
+/*
+ * @file microphonearray.cpp
+ * \~english
+ * @brief Geometry of the 16-microphone array and steering delays
+ * \~japanese
+ * @brief 16ch マイクアレイの配置と、到来方向に対する各マイクの到達時間差の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/microphonearray.h"
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace tumbler{
+
+constexpr float MicrophoneArray::k_speed_of_sound_;
+
+MicrophoneArray MicrophoneArray::tumbler()
+{
+	// microphone_positions.txt の値 [mm]。1ch〜8ch が下側の基板、9ch〜16ch が上側の基板で、上から見て時計回りに並ぶ
+	static const float k_positions[16][3] = {
+		{12.6F, 30.5F, -23.3F}, {30.5F, 12.6F, -23.3F}, {30.5F, -12.6F, -23.3F}, {12.6F, -30.5F, -23.3F},
+		{-12.6F, -30.5F, -23.3F}, {-30.5F, -12.6F, -23.3F}, {-30.5F, 12.6F, -23.3F}, {-12.6F, 30.5F, -23.3F},
+		{12.6F, 30.5F, 23.3F}, {30.5F, 12.6F, 23.3F}, {30.5F, -12.6F, 23.3F}, {12.6F, -30.5F, 23.3F},
+		{-12.6F, -30.5F, 23.3F}, {-30.5F, -12.6F, 23.3F}, {-30.5F, 12.6F, 23.3F}, {-12.6F, 30.5F, 23.3F}
+	};
+	std::vector<MicrophonePosition> positions;
+	for(size_t i=0;i<16;++i){
+		positions.push_back(MicrophonePosition(k_positions[i][0] / 1000.0F, k_positions[i][1] / 1000.0F, k_positions[i][2] / 1000.0F));
+	}
+	return MicrophoneArray(positions);
+}
+
+MicrophoneArray MicrophoneArray::load(const std::string& path)
+{
+	std::ifstream ifs(path.c_str());
+	if(!ifs){
+		std::stringstream ss;
+		ss << "MicrophoneArray::load(): could not open " << path;
+		throw std::runtime_error(ss.str());
+	}
+	std::vector<MicrophonePosition> positions;
+	std::string line;
+	size_t lineNumber = 0;
+	while(std::getline(ifs, line)){
+		lineNumber++;
+		const size_t begin = line.find_first_not_of(" \t\r");
+		if(begin == std::string::npos || line[begin] == '#'){
+			continue;
+		}
+		std::istringstream iss(line);
+		float x, y, z;
+		if(!(iss >> x >> y >> z)){
+			std::stringstream ss;
+			ss << "MicrophoneArray::load(): " << path << ":" << lineNumber << ": expected \"x y z\" in millimeters";
+			throw std::runtime_error(ss.str());
+		}
+		positions.push_back(MicrophonePosition(x / 1000.0F, y / 1000.0F, z / 1000.0F));
+	}
+	if(positions.empty()){
+		std::stringstream ss;
+		ss << "MicrophoneArray::load(): " << path << " has no microphone positions";
+		throw std::runtime_error(ss.str());
+	}
+	return MicrophoneArray(positions);
+}
+
+MicrophoneArray::MicrophoneArray(const std::vector<MicrophonePosition>& positions) : positions_(positions)
+{
+}
+
+float MicrophoneArray::radius() const
+{
+	float r = 0;
+	for(size_t i=0;i<positions_.size();++i){
+		const MicrophonePosition& p = positions_[i];
+		r = std::max(r, std::sqrt(p.x_ * p.x_ + p.y_ * p.y_ + p.z_ * p.z_));
+	}
+	return r;
+}
+
+void MicrophoneArray::advances(float azimuth, float elevation, float* advances) const
+{
+	// 音源の方向の単位ベクトルへの射影が大きいマイクほど早く到達する
+	const double az = azimuth * M_PI / 180.0;
+	const double el = elevation * M_PI / 180.0;
+	const double ux = std::cos(el) * std::cos(az);
+	const double uy = std::cos(el) * std::sin(az);
+	const double uz = std::sin(el);
+	for(size_t i=0;i<positions_.size();++i){
+		const MicrophonePosition& p = positions_[i];
+		advances[i] = static_cast<float>((p.x_ * ux + p.y_ * uy + p.z_ * uz) / k_speed_of_sound_);
+	}
+}
+
+}
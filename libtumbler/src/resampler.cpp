@@ -0,0 +1,208 @@
+/*
+ * @file resampler.cpp
+ * \~english
+ * @brief Polyphase sample rate converter with cached filter tables
+ * \~japanese
+ * @brief フィルタ係数表をキャッシュするポリフェーズ・サンプリングレート変換器の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/resampler.h"
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace tumbler{
+
+const int Resampler::k_taps_per_phase_;
+const size_t Resampler::k_block_;
+
+/**
+ * @class Resampler::Table
+ * @brief 変換比毎のポリフェーズ・フィルタ係数表
+ */
+class Resampler::Table
+{
+public:
+	Table(int up, int down, int inputRate, int outputRate);
+	int taps_;                 //!< 1 出力サンプルあたりのタップ数
+	std::vector<float> coefs_; //!< [位相][タップ]。タップは入力の古い順
+};
+
+static double Resampler_besselI0_(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for(int k=1;k<50;++k){
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if(term < sum * 1e-12){
+			break;
+		}
+	}
+	return sum;
+}
+
+Resampler::Table::Table(int up, int down, int inputRate, int outputRate) :
+		taps_(k_taps_per_phase_ * std::max(1, (down + up - 1) / up)) // ダウンサンプルでは遮断周波数が下がる分だけフィルタ長を延ばす
+{
+	const int taps = taps_;
+	const int length = up * taps;
+	const double beta = 7.0;            // カイザー窓のパラメータ（阻止域減衰 約 70dB）
+	const double rolloff = 0.88;        // 遷移帯域を考慮した通過域端の比
+	const double fc = 0.5 * std::min(inputRate, outputRate) / (static_cast<double>(up) * inputRate) * rolloff; // アップサンプル後のレートに対する遮断周波数
+	const double center = (length - 1) / 2.0;
+	std::vector<double> h(length);
+	double sum = 0;
+	for(int m=0;m<length;++m){
+		const double t = m - center;
+		const double sinc = t == 0 ? 2.0 * fc : std::sin(2.0 * M_PI * fc * t) / (M_PI * t);
+		const double r = 2.0 * m / (length - 1) - 1.0;
+		const double window = Resampler_besselI0_(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / Resampler_besselI0_(beta);
+		h[m] = sinc * window;
+		sum += h[m];
+	}
+	// 各位相の直流利得が 1 となるよう正規化する（アップサンプルによる 1/up の減衰を補う）
+	const double gain = up / sum;
+	coefs_.resize(static_cast<size_t>(length));
+	for(int p=0;p<up;++p){
+		for(int j=0;j<taps;++j){
+			coefs_[static_cast<size_t>(p) * taps + j] = static_cast<float>(h[p + (taps - 1 - j) * up] * gain);
+		}
+	}
+}
+
+std::shared_ptr<const Resampler::Table> Resampler::cachedTable_(int up, int down, int inputRate, int outputRate)
+{
+	static std::mutex mutex;
+	static std::map<std::pair<int,int>, std::shared_ptr<const Table>> cache;
+	std::lock_guard<std::mutex> lock(mutex);
+	// 係数表は変換比 up/down と、遮断周波数を決める入出力レートの大小関係のみで決まる
+	const std::pair<int,int> key(up, down);
+	std::map<std::pair<int,int>, std::shared_ptr<const Table>>::iterator it = cache.find(key);
+	if(it != cache.end()){
+		return it->second;
+	}
+	std::shared_ptr<const Table> table = std::make_shared<Table>(up, down, inputRate, outputRate);
+	cache[key] = table;
+	return table;
+}
+
+static int Resampler_gcd_(int a, int b)
+{
+	while(b != 0){
+		const int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+Resampler::Resampler(int inputRate, int outputRate) :
+		inputRate_(inputRate),
+		outputRate_(outputRate),
+		up_(1),
+		down_(1),
+		phase_(0),
+		offset_(0)
+{
+	if(inputRate <= 0 || outputRate <= 0){
+		std::stringstream ss;
+		ss << "Resampler: invalid rate " << inputRate << " -> " << outputRate;
+		throw std::invalid_argument(ss.str());
+	}
+	const int g = Resampler_gcd_(inputRate, outputRate);
+	up_ = outputRate / g;
+	down_ = inputRate / g;
+	table_ = cachedTable_(up_, down_, inputRate, outputRate);
+	work_.assign(table_->taps_ - 1 + k_block_, 0.0F);
+	offset_ = table_->taps_ - 1;
+}
+
+int Resampler::taps() const
+{
+	return table_->taps_;
+}
+
+void Resampler::reset()
+{
+	std::fill(work_.begin(), work_.end(), 0.0F);
+	phase_ = 0;
+	offset_ = table_->taps_ - 1;
+}
+
+size_t Resampler::process(const short* in, size_t n, short* out)
+{
+	const int taps = table_->taps_;
+	const size_t history = taps - 1;
+	const float* coefs = table_->coefs_.data();
+	size_t produced = 0;
+	while(n > 0){
+		const size_t c = std::min(n, k_block_);
+		for(size_t i=0;i<c;++i){
+			work_[history + i] = static_cast<float>(in[i]);
+		}
+		const size_t end = history + c;
+		while(offset_ < end){
+			const float* h = coefs + static_cast<size_t>(phase_) * taps;
+			const float* x = work_.data() + offset_ - history;
+			float y = 0;
+			for(int j=0;j<taps;++j){
+				y += h[j] * x[j];
+			}
+			out[produced++] = static_cast<short>(y > 32767.0F ? 32767 : (y < -32768.0F ? -32768 : lrintf(y)));
+			phase_ += down_;
+			offset_ += phase_ / up_;
+			phase_ %= up_;
+		}
+		// 末尾を次回の履歴として先頭に移す
+		std::copy(work_.begin() + c, work_.begin() + end, work_.begin());
+		offset_ -= c;
+		in += c;
+		n -= c;
+	}
+	return produced;
+}
+
+size_t Resampler::flush(short* out)
+{
+	const short zeros[k_taps_per_phase_] = {0};
+	size_t produced = 0;
+	for(int remaining=table_->taps_/2;remaining>0;remaining-=k_taps_per_phase_){
+		produced += process(zeros, std::min(remaining, k_taps_per_phase_), out + produced);
+	}
+	reset();
+	return produced;
+}
+
+void Resampler::precompute(int outputRate)
+{
+	const int rates[] = {8000, 16000, 22050, 24000, 32000, 44100, 48000};
+	for(size_t i=0;i<sizeof(rates)/sizeof(rates[0]);++i){
+		if(rates[i] != outputRate){
+			Resampler r(rates[i], outputRate);
+		}
+	}
+}
+
+}
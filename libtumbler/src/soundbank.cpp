@@ -0,0 +1,269 @@
+/*
+ * @file soundbank.cpp
+ * \~english
+ * @brief Preloaded sound cache with mmap-backed WAV/raw loader
+ * \~japanese
+ * @brief WAV/raw 音声ファイルを mmap で読み込み、再生可能な形式で保持する音声キャッシュの実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/soundbank.h"
+#include "tumbler/resampler.h"
+#include "tumbler/audiokernels.h"
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace tumbler{
+
+Sound::Sound() :
+		data_(nullptr),
+		size_(0),
+		rate_(0),
+		normalizationGain_(0),
+		map_(nullptr),
+		mapLength_(0)
+{
+}
+
+Sound::~Sound()
+{
+	if(map_ != nullptr){
+		munmap(map_, mapLength_);
+	}
+}
+
+/**
+ * @class SoundFormat_
+ * @brief 音声ファイルのヘッダから読み取った形式
+ */
+class SoundFormat_
+{
+public:
+	int rate_ = 0;
+	int channels_ = 0;
+	int bits_ = 0;
+	size_t offset_ = 0; //!< 音声データの先頭のファイル上の位置
+	size_t bytes_ = 0;  //!< 音声データの byte 数
+};
+
+static uint32_t SoundBank_u32_(const unsigned char* p)
+{
+	uint32_t v;
+	std::memcpy(&v, p, 4); // リトルエンディアンの処理系を前提とする
+	return v;
+}
+
+static uint16_t SoundBank_u16_(const unsigned char* p)
+{
+	uint16_t v;
+	std::memcpy(&v, p, 2);
+	return v;
+}
+
+static void SoundBank_error_(const std::string& path, const std::string& message)
+{
+	std::stringstream ss;
+	ss << "SoundBank: " << path << ": " << message;
+	throw std::runtime_error(ss.str());
+}
+
+/**
+ * @brief RIFF/WAVE ヘッダを検証し、形式と音声データの位置を返す
+ */
+static SoundFormat_ SoundBank_parseWav_(const unsigned char* p, size_t length, const std::string& path)
+{
+	if(length < 12 || std::memcmp(p, "RIFF", 4) != 0 || std::memcmp(p + 8, "WAVE", 4) != 0){
+		SoundBank_error_(path, "not a RIFF/WAVE file");
+	}
+	SoundFormat_ f;
+	bool fmt = false;
+	bool data = false;
+	size_t pos = 12;
+	while(pos + 8 <= length && !data){
+		const unsigned char* chunk = p + pos;
+		const size_t size = SoundBank_u32_(chunk + 4);
+		const size_t body = pos + 8;
+		if(std::memcmp(chunk, "fmt ", 4) == 0){
+			if(size < 16 || body + size > length){
+				SoundBank_error_(path, "broken fmt chunk");
+			}
+			uint16_t format = SoundBank_u16_(p + body);
+			f.channels_ = SoundBank_u16_(p + body + 2);
+			f.rate_ = static_cast<int>(SoundBank_u32_(p + body + 4));
+			const uint16_t block = SoundBank_u16_(p + body + 12);
+			f.bits_ = SoundBank_u16_(p + body + 14);
+			if(format == 0xFFFE && size >= 40){
+				format = SoundBank_u16_(p + body + 24); // WAVE_FORMAT_EXTENSIBLE のサブフォーマット
+			}
+			if(format != 1){
+				SoundBank_error_(path, "only linear PCM is supported");
+			}
+			if((f.bits_ != 8 && f.bits_ != 16) || f.channels_ < 1 || 2 < f.channels_ || f.rate_ <= 0 || block != f.channels_ * f.bits_ / 8){
+				std::stringstream ss;
+				ss << "unsupported format (" << f.channels_ << " ch, " << f.bits_ << " bit, " << f.rate_ << " Hz)";
+				SoundBank_error_(path, ss.str());
+			}
+			fmt = true;
+		}else if(std::memcmp(chunk, "data", 4) == 0){
+			if(!fmt){
+				SoundBank_error_(path, "data chunk precedes fmt chunk");
+			}
+			f.offset_ = body;
+			f.bytes_ = std::min(size, length - body); // 書き込み途中で長さが確定していないファイルはファイル末尾までとする
+			data = true;
+		}
+		pos = body + size + (size & 1); // チャンクは 2 byte 境界に整列する
+	}
+	if(!data){
+		SoundBank_error_(path, "no data chunk");
+	}
+	return f;
+}
+
+SoundBank::SoundBank(int rate) : rate_(rate)
+{
+}
+
+SoundBank::Handle SoundBank::load_(const std::string& name, const std::string& path, bool wav, int rate, int channels)
+{
+	const int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0){
+		SoundBank_error_(path, "could not open");
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0){
+		::close(fd);
+		SoundBank_error_(path, "empty or unreadable file");
+	}
+	const size_t length = static_cast<size_t>(st.st_size);
+	void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(map == MAP_FAILED){
+		SoundBank_error_(path, "could not mmap");
+	}
+	const unsigned char* p = static_cast<const unsigned char*>(map);
+
+	SoundFormat_ f;
+	try{
+		if(wav){
+			f = SoundBank_parseWav_(p, length, path);
+		}else{
+			if(rate <= 0 || channels < 1 || 2 < channels){
+				SoundBank_error_(path, "invalid raw format");
+			}
+			f.rate_ = rate;
+			f.channels_ = channels;
+			f.bits_ = 16;
+			f.offset_ = 0;
+			f.bytes_ = length;
+		}
+	}catch(...){
+		munmap(map, length);
+		throw;
+	}
+	const size_t frames = f.bytes_ / (f.channels_ * f.bits_ / 8);
+	if(frames == 0){
+		munmap(map, length);
+		SoundBank_error_(path, "no audio data");
+	}
+
+	std::shared_ptr<Sound> sound(new Sound());
+	sound->rate_ = rate_;
+	sound->size_ = frames;
+	if(f.bits_ == 16 && f.channels_ == 1 && f.rate_ == rate_ && f.offset_ % 2 == 0){
+		// 再生可能な形式のため mmap した領域をそのまま参照する
+		madvise(map, length, MADV_WILLNEED);
+		sound->map_ = map;
+		sound->mapLength_ = length;
+		sound->data_ = reinterpret_cast<const short*>(p + f.offset_);
+	}else{
+		// モノラル 16bit に変換する
+		std::vector<short> mono(frames);
+		const unsigned char* src = p + f.offset_;
+		for(size_t i=0;i<frames;++i){
+			int sum = 0;
+			for(int c=0;c<f.channels_;++c){
+				if(f.bits_ == 16){
+					sum += static_cast<short>(SoundBank_u16_(src + (i * f.channels_ + c) * 2));
+				}else{
+					sum += (static_cast<int>(src[i * f.channels_ + c]) - 128) * 256;
+				}
+			}
+			mono[i] = static_cast<short>(sum / f.channels_);
+		}
+		munmap(map, length);
+		if(f.rate_ != rate_){
+			Resampler resampler(f.rate_, rate_);
+			sound->converted_.resize(resampler.maxOutput(frames) + resampler.maxOutput(resampler.taps()));
+			size_t n = resampler.process(mono.data(), frames, sound->converted_.data());
+			n += resampler.flush(sound->converted_.data() + n);
+			sound->converted_.resize(n);
+		}else{
+			sound->converted_.swap(mono);
+		}
+		sound->data_ = sound->converted_.data();
+		sound->size_ = sound->converted_.size();
+	}
+	// 正規化ゲインを求める（mmap した領域はこの走査で読み込まれ、初回再生時にディスクを読むことはない）
+	const short peak = peakAbsolute(sound->data_, sound->size_);
+	sound->normalizationGain_ = peak == 0 ? 0.0F : 32766.0F / static_cast<float>(peak);
+
+	Handle handle(sound);
+	std::lock_guard<std::mutex> lock(mutex_);
+	sounds_[name] = handle;
+	return handle;
+}
+
+SoundBank::Handle SoundBank::loadWav(const std::string& name, const std::string& path)
+{
+	return load_(name, path, true, 0, 0);
+}
+
+SoundBank::Handle SoundBank::loadRaw(const std::string& name, const std::string& path, int rate, int channels)
+{
+	return load_(name, path, false, rate, channels);
+}
+
+SoundBank::Handle SoundBank::get(const std::string& name) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::map<std::string, Handle>::const_iterator it = sounds_.find(name);
+	return it == sounds_.end() ? Handle() : it->second;
+}
+
+void SoundBank::unload(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	sounds_.erase(name);
+}
+
+size_t SoundBank::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return sounds_.size();
+}
+
+}
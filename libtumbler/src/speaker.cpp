@@ -25,6 +25,8 @@
  */
 
 #include "tumbler/speaker.h"
+#include "tumbler/audiokernels.h"
+#include "tumbler/resampler.h"
 #include <unistd.h>
 #include <mutex>
 #include <future>
@@ -32,33 +34,225 @@
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <syslog.h>
+#include <time.h>
+#include <cstdint>
+#include <cerrno>
 
 namespace tumbler
 {
 
+const size_t Speaker::k_period_frames_;
+const size_t Speaker::k_ring_frames_;
+const size_t Speaker::k_fade_frames_;
+const size_t Speaker::k_voice_queue_;
+const size_t Speaker::k_max_voices_;
+const size_t Speaker::k_completion_queue_;
+const int Speaker::k_device_rate_;
+
+/**
+ * @class Playback::State
+ * @brief 再生要求の状態（ハンドル、ボイス、再生スレッド、完了通知用のスレッドで共有される）
+ */
+class Playback::State
+{
+public:
+	State(Speaker* speaker, size_t length, int rate) :
+		speaker_(speaker),
+		length_(length),
+		rate_(rate),
+		future_(promise_.get_future().share()),
+		cancelled_(false),
+		startFrame_(-1),
+		written_(0)
+	{
+	}
+
+	/**
+	 * @brief 完了を通知する
+	 */
+	void complete(Playback::Result result)
+	{
+		std::function<void(Playback::Result)> callback;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			done_ = true;
+			result_ = result;
+			callback.swap(callback_);
+		}
+		promise_.set_value(result);
+		if(callback){
+			callback(result);
+		}
+	}
+
+	Speaker* speaker_;
+	const size_t length_;            //!< 再生を要求した音声のサンプル数
+	const int rate_;                 //!< 再生を要求した音声のサンプリングレート
+	std::promise<Playback::Result> promise_;
+	std::shared_future<Playback::Result> future_;
+	std::mutex mutex_;
+	bool done_ = false;
+	Playback::Result result_ = Playback::Result::completed_;
+	std::function<void(Playback::Result)> callback_;
+	std::atomic<bool> cancelled_;
+	std::atomic<int64_t> startFrame_; //!< 最初のフレームを書き込んだ PCM デバイス上の位置（再生開始前は -1）
+	std::atomic<uint64_t> written_;   //!< PCM デバイスに書き込んだフレーム数
+	uint64_t endFrame_ = 0;           //!< 最後のフレームの次の PCM デバイス上の位置（再生スレッド専用）
+	Playback::Result pendingResult_ = Playback::Result::completed_; //!< 出力の完了時に通知する結果（再生スレッド専用）
+};
+
+std::shared_future<Playback::Result> Playback::future() const
+{
+	return state_ ? state_->future_ : std::shared_future<Result>();
+}
+
+bool Playback::done() const
+{
+	if(!state_){
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(state_->mutex_);
+	return state_->done_;
+}
+
+Playback::Result Playback::wait() const
+{
+	return state_ ? state_->future_.get() : Result::stopped_;
+}
+
+void Playback::cancel()
+{
+	if(state_ && !done()){
+		state_->cancelled_.store(true);
+		sem_post(&state_->speaker_->dataSem_);
+	}
+}
+
+void Playback::onComplete(std::function<void(Result)> callback)
+{
+	if(!state_){
+		return;
+	}
+	std::unique_lock<std::mutex> lock(state_->mutex_);
+	if(!state_->done_){
+		state_->callback_ = callback;
+		return;
+	}
+	const Result result = state_->result_;
+	lock.unlock();
+	callback(result);
+}
+
+size_t Playback::position() const
+{
+	if(!state_){
+		return 0;
+	}
+	const int64_t start = state_->startFrame_.load();
+	if(start < 0){
+		return 0;
+	}
+	if(done()){
+		return state_->result_ == Result::completed_ ? state_->length_ : static_cast<size_t>(state_->written_.load() * state_->rate_ / state_->speaker_->rate());
+	}
+	const uint64_t played = state_->speaker_->playedFrames_();
+	uint64_t frames = played > static_cast<uint64_t>(start) ? played - start : 0;
+	frames = std::min(frames, state_->written_.load());
+	return std::min(state_->length_, static_cast<size_t>(frames * state_->rate_ / state_->speaker_->rate()));
+}
+
+size_t Playback::length() const
+{
+	return state_ ? state_->length_ : 0;
+}
+
+/**
+ * @brief PCM デバイスが指定フレーム数を出力するまでの時間、またはセマフォが通知されるまで待つ
+ */
+static void Speaker_waitFrames_(sem_t* sem, long long frames, int rate)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	const long long ns = ts.tv_nsec + frames * 1000000000LL / rate;
+	ts.tv_sec += ns / 1000000000LL;
+	ts.tv_nsec = ns % 1000000000LL;
+	sem_timedwait(sem, &ts);
+}
+
 Speaker& Speaker::getInstance()
 {
-	static Speaker instance;
+	return getInstance(SpeakerConfig());
+}
+
+Speaker& Speaker::getInstance(const SpeakerConfig& config)
+{
+	static Speaker instance(config);
 	return instance;
 }
 
-Speaker::Speaker()
+Speaker::Speaker(const SpeakerConfig& config) :
+		pcm_handle_(nullptr),
+		pcm_params_(nullptr),
+		periodFrames_(0),
+		bufferFrames_(0),
+		startThreshold_(0),
+		mixFrames_(k_period_frames_),
+		mmap_(false),
+		ring_(k_ring_frames_),
+		stopflag_(false),
+		drainRequested_(false),
+		underruns_(0),
+		starvations_(0),
+		streamActive_(false),
+		streamLeftGain_(1.0F),
+		streamRightGain_(0.0F),
+		voiceQueue_(k_voice_queue_),
+		deviceActive_(false),
+		activePlaybacks_(0),
+		framesWritten_(0),
+		positionFrames_(0),
+		completionQueue_(k_completion_queue_),
+		dispatchStopflag_(false)
 {
-	rate_.store(44100);
-	init(rate_.load());
+	voices_.reserve(k_max_voices_);
+	pending_.reserve(k_completion_queue_);
+	rate_.store(k_device_rate_);
+	Resampler::precompute(k_device_rate_); // よく用いるレートからの変換係数表を予め作成しておく
+	init(config);
+	sem_init(&dataSem_, 0, 0);
+	sem_init(&completionSem_, 0, 0);
+	positionTime_ = std::chrono::steady_clock::now();
+	dispatcher_ = std::async(std::launch::async, &Speaker::dispatchImpl_, this);
+	playback_ = std::async(std::launch::async, &Speaker::playbackImpl_, this);
 }
 
 Speaker::~Speaker()
 {
+	stopflag_.store(true);
+	sem_post(&dataSem_); // 再生スレッドを起こし、リングバッファに残った音声を再生させて終了させる
+	playback_.get();
+	dispatchStopflag_.store(true);
+	sem_post(&completionSem_);
+	dispatcher_.get();
+	sem_destroy(&dataSem_);
+	sem_destroy(&completionSem_);
 	close();
+	Voice* voice = nullptr;
+	// 再生スレッドでヒープ確保を行わないよう、保持できる数を超えた分は再生を終えたボイスが破棄されるまでキューに留め置く
+	// （キューも満杯になれば batchPlay() 等が再生要求を破棄する）
+	while(voices_.size() < k_max_voices_ && voiceQueue_.pop(voice)){
+		delete voice;
+	}
 }
 
-void Speaker::init(int rate)
+void Speaker::init(const SpeakerConfig& config)
 {
-	rate_.store(rate);
-	state_.store(false);
+	const int rate = rate_.load();
 	std::unique_lock<std::mutex> lock(mutex_);
-	int errorno = snd_pcm_open(&pcm_handle_, device_name_.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+	int errorno = snd_pcm_open(&pcm_handle_, config.device_.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
 	if(errorno < 0){
 		std::stringstream s;
 		s << "Could not open speaker with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
@@ -66,11 +260,18 @@ void Speaker::init(int rate)
 	}
 	snd_pcm_hw_params_alloca(&pcm_params_);
 	snd_pcm_hw_params_any(pcm_handle_, pcm_params_);
-	errorno = snd_pcm_hw_params_set_access(pcm_handle_, pcm_params_, SND_PCM_ACCESS_RW_INTERLEAVED);
-	if(errorno < 0){
-		std::stringstream s;
-		s << "Could not set interleaved mode with ALSA " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
-		throw std::runtime_error(s.str());
+	mmap_ = config.mmap_;
+	if(mmap_ && snd_pcm_hw_params_set_access(pcm_handle_, pcm_params_, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0){
+		syslog(LOG_NOTICE, "Speaker: %s does not support mmap access, falling back to interleaved writes", config.device_.c_str());
+		mmap_ = false;
+	}
+	if(!mmap_){
+		errorno = snd_pcm_hw_params_set_access(pcm_handle_, pcm_params_, SND_PCM_ACCESS_RW_INTERLEAVED);
+		if(errorno < 0){
+			std::stringstream s;
+			s << "Could not set interleaved mode with ALSA " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
+			throw std::runtime_error(s.str());
+		}
 	}
 	errorno = snd_pcm_hw_params_set_format(pcm_handle_, pcm_params_, SND_PCM_FORMAT_S16_LE);
 	if(errorno < 0){
@@ -85,19 +286,54 @@ void Speaker::init(int rate)
 		s << "Could not set channels number with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
 		throw std::runtime_error(s.str());
 	}
-	// 再生サンプリングレートは初期値 play コール毎に変えられる
 	errorno = snd_pcm_hw_params_set_rate(pcm_handle_, pcm_params_, rate, 0);
 	if(errorno < 0){
 		std::stringstream s;
 		s << "Could not set rate with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
 		throw std::runtime_error(s.str());
 	}
+	if(config.periodFrames_ > 0){
+		snd_pcm_uframes_t frames = config.periodFrames_;
+		errorno = snd_pcm_hw_params_set_period_size_near(pcm_handle_, pcm_params_, &frames, nullptr);
+		if(errorno < 0){
+			std::stringstream s;
+			s << "Could not set period size with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
+			throw std::runtime_error(s.str());
+		}
+	}
+	if(config.bufferFrames_ > 0){
+		snd_pcm_uframes_t frames = config.bufferFrames_;
+		errorno = snd_pcm_hw_params_set_buffer_size_near(pcm_handle_, pcm_params_, &frames);
+		if(errorno < 0){
+			std::stringstream s;
+			s << "Could not set buffer size with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
+			throw std::runtime_error(s.str());
+		}
+	}
 	errorno = snd_pcm_hw_params(pcm_handle_, pcm_params_);
 	if(errorno < 0){
 		std::stringstream s;
 		s << "Could not set hw parameters with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
 		throw std::runtime_error(s.str());
 	}
+	snd_pcm_hw_params_get_period_size(pcm_params_, &periodFrames_, nullptr);
+	snd_pcm_hw_params_get_buffer_size(pcm_params_, &bufferFrames_);
+	mixFrames_ = periodFrames_ == 0 ? k_period_frames_ : std::min(static_cast<size_t>(periodFrames_), k_period_frames_);
+
+	// 再生開始の閾値と、書き込み可能となったとみなすフレーム数（1 周期分）
+	startThreshold_ = config.startThreshold_ > 0 ? config.startThreshold_ : periodFrames_;
+	startThreshold_ = std::min(startThreshold_, bufferFrames_);
+	snd_pcm_sw_params_t* sw_params = nullptr;
+	snd_pcm_sw_params_alloca(&sw_params);
+	snd_pcm_sw_params_current(pcm_handle_, sw_params);
+	snd_pcm_sw_params_set_start_threshold(pcm_handle_, sw_params, startThreshold_);
+	snd_pcm_sw_params_set_avail_min(pcm_handle_, sw_params, periodFrames_);
+	errorno = snd_pcm_sw_params(pcm_handle_, sw_params);
+	if(errorno < 0){
+		std::stringstream s;
+		s << "Could not set sw parameters with ALSA; " << snd_strerror(errorno) << "(" << errorno << ")" << std::endl;
+		throw std::runtime_error(s.str());
+	}
 }
 
 void Speaker::close()
@@ -106,31 +342,728 @@ void Speaker::close()
 	snd_pcm_close(pcm_handle_);
 }
 
-void Speaker::batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode)
+bool Speaker::recover_(int errorno)
 {
-	state_.store(true);
-	auto th = std::thread([&](int rate, float volume, Speaker::PlayBackMode mode){
-		if(rate_.load() != rate){
-			close();
-			init(rate);
+	if(errorno == -EPIPE){
+		// 書き込みが追いつかず再生するデータが尽きた
+		underruns_++;
+		snd_pcm_prepare(pcm_handle_);
+		return true;
+	}else if(errorno == -EAGAIN){
+		return true;
+	}
+	if(snd_pcm_recover(pcm_handle_, errorno, 1) < 0){
+		syslog(LOG_ERR, "Speaker: could not write to PCM device; %s (%d)", snd_strerror(errorno), errorno);
+		return false;
+	}
+	return true;
+}
+
+void Speaker::writeFrames_(const short* left, const short* right, size_t frames, short* stereo)
+{
+	// 左チャネルはスピーカー用、右チャネルは BT/USB オーディオサブシステムへの入力
+	if(!mmap_){
+		interleaveStereo(stereo, left, right, frames);
+		while(frames > 0){
+			snd_pcm_sframes_t r = snd_pcm_writei(pcm_handle_, stereo, frames);
+			if(r < 0){
+				if(!recover_(static_cast<int>(r))){
+					return;
+				}
+				continue;
+			}
+			stereo += r * 2;
+			frames -= r;
+			framesWritten_ += r;
+		}
+		return;
+	}
+	// PCM デバイスのバッファへ直接インターリーブして書き込む
+	while(frames > 0){
+		const snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm_handle_);
+		if(avail < 0){
+			if(!recover_(static_cast<int>(avail))){
+				return;
+			}
+			continue;
 		}
-		short max_value = 0;
-		for(size_t i=0;i<audio.size();++i){
-			if(max_value < std::abs(audio[i])) max_value = std::abs(audio[i]);
+		if(avail == 0){
+			if(snd_pcm_state(pcm_handle_) == SND_PCM_STATE_PREPARED){
+				snd_pcm_start(pcm_handle_); // バッファが満ちたが再生開始の閾値に達していない
+			}
+			snd_pcm_wait(pcm_handle_, -1);
+			continue;
 		}
-		size_t size = audio.size()*2;
-		std::vector<short> stereoaudio(size*2,0);
-		int j=0;
-		for(size_t i=0;i<size;i+=2){
-			stereoaudio[i] = static_cast<float>(audio[j]) / static_cast<float>(max_value) * 32766 * volume;
-			++j;
+		const snd_pcm_channel_area_t* areas = nullptr;
+		snd_pcm_uframes_t offset = 0;
+		snd_pcm_uframes_t n = frames;
+		int errorno = snd_pcm_mmap_begin(pcm_handle_, &areas, &offset, &n);
+		if(errorno < 0){
+			if(!recover_(errorno)){
+				return;
+			}
+			continue;
 		}
-		snd_pcm_prepare(pcm_handle_);
-		snd_pcm_writei(pcm_handle_, stereoaudio.data(), stereoaudio.size()/2);
-		state_.store(false);
-	},  rate, volume, mode);
-	th.detach();
+		short* dst = reinterpret_cast<short*>(static_cast<char*>(areas[0].addr) + (areas[0].first + offset * areas[0].step) / 8);
+		interleaveStereo(dst, left, right, n);
+		const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm_handle_, offset, n);
+		if(committed < 0 || static_cast<snd_pcm_uframes_t>(committed) != n){
+			if(!recover_(committed < 0 ? static_cast<int>(committed) : -EPIPE)){
+				return;
+			}
+			continue;
+		}
+		framesWritten_ += n;
+		left += n;
+		if(right != nullptr){
+			right += n;
+		}
+		frames -= n;
+		// mmap アクセスでは自動的に再生が開始されないため、閾値に達したら開始する
+		if(snd_pcm_state(pcm_handle_) == SND_PCM_STATE_PREPARED && bufferFrames_ - avail + n >= startThreshold_){
+			snd_pcm_start(pcm_handle_);
+		}
+	}
+}
+
+void Speaker::updatePosition_()
+{
+	snd_pcm_sframes_t delay = 0;
+	if(snd_pcm_delay(pcm_handle_, &delay) < 0 || delay < 0){
+		delay = 0;
+	}
+	const uint64_t written = framesWritten_.load();
+	std::lock_guard<std::mutex> lock(positionMutex_);
+	positionFrames_ = written - std::min(static_cast<uint64_t>(delay), written);
+	positionTime_ = std::chrono::steady_clock::now();
+}
+
+uint64_t Speaker::playedFrames_()
+{
+	// 最後に計測した時点から、PCM デバイスは書き込み済みのフレームを実時間で出力し続けているとみなす
+	std::lock_guard<std::mutex> lock(positionMutex_);
+	const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - positionTime_).count();
+	const uint64_t played = positionFrames_ + static_cast<uint64_t>(elapsed) * rate_.load() / 1000000;
+	return std::min(played, framesWritten_.load());
+}
+
+void Speaker::retireVoice_(Voice* voice)
+{
+	Playback::State& state = *voice->playback_;
+	const int64_t start = state.startFrame_.load();
+	state.endFrame_ = start < 0 ? 0 : start + state.written_.load();
+	if(state.cancelled_.load()){
+		state.pendingResult_ = Playback::Result::cancelled_;
+	}else if(voice->stopped_){
+		state.pendingResult_ = Playback::Result::stopped_;
+	}
+	pending_.push_back(voice->playback_);
+	delete voice;
+}
+
+void Speaker::completePlaybacks_(bool all)
+{
+	if(pending_.empty()){
+		return;
+	}
+	const uint64_t played = all ? UINT64_MAX : playedFrames_();
+	bool notified = false;
+	size_t j = 0;
+	for(size_t i=0;i<pending_.size();++i){
+		if(pending_[i]->endFrame_ <= played && completionQueue_.push(pending_[i])){
+			notified = true;
+		}else{
+			pending_[j++].swap(pending_[i]); // 出力が完了していないか、完了通知が満杯のため次回に持ち越す
+		}
+	}
+	pending_.resize(j);
+	if(notified){
+		sem_post(&completionSem_);
+	}
+}
+
+void Speaker::dispatchImpl_()
+{
+	while(true){
+		sem_wait(&completionSem_);
+		std::shared_ptr<Playback::State> state;
+		while(completionQueue_.pop(state)){
+			state->complete(state->pendingResult_);
+			state.reset();
+			activePlaybacks_--;
+		}
+		if(dispatchStopflag_.load() && completionQueue_.empty()){
+			break;
+		}
+	}
+}
+
+double Speaker::latencyMs()
+{
+	snd_pcm_sframes_t delay = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(snd_pcm_delay(pcm_handle_, &delay) < 0 || delay < 0){
+			delay = 0;
+		}
+	}
+	return static_cast<double>(delay) * 1000.0 / rate_.load();
 }
 
+void Speaker::stopVoice_(Voice& voice)
+{
+	if(voice.played_ == 0){
+		voice.finish(); // 再生待ちのものは再生せずに破棄する
+	}else if(!voice.fadingOut_){
+		voice.fadingOut_ = true;
+		voice.fadeOut_ = voice.fadeLength_ = k_fade_frames_;
+	}
 }
 
+void Speaker::acceptVoices_()
+{
+	Voice* voice = nullptr;
+	while(voiceQueue_.pop(voice)){
+		if(voice->mode_ == PlayBackMode::overwrite_){
+			// 出力先チャネルが重なる再生中、再生待ちの音声をすべてフェードアウトさせる（再生待ちのものは再生せずに破棄する）
+			for(size_t i=0;i<voices_.size();++i){
+				if(!voices_[i]->routing_.overlaps(voice->routing_)){
+					continue;
+				}
+				voices_[i]->stopped_ = true;
+				stopVoice_(*voices_[i]);
+			}
+		}
+		voices_.push_back(voice);
+	}
+	// cancel() された音声を停止する
+	for(size_t i=0;i<voices_.size();++i){
+		if(voices_[i]->playback_->cancelled_.load()){
+			stopVoice_(*voices_[i]);
+		}
+	}
+}
+
+size_t Speaker::voiceOffset_(size_t index, size_t limit) const
+{
+	const Voice* voice = voices_[index];
+	size_t offset = 0;
+	if(voice->mode_ == PlayBackMode::normal_){
+		// 出力先チャネルが重なる、先行する normal_, overwrite_ の音声の再生終了（フェードアウトの開始）を待つ。
+		// 先行する音声がこの周期の途中で終了した場合は、その直後のフレームから再生する
+		for(size_t i=0;i<index;++i){
+			const Voice* prior = voices_[i];
+			if(prior->mode_ == PlayBackMode::overlay_ || !prior->routing_.overlaps(voice->routing_)){
+				continue;
+			}
+			if(prior->release_ >= limit){
+				return limit;
+			}
+			offset = std::max(offset, prior->release_);
+		}
+	}
+	return offset;
+}
+
+size_t Speaker::crossfadePoint_(size_t index) const
+{
+	const Voice* voice = voices_[index];
+	if(voice->mode_ == PlayBackMode::overlay_ || voice->fadingOut_ || voice->resampler_){
+		return SIZE_MAX; // 残りのフレーム数が定まらない変換中の音声とはクロスフェードしない
+	}
+	for(size_t i=index+1;i<voices_.size();++i){
+		const Voice* next = voices_[i];
+		if(next->mode_ == PlayBackMode::overlay_ || !next->routing_.overlaps(voice->routing_)){
+			continue;
+		}
+		if(next->mode_ != PlayBackMode::normal_ || next->crossfade_ == 0 || next->played_ > 0){
+			return SIZE_MAX;
+		}
+		// 後続の音声と重ねる末尾のフレーム数（先行する音声の半分までとする）
+		const size_t remaining = voice->length_ - voice->position_;
+		const size_t overlap = std::min(next->crossfade_, voice->length_ / 2);
+		return remaining > overlap ? remaining - overlap : 0;
+	}
+	return SIZE_MAX;
+}
+
+size_t Speaker::voiceSource_(Voice& voice, short* out, size_t frames, const short*& source)
+{
+	if(voice.synth_){
+		// 通知音は出力先へ直接合成する
+		source = out;
+		return voice.synth_->render(out, std::min(frames, voice.length_ - voice.position_));
+	}
+	if(!voice.resampler_){
+		const size_t remaining = voice.length_ - voice.position_;
+		source = voice.samples_ + voice.position_;
+		return frames < remaining ? frames : remaining;
+	}
+	// 変換済みの音声が frames に満たなければ、必要な分だけ変換する
+	Resampler& resampler = *voice.resampler_;
+	while(voice.convertedEnd_ - voice.convertedBegin_ < frames && !voice.flushed_){
+		if(voice.convertedBegin_ > 0){
+			std::copy(voice.converted_.begin() + voice.convertedBegin_, voice.converted_.begin() + voice.convertedEnd_, voice.converted_.begin());
+			voice.convertedEnd_ -= voice.convertedBegin_;
+			voice.convertedBegin_ = 0;
+		}
+		short* out = voice.converted_.data() + voice.convertedEnd_;
+		if(voice.position_ < voice.length_){
+			const size_t needed = (frames - voice.convertedEnd_) * resampler.inputRate() / resampler.outputRate() + 1;
+			const size_t c = std::min(std::min(needed, Resampler::k_block_), voice.length_ - voice.position_);
+			voice.convertedEnd_ += resampler.process(voice.samples_ + voice.position_, c, out);
+			voice.position_ += c;
+		}else{
+			voice.convertedEnd_ += resampler.flush(out);
+			voice.flushed_ = true;
+		}
+	}
+	source = voice.converted_.data() + voice.convertedBegin_;
+	return std::min(frames, voice.convertedEnd_ - voice.convertedBegin_);
+}
+
+size_t Speaker::renderVoice_(Voice& voice, short* out, size_t frames)
+{
+	const short* src = nullptr;
+	size_t n = voiceSource_(voice, out, frames, src);
+	if(voice.fadingOut_){
+		if(n > voice.fadeOut_){
+			n = voice.fadeOut_;
+		}
+		const float fade = static_cast<float>(voice.fadeLength_);
+		applyGainRamp(out, src, n, voice.gain_ * voice.fadeOut_ / fade, voice.gain_ * (voice.fadeOut_ - n) / fade);
+		voice.fadeOut_ -= n;
+	}else{
+		size_t done = 0;
+		if(voice.played_ < voice.fadeIn_){
+			// フェードイン
+			const float fade = static_cast<float>(voice.fadeIn_);
+			const size_t m = std::min(n, voice.fadeIn_ - voice.played_);
+			applyGainRamp(out, src, m, voice.gain_ * voice.played_ / fade, voice.gain_ * (voice.played_ + m) / fade);
+			done = m;
+		}
+		applyGainRamp(out + done, src + done, n - done, voice.gain_, voice.gain_);
+	}
+	voice.played_ += n;
+	if(voice.resampler_){
+		voice.convertedBegin_ += n;
+	}else{
+		voice.position_ += n;
+	}
+	if(voice.fadingOut_ && voice.fadeOut_ == 0){
+		voice.finish();
+	}
+	return n;
+}
+
+/**
+ * @brief モノラル音声にゲインを乗じて 1 つのチャネルに飽和加算する
+ */
+static void Speaker_mixRouted_(short* mix, const short* src, short* gained, size_t n, float gain)
+{
+	if(gain == 1.0F){
+		mixSaturate(mix, src, n);
+	}else if(gain != 0.0F){
+		applyGain(gained, src, n, gain);
+		mixSaturate(mix, gained, n);
+	}
+}
+
+size_t Speaker::mixPeriod_(short* left, short* right, short* work, short* gained)
+{
+	std::fill(left, left + mixFrames_, 0);
+	std::fill(right, right + mixFrames_, 0);
+	size_t frames = 0;
+	// write() による音声
+	const size_t streamed = ring_.pop(work, mixFrames_);
+	size_t limit = mixFrames_;
+	if(streamed > 0){
+		spaceCond_.notify_all();
+		Speaker_mixRouted_(left, work, gained, streamed, streamLeftGain_.load());
+		Speaker_mixRouted_(right, work, gained, streamed, streamRightGain_.load());
+		frames = streamed;
+		if(streamActive_.load() && !drainRequested_.load()){
+			limit = streamed; // 書き込み途中の音声に隙間を空けないよう、他の音声も同じフレーム数だけ進める
+		}
+	}
+	// batchPlay(), play(), enqueue() による音声
+	for(size_t i=0;i<voices_.size();++i){
+		voices_[i]->release_ = (voices_[i]->fadingOut_ || voices_[i]->finished()) ? 0 : SIZE_MAX;
+	}
+	for(size_t i=0;i<voices_.size();++i){
+		const size_t offset = voiceOffset_(i, limit);
+		if(offset >= limit){
+			continue;
+		}
+		Voice& voice = *voices_[i];
+		size_t n = 0;
+		const size_t fadeAt = crossfadePoint_(i);
+		if(fadeAt < limit - offset){
+			// 後続の音声と重なる位置から残りをフェードアウトし、後続の音声の再生を許す
+			n = renderVoice_(voice, work, fadeAt);
+			voice.fadingOut_ = true;
+			voice.fadeOut_ = voice.fadeLength_ = voice.length_ - voice.position_;
+			voice.release_ = offset + n;
+		}
+		n += renderVoice_(voice, work + n, limit - offset - n);
+		if(voice.finished() && offset + n < voice.release_){
+			voice.release_ = offset + n;
+		}
+		if(n > 0){
+			// この周期の先頭は、次に PCM デバイスへ書き込むフレームとなる
+			if(voice.playback_->startFrame_.load() < 0){
+				voice.playback_->startFrame_.store(static_cast<int64_t>(framesWritten_.load() + offset));
+			}
+			voice.playback_->written_ += n;
+		}
+		Speaker_mixRouted_(left + offset, work, gained, n, voice.routing_.left_);
+		Speaker_mixRouted_(right + offset, work, gained, n, voice.routing_.right_);
+		if(frames < offset + n){
+			frames = offset + n;
+		}
+	}
+	// 再生し終えたボイスを破棄する
+	size_t j = 0;
+	for(size_t i=0;i<voices_.size();++i){
+		if(voices_[i]->finished()){
+			retireVoice_(voices_[i]);
+		}else{
+			voices_[j++] = voices_[i];
+		}
+	}
+	voices_.resize(j);
+	if(streamActive_.load() && !drainRequested_.load() && streamed < frames){
+		// 他の音声の再生中に write() による書き込みが追いつかず、途切れた（PCM デバイスはアンダーランしていない）
+		starvations_++;
+	}
+	return frames;
+}
+
+void Speaker::playbackImpl_()
+{
+	AlignedBuffer<short> left(k_period_frames_);
+	AlignedBuffer<short> right(k_period_frames_);
+	AlignedBuffer<short> work(k_period_frames_);
+	AlignedBuffer<short> gained(k_period_frames_);
+	AlignedBuffer<short> stereo(k_period_frames_ * 2);
+	while(true){
+		acceptVoices_();
+		if(ring_.empty() && !voices_.empty() && streamActive_.load() && !drainRequested_.load()){
+			// write() による書き込みの途中で他の音声を再生している。PCM デバイスに再生待ちのデータが残っている間は書き込みを待つ
+			snd_pcm_sframes_t delay = 0;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if(snd_pcm_delay(pcm_handle_, &delay) < 0){
+					delay = 0;
+				}
+			}
+			if(delay > static_cast<snd_pcm_sframes_t>(mixFrames_)){
+				Speaker_waitFrames_(&dataSem_, delay - static_cast<snd_pcm_sframes_t>(mixFrames_), rate_.load());
+				continue;
+			}
+		}
+		if(!ring_.empty() || !voices_.empty()){
+			const size_t n = mixPeriod_(left.data(), right.data(), work.data(), gained.data());
+			if(n == 0){
+				continue; // 空の音声のボイスを破棄した
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				writeFrames_(left.data(), right.data(), n, stereo.data());
+				updatePosition_();
+			}
+			deviceActive_ = true;
+			completePlaybacks_(false);
+			continue;
+		}
+		// 再生する音声がない
+		// 出力の完了を待っている再生要求があれば PCM デバイスを drain せずに出力し終えるのを待ち、その間に次の音声が与えられれば途切れずに続けて再生する。
+		// 全て出力し終えた時点で PCM デバイスのバッファは空であり、出力を続けたままではアンダーランとなるため、再生要求を完了とする前に drain する
+		// （完了の通知を受けて与えられた音声は、drain し終えたデバイスに書き込まれる）
+		bool played = true;
+		if(!pending_.empty()){
+			const uint64_t frames = playedFrames_();
+			for(size_t i=0;i<pending_.size();++i){
+				if(frames < pending_[i]->endFrame_){
+					played = false;
+					break;
+				}
+			}
+		}
+		bool drained = false;
+		{
+			std::lock_guard<std::mutex> lock(drainMutex_);
+			if(drainRequested_.load() || (played && deviceActive_ && !streamActive_.load())){
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					snd_pcm_drain(pcm_handle_);
+					snd_pcm_prepare(pcm_handle_); // 次の書き込みに備える（待機中はアンダーランとならない）
+					updatePosition_();
+				}
+				deviceActive_ = false;
+				if(drainRequested_.load()){
+					streamActive_.store(false);
+				}
+				drainRequested_.store(false);
+				drained = true;
+			}
+		}
+		if(drained){
+			completePlaybacks_(true);
+			drainCond_.notify_all();
+		}
+		if(stopflag_.load() && ring_.empty() && voiceQueue_.empty()){
+			while(!pending_.empty()){
+				completePlaybacks_(true);
+				std::this_thread::yield();
+			}
+			break;
+		}
+		if(!pending_.empty()){
+			// 出力の完了を待っている再生要求があれば、完了する頃に起きる
+			completePlaybacks_(false);
+			if(!pending_.empty()){
+				uint64_t end = UINT64_MAX;
+				for(size_t i=0;i<pending_.size();++i){
+					end = std::min(end, pending_[i]->endFrame_);
+				}
+				const uint64_t played = playedFrames_();
+				Speaker_waitFrames_(&dataSem_, end > played ? static_cast<long long>(end - played) : 1, rate_.load());
+				continue;
+			}
+		}
+		sem_wait(&dataSem_);
+	}
+}
+
+void Speaker::writeLocked_(const short* audio, size_t n)
+{
+	streamActive_.store(true);
+	while(n > 0){
+		const size_t pushed = ring_.push(audio, n);
+		if(pushed > 0){
+			audio += pushed;
+			n -= pushed;
+			sem_post(&dataSem_);
+			continue;
+		}
+		// 満杯のため再生スレッドが読み出すのを待つ（通知を取りこぼしても 1 周期分の時間で再確認する）
+		std::unique_lock<std::mutex> lock(spaceMutex_);
+		spaceCond_.wait_for(lock, std::chrono::microseconds(mixFrames_ * 1000000 / rate_.load()),
+				[this]{ return ring_.size() < ring_.capacity(); });
+	}
+}
+
+void Speaker::drainLocked_()
+{
+	std::unique_lock<std::mutex> lock(drainMutex_);
+	drainRequested_.store(true);
+	sem_post(&dataSem_);
+	drainCond_.wait(lock, [this]{ return !drainRequested_.load(); });
+}
+
+void Speaker::flushWriterResampler_()
+{
+	if(writerResampler_){
+		const size_t n = writerResampler_->flush(writerBuffer_.data());
+		writeLocked_(writerBuffer_.data(), n);
+		writerResampler_.reset();
+	}
+}
+
+void Speaker::write(const short* audio, size_t n)
+{
+	std::lock_guard<std::mutex> lock(writerMutex_);
+	flushWriterResampler_();
+	writeLocked_(audio, n);
+}
+
+void Speaker::write(const short* audio, size_t n, int rate)
+{
+	std::lock_guard<std::mutex> lock(writerMutex_);
+	if(rate == rate_.load()){
+		flushWriterResampler_();
+		writeLocked_(audio, n);
+		return;
+	}
+	if(writerResampler_ && writerResampler_->inputRate() != rate){
+		flushWriterResampler_();
+	}
+	if(!writerResampler_){
+		writerResampler_.reset(new Resampler(rate, rate_.load()));
+		const size_t required = std::max(writerResampler_->maxOutput(Resampler::k_block_), writerResampler_->maxOutput(writerResampler_->taps()));
+		if(writerBuffer_.size() < required){
+			writerBuffer_.resize(required);
+		}
+	}
+	while(n > 0){
+		const size_t c = std::min(n, Resampler::k_block_);
+		const size_t m = writerResampler_->process(audio, c, writerBuffer_.data());
+		writeLocked_(writerBuffer_.data(), m);
+		audio += c;
+		n -= c;
+	}
+}
+
+void Speaker::setStreamRouting(const SpeakerRouting& routing)
+{
+	streamLeftGain_.store(routing.left_);
+	streamRightGain_.store(routing.right_);
+}
+
+void Speaker::drain()
+{
+	std::lock_guard<std::mutex> lock(writerMutex_);
+	flushWriterResampler_();
+	drainLocked_();
+}
+
+float Speaker::normalizationGain(const short* audio, size_t n)
+{
+	const short peak = peakAbsolute(audio, n);
+	return peak == 0 ? 0.0F : 32766.0F / static_cast<float>(peak);
+}
+
+Playback Speaker::enqueueVoice_(Voice* voice, int rate)
+{
+	if(!voice->playback_){
+		voice->playback_ = std::make_shared<Playback::State>(this, voice->length_, rate);
+	}
+	Playback playback(voice->playback_);
+	if(rate != rate_.load()){
+		// 変換は再生スレッドで周期毎に必要な分だけ行う
+		voice->resampler_.reset(new Resampler(rate, rate_.load()));
+		voice->converted_.resize(k_period_frames_ + voice->resampler_->maxOutput(std::max(Resampler::k_block_, static_cast<size_t>(voice->resampler_->taps()))));
+	}
+	activePlaybacks_++;
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	if(!voiceQueue_.push(voice)){
+		syslog(LOG_WARNING, "Speaker: voice queue is full, audio is discarded");
+		delete voice;
+		playback.state_->complete(Playback::Result::stopped_);
+		activePlaybacks_--;
+		return playback;
+	}
+	sem_post(&dataSem_);
+	return playback;
+}
+
+Playback Speaker::batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode)
+{
+	return batchPlay(audio, rate, volume, mode, true);
+}
+
+Playback Speaker::batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode, bool normalize)
+{
+	return batchPlay(audio, rate, volume, mode, normalize, SpeakerRouting());
+}
+
+Playback Speaker::batchPlay(const std::vector<short>& audio, int rate, float volume, Speaker::PlayBackMode mode, bool normalize, const SpeakerRouting& routing)
+{
+	// 呼び出し元の audio は呼び出し後に破棄され得るため複製する
+	std::shared_ptr<const std::vector<short>> copy = std::make_shared<const std::vector<short>>(audio);
+	Voice* voice = new Voice();
+	voice->samples_ = copy->data();
+	voice->length_ = copy->size();
+	voice->owner_ = copy;
+	voice->mode_ = mode;
+	voice->gain_ = normalize ? normalizationGain(audio.data(), audio.size()) * volume : volume;
+	voice->routing_ = routing;
+	return enqueueVoice_(voice, rate);
+}
+
+Playback Speaker::play(const SoundBank::Handle& sound, float volume, Speaker::PlayBackMode mode)
+{
+	return play(sound, volume, mode, SpeakerRouting());
+}
+
+Playback Speaker::play(const SoundBank::Handle& sound, float volume, Speaker::PlayBackMode mode, const SpeakerRouting& routing)
+{
+	if(!sound){
+		return Playback();
+	}
+	Voice* voice = new Voice();
+	voice->samples_ = sound->data();
+	voice->length_ = sound->size();
+	voice->owner_ = sound;
+	voice->mode_ = mode;
+	voice->gain_ = sound->normalizationGain() * volume;
+	voice->routing_ = routing;
+	return enqueueVoice_(voice, sound->rate());
+}
+
+Playback Speaker::play(const Earcon& earcon, float volume, Speaker::PlayBackMode mode)
+{
+	return play(earcon, volume, mode, SpeakerRouting());
+}
+
+Playback Speaker::play(const Earcon& earcon, float volume, Speaker::PlayBackMode mode, const SpeakerRouting& routing)
+{
+	std::unique_ptr<ToneSynth> synth(new ToneSynth(earcon, rate_.load())); // 範囲外の周波数を含む場合は例外が送出される
+	Voice* voice = new Voice();
+	voice->synth_ = std::move(synth);
+	voice->length_ = voice->synth_->length();
+	voice->fadeIn_ = 0; // 立ち上がりはエンベロープのアタックによる
+	voice->mode_ = mode;
+	voice->gain_ = volume;
+	voice->routing_ = routing;
+	return enqueueVoice_(voice, rate_.load());
+}
+
+Playback Speaker::enqueueConverted_(const short* audio, size_t n, int rate, std::shared_ptr<const void> owner, float gain, size_t crossfadeFrames, const SpeakerRouting& routing)
+{
+	Voice* voice = new Voice();
+	voice->playback_ = std::make_shared<Playback::State>(this, n, rate); // 再生位置は与えられた音声のサンプル位置で返す
+	const int deviceRate = rate_.load();
+	if(rate == deviceRate){
+		voice->samples_ = audio;
+		voice->length_ = n;
+		voice->owner_ = owner;
+	}else{
+		// 再生スレッドで周期毎に変換すると残りのフレーム数が定まらないため、先行する音声の再生中にこのスレッドで全体を変換しておく
+		Resampler resampler(rate, deviceRate);
+		std::shared_ptr<std::vector<short>> converted = std::make_shared<std::vector<short>>(resampler.maxOutput(n) + resampler.maxOutput(resampler.taps()));
+		size_t m = resampler.process(audio, n, converted->data());
+		m += resampler.flush(converted->data() + m);
+		converted->resize(m);
+		voice->samples_ = converted->data();
+		voice->length_ = m;
+		voice->owner_ = converted;
+	}
+	voice->mode_ = PlayBackMode::normal_;
+	voice->gain_ = gain;
+	voice->routing_ = routing;
+	voice->crossfade_ = crossfadeFrames;
+	voice->fadeIn_ = crossfadeFrames; // 続けて再生する場合はフェードインしない
+	return enqueueVoice_(voice, deviceRate);
+}
+
+Playback Speaker::enqueue(const std::vector<short>& audio, int rate, float gain, size_t crossfadeFrames)
+{
+	return enqueue(audio, rate, gain, crossfadeFrames, SpeakerRouting());
+}
+
+Playback Speaker::enqueue(const std::vector<short>& audio, int rate, float gain, size_t crossfadeFrames, const SpeakerRouting& routing)
+{
+	if(rate == rate_.load()){
+		// 呼び出し元の audio は呼び出し後に破棄され得るため複製する
+		std::shared_ptr<const std::vector<short>> copy = std::make_shared<const std::vector<short>>(audio);
+		return enqueueConverted_(copy->data(), copy->size(), rate, copy, gain, crossfadeFrames, routing);
+	}
+	return enqueueConverted_(audio.data(), audio.size(), rate, nullptr, gain, crossfadeFrames, routing);
+}
+
+Playback Speaker::enqueue(const SoundBank::Handle& sound, float gain, size_t crossfadeFrames)
+{
+	return enqueue(sound, gain, crossfadeFrames, SpeakerRouting());
+}
+
+Playback Speaker::enqueue(const SoundBank::Handle& sound, float gain, size_t crossfadeFrames, const SpeakerRouting& routing)
+{
+	if(!sound){
+		return Playback();
+	}
+	return enqueueConverted_(sound->data(), sound->size(), sound->rate(), sound, gain, crossfadeFrames, routing);
+}
+
+}
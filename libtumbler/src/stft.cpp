@@ -0,0 +1,187 @@
+/*
+ * @file stft.cpp
+ * \~english
+ * @brief Multichannel short-time Fourier transform shared between audio processing stages
+ * \~japanese
+ * @brief 音声処理の各段で共有する多チャネルの短時間フーリエ変換の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/stft.h"
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+void stftWindow(float* dst, StftWindow window, size_t size)
+{
+	for(size_t i=0;i<size;++i){
+		const double hann = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / size);
+		switch(window){
+		case StftWindow::hann_:
+			dst[i] = static_cast<float>(hann);
+			break;
+		case StftWindow::sqrtHann_:
+			dst[i] = static_cast<float>(std::sqrt(hann));
+			break;
+		default:
+			dst[i] = 1.0F;
+			break;
+		}
+	}
+}
+
+float stftWindowPower(StftWindow window)
+{
+	// 周期的な窓（長さ N で 1 周期）の二乗平均は N に依らない
+	switch(window){
+	case StftWindow::hann_:
+		return 0.375F;
+	case StftWindow::sqrtHann_:
+		return 0.5F;
+	default:
+		return 1.0F;
+	}
+}
+
+static size_t Stft_validate_(size_t size, size_t hop)
+{
+	if(size < 4 || (size & (size - 1)) != 0 || hop == 0 || hop > size){
+		std::stringstream ss;
+		ss << "Stft: size " << size << " must be a power of two >= 4 and hop " << hop << " must be in [1," << size << "]";
+		throw std::invalid_argument(ss.str());
+	}
+	return size;
+}
+
+/**
+ * @brief チャネル間の間隔 [要素]（各チャネルの先頭を整列境界に揃える）
+ */
+static size_t StftFrame_stride_(size_t size)
+{
+	const size_t align = AlignedBuffer<float>::k_alignment_ / sizeof(float);
+	return (size / 2 + 1 + align - 1) / align * align;
+}
+
+StftFrame::StftFrame(size_t channels, size_t size, size_t hop, StftWindow window) :
+		index_(0),
+		end_(0),
+		channels_(channels),
+		size_(size),
+		hop_(hop),
+		stride_(StftFrame_stride_(size)),
+		window_(window),
+		re_(channels * StftFrame_stride_(size)),
+		im_(channels * StftFrame_stride_(size))
+{
+}
+
+StftAnalyzer::StftAnalyzer(size_t channels, size_t size, size_t hop, StftWindow window) :
+		channels_(channels),
+		size_(Stft_validate_(size, hop)),
+		hop_(hop),
+		fft_(size),
+		window_(size),
+		history_(channels * size),
+		work_(size),
+		filled_(0),
+		samples_(0),
+		frame_(channels, size, hop, window)
+{
+	stftWindow(window_.data(), window, size);
+}
+
+void StftAnalyzer::reset()
+{
+	std::fill(history_.data(), history_.data() + history_.size(), 0.0F);
+	filled_ = 0;
+	samples_ = 0;
+	frame_.index_ = 0;
+	frame_.end_ = 0;
+}
+
+void StftAnalyzer::analyze_()
+{
+	for(size_t c=0;c<channels_;++c){
+		float* h = history_.data() + c * size_;
+		const float* w = window_.data();
+		float* x = work_.data();
+		for(size_t i=0;i<size_;++i){
+			x[i] = h[i] * w[i];
+		}
+		fft_.forward(x, frame_.re(c), frame_.im(c));
+		std::memmove(h, h + hop_, (size_ - hop_) * sizeof(float));
+	}
+	frame_.index_ = samples_ / hop_ - 1;
+	frame_.end_ = samples_;
+	filled_ = 0;
+}
+
+StftSynthesizer::StftSynthesizer(size_t size, size_t hop, StftWindow analysis, StftWindow synthesis) :
+		size_(Stft_validate_(size, hop)),
+		hop_(hop),
+		fft_(size),
+		window_(size),
+		overlap_(size),
+		work_(size)
+{
+	// 出力位置 n mod hop 毎に、重なる全フレームの分析窓と合成窓の積の和で正規化する
+	std::vector<float> a(size);
+	std::vector<float> s(size);
+	stftWindow(a.data(), analysis, size);
+	stftWindow(s.data(), synthesis, size);
+	std::vector<double> sum(hop, 0.0);
+	for(size_t i=0;i<size;++i){
+		sum[i % hop] += static_cast<double>(a[i]) * s[i];
+	}
+	for(size_t i=0;i<hop;++i){
+		if(sum[i] < 1e-6){
+			std::stringstream ss;
+			ss << "StftSynthesizer: the windows do not overlap at " << i << " with size " << size << " and hop " << hop;
+			throw std::invalid_argument(ss.str());
+		}
+	}
+	for(size_t i=0;i<size;++i){
+		window_[i] = static_cast<float>(s[i] / sum[i % hop]);
+	}
+}
+
+void StftSynthesizer::reset()
+{
+	std::fill(overlap_.data(), overlap_.data() + overlap_.size(), 0.0F);
+}
+
+void StftSynthesizer::synthesize(const float* re, const float* im, float* out)
+{
+	fft_.inverse(re, im, work_.data());
+	float* o = overlap_.data();
+	const float* w = window_.data();
+	const float* x = work_.data();
+	for(size_t i=0;i<size_;++i){
+		o[i] += x[i] * w[i];
+	}
+	std::memcpy(out, o, hop_ * sizeof(float));
+	std::memmove(o, o + hop_, (size_ - hop_) * sizeof(float));
+	std::fill(o + size_ - hop_, o + size_, 0.0F);
+}
+
+}
@@ -0,0 +1,233 @@
+/*
+ * @file tonesynth.cpp
+ * \~english
+ * @brief Allocation-free tone and earcon synthesizer
+ * \~japanese
+ * @brief 通知音（イヤコン）をヒープ確保なしで合成するトーン合成器の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/tonesynth.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+const size_t Earcon::k_max_tones_;
+const int ToneSynth::k_table_bits_;
+const size_t ToneSynth::k_table_size_;
+const size_t ToneSynth::k_block_;
+
+static const double k_phase_scale_ = 4294967296.0; // 位相 1 周期（2^32）
+
+/**
+ * @brief 正弦波の表（補間のため末尾に先頭の値を複製した k_table_size_ + 1 点）
+ */
+class ToneSynth_SineTable_
+{
+public:
+	ToneSynth_SineTable_()
+	{
+		for(size_t i=0;i<=ToneSynth::k_table_size_;++i){
+			values_[i] = static_cast<float>(std::sin(2.0 * M_PI * static_cast<double>(i) / ToneSynth::k_table_size_));
+		}
+	}
+	float values_[ToneSynth::k_table_size_ + 1];
+};
+
+static const float* ToneSynth_sineTable_()
+{
+	static const ToneSynth_SineTable_ table; // 初回の呼び出し時に一度だけ作成される
+	return table.values_;
+}
+
+/**
+ * @brief 矩形波の不連続点を補正する PolyBLEP 残差
+ * @param [in] t 不連続点からの位相 [0,1)
+ * @param [in] dt 1 フレームあたりの位相の増分
+ */
+static inline float ToneSynth_polyBlep_(float t, float dt)
+{
+	if(t < dt){
+		const float x = t / dt;
+		return x + x - x * x - 1.0F;
+	}else if(t > 1.0F - dt){
+		const float x = (t - 1.0F) / dt;
+		return x * x + x + x + 1.0F;
+	}
+	return 0.0F;
+}
+
+static size_t ToneSynth_frames_(float ms, int rate)
+{
+	return ms <= 0 ? 0 : static_cast<size_t>(ms * rate / 1000.0F + 0.5F);
+}
+
+Earcon& Earcon::add(const Tone& tone, float startMs)
+{
+	if(size_ >= k_max_tones_){
+		std::stringstream ss;
+		ss << "Earcon::add(): an earcon can hold at most " << k_max_tones_ << " tones";
+		throw std::runtime_error(ss.str());
+	}
+	tones_[size_] = tone;
+	starts_[size_] = startMs < 0 ? 0 : startMs;
+	size_++;
+	return *this;
+}
+
+Earcon& Earcon::append(const Tone& tone, float gapMs)
+{
+	return add(tone, durationMs() + gapMs);
+}
+
+float Earcon::durationMs() const
+{
+	float end = 0;
+	for(size_t i=0;i<size_;++i){
+		end = std::max(end, starts_[i] + tones_[i].durationMs_);
+	}
+	return end;
+}
+
+ToneSynth::ToneSynth() : count_(0), length_(0), position_(0)
+{
+}
+
+ToneSynth::ToneSynth(const Earcon& earcon, int rate) : count_(0), length_(0), position_(0)
+{
+	ToneSynth_sineTable_();
+	for(size_t i=0;i<earcon.size();++i){
+		const Tone& tone = earcon.tone(i);
+		if(!(0 < tone.frequency_ && tone.frequency_ < rate / 2) || !(0 < tone.endFrequency_ && tone.endFrequency_ < rate / 2)){
+			std::stringstream ss;
+			ss << "ToneSynth: frequency " << tone.frequency_ << " -> " << tone.endFrequency_ << " Hz is out of range at " << rate << " Hz";
+			throw std::invalid_argument(ss.str());
+		}
+		Oscillator& osc = oscillators_[count_++];
+		osc.waveform_ = tone.waveform_;
+		osc.begin_ = ToneSynth_frames_(earcon.startMs(i), rate);
+		osc.length_ = ToneSynth_frames_(tone.durationMs_, rate);
+		osc.amplitude_ = tone.amplitude_;
+		osc.increment0_ = static_cast<double>(tone.frequency_) / rate * k_phase_scale_;
+		if(tone.endFrequency_ != tone.frequency_ && osc.length_ > 1){
+			osc.ratio_ = std::pow(static_cast<double>(tone.endFrequency_) / tone.frequency_, 1.0 / (osc.length_ - 1));
+		}
+		// エンベロープの各区間（トーンの長さに収める）
+		const ToneEnvelope& env = tone.envelope_;
+		osc.release_ = std::min(ToneSynth_frames_(env.releaseMs_, rate), osc.length_);
+		osc.attack_ = std::min(ToneSynth_frames_(env.attackMs_, rate), osc.length_);
+		osc.decay_ = ToneSynth_frames_(env.decayMs_, rate);
+		osc.sustain_ = std::min(std::max(env.sustain_, 0.0F), 1.0F);
+		const size_t releaseBegin = osc.length_ - osc.release_;
+		if(releaseBegin < osc.attack_){
+			osc.releaseLevel_ = osc.attack_ == 0 ? 1.0F : static_cast<float>(releaseBegin) / osc.attack_;
+		}else if(releaseBegin < osc.attack_ + osc.decay_){
+			osc.releaseLevel_ = 1.0F - (1.0F - osc.sustain_) * (releaseBegin - osc.attack_) / osc.decay_;
+		}else{
+			osc.releaseLevel_ = osc.sustain_;
+		}
+		length_ = std::max(length_, osc.begin_ + osc.length_);
+	}
+	reset();
+}
+
+void ToneSynth::reset()
+{
+	position_ = 0;
+	for(size_t i=0;i<count_;++i){
+		oscillators_[i].phase_ = 0;
+		oscillators_[i].increment_ = oscillators_[i].increment0_;
+		oscillators_[i].done_ = 0;
+	}
+}
+
+void ToneSynth::renderOscillator_(Oscillator& osc, float* acc, size_t frames)
+{
+	const float* table = ToneSynth_sineTable_();
+	const size_t releaseBegin = osc.length_ - osc.release_;
+	const float attackStep = osc.attack_ == 0 ? 0.0F : 1.0F / osc.attack_;
+	const float decayStep = osc.decay_ == 0 ? 0.0F : (1.0F - osc.sustain_) / osc.decay_;
+	const float releaseStep = osc.release_ == 0 ? 0.0F : osc.releaseLevel_ / osc.release_;
+	for(size_t i=0;i<frames;++i){
+		const size_t k = osc.done_ + i;
+		// エンベロープ（区間毎の線形関数をフレーム位置から直接求めるため、分割の仕方によらない）
+		float env;
+		if(k >= releaseBegin){
+			env = releaseStep * (osc.length_ - k);
+		}else if(k < osc.attack_){
+			env = attackStep * k;
+		}else if(k < osc.attack_ + osc.decay_){
+			env = 1.0F - decayStep * (k - osc.attack_);
+		}else{
+			env = osc.sustain_;
+		}
+		float v;
+		if(osc.waveform_ == ToneWaveform::sine_){
+			const uint32_t index = osc.phase_ >> (32 - k_table_bits_);
+			const float frac = static_cast<float>(osc.phase_ & ((1U << (32 - k_table_bits_)) - 1)) * (1.0F / (1U << (32 - k_table_bits_)));
+			v = table[index] + (table[index + 1] - table[index]) * frac;
+		}else{
+			const float t = static_cast<float>(osc.phase_) * (1.0F / 4294967296.0F);
+			const float d = static_cast<float>(osc.increment_ / k_phase_scale_);
+			float h = t + 0.5F;
+			if(h >= 1.0F){
+				h -= 1.0F;
+			}
+			v = (t < 0.5F ? 1.0F : -1.0F) + ToneSynth_polyBlep_(t, d) - ToneSynth_polyBlep_(h, d);
+		}
+		acc[i] += v * env * osc.amplitude_;
+		osc.phase_ += static_cast<uint32_t>(osc.increment_);
+		osc.increment_ *= osc.ratio_;
+	}
+	osc.done_ += frames;
+}
+
+size_t ToneSynth::render(short* out, size_t frames)
+{
+	const size_t total = std::min(frames, length_ - position_);
+	float acc[k_block_];
+	size_t done = 0;
+	while(done < total){
+		const size_t n = std::min(k_block_, total - done);
+		const size_t begin = position_;
+		const size_t end = position_ + n;
+		std::fill(acc, acc + n, 0.0F);
+		for(size_t i=0;i<count_;++i){
+			Oscillator& osc = oscillators_[i];
+			const size_t b = std::max(begin, osc.begin_);
+			const size_t e = std::min(end, osc.begin_ + osc.length_);
+			if(b < e){
+				renderOscillator_(osc, acc + (b - begin), e - b);
+			}
+		}
+		for(size_t i=0;i<n;++i){
+			const float s = acc[i] * 32767.0F;
+			out[done + i] = static_cast<short>(s > 32767.0F ? 32767.0F : (s < -32768.0F ? -32768.0F : s));
+		}
+		position_ = end;
+		done += n;
+	}
+	return total;
+}
+
+}
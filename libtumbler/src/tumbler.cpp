@@ -55,10 +55,19 @@ void ArduinoSubsystem::hardReset()
 ArduinoSubsystem::ArduinoSubsystem()
 {
 	openlog("libtumbler", LOG_PID, LOG_USER);
-	c_status_ledringChange_.store(false);
 	connectionOpen();
 }
 
+void ArduinoSubsystem::updateLEDRingBrightness(const LEDRingBrightness& brightness)
+{
+	if(brightness.sameState(c_status_ledringBrightness_)){
+		return; // 変化なし
+	}
+	const uint32_t sequence = c_status_ledringBrightness_.sequence_ + 1;
+	c_status_ledringBrightness_ = brightness;
+	c_status_ledringBrightness_.sequence_ = sequence;
+}
+
 int ArduinoSubsystem::read(char* buf, int length)
 {
 	return ::read(serial_, buf, length);
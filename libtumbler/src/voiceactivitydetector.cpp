@@ -0,0 +1,214 @@
+/*
+ * @file voiceactivitydetector.cpp
+ * \~english
+ * @brief Energy / zero-crossing / band-energy voice activity detector
+ * \~japanese
+ * @brief エネルギー、ゼロ交差数、帯域エネルギーによる音声区間検出器の実装
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tumbler/voiceactivitydetector.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace tumbler{
+
+static const double k_VoiceActivityDetector_low_ = 300.0;   //!< 音声帯域の下端 [Hz]
+static const double k_VoiceActivityDetector_high_ = 3400.0; //!< 音声帯域の上端 [Hz]
+
+static const VoiceActivityDetectorConfig& VoiceActivityDetector_validate_(size_t channels, const VoiceActivityDetectorConfig& config)
+{
+	std::stringstream ss;
+	if(channels < 1){
+		ss << "VoiceActivityDetector: no channels";
+	}else if(config.rate_ < 8000 || config.rate_ > 48000){
+		ss << "VoiceActivityDetector: rate " << config.rate_ << " is not supported (8000-48000)";
+	}else if(config.frameMs_ * config.rate_ / 1000 < 16){
+		ss << "VoiceActivityDetector: frame " << config.frameMs_ << " ms is too short";
+	}else if(config.onsetFrames_ < 1){
+		ss << "VoiceActivityDetector: onsetFrames_ must be >= 1";
+	}else{
+		return config;
+	}
+	throw std::invalid_argument(ss.str());
+}
+
+/**
+ * @brief RBJ Audio EQ Cookbook による 2 次の高域通過・低域通過フィルタ（Q = 1/√2）の係数を設定する
+ */
+template<typename Biquad>
+static void VoiceActivityDetector_design_(Biquad& f, double frequency, int rate, bool highpass)
+{
+	const double w0 = 2.0 * M_PI * frequency / rate;
+	const double alpha = std::sin(w0) / std::sqrt(2.0);
+	const double c = std::cos(w0);
+	const double a0 = 1.0 + alpha;
+	const double b = highpass ? (1.0 + c) / 2.0 : (1.0 - c) / 2.0;
+	f.b0_ = static_cast<float>(b / a0);
+	f.b1_ = static_cast<float>((highpass ? -2.0 * b : 2.0 * b) / a0);
+	f.b2_ = static_cast<float>(b / a0);
+	f.a1_ = static_cast<float>(-2.0 * c / a0);
+	f.a2_ = static_cast<float>((1.0 - alpha) / a0);
+}
+
+VoiceActivityDetector::VoiceActivityDetector(size_t channels, const VoiceActivityDetectorConfig& config) :
+		config_(VoiceActivityDetector_validate_(channels, config)),
+		channels_(channels),
+		frameSize_(static_cast<size_t>(config.frameMs_ * config.rate_ / 1000)),
+		state_(channels * 4),
+		previous_(channels),
+		filled_(0),
+		highEnergy_(0),
+		bandEnergy_(0),
+		crossings_(0),
+		level_(-100.0F),
+		noise_(-100.0F),
+		riseStep_(config.noiseRise_ * config.frameMs_ / 1000.0F),
+		initialized_(false),
+		run_(0),
+		silence_(0),
+		active_(false),
+		onset_(0),
+		position_(0)
+{
+	VoiceActivityDetector_design_(highpass_, k_VoiceActivityDetector_low_, config_.rate_, true);
+	VoiceActivityDetector_design_(lowpass_, std::min(k_VoiceActivityDetector_high_, config_.rate_ * 0.45), config_.rate_, false);
+}
+
+void VoiceActivityDetector::reset()
+{
+	std::fill(state_.begin(), state_.end(), 0.0F);
+	std::fill(previous_.begin(), previous_.end(), 0.0F);
+	filled_ = 0;
+	highEnergy_ = 0;
+	bandEnergy_ = 0;
+	crossings_ = 0;
+	level_ = -100.0F;
+	noise_ = -100.0F;
+	initialized_ = false;
+	run_ = 0;
+	silence_ = 0;
+	active_ = false;
+	onset_ = 0;
+	position_ = 0;
+}
+
+bool VoiceActivityDetector::process(const short* const* in, size_t frames)
+{
+	return process_(in, frames);
+}
+
+bool VoiceActivityDetector::process(const float* const* in, size_t frames)
+{
+	return process_(in, frames);
+}
+
+template<typename Sample>
+bool VoiceActivityDetector::process_(const Sample* const* in, size_t frames)
+{
+	const Biquad h = highpass_;
+	const Biquad l = lowpass_;
+	size_t done = 0;
+	while(done < frames){
+		const size_t n = std::min(frames - done, frameSize_ - filled_);
+		for(size_t c=0;c<channels_;++c){
+			const Sample* src = in[c] + done;
+			float* s = &state_[c * 4];
+			float h1 = s[0], h2 = s[1], l1 = s[2], l2 = s[3];
+			float prev = previous_[c];
+			float high = 0;
+			float band = 0;
+			size_t crossings = 0;
+			for(size_t i=0;i<n;++i){
+				// 300Hz の高域通過、続けて 3400Hz の低域通過（直接形 II 転置型）
+				const float x = static_cast<float>(src[i]);
+				const float y = h.b0_ * x + h1;
+				h1 = h.b1_ * x - h.a1_ * y + h2;
+				h2 = h.b2_ * x - h.a2_ * y;
+				const float z = l.b0_ * y + l1;
+				l1 = l.b1_ * y - l.a1_ * z + l2;
+				l2 = l.b2_ * y - l.a2_ * z;
+				high += y * y;
+				band += z * z;
+				crossings += (y < 0) != (prev < 0);
+				prev = y;
+			}
+			s[0] = h1;
+			s[1] = h2;
+			s[2] = l1;
+			s[3] = l2;
+			previous_[c] = prev;
+			highEnergy_ += high;
+			bandEnergy_ += band;
+			crossings_ += crossings;
+		}
+		done += n;
+		filled_ += n;
+		position_ += n;
+		if(filled_ == frameSize_){
+			decide_();
+			filled_ = 0;
+			highEnergy_ = 0;
+			bandEnergy_ = 0;
+			crossings_ = 0;
+		}
+	}
+	return active_;
+}
+
+void VoiceActivityDetector::decide_()
+{
+	const double samples = static_cast<double>(channels_ * frameSize_);
+	level_ = static_cast<float>(10.0 * std::log10(bandEnergy_ / samples / (32768.0 * 32768.0) + 1e-10));
+	const double ratio = highEnergy_ > 0 ? bandEnergy_ / highEnergy_ : 0.0;
+	const double zeroCrossing = crossings_ / samples;
+	if(!initialized_){
+		noise_ = level_;
+		initialized_ = true;
+	}
+	const bool speech = level_ >= noise_ + config_.threshold_ && level_ >= config_.minLevel_
+			&& ratio >= config_.minBandRatio_ && zeroCrossing <= config_.maxZeroCrossing_;
+
+	// 雑音レベルは帯域エネルギーの最小値に追従し、定常的な雑音の増加にはゆっくり追従する
+	if(level_ < noise_){
+		noise_ = level_;
+	}else{
+		noise_ = std::min(level_, noise_ + (speech ? riseStep_ / 10.0F : riseStep_));
+	}
+
+	if(speech){
+		run_++;
+		silence_ = 0;
+		if(!active_ && run_ >= config_.onsetFrames_){
+			active_ = true;
+			onset_ = position_ - run_ * frameSize_;
+		}
+	}else{
+		run_ = 0;
+		if(active_ && ++silence_ >= config_.hangoverFrames_){
+			active_ = false;
+			silence_ = 0;
+		}
+	}
+}
+
+}
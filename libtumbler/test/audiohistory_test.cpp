@@ -0,0 +1,234 @@
+/*
+ * @file audiohistory_test.cpp
+ * \~english
+ * @brief Tests of the time-indexed pre-roll capture ring
+ * \~japanese
+ * @brief 録音時刻とともに直近の音声を保持するリングバッファの試験
+ * @details 指定した時刻から履歴とそれに続く音声が途切れなく読み出せること、上書きされた分の読み飛ばし、不連続なブロックの時刻の対応、
+ * 間引いて保持する場合の時刻の対応、書き込みと並行した読み出しを確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiohistory.h"
+
+using namespace tumbler;
+
+static const int C = Microphone::k_channels_;
+static const uint64_t k_base = 1000000000ULL; // 録音開始時刻 [microsecond]
+
+/**
+ * @brief 通し番号 frame のフレームのチャネル c のサンプル値
+ */
+short pattern(uint64_t frame, int c)
+{
+	return static_cast<short>((frame * 7 + c * 1000) % 30000);
+}
+
+/**
+ * @brief 通し番号 begin から n フレームを、録音時刻 timestamp のブロックとして書き込む
+ */
+void write(AudioHistory& history, uint64_t begin, size_t n, uint64_t timestamp, bool discontinuous)
+{
+	std::vector<short> data(n * C);
+	for(size_t i=0;i<n;++i){
+		for(int c=0;c<C;++c){
+			data[i * C + c] = pattern(begin + i, c);
+		}
+	}
+	MicrophoneBlock block;
+	block.frame_ = begin;
+	block.frames_ = n;
+	block.timestamp_ = timestamp;
+	block.discontinuous_ = discontinuous;
+	history.write(data.data(), n, block);
+}
+
+uint64_t at(uint64_t frame)
+{
+	return k_base + frame * 1000000ULL / 48000;
+}
+
+/**
+ * @brief 読み出した 1ch 目と 18ch 目が、通し番号 first からのフレームと一致するかを返す
+ */
+bool matches(const std::vector<short>& out, size_t n, uint64_t first)
+{
+	for(size_t i=0;i<n;++i){
+		if(out[i * 2] != pattern(first + i, 0) || out[i * 2 + 1] != pattern(first + i, Microphone::k_line_channel_)){
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	AudioHistoryConfig config;
+	config.mask_ = (1U << 0) | Microphone::k_line_mask_;
+	config.seconds_ = 1.0F;
+
+	// 指定した時刻から、履歴とそれに続けて書き込まれる音声を途切れなく読み出す
+	{
+		AudioHistory history(config);
+		uint64_t frame = 0;
+		for(;frame<3*48000;frame+=480){
+			write(history, frame, 480, at(frame), false);
+		}
+		AudioHistoryReader reader = history.open(at(frame) - 500000); // 0.5 秒前
+		const uint64_t start = reader.position();
+		std::vector<short> out(48000 * 2);
+		bool ok = start == frame - 24000 && reader.timestamp() == at(start);
+		uint64_t expected = start;
+		for(int i=0;i<20;++i){
+			write(history, frame, 480, at(frame), false);
+			frame += 480;
+			const size_t n = reader.read(out.data(), 700, 0);
+			ok = ok && matches(out, n, expected);
+			expected += n;
+		}
+		while(size_t n = reader.read(out.data(), 700, 0)){
+			ok = ok && matches(out, n, expected);
+			expected += n;
+		}
+		std::cout << "pre-roll: opened at frame " << start << " (0.5 s before frame " << frame - 20 * 480 << "), read up to " << expected << std::endl;
+		if(!ok || expected != frame || reader.lost() != 0){
+			std::cout << "failed: pre-roll" << std::endl;
+			failed++;
+		}
+
+		// 保持している範囲より前の時刻は最も古いフレームから読み出す。読み出す前に上書きされた分は読み飛ばす
+		AudioHistoryReader old = history.open(k_base);
+		const bool clamped = old.position() == frame - 48000 && old.timestamp() == history.oldest();
+		for(int i=0;i<50;++i){
+			write(history, frame, 480, at(frame), false);
+			frame += 480;
+		}
+		const size_t n = old.read(out.data(), 100, 0);
+		std::cout << "overwritten: opened at " << frame - 24000 - 48000 << ", " << old.lost() << " frames lost" << std::endl;
+		if(!clamped || old.lost() != 24000 || n != 100 || !matches(out, n, frame - 48000)){
+			std::cout << "failed: overwritten" << std::endl;
+			failed++;
+		}
+	}
+
+	// 不連続なブロック：欠損した間の時刻は、欠損の後の最初のフレームに対応する
+	{
+		AudioHistory history(config);
+		write(history, 0, 9600, at(0), false);
+		write(history, 19200, 9600, at(19200), true); // 9600 フレーム（200ms）欠損
+		const AudioHistoryReader inGap = history.open(at(14400));
+		const AudioHistoryReader after = history.open(at(24000));
+		std::vector<short> out(2);
+		AudioHistoryReader r = after;
+		r.read(out.data(), 1, 0);
+		std::cout << "gap: time in the gap maps to position " << inGap.position() << ", 100 ms after maps to " << after.position() << std::endl;
+		if(inGap.position() != 9600 || after.position() != 14400 || !matches(out, 1, 24000) || after.timestamp() != at(24000)){
+			std::cout << "failed: gap" << std::endl;
+			failed++;
+		}
+	}
+
+	// 16kHz に間引いて保持する：インパルスは録音時刻どおりの位置に現れる
+	{
+		AudioHistoryConfig low;
+		low.mask_ = 1U << 3;
+		low.seconds_ = 2.0F;
+		low.factor_ = 3;
+		AudioHistory history(low);
+		const uint64_t impulse = 30011;
+		std::vector<short> data(480 * C, 0);
+		for(uint64_t frame=0;frame<48000;frame+=480){
+			std::fill(data.begin(), data.end(), 0);
+			if(impulse >= frame && impulse < frame + 480){
+				data[(impulse - frame) * C + 3] = 30000;
+			}
+			MicrophoneBlock block;
+			block.frame_ = frame;
+			block.frames_ = 480;
+			block.timestamp_ = at(frame);
+			history.write(data.data(), 480, block);
+		}
+		AudioHistoryReader reader = history.open(at(impulse) - 100000);
+		std::vector<short> out(3200);
+		const size_t n = reader.read(out.data(), out.size(), 0);
+		const size_t peak = static_cast<size_t>(std::max_element(out.begin(), out.begin() + n) - out.begin());
+		std::cout << "16kHz: " << history.written() << " samples kept, impulse 100 ms after the opened time appears at sample " << peak << " (expected 1600)" << std::endl;
+		if(history.rate() != 16000 || history.written() != 16000 || std::abs(static_cast<int>(peak) - 1600) > 1){
+			std::cout << "failed: 16kHz" << std::endl;
+			failed++;
+		}
+	}
+
+	// 書き込みと並行して別のスレッドで開き、読み出す
+	{
+		AudioHistory history(config);
+		const uint64_t total = 10 * 48000;
+		std::thread writer([&]{
+			for(uint64_t frame=0;frame<total;frame+=480){
+				write(history, frame, 480, at(frame), false);
+				std::this_thread::sleep_for(std::chrono::microseconds(500)); // 実時間の 20 倍の速さで書き込む
+			}
+		});
+		while(history.written() < 48000){
+			std::this_thread::yield();
+		}
+		AudioHistoryReader reader = history.open(at(history.written()) - 200000);
+		uint64_t expected = reader.position();
+		std::vector<short> out(1000 * 2);
+		bool ok = true;
+		while(expected < total){
+			const size_t n = reader.read(out.data(), 1000, 100);
+			if(n == 0){
+				break;
+			}
+			ok = ok && matches(out, n, expected);
+			expected += n;
+		}
+		writer.join();
+		std::cout << "concurrent: read up to " << expected << ", " << reader.lost() << " frames lost" << std::endl;
+		if(!ok || expected != total || reader.lost() != 0){
+			std::cout << "failed: concurrent" << std::endl;
+			failed++;
+		}
+	}
+
+	// 設定の誤り
+	try{
+		AudioHistoryConfig bad;
+		bad.factor_ = 4;
+		AudioHistory history(bad);
+		std::cout << "failed: factor 4 is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	if(failed == 0){
+		std::cout << "all audio history tests passed" << std::endl;
+	}
+	return failed == 0 ? 0 : 1;
+}
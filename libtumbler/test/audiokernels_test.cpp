@@ -0,0 +1,266 @@
+/*
+ * @file audiokernels_test.cpp
+ * \~english
+ * @brief Tests of the audio sample processing kernels against scalar references
+ * \~japanese
+ * @brief 音声サンプル処理カーネルの試験
+ * @details SIMD カーネルの結果を単純なスカラー実装の結果と比較する。端数の長さ、飽和する入力を含む。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "tumbler/tumbler.h"
+#include "tumbler/audiokernels.h"
+
+using namespace tumbler;
+
+std::vector<short> randomAudio(size_t n, std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> dist(-32768, 32767);
+	std::vector<short> audio(n);
+	for(size_t i=0;i<n;++i){
+		audio[i] = static_cast<short>(dist(rng));
+	}
+	return audio;
+}
+
+bool testMixSaturate(std::mt19937& rng)
+{
+	for(size_t n=0;n<40;++n){
+		std::vector<short> dst = randomAudio(n, rng);
+		const std::vector<short> src = randomAudio(n, rng);
+		std::vector<short> expected(n);
+		for(size_t i=0;i<n;++i){
+			const int v = static_cast<int>(dst[i]) + static_cast<int>(src[i]);
+			expected[i] = static_cast<short>(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+		}
+		mixSaturate(dst.data(), src.data(), n);
+		if(dst != expected){
+			std::cout << "mixSaturate mismatch at n=" << n << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool testApplyGainRamp(std::mt19937& rng)
+{
+	const size_t n = 37;
+	const std::vector<short> src = randomAudio(n, rng);
+	std::vector<short> dst(n);
+	// 一定ゲイン 2 倍（飽和する）
+	applyGainRamp(dst.data(), src.data(), n, 2.0F, 2.0F);
+	for(size_t i=0;i<n;++i){
+		const int v = 2 * static_cast<int>(src[i]);
+		const int e = v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+		if(dst[i] != e){
+			std::cout << "applyGainRamp (constant) mismatch at " << i << std::endl;
+			return false;
+		}
+	}
+	// 0 から 1 へのフェードイン
+	applyGainRamp(dst.data(), src.data(), n, 0.0F, 1.0F);
+	for(size_t i=0;i<n;++i){
+		const float e = static_cast<float>(src[i]) * static_cast<float>(i) / n;
+		if(std::abs(dst[i] - e) > 1.0F){
+			std::cout << "applyGainRamp (ramp) mismatch at " << i << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool testPeakAbsolute(std::mt19937& rng)
+{
+	for(size_t n=0;n<40;++n){
+		std::vector<short> src = randomAudio(n, rng);
+		for(size_t i=0;i<n;++i){
+			src[i] /= 4;
+		}
+		if(n > 3){
+			src[n - 2] = -32768; // 末尾の端数部分、ベクトル部分の両方で最小値を扱えること
+			src[1] = -32768;
+		}
+		short expected = 0;
+		for(size_t i=0;i<n;++i){
+			const int a = std::min(32767, std::abs(static_cast<int>(src[i])));
+			expected = std::max<short>(expected, static_cast<short>(a));
+		}
+		if(peakAbsolute(src.data(), n) != expected){
+			std::cout << "peakAbsolute mismatch at n=" << n << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool testApplyGain(std::mt19937& rng)
+{
+	const float gains[] = {0.0F, 0.05F, 0.5F, 1.0F, 1.5F, 3.7F, 100000.0F}; // 0.5, 1.5 は奇数のサンプルで端数 0.5 となる
+	for(size_t g=0;g<sizeof(gains)/sizeof(gains[0]);++g){
+		for(size_t n=0;n<40;++n){
+			const std::vector<short> src = randomAudio(n, rng);
+			std::vector<short> dst(n);
+			applyGain(dst.data(), src.data(), n, gains[g]);
+			for(size_t i=0;i<n;++i){
+				const float v = static_cast<float>(src[i]) * gains[g];
+				const long e = v > 32767.0F ? 32767 : (v < -32768.0F ? -32768 : lrintf(v)); // 最近接偶数丸め
+				if(dst[i] != e){
+					std::cout << "applyGain mismatch at gain=" << gains[g] << " n=" << n << " i=" << i << std::endl;
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool testInterleaveStereo(std::mt19937& rng)
+{
+	for(size_t n=0;n<40;++n){
+		const std::vector<short> left = randomAudio(n, rng);
+		const std::vector<short> right = randomAudio(n, rng);
+		AlignedBuffer<short> stereo(2 * n);
+		AlignedBuffer<short> mono(2 * n);
+		if(reinterpret_cast<size_t>(stereo.data()) % AlignedBuffer<short>::k_alignment_ != 0){
+			std::cout << "AlignedBuffer is not aligned" << std::endl;
+			return false;
+		}
+		interleaveStereo(stereo.data(), left.data(), right.data(), n);
+		interleaveStereo(mono.data(), left.data(), nullptr, n);
+		for(size_t i=0;i<n;++i){
+			if(stereo[2*i] != left[i] || stereo[2*i+1] != right[i] || mono[2*i] != left[i] || mono[2*i+1] != 0){
+				std::cout << "interleaveStereo mismatch at n=" << n << " i=" << i << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool testDeinterleave(std::mt19937& rng)
+{
+	// チャネル数、マスク（全チャネル、マイクのみ、末尾のチャネルのみ、飛び飛び、乱数）、端数を含むフレーム数の組合せ
+	std::uniform_int_distribution<uint32_t> bits;
+	for(size_t channels=1;channels<=20;++channels){
+		const uint32_t all = (channels == 32 ? 0xFFFFFFFFU : (1U << channels) - 1);
+		const uint32_t masks[] = {all, 0xFFFFU & all, 1U << (channels - 1), 0x15555U & all, bits(rng) & all, 0};
+		for(size_t m=0;m<sizeof(masks)/sizeof(masks[0]);++m){
+			for(size_t frames=0;frames<35;frames+=(frames < 17 ? 1 : 8)){
+				const std::vector<short> src = randomAudio(frames * channels, rng);
+				std::vector<std::vector<short> > planar(channels, std::vector<short>(frames + 1, 12345));
+				std::vector<std::vector<float> > planarFloat(channels, std::vector<float>(frames + 1, 12345.0F));
+				std::vector<short*> dst;
+				std::vector<float*> dstFloat;
+				for(size_t c=0;c<channels;++c){
+					dst.push_back(planar[c].data());
+					dstFloat.push_back(planarFloat[c].data());
+				}
+				deinterleave(dst.data(), src.data(), frames, channels, masks[m]);
+				deinterleave(dstFloat.data(), src.data(), frames, channels, masks[m], 1.0F / 32768);
+				size_t k = 0;
+				for(size_t c=0;c<channels;++c){
+					if(!(masks[m] & (1U << c))){
+						continue;
+					}
+					for(size_t i=0;i<frames;++i){
+						const short e = src[i * channels + c];
+						if(planar[k][i] != e || planarFloat[k][i] != e / 32768.0F){
+							std::cout << "deinterleave mismatch at channels=" << channels << " mask=" << masks[m] << " frames=" << frames << " c=" << c << " i=" << i << std::endl;
+							return false;
+						}
+					}
+					if(planar[k][frames] != 12345 || planarFloat[k][frames] != 12345.0F){
+						std::cout << "deinterleave writes past the end at channels=" << channels << " mask=" << masks[m] << std::endl;
+						return false;
+					}
+					k++;
+				}
+				for(;k<channels;++k){ // 取り出すチャネル数より後の出力先には書き込まない
+					if(planar[k][0] != 12345){
+						std::cout << "deinterleave writes to an unused output at channels=" << channels << " mask=" << masks[m] << std::endl;
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool testAccumulateFir(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+	for(size_t taps=1;taps<=17;taps+=4){
+		for(size_t n=0;n<23;++n){
+			std::vector<float> x(taps + n);
+			std::vector<float> h(taps);
+			std::vector<float> acc(n);
+			for(size_t i=0;i<x.size();++i){
+				x[i] = dist(rng);
+			}
+			for(size_t k=0;k<taps;++k){
+				h[k] = dist(rng);
+			}
+			for(size_t i=0;i<n;++i){
+				acc[i] = dist(rng);
+			}
+			std::vector<float> expected(acc);
+			const float* input = x.data() + taps - 1; // input[-(taps - 1)] から参照できる
+			for(size_t i=0;i<n;++i){
+				for(size_t k=0;k<taps;++k){
+					expected[i] += h[k] * input[static_cast<int>(i) - static_cast<int>(k)];
+				}
+			}
+			accumulateFir(acc.data(), input, n, h.data(), taps);
+			for(size_t i=0;i<n;++i){
+				if(std::abs(acc[i] - expected[i]) > 1e-5F){
+					std::cout << "accumulateFir mismatch at taps=" << taps << " n=" << n << " i=" << i << std::endl;
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::mt19937 rng(1);
+	int failed = 0;
+	if(!testMixSaturate(rng)) failed++;
+	if(!testApplyGainRamp(rng)) failed++;
+	if(!testPeakAbsolute(rng)) failed++;
+	if(!testApplyGain(rng)) failed++;
+	if(!testInterleaveStereo(rng)) failed++;
+	if(!testDeinterleave(rng)) failed++;
+	if(!testAccumulateFir(rng)) failed++;
+	if(failed != 0){
+		std::cout << failed << " kernel test(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "all kernel tests passed" << std::endl;
+	return 0;
+}
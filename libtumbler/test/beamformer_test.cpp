@@ -0,0 +1,265 @@
+/*
+ * @file beamformer_test.cpp
+ * \~english
+ * @brief Tests of the microphone array geometry and the beamformer with simulated plane waves
+ * \~japanese
+ * @brief マイクアレイの配置とビームフォーマーの試験
+ * @details 配置ファイルの読み込みと、模擬した平面波に対する遅延和・MVDR の目的方向の利得、他方向の抑圧、無相関雑音の抑圧、共有する STFT のフレームによる処理、16kHz 出力を確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/microphonearray.h"
+#include "tumbler/beamformer.h"
+#include "tumbler/stft.h"
+
+using namespace tumbler;
+
+static const int k_rate = 48000;
+
+/**
+ * @class Wave
+ * @brief 方向 (azimuth, elevation) から到来する周波数 frequency、振幅 amplitude の正弦波
+ */
+class Wave
+{
+public:
+	float azimuth_;
+	float elevation_;
+	float frequency_;
+	float amplitude_;
+};
+
+/**
+ * @brief 平面波を 16ch のマイク入力として模擬する（各マイクへの到達時間差を解析的に与える）
+ */
+std::vector<std::vector<float> > simulate(const MicrophoneArray& array, const std::vector<Wave>& waves, size_t frames, float noise = 0)
+{
+	std::vector<std::vector<float> > mics(array.size(), std::vector<float>(frames, 0.0F));
+	std::vector<float> advances(array.size());
+	for(size_t w=0;w<waves.size();++w){
+		array.advances(waves[w].azimuth_, waves[w].elevation_, advances.data());
+		for(size_t m=0;m<array.size();++m){
+			for(size_t i=0;i<frames;++i){
+				mics[m][i] += waves[w].amplitude_ * static_cast<float>(std::sin(2.0 * M_PI * waves[w].frequency_ * (static_cast<double>(i) / k_rate + advances[m])));
+			}
+		}
+	}
+	std::mt19937 rng(1);
+	std::normal_distribution<float> dist(0.0F, noise > 0 ? noise : 1.0F);
+	if(noise > 0){
+		for(size_t m=0;m<array.size();++m){
+			for(size_t i=0;i<frames;++i){
+				mics[m][i] += dist(rng);
+			}
+		}
+	}
+	return mics;
+}
+
+/**
+ * @brief ビームフォーマーに 480 フレームずつ与え、出力を返す
+ */
+std::vector<short> run(Beamformer& bf, const std::vector<std::vector<float> >& mics)
+{
+	std::vector<short> out;
+	std::vector<short> buffer(bf.maxOutput(480));
+	std::vector<const float*> in(mics.size());
+	for(size_t done=0;done<mics[0].size();done+=480){
+		for(size_t m=0;m<mics.size();++m){
+			in[m] = mics[m].data() + done;
+		}
+		const size_t n = bf.process(in.data(), std::min<size_t>(480, mics[0].size() - done), buffer.data());
+		out.insert(out.end(), buffer.begin(), buffer.begin() + n);
+	}
+	return out;
+}
+
+/**
+ * @brief 後半の区間の、指定した周波数成分の振幅
+ */
+double amplitude(const std::vector<short>& audio, double frequency, int rate)
+{
+	const size_t begin = audio.size() / 2;
+	double re = 0;
+	double im = 0;
+	for(size_t i=begin;i<audio.size();++i){
+		re += audio[i] * std::cos(2.0 * M_PI * frequency * i / rate);
+		im += audio[i] * std::sin(2.0 * M_PI * frequency * i / rate);
+	}
+	return 2.0 * std::sqrt(re * re + im * im) / (audio.size() - begin);
+}
+
+double rms(const std::vector<short>& audio)
+{
+	const size_t begin = audio.size() / 2;
+	double sum = 0;
+	for(size_t i=begin;i<audio.size();++i){
+		sum += static_cast<double>(audio[i]) * audio[i];
+	}
+	return std::sqrt(sum / (audio.size() - begin));
+}
+
+double db(double ratio)
+{
+	return 20.0 * std::log10(ratio);
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	const MicrophoneArray array = MicrophoneArray::tumbler();
+
+	// 配置：microphone_positions.txt と同じ形式のファイルから読み込んだ値が組込みの値と一致する
+	{
+		const std::string path = "/tmp/beamformer_test_positions.txt";
+		std::ofstream ofs(path.c_str());
+		ofs << "# comment" << std::endl << std::endl;
+		for(size_t i=0;i<array.size();++i){
+			ofs << "# " << i + 1 << "ch" << std::endl;
+			ofs << array.position(i).x_ * 1000 << " " << array.position(i).y_ * 1000 << " " << array.position(i).z_ * 1000 << std::endl;
+		}
+		ofs.close();
+		const MicrophoneArray loaded = MicrophoneArray::load(path);
+		bool ok = loaded.size() == 16 && std::abs(array.radius() - 0.0404F) < 0.0005F;
+		for(size_t i=0;i<loaded.size() && ok;++i){
+			ok = std::abs(loaded.position(i).x_ - array.position(i).x_) < 1e-6F && std::abs(loaded.position(i).z_ - array.position(i).z_) < 1e-6F;
+		}
+		// 正面（270 度）から到来する音は、正面側（y が負）のマイクに早く到達する
+		std::vector<float> advances(16);
+		array.advances(270, 0, advances.data());
+		ok = ok && std::abs(advances[3] - 0.0305F / MicrophoneArray::k_speed_of_sound_) < 1e-7F && advances[0] < 0;
+		std::remove(path.c_str());
+		std::ofstream bad(path.c_str());
+		bad << "1 2" << std::endl;
+		bad.close();
+		try{
+			MicrophoneArray::load(path);
+			ok = false;
+		}catch(const std::runtime_error& e){
+		}
+		std::remove(path.c_str());
+		std::cout << "geometry: radius " << array.radius() * 1000 << " mm" << std::endl;
+		if(!ok){
+			std::cout << "failed: geometry" << std::endl;
+			failed++;
+		}
+	}
+
+	// 遅延和：目的方向の利得は 1、反対方向の 4kHz は減衰し、無相関雑音は約 1/4（16ch の平均）となる
+	{
+		const size_t frames = k_rate;
+		Beamformer bf(array);
+		const double onAxis = amplitude(run(bf, simulate(array, {{270, 0, 1000, 8000}, {270, 0, 3000, 8000}}, frames)), 3000, k_rate);
+		bf.reset();
+		const double offAxis = amplitude(run(bf, simulate(array, {{90, 0, 4000, 8000}}, frames)), 4000, k_rate);
+		bf.reset();
+		const double noise = rms(run(bf, simulate(array, {}, frames, 4000)));
+		std::cout << "delay-and-sum: on-axis 3kHz gain " << db(onAxis / 8000) << " dB, opposite 4kHz " << db(offAxis / 8000) << " dB, white noise " << db(noise / 4000) << " dB, latency " << bf.latency() << std::endl;
+		if(std::abs(db(onAxis / 8000)) > 0.5 || db(offAxis / 8000) > -6 || std::abs(db(noise / 4000) + 12) > 1){
+			std::cout << "failed: delay-and-sum" << std::endl;
+			failed++;
+		}
+	}
+
+	// MVDR：目的方向の利得を保ったまま、他方向の干渉音を遅延和よりも強く抑える
+	{
+		const size_t frames = 2 * k_rate;
+		const std::vector<std::vector<float> > mics = simulate(array, {{270, 20, 1000, 4000}, {0, 0, 1700, 4000}}, frames, 30);
+		Beamformer das(array, [](){ BeamformerConfig c; c.elevation_ = 20; return c; }());
+		BeamformerConfig config;
+		config.method_ = BeamformerMethod::mvdr_;
+		config.elevation_ = 20;
+		Beamformer mvdr(array, config);
+		const std::vector<short> a = run(das, mics);
+		const std::vector<short> b = run(mvdr, mics);
+		const double dasTarget = db(amplitude(a, 1000, k_rate) / 4000);
+		const double dasInterference = db(amplitude(a, 1700, k_rate) / 4000);
+		const double mvdrTarget = db(amplitude(b, 1000, k_rate) / 4000);
+		const double mvdrInterference = db(amplitude(b, 1700, k_rate) / 4000);
+		std::cout << "mvdr: target " << mvdrTarget << " dB (delay-and-sum " << dasTarget << " dB), interference " << mvdrInterference << " dB (delay-and-sum " << dasInterference << " dB), " << b.size() << " samples" << std::endl;
+		if(std::abs(mvdrTarget) > 1 || mvdrInterference > dasInterference - 15 || b.size() != frames){
+			std::cout << "failed: mvdr" << std::endl;
+			failed++;
+		}
+
+		// 他の処理と共有する STFT のフレームを与えても、同じ出力となる
+		Beamformer shared(array, config);
+		StftAnalyzer analyzer(array.size(), config.fftSize_, config.fftSize_ / 2, StftWindow::sqrtHann_);
+		std::vector<const float*> in(mics.size());
+		for(size_t m=0;m<mics.size();++m){
+			in[m] = mics[m].data();
+		}
+		std::vector<short> c;
+		std::vector<short> buffer(shared.maxOutput(config.fftSize_ / 2));
+		analyzer.process(in.data(), frames, [&](const StftFrame& frame){
+			const size_t n = shared.process(frame, buffer.data());
+			c.insert(c.end(), buffer.begin(), buffer.begin() + n);
+		});
+		int difference = 0;
+		for(size_t i=0;i<std::min(b.size(), c.size());++i){
+			difference = std::max(difference, std::abs(b[i] - c[i]));
+		}
+		if(c.size() != b.size() || difference > 1){
+			std::cout << "failed: mvdr with shared frames (" << c.size() << " samples, difference " << difference << ")" << std::endl;
+			failed++;
+		}
+		try{
+			StftAnalyzer hann(array.size(), config.fftSize_, config.fftSize_ / 2, StftWindow::hann_);
+			hann.process(in.data(), config.fftSize_ / 2, [&](const StftFrame& frame){ shared.process(frame, buffer.data()); });
+			std::cout << "failed: a frame with a different window is accepted" << std::endl;
+			failed++;
+		}catch(const std::invalid_argument& e){
+		}
+	}
+
+	// 16kHz 出力
+	for(int method=0;method<2;++method){
+		BeamformerConfig config;
+		config.method_ = method == 0 ? BeamformerMethod::delayAndSum_ : BeamformerMethod::mvdr_;
+		config.outputRate_ = 16000;
+		Beamformer bf(array, config);
+		const std::vector<short> out = run(bf, simulate(array, {{270, 0, 1000, 8000}}, k_rate));
+		const double gain = db(amplitude(out, 1000, 16000) / 8000);
+		std::cout << (method == 0 ? "delay-and-sum" : "mvdr") << " 16kHz: " << out.size() << " samples, 1kHz gain " << gain << " dB" << std::endl;
+		if(std::abs(static_cast<int>(out.size()) - 16000) > 200 || std::abs(gain) > 0.5){
+			std::cout << "failed: 16kHz output" << std::endl;
+			failed++;
+		}
+	}
+
+	// 設定の誤り
+	try{
+		BeamformerConfig config;
+		config.outputRate_ = 44100;
+		Beamformer bf(array, config);
+		std::cout << "failed: unsupported output rate is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	return failed == 0 ? 0 : 1;
+}
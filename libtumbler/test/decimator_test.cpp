@@ -0,0 +1,245 @@
+/*
+ * @file decimator_test.cpp
+ * \~english
+ * @brief Tests of the integer-factor polyphase decimator
+ * \~japanese
+ * @brief 整数比のポリフェーズ・デシメーターの試験
+ * @details 変換比毎の通過域の利得と阻止域（エイリアシング）の減衰、遅延、入力の分割の仕方とインターリーブ形式・チャネル毎の入力によらず同じ出力となること、
+ * 処理時間（汎用の Resampler との比較）を確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/decimator.h"
+#include "tumbler/resampler.h"
+
+using namespace tumbler;
+
+static const int k_rate = 48000;
+
+/**
+ * @brief 1ch の入力を一度に変換する
+ */
+std::vector<short> decimate(int factor, const std::vector<float>& x)
+{
+	Decimator decimator(1, factor);
+	std::vector<short> y(decimator.maxOutput(x.size()));
+	const float* in = x.data();
+	short* out = y.data();
+	y.resize(decimator.process(&in, x.size(), &out));
+	return y;
+}
+
+std::vector<float> tone(double frequency, double amplitude, size_t frames)
+{
+	std::vector<float> x(frames);
+	for(size_t i=0;i<frames;++i){
+		x[i] = static_cast<float>(amplitude * std::sin(2.0 * M_PI * frequency * i / k_rate));
+	}
+	return x;
+}
+
+/**
+ * @brief 出力の周波数 frequency の成分の振幅（フィルタの立ち上がりを除く）
+ */
+double amplitude(const std::vector<short>& y, double frequency, int rate, size_t skip)
+{
+	double re = 0;
+	double im = 0;
+	for(size_t i=skip;i<y.size();++i){
+		re += y[i] * std::cos(2.0 * M_PI * frequency * i / rate);
+		im += y[i] * std::sin(2.0 * M_PI * frequency * i / rate);
+	}
+	return 2.0 * std::sqrt(re * re + im * im) / (y.size() - skip);
+}
+
+double rms(const std::vector<short>& y, size_t skip)
+{
+	double sum = 0;
+	for(size_t i=skip;i<y.size();++i){
+		sum += static_cast<double>(y[i]) * y[i];
+	}
+	return std::sqrt(sum / (y.size() - skip));
+}
+
+double db(double ratio)
+{
+	return 20.0 * std::log10(std::max(ratio, 1e-12));
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+
+	// 通過域の利得は 0dB、出力のナイキスト周波数を超える成分はエイリアシングとして現れない
+	const int factors[] = {2, 3, 6};
+	for(int f : factors){
+		const int rate = k_rate / f;
+		const size_t skip = Decimator::k_taps_per_phase_;
+		const double passband = rate * 0.42;
+		const double passGain = db(amplitude(decimate(f, tone(1000, 10000, k_rate)), 1000, rate, skip) / 10000);
+		const double edgeGain = db(amplitude(decimate(f, tone(passband, 10000, k_rate)), passband, rate, skip) / 10000);
+		double alias = -200;
+		const double stops[] = {rate * 0.5 + 100, rate * 0.6, rate * 1.0 + 1000, 20000};
+		for(double s : stops){
+			alias = std::max(alias, db(rms(decimate(f, tone(s, 30000, k_rate)), skip) * std::sqrt(2.0) / 30000));
+		}
+		std::cout << "factor " << f << " (" << rate << " Hz): 1kHz gain " << passGain << " dB, " << passband << " Hz gain " << edgeGain << " dB, worst alias " << alias << " dB" << std::endl;
+		if(std::abs(passGain) > 0.05 || std::abs(edgeGain) > 0.5 || alias > -65){
+			std::cout << "failed: frequency response of factor " << f << std::endl;
+			failed++;
+		}
+	}
+
+	// 遅延：入力の t0 番目のインパルスは、出力の (n + 1) * factor - 1 - delay() = t0 となる n 付近に現れる
+	{
+		Decimator decimator(1, 3);
+		std::vector<float> x(4800, 0.0F);
+		const size_t t0 = 1001;
+		x[t0] = 30000;
+		std::vector<short> y = decimate(3, x);
+		const size_t peak = static_cast<size_t>(std::max_element(y.begin(), y.end()) - y.begin());
+		const double expected = (t0 + decimator.delay() + 1) / 3.0 - 1;
+		std::cout << "impulse at " << t0 << ": peak at output " << peak << " (expected " << expected << "), delay " << decimator.delay() << " samples" << std::endl;
+		if(std::abs(peak - expected) > 1){
+			std::cout << "failed: delay" << std::endl;
+			failed++;
+		}
+	}
+
+	// インターリーブ形式の入力から指定したチャネルのみを変換し、分割の仕方、チャネル毎の入力によらず同じ出力となる
+	{
+		const size_t frames = k_rate;
+		const size_t stride = 18;
+		const uint32_t mask = (1U << 0) | (1U << 5) | (1U << 16);
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<int> dist(-20000, 20000);
+		std::vector<short> interleaved(frames * stride);
+		for(size_t i=0;i<interleaved.size();++i){
+			interleaved[i] = static_cast<short>(dist(rng));
+		}
+		const int selected[] = {0, 5, 16};
+		for(int f : factors){
+			Decimator whole(3, f);
+			Decimator split(3, f);
+			Decimator planar(3, f);
+			std::vector<std::vector<short> > a(3, std::vector<short>(whole.maxOutput(frames)));
+			std::vector<std::vector<short> > b(3, std::vector<short>(whole.maxOutput(frames)));
+			std::vector<std::vector<short> > c(3, std::vector<short>(whole.maxOutput(frames)));
+			short* pa[3] = {a[0].data(), a[1].data(), a[2].data()};
+			const size_t na = whole.process(interleaved.data(), frames, stride, mask, pa);
+			size_t nb = 0;
+			std::uniform_int_distribution<size_t> chunk(1, 1000);
+			for(size_t done=0;done<frames;){
+				const size_t n = std::min(chunk(rng), frames - done);
+				short* pb[3] = {b[0].data() + nb, b[1].data() + nb, b[2].data() + nb};
+				nb += split.process(interleaved.data() + done * stride, n, stride, mask, pb);
+				done += n;
+			}
+			std::vector<std::vector<float> > channels(3, std::vector<float>(frames));
+			for(int k=0;k<3;++k){
+				for(size_t i=0;i<frames;++i){
+					channels[k][i] = interleaved[i * stride + selected[k]];
+				}
+			}
+			const float* in[3] = {channels[0].data(), channels[1].data(), channels[2].data()};
+			short* pc[3] = {c[0].data(), c[1].data(), c[2].data()};
+			const size_t nc = planar.process(in, frames, pc);
+			bool same = na == frames / f && nb == na && nc == na;
+			for(int k=0;k<3 && same;++k){
+				same = std::equal(a[k].begin(), a[k].begin() + na, b[k].begin()) && std::equal(a[k].begin(), a[k].begin() + na, c[k].begin());
+			}
+			if(!same){
+				std::cout << "failed: factor " << f << " outputs " << na << ", " << nb << ", " << nc << " samples differently" << std::endl;
+				failed++;
+			}
+		}
+	}
+
+	// 処理時間：16ch の 3:1 変換と、汎用の Resampler（1ch ずつ）との比較
+	{
+		const size_t frames = 10 * k_rate;
+		const size_t stride = 18;
+		std::mt19937 rng(2);
+		std::uniform_int_distribution<int> dist(-20000, 20000);
+		std::vector<short> interleaved(frames * stride);
+		for(size_t i=0;i<interleaved.size();++i){
+			interleaved[i] = static_cast<short>(dist(rng));
+		}
+		Decimator decimator(16, 3);
+		std::vector<std::vector<short> > out(16, std::vector<short>(decimator.maxOutput(480)));
+		short* dst[16];
+		for(int c=0;c<16;++c){
+			dst[c] = out[c].data();
+		}
+		auto begin = std::chrono::steady_clock::now();
+		for(size_t done=0;done<frames;done+=480){
+			decimator.process(interleaved.data() + done * stride, 480, stride, 0xFFFFU, dst);
+		}
+		const double decimatorMs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() * 1000 / 10 / 16;
+
+		std::vector<std::vector<short> > channels(16, std::vector<short>(frames));
+		for(int c=0;c<16;++c){
+			for(size_t i=0;i<frames;++i){
+				channels[c][i] = interleaved[i * stride + c];
+			}
+		}
+		std::vector<short> converted(frames);
+		begin = std::chrono::steady_clock::now();
+		for(int c=0;c<16;++c){
+			Resampler resampler(k_rate, 16000);
+			for(size_t done=0;done<frames;done+=480){
+				resampler.process(channels[c].data() + done, 480, converted.data());
+			}
+		}
+		const double resamplerMs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() * 1000 / 10 / 16;
+		std::cout << "48kHz to 16kHz: decimator " << decimatorMs << " ms per second per channel (" << decimator.taps() << " taps, from interleaved input), resampler "
+				<< resamplerMs << " ms per second per channel (" << Resampler(k_rate, 16000).taps() << " taps, from deinterleaved input)" << std::endl;
+	}
+
+	// 設定の誤り
+	try{
+		Decimator decimator(1, 4);
+		std::cout << "failed: factor 4 is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	try{
+		Decimator decimator(2, 3);
+		short in[18] = {};
+		short out[2];
+		short* dst[2] = {out, out};
+		decimator.process(in, 1, 18, 0x7U, dst);
+		std::cout << "failed: mask with three channels is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	if(failed == 0){
+		std::cout << "all decimator tests passed" << std::endl;
+	}
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+/*
+ * @file directionestimator_test.cpp
+ * \~english
+ * @brief Tests of the SRP-PHAT direction estimator with simulated plane waves
+ * \~japanese
+ * @brief 音源方向推定器の試験
+ * @details 模擬した広帯域の平面波に対する方位角の推定誤差と信頼度、無相関雑音と無音に対する信頼度、推定の頻度と処理時間、
+ * 方位角から LED 番号への変換を確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/ledring.h"
+#include "tumbler/microphonearray.h"
+#include "tumbler/directionestimator.h"
+#include "tumbler/stft.h"
+
+using namespace tumbler;
+
+static const int k_rate = 48000;
+
+/**
+ * @brief 方向 (azimuth, elevation) から到来する広帯域の平面波（300Hz〜3500Hz の 64 個の正弦波の和）に、マイク毎に無相関な雑音を加えて 16ch のマイク入力として模擬する
+ */
+std::vector<std::vector<float> > simulate(const MicrophoneArray& array, float azimuth, float elevation, float amplitude, float noise, size_t frames, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> phase(0, 2.0 * M_PI);
+	std::uniform_real_distribution<double> frequency(300, 3500);
+	std::normal_distribution<float> dist(0.0F, 1.0F);
+	std::vector<std::vector<float> > mics(array.size(), std::vector<float>(frames, 0.0F));
+	std::vector<float> advances(array.size());
+	array.advances(azimuth, elevation, advances.data());
+	if(amplitude > 0){
+		for(int t=0;t<64;++t){
+			const double f = frequency(rng);
+			const double p = phase(rng);
+			for(size_t m=0;m<array.size();++m){
+				for(size_t i=0;i<frames;++i){
+					mics[m][i] += amplitude / 8 * static_cast<float>(std::sin(2.0 * M_PI * f * (static_cast<double>(i) / k_rate + advances[m]) + p));
+				}
+			}
+		}
+	}
+	for(size_t m=0;m<array.size() && noise > 0;++m){
+		for(size_t i=0;i<frames;++i){
+			mics[m][i] += noise * dist(rng);
+		}
+	}
+	return mics;
+}
+
+/**
+ * @brief 推定器に 480 フレームずつ与え、得られた推定値の数を返す
+ */
+size_t run(DirectionEstimator& estimator, const std::vector<std::vector<float> >& mics)
+{
+	size_t count = 0;
+	std::vector<const float*> in(mics.size());
+	for(size_t done=0;done<mics[0].size();done+=480){
+		for(size_t m=0;m<mics.size();++m){
+			in[m] = mics[m].data() + done;
+		}
+		count += estimator.process(in.data(), std::min<size_t>(480, mics[0].size() - done));
+	}
+	return count;
+}
+
+float angleError(float a, float b)
+{
+	const float d = std::fmod(std::abs(a - b), 360.0F);
+	return std::min(d, 360.0F - d);
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	const MicrophoneArray array = MicrophoneArray::tumbler();
+
+	// 平面波：格子上にない方向も含めて、方位角を数度以内で推定し、信頼度は高い
+	{
+		const float azimuths[] = {0, 45, 137, 222.5F, 270, 301};
+		const float elevations[] = {0, 20, 10, 0, 30, 0};
+		for(int i=0;i<6;++i){
+			DirectionEstimator estimator(array);
+			run(estimator, simulate(array, azimuths[i], elevations[i], 4000, 400, k_rate / 2, i + 1));
+			const DirectionEstimate& e = estimator.estimate();
+			const float error = angleError(e.azimuth_, azimuths[i]);
+			std::cout << "source " << azimuths[i] << " deg (elevation " << elevations[i] << "): estimated " << e.azimuth_ << " deg (elevation " << e.elevation_ << "), confidence " << e.confidence_ << std::endl;
+			if(error > 3 || e.confidence_ < 0.5F){
+				std::cout << "failed: plane wave from " << azimuths[i] << " deg" << std::endl;
+				failed++;
+			}
+		}
+	}
+
+	// 無相関な雑音では信頼度は低く、無音では推定しない（信頼度 0）
+	{
+		DirectionEstimator estimator(array);
+		run(estimator, simulate(array, 0, 0, 0, 2000, k_rate / 2, 10));
+		const float noise = estimator.estimate().confidence_;
+		estimator.reset();
+		run(estimator, simulate(array, 0, 0, 0, 10, k_rate / 2, 11));
+		const float silence = estimator.estimate().confidence_;
+		std::cout << "diffuse noise: confidence " << noise << ", silence: confidence " << silence << std::endl;
+		if(noise > 0.2F || silence != 0){
+			std::cout << "failed: confidence of noise" << std::endl;
+			failed++;
+		}
+	}
+
+	// Beamformer と共有する STFT のフレーム（平方根ハン窓、シフト幅 512）からも推定でき、hop_ 毎に間引かれる
+	{
+		DirectionEstimator estimator(array);
+		StftAnalyzer analyzer(array.size(), 1024, 512, StftWindow::sqrtHann_);
+		const std::vector<std::vector<float> > mics = simulate(array, 137, 0, 4000, 400, k_rate / 2, 12);
+		std::vector<const float*> in(mics.size());
+		for(size_t m=0;m<mics.size();++m){
+			in[m] = mics[m].data();
+		}
+		size_t count = 0;
+		const size_t frames = analyzer.process(in.data(), mics[0].size(), [&](const StftFrame& frame){
+			if(estimator.process(frame)){
+				count++;
+			}
+		});
+		const DirectionEstimate& e = estimator.estimate();
+		std::cout << "shared frames: " << count << " estimates from " << frames << " frames, estimated " << e.azimuth_ << " deg, confidence " << e.confidence_ << std::endl;
+		if(count != frames / 2 || angleError(e.azimuth_, 137) > 3 || e.confidence_ < 0.5F){
+			std::cout << "failed: shared frames" << std::endl;
+			failed++;
+		}
+		try{
+			StftAnalyzer other(array.size(), 512, 256);
+			other.process(in.data(), 256, [&](const StftFrame& frame){ estimator.process(frame); });
+			std::cout << "failed: a frame of a different size is accepted" << std::endl;
+			failed++;
+		}catch(const std::invalid_argument& e){
+		}
+	}
+
+	// 推定の頻度（既定で 50Hz、hop_ = 480 で 100Hz）と処理時間
+	for(size_t hop=960;hop>=480;hop/=2){
+		DirectionEstimatorConfig config;
+		config.hop_ = hop;
+		DirectionEstimator estimator(array, config);
+		const std::vector<std::vector<float> > mics = simulate(array, 270, 0, 4000, 400, k_rate, 20);
+		const auto begin = std::chrono::steady_clock::now();
+		const size_t count = run(estimator, mics);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		const size_t expected = (k_rate - config.fftSize_) / hop + 1;
+		std::cout << "hop " << hop << ": " << count << " estimates per second, " << seconds * 1000 << " ms per second of audio (" << estimator.directions() << " directions)" << std::endl;
+		if(count != expected || estimator.estimate().frame_ != static_cast<uint64_t>(k_rate / hop * hop)){
+			std::cout << "failed: estimate rate" << std::endl;
+			failed++;
+		}
+	}
+
+	// 方位角から LED 番号への変換：正面（270 度）は物理 LED 9 番のみ、向かって右（0 度）は物理 LED 4 番と 5 番の中間、350 度は物理 LED 5 番のみ
+	{
+		const AzimuthFrame front({270}, LED(0, 0, 200), LED(0, 0, 0));
+		const AzimuthFrame right({0}, LED(0, 0, 200), LED(0, 0, 0));
+		const AzimuthFrame wrapped({-10}, LED(0, 0, 200), LED(0, 0, 0));
+		bool ok = front.getLED(9).b_ == 200 && right.getLED(4).b_ == 100 && right.getLED(5).b_ == 100 && wrapped.getLED(5).b_ == 200;
+		for(int i=0;i<Frame::k_num_leds_ && ok;++i){
+			ok = (i == 9 || front.getLED(i).b_ == 0) && (i == 4 || i == 5 || right.getLED(i).b_ == 0) && (i == 5 || wrapped.getLED(i).b_ == 0);
+		}
+		if(!ok){
+			std::cout << "failed: azimuth frame" << std::endl;
+			failed++;
+		}
+	}
+
+	// 設定の誤り
+	try{
+		DirectionEstimatorConfig config;
+		config.fftSize_ = 1000;
+		DirectionEstimator estimator(array, config);
+		std::cout << "failed: FFT size 1000 is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/*
+ * @file echocanceller_test.cpp
+ * \~english
+ * @brief Tests of the acoustic echo canceller with simulated echo paths
+ * \~japanese
+ * @brief 音響エコーキャンセラーの試験
+ * @details 模擬したエコーの経路（減衰する乱数のインパルス応答）と、マイクに対して遅延した参照信号を与え、エコー抑圧量、近端の音声の保存、
+ * 参照信号の遅延の補償、ブロック単位の出力、処理時間を確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/echocanceller.h"
+
+using namespace tumbler;
+
+static const int k_rate = 48000;
+static const size_t k_channels = 4;
+
+/**
+ * @class Scene
+ * @brief 模擬した入力。スピーカーの再生音 x が、チャネル毎のインパルス応答を経てマイクに届き、参照信号は x を referenceDelay サンプル遅延させたものとなる
+ */
+class Scene
+{
+public:
+	std::vector<std::vector<float> > mics_;
+	std::vector<std::vector<float> > nearEnd_; //!< マイク入力に含まれる近端の音声
+	std::vector<float> reference_;
+};
+
+/**
+ * @brief 再生音（帯域制限した雑音）、エコーの経路（長さ taps で指数的に減衰する乱数）、近端の音声（nearStart 以降の 440Hz と 1.3kHz の正弦波）を模擬する
+ */
+Scene simulate(size_t frames, size_t taps, size_t referenceDelay, size_t nearStart, float nearAmplitude)
+{
+	std::mt19937 rng(1);
+	std::normal_distribution<float> dist(0.0F, 1.0F);
+	std::vector<float> x(frames);
+	float lowpass = 0;
+	for(size_t i=0;i<frames;++i){
+		lowpass = 0.6F * lowpass + 0.4F * dist(rng);
+		x[i] = 6000.0F * lowpass;
+	}
+	Scene scene;
+	scene.reference_.assign(frames, 0.0F);
+	for(size_t i=referenceDelay;i<frames;++i){
+		scene.reference_[i] = x[i - referenceDelay];
+	}
+	for(size_t c=0;c<k_channels;++c){
+		// スピーカーからマイクまでの直接音（数サンプル）と、減衰する残響
+		std::vector<float> h(taps, 0.0F);
+		const size_t direct = 4 + c * 3;
+		h[direct] = 0.5F;
+		for(size_t k=direct+1;k<taps;++k){
+			h[k] = 0.1F * dist(rng) * std::exp(-static_cast<float>(k) / (taps / 6.0F));
+		}
+		std::vector<float> mic(frames, 0.0F);
+		std::vector<float> nearEnd(frames, 0.0F);
+		for(size_t i=0;i<frames;++i){
+			float sum = 0;
+			const size_t n = std::min(taps, i + 1);
+			for(size_t k=0;k<n;++k){
+				sum += h[k] * x[i - k];
+			}
+			if(i >= nearStart){
+				nearEnd[i] = nearAmplitude * static_cast<float>(std::sin(2.0 * M_PI * 440 * i / k_rate) + 0.5 * std::sin(2.0 * M_PI * 1300 * i / k_rate + c));
+			}
+			mic[i] = sum + nearEnd[i] + 3.0F * dist(rng);
+		}
+		scene.mics_.push_back(mic);
+		scene.nearEnd_.push_back(nearEnd);
+	}
+	return scene;
+}
+
+/**
+ * @brief エコーキャンセラーに 480 フレームずつ与え、チャネル毎の出力を返す
+ */
+std::vector<std::vector<float> > run(EchoCanceller& aec, const Scene& scene, double* seconds = nullptr)
+{
+	const size_t frames = scene.reference_.size();
+	std::vector<std::vector<float> > out(k_channels, std::vector<float>(frames + aec.maxOutput(480), 0.0F));
+	std::vector<const float*> in(k_channels);
+	std::vector<float*> dst(k_channels);
+	size_t produced = 0;
+	const auto begin = std::chrono::steady_clock::now();
+	for(size_t done=0;done<frames;done+=480){
+		for(size_t c=0;c<k_channels;++c){
+			in[c] = scene.mics_[c].data() + done;
+			dst[c] = out[c].data() + produced;
+		}
+		produced += aec.process(in.data(), scene.reference_.data() + done, std::min<size_t>(480, frames - done), dst.data());
+	}
+	if(seconds != nullptr){
+		*seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+	for(size_t c=0;c<k_channels;++c){
+		out[c].resize(produced);
+	}
+	return out;
+}
+
+double power(const std::vector<float>& x, size_t begin, size_t end, size_t shift = 0)
+{
+	double sum = 0;
+	for(size_t i=begin;i<end;++i){
+		sum += static_cast<double>(x[i - shift]) * x[i - shift];
+	}
+	return sum / (end - begin);
+}
+
+double db(double ratio)
+{
+	return 10.0 * std::log10(ratio);
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	const size_t frames = 6 * k_rate;
+	const size_t taps = 1024;
+
+	// エコーのみ：収束後（後半 2 秒）のエコー抑圧量
+	{
+		const Scene scene = simulate(frames, taps, 24, frames, 0);
+		EchoCanceller aec(k_channels);
+		double seconds = 0;
+		const std::vector<std::vector<float> > out = run(aec, scene, &seconds);
+		bool ok = out[0].size() == frames / 256 * 256;
+		const size_t begin = 4 * k_rate;
+		const size_t end = out[0].size();
+		for(size_t c=0;c<k_channels;++c){
+			const double erle = db(power(scene.mics_[c], begin, end) / power(out[c], begin, end));
+			std::cout << "channel " << c << ": ERLE " << erle << " dB (estimated " << aec.erle(c) << " dB)" << std::endl;
+			ok = ok && erle > 25 && std::abs(aec.erle(c) - erle) < 6;
+		}
+		std::cout << "cpu: " << seconds * 1000 / (frames / k_rate) / k_channels << " ms per second per channel (" << aec.config().filterLength_ << " taps, latency " << aec.latency() << " samples)" << std::endl;
+		if(!ok){
+			std::cout << "failed: echo only" << std::endl;
+			failed++;
+		}
+	}
+
+	// 参照信号の遅延を補償しない場合は、直接音が参照信号より先に届くため抑圧量が小さい
+	{
+		const Scene scene = simulate(3 * k_rate, taps, 24, 3 * k_rate, 0);
+		EchoCancellerConfig config;
+		config.referenceDelay_ = 0;
+		EchoCanceller uncompensated(k_channels, config);
+		EchoCanceller compensated(k_channels);
+		const std::vector<std::vector<float> > a = run(uncompensated, scene);
+		const std::vector<std::vector<float> > b = run(compensated, scene);
+		const double erleA = db(power(scene.mics_[0], 2 * k_rate, a[0].size()) / power(a[0], 2 * k_rate, a[0].size()));
+		const double erleB = db(power(scene.mics_[0], 2 * k_rate, b[0].size()) / power(b[0], 2 * k_rate, b[0].size()));
+		std::cout << "reference delay: ERLE " << erleA << " dB without compensation, " << erleB << " dB with compensation" << std::endl;
+		if(erleB < erleA + 10){
+			std::cout << "failed: reference delay" << std::endl;
+			failed++;
+		}
+	}
+
+	// ダブルトーク：収束後に近端の音声が加わっても、出力の近端の音声はほぼ保たれ、エコーは抑圧されたままとなる
+	{
+		const size_t nearStart = 4 * k_rate;
+		const Scene scene = simulate(frames, taps, 24, nearStart, 2000);
+		EchoCanceller aec(k_channels);
+		const std::vector<std::vector<float> > out = run(aec, scene);
+		bool ok = true;
+		for(size_t c=0;c<k_channels;++c){
+			// 出力は referenceDelay_ だけ遅延する
+			const size_t delay = aec.config().referenceDelay_;
+			const size_t begin = nearStart + k_rate / 2;
+			const size_t end = out[c].size();
+			double residual = 0;
+			for(size_t i=begin;i<end;++i){
+				const double r = out[c][i] - scene.nearEnd_[c][i - delay];
+				residual += r * r;
+			}
+			residual /= (end - begin);
+			const double nearEnd = power(scene.nearEnd_[c], begin, end, delay);
+			const double echo = power(scene.mics_[c], begin, end, delay) - nearEnd;
+			std::cout << "double talk channel " << c << ": residual echo " << db(residual / echo) << " dB of the echo, near-end " << db(power(out[c], begin, end) / nearEnd) << " dB" << std::endl;
+			ok = ok && db(residual / echo) < -15;
+		}
+		if(!ok){
+			std::cout << "failed: double talk" << std::endl;
+			failed++;
+		}
+	}
+
+	// 設定の誤り
+	try{
+		EchoCancellerConfig config;
+		config.filterLength_ = 1000;
+		EchoCanceller aec(1, config);
+		std::cout << "failed: filter length 1000 is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	return failed == 0 ? 0 : 1;
+}
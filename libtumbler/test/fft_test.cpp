@@ -0,0 +1,93 @@
+/*
+ * @file fft_test.cpp
+ * \~english
+ * @brief Tests of the real-input FFT against a direct DFT
+ * \~japanese
+ * @brief 実数入力の高速フーリエ変換の試験
+ * @details 順変換を定義どおりの離散フーリエ変換と比較し、逆変換で元の実数列に戻ること、planar 版と std::complex 版が一致することを確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/fft.h"
+
+using namespace tumbler;
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+	for(size_t size=4;size<=2048;size*=2){
+		std::vector<float> x(size);
+		for(size_t i=0;i<size;++i){
+			x[i] = dist(rng);
+		}
+		FFT fft(size);
+		std::vector<std::complex<float> > X(fft.bins());
+		fft.forward(x.data(), X.data());
+		double error = 0;
+		for(size_t k=0;k<fft.bins();++k){
+			std::complex<double> e;
+			for(size_t n=0;n<size;++n){
+				e += static_cast<double>(x[n]) * std::polar(1.0, -2.0 * M_PI * k * n / size);
+			}
+			error = std::max(error, std::abs(std::complex<double>(X[k]) - e));
+		}
+		std::vector<float> y(size);
+		fft.inverse(X.data(), y.data());
+		double roundTrip = 0;
+		for(size_t i=0;i<size;++i){
+			roundTrip = std::max(roundTrip, static_cast<double>(std::abs(y[i] - x[i])));
+		}
+		// planar 版は std::complex 版と一致する
+		std::vector<float> re(fft.bins());
+		std::vector<float> im(fft.bins());
+		fft.forward(x.data(), re.data(), im.data());
+		double planar = 0;
+		for(size_t k=0;k<fft.bins();++k){
+			planar = std::max(planar, static_cast<double>(std::abs(std::complex<float>(re[k], im[k]) - X[k])));
+		}
+		fft.inverse(re.data(), im.data(), y.data());
+		for(size_t i=0;i<size;++i){
+			planar = std::max(planar, static_cast<double>(std::abs(y[i] - x[i])));
+		}
+		if(error > 1e-4 * size || roundTrip > 1e-5 || planar > 1e-5){
+			std::cout << "failed: size " << size << ", DFT error " << error << ", round trip error " << roundTrip << ", planar error " << planar << std::endl;
+			failed++;
+		}
+	}
+	try{
+		FFT fft(100);
+		std::cout << "failed: size 100 is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	if(failed == 0){
+		std::cout << "all FFT tests passed" << std::endl;
+	}
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,355 @@
+/*
+ * @file microphone_test.cpp
+ * \~english
+ * @brief Tests of the microphone capture thread with a raw file and a FIFO in place of the device
+ * \~japanese
+ * @brief 録音デバイスの代わりに raw ファイル、FIFO を与えた Microphone クラスの試験
+ * @details 読み出したブロックの内容と通し番号、チャネル毎に取り出した内容、デシメーターへ読み出した内容、リングバッファが満杯の場合の破棄と不連続の通知、受信の途絶による欠損の検出、
+ * まとめて届いたフレームを欠損とみなさないこと、実時間に合わせて読み出した場合の録音時刻を確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "tumbler/tumbler.h"
+#include "tumbler/microphone.h"
+
+using namespace tumbler;
+
+static const int C = Microphone::k_channels_;
+
+/**
+ * @brief 通し番号 frame のフレームのチャネル c のサンプル値
+ */
+short pattern(uint64_t frame, int c)
+{
+	return static_cast<short>((frame * 7 + c * 1000) % 30000);
+}
+
+std::vector<short> frames(uint64_t begin, size_t n)
+{
+	std::vector<short> data(n * C);
+	for(size_t i=0;i<n;++i){
+		for(int c=0;c<C;++c){
+			data[i * C + c] = pattern(begin + i, c);
+		}
+	}
+	return data;
+}
+
+/**
+ * @brief ブロックの内容が通し番号どおりであるかを返す
+ */
+bool matches(const short* data, const MicrophoneBlock& block)
+{
+	for(size_t i=0;i<block.frames_;++i){
+		for(int c=0;c<C;++c){
+			if(data[i * C + c] != pattern(block.frame_ + i, c)){
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief 録音デバイスの代わりに、通し番号 0 から total 未満のフレームを 480 フレームずつ通し番号に対応する時刻に FIFO に書き込む
+ * @param [in] wfd FIFO
+ * @param [in] total 書き込むフレーム数
+ * @param [in] skipBegin, skipEnd この間のフレームは書き込まない（録音デバイス側の欠損）
+ * @param [in] holdBegin, holdEnd この間のフレームは holdEnd の時刻にまとめて書き込む（受信済のフレームがカーネルに溜まった状態）
+ */
+void writeRealtime(int wfd, uint64_t total, uint64_t skipBegin, uint64_t skipEnd, uint64_t holdBegin, uint64_t holdEnd)
+{
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for(uint64_t f=0;f<total;f+=480){
+		if((skipBegin <= f && f < skipEnd) || (holdBegin <= f && f < holdEnd)){
+			continue;
+		}
+		std::this_thread::sleep_until(begin + std::chrono::microseconds(f * 1000000 / 48000));
+		const uint64_t first = f == holdEnd ? holdBegin : f;
+		const std::vector<short> data = frames(first, static_cast<size_t>(f + 480 - first));
+		if(::write(wfd, data.data(), data.size() * sizeof(short)) < 0){
+			break;
+		}
+	}
+	::close(wfd);
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	std::vector<short> buf(480 * C);
+
+	// raw ファイル：全フレームが連続したブロックとして読み出される
+	{
+		const std::string path = "/tmp/microphone_test.raw";
+		const std::vector<short> data = frames(0, 48000);
+		FILE* fp = std::fopen(path.c_str(), "wb");
+		std::fwrite(data.data(), sizeof(short), data.size(), fp);
+		std::fclose(fp);
+		MicrophoneConfig config;
+		config.device_ = path;
+		config.control_ = false;
+		config.ringFrames_ = 65536;
+		Microphone mic(config);
+		mic.start();
+		size_t total = 0;
+		bool ok = true;
+		MicrophoneBlock block;
+		while(size_t n = mic.read(buf.data(), 480, block, 1000)){
+			ok = ok && block.frame_ == total && !block.discontinuous_ && matches(buf.data(), block);
+			total += n;
+		}
+		mic.stop();
+		const MicrophoneStats s = mic.stats();
+		std::cout << "file: " << total << " frames read, " << s.frames_ << " received, " << s.overflows_ << " overflow(s)" << std::endl;
+		if(!ok || total != 48000 || s.frames_ != 48000 || s.overflows_ != 0){
+			std::cout << "failed: file" << std::endl;
+			failed++;
+		}
+
+		// 実時間に合わせて読み出すと、録音時刻は経過時間に沿って進む
+		config.paced_ = true;
+		Microphone paced(config);
+		paced.start();
+		uint64_t first = 0;
+		uint64_t last = 0;
+		size_t read = 0;
+		while(size_t n = paced.read(buf.data(), 480, block, 1000)){
+			if(read == 0){
+				first = block.timestamp_;
+			}
+			last = block.timestamp_;
+			read += n;
+			if(read >= 24000){
+				break;
+			}
+		}
+		paced.stop();
+		const double ms = (last - first) / 1000.0;
+		std::cout << "paced: timestamps span " << ms << " ms for " << read - 480 << " frames" << std::endl;
+		if(ms < 450 || ms > 550){
+			std::cout << "failed: paced timestamps" << std::endl;
+			failed++;
+		}
+
+		// 読み残しがある状態で録音を再開すると、読み残しは破棄され通し番号 0 のフレームから読み出される
+		paced.start();
+		const size_t restarted = paced.read(buf.data(), 480, block, 1000);
+		paced.stop();
+		std::cout << "restart: first block at frame " << block.frame_ << std::endl;
+		if(restarted == 0 || block.frame_ != 0 || block.discontinuous_ || !matches(buf.data(), block)){
+			std::cout << "failed: restart" << std::endl;
+			failed++;
+		}
+
+		// チャネル毎の読み出し：マイクとフィードバック信号を float で、外部入力端子を short で取り出す
+		// （容量 2048 フレーム = 65536 サンプルのリングバッファでは、約 3641 フレーム毎にフレームの途中で折り返す）
+		config.ringFrames_ = 2048;
+		Microphone planar(config);
+		planar.start();
+		std::vector<std::vector<float> > mics(17, std::vector<float>(480));
+		std::vector<float*> micPtrs;
+		for(size_t c=0;c<mics.size();++c){
+			micPtrs.push_back(mics[c].data());
+		}
+		std::vector<short> line(480);
+		short* linePtr = line.data();
+		total = 0;
+		ok = true;
+		for(bool odd=false;;odd=!odd){
+			// 読み出し方を交互に替えても通し番号は続く
+			const size_t n = odd ? planar.read(&linePtr, Microphone::k_line_mask_, 333, block, 1000)
+			                     : planar.read(micPtrs.data(), Microphone::k_mic_mask_ | Microphone::k_reference_mask_, 2.0F, 480, block, 1000);
+			if(n == 0){
+				break;
+			}
+			ok = ok && block.frame_ == total;
+			for(size_t i=0;i<n;++i){
+				if(odd){
+					ok = ok && line[i] == pattern(total + i, Microphone::k_line_channel_);
+				}else{
+					for(int c=0;c<17;++c){
+						ok = ok && mics[c][i] == 2.0F * pattern(total + i, c);
+					}
+				}
+			}
+			total += n;
+		}
+		planar.stop();
+		std::cout << "planar: " << total << " frames read" << std::endl;
+		if(!ok || total != 48000){
+			std::cout << "failed: planar" << std::endl;
+			failed++;
+		}
+
+		// デシメーターへの読み出し：リングバッファの末尾で折り返すフレームを含め、同じ入力を一度に変換した場合と一致する
+		Microphone decimated(config);
+		decimated.start();
+		Decimator decimator(2, 3);
+		std::vector<std::vector<short> > low(2, std::vector<short>(decimator.maxOutput(48000)));
+		total = 0;
+		size_t produced = 0;
+		while(true){
+			short* dst[2] = {low[0].data() + produced, low[1].data() + produced};
+			const size_t n = decimated.read(decimator, (1U << 3) | Microphone::k_line_mask_, dst, 481, block, 1000);
+			if(block.frames_ == 0){
+				break;
+			}
+			total += block.frames_;
+			produced += n;
+		}
+		decimated.stop();
+		Decimator reference(2, 3);
+		std::vector<std::vector<short> > expected(2, std::vector<short>(reference.maxOutput(48000)));
+		short* ref[2] = {expected[0].data(), expected[1].data()};
+		const size_t m = reference.process(data.data(), 48000, C, (1U << 3) | Microphone::k_line_mask_, ref);
+		ok = total == 48000 && produced == m;
+		for(int k=0;k<2 && ok;++k){
+			ok = std::equal(expected[k].begin(), expected[k].begin() + m, low[k].begin());
+		}
+		std::cout << "decimated: " << total << " frames read, " << produced << " samples per channel at " << decimator.outputRate() << " Hz" << std::endl;
+		if(!ok){
+			std::cout << "failed: decimated" << std::endl;
+			failed++;
+		}
+		std::remove(path.c_str());
+	}
+
+	// FIFO：リングバッファが満杯の間に受信したフレームは破棄され、その後のブロックは不連続として通知される
+	const std::string fifo = "/tmp/microphone_test.fifo";
+	{
+		std::remove(fifo.c_str());
+		mkfifo(fifo.c_str(), 0600);
+		std::vector<short> first = frames(0, 4800);
+		std::vector<short> second = frames(4800, 960);
+		int wfd = -1;
+		std::thread writer([&]{ wfd = ::open(fifo.c_str(), O_WRONLY); });
+		MicrophoneConfig config;
+		config.device_ = fifo;
+		config.control_ = false;
+		config.ringFrames_ = 2048;
+		config.gapToleranceMs_ = 0;
+		Microphone mic(config);
+		mic.start();
+		writer.join();
+		if(::write(wfd, first.data(), first.size() * sizeof(short)) < 0){
+			std::cout << "failed: write to FIFO" << std::endl;
+		}
+		while(mic.stats().frames_ < 4800){
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		const MicrophoneStats s = mic.stats();
+		size_t kept = 0;
+		bool ok = true;
+		MicrophoneBlock block;
+		while(size_t n = mic.read(buf.data(), 480, block, 0)){
+			ok = ok && block.frame_ == kept && !block.discontinuous_ && matches(buf.data(), block);
+			kept += n;
+		}
+		if(::write(wfd, second.data(), second.size() * sizeof(short)) < 0){
+			std::cout << "failed: write to FIFO" << std::endl;
+		}
+		::close(wfd);
+		const size_t n = mic.read(buf.data(), 480, block, 1000);
+		std::cout << "fifo: " << kept << " kept, " << s.droppedFrames_ << " dropped, next block at " << block.frame_ << (block.discontinuous_ ? " (discontinuous)" : "") << std::endl;
+		ok = ok && s.overflows_ > 0 && kept + s.droppedFrames_ == 4800 && n == 480 && block.frame_ == 4800 && block.discontinuous_ && matches(buf.data(), block);
+		mic.stop();
+		if(!ok){
+			std::cout << "failed: overflow" << std::endl;
+			failed++;
+		}
+	}
+
+	// FIFO：実時間で書き込む途中で 200ms 分の受信が途絶えると、欠損として検出される
+	{
+		int wfd = -1;
+		std::thread opener([&]{ wfd = ::open(fifo.c_str(), O_WRONLY); });
+		MicrophoneConfig config;
+		config.device_ = fifo;
+		config.control_ = false;
+		config.priority_ = 0;
+		config.gapToleranceMs_ = 50.0; // 書き込み側のスケジューリングの揺らぎを欠損とみなさない
+		Microphone mic(config);
+		mic.start();
+		opener.join();
+		std::thread writer([&]{ writeRealtime(wfd, 24000, 12000, 21600, 0, 0); });
+		MicrophoneBlock block;
+		size_t discontinuities = 0;
+		while(mic.read(buf.data(), 480, block, 1000) > 0){
+			if(block.discontinuous_){
+				discontinuities++;
+			}
+		}
+		writer.join();
+		mic.stop();
+		const MicrophoneStats s = mic.stats();
+		std::cout << "gap: " << s.gaps_ << " gap(s), " << s.lostFrames_ << " frames lost, " << discontinuities << " discontinuous block(s)" << std::endl;
+		if(s.gaps_ != 1 || s.lostFrames_ < 7200 || s.lostFrames_ > 12000 || discontinuities != 1){
+			std::cout << "failed: gap detection" << std::endl;
+			failed++;
+		}
+	}
+
+	// FIFO：60ms 分のフレームがまとめて届いても（読み出しの遅れと同じく、カーネルに溜まっていたフレーム）、欠損とはみなさない
+	{
+		int wfd = -1;
+		std::thread opener([&]{ wfd = ::open(fifo.c_str(), O_WRONLY); });
+		MicrophoneConfig config;
+		config.device_ = fifo;
+		config.control_ = false;
+		config.priority_ = 0;
+		config.gapToleranceMs_ = 40.0;
+		Microphone mic(config);
+		mic.start();
+		opener.join();
+		fcntl(wfd, F_SETPIPE_SZ, 1 << 20); // まとめて書き込むフレームが一度に FIFO に収まるようにする
+		std::thread writer([&]{ writeRealtime(wfd, 24000, 0, 0, 12000, 14880); });
+		MicrophoneBlock block;
+		size_t total = 0;
+		uint64_t previous = 0;
+		bool ok = true;
+		while(size_t n = mic.read(buf.data(), 480, block, 1000)){
+			ok = ok && block.frame_ == total && !block.discontinuous_ && matches(buf.data(), block) && previous <= block.timestamp_;
+			previous = block.timestamp_;
+			total += n;
+		}
+		writer.join();
+		mic.stop();
+		const MicrophoneStats s = mic.stats();
+		std::cout << "late: " << total << " frames read, " << s.gaps_ << " gap(s)" << std::endl;
+		if(!ok || total != 24000 || s.gaps_ != 0){
+			std::cout << "failed: late frames" << std::endl;
+			failed++;
+		}
+	}
+	std::remove(fifo.c_str());
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+/*
+ * @file resampler_test.cpp
+ * \~english
+ * @brief Tests of the polyphase sample rate converter
+ * \~japanese
+ * @brief ポリフェーズ・サンプリングレート変換器の試験
+ * @details よく用いる変換比について、通過域の正弦波の振幅、遮断周波数を超える正弦波の減衰、入力の分割の仕方によらず同じ出力が得られることを確認する。
+ * 実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "tumbler/tumbler.h"
+#include "tumbler/resampler.h"
+
+using namespace tumbler;
+
+std::vector<short> sine(double frequency, int rate, size_t n, double amplitude)
+{
+	std::vector<short> audio(n);
+	for(size_t i=0;i<n;++i){
+		audio[i] = static_cast<short>(amplitude * std::sin(2.0 * M_PI * frequency * i / rate));
+	}
+	return audio;
+}
+
+/**
+ * @brief 一括で変換する
+ */
+std::vector<short> convert(Resampler& resampler, const std::vector<short>& in)
+{
+	std::vector<short> out(resampler.maxOutput(in.size()) + resampler.maxOutput(resampler.taps()));
+	size_t n = resampler.process(in.data(), in.size(), out.data());
+	n += resampler.flush(out.data() + n);
+	out.resize(n);
+	return out;
+}
+
+/**
+ * @brief 指定した周波数成分の振幅を返す（先頭と末尾の過渡応答は除く）
+ */
+double amplitude(const std::vector<short>& audio, double frequency, int rate)
+{
+	const size_t skip = 200;
+	double re = 0;
+	double im = 0;
+	size_t n = 0;
+	for(size_t i=skip;i+skip<audio.size();++i){
+		re += audio[i] * std::cos(2.0 * M_PI * frequency * i / rate);
+		im += audio[i] * std::sin(2.0 * M_PI * frequency * i / rate);
+		n++;
+	}
+	return 2.0 * std::sqrt(re * re + im * im) / n;
+}
+
+bool testRatio(int inputRate, int outputRate)
+{
+	bool ok = true;
+	// 通過域の正弦波の振幅と出力長
+	const std::vector<short> in = sine(1000, inputRate, inputRate, 10000);
+	Resampler resampler(inputRate, outputRate);
+	const std::vector<short> out = convert(resampler, in);
+	const double a = amplitude(out, 1000, outputRate);
+	const long expected = static_cast<long>(in.size()) * outputRate / inputRate;
+	if(std::abs(a - 10000) > 50 || std::abs(static_cast<long>(out.size()) - expected) > static_cast<long>(resampler.maxOutput(resampler.taps()))){
+		std::cout << inputRate << "->" << outputRate << ": amplitude " << a << ", length " << out.size() << " (expected " << expected << ")" << std::endl;
+		ok = false;
+	}
+	// 分割して与えても一括の場合と同じ出力となる
+	Resampler chunked(inputRate, outputRate);
+	std::vector<short> out2(out.size() + 16);
+	const size_t sizes[] = {1, 7, 333, 2048, 5};
+	size_t produced = 0;
+	for(size_t pos=0, k=0;pos<in.size();++k){
+		const size_t c = std::min(sizes[k % 5], in.size() - pos);
+		produced += chunked.process(&in[pos], c, &out2[produced]);
+		pos += c;
+	}
+	produced += chunked.flush(&out2[produced]);
+	out2.resize(produced);
+	if(out2 != out){
+		std::cout << inputRate << "->" << outputRate << ": chunked output differs" << std::endl;
+		ok = false;
+	}
+	// 入力、出力の低い方のナイキスト周波数を 5% 超える正弦波は 60dB 以上減衰する
+	const double nyquist = std::min(inputRate, outputRate) / 2.0;
+	if(nyquist * 1.05 < inputRate / 2.0){
+		Resampler r(inputRate, outputRate);
+		const std::vector<short> alias = convert(r, sine(nyquist * 1.05, inputRate, inputRate, 10000));
+		double energy = 0;
+		for(size_t i=200;i+200<alias.size();++i){
+			energy += static_cast<double>(alias[i]) * alias[i];
+		}
+		const double rms = std::sqrt(energy / (alias.size() - 400)) * std::sqrt(2.0);
+		if(rms > 10){
+			std::cout << inputRate << "->" << outputRate << ": stopband amplitude " << rms << std::endl;
+			ok = false;
+		}
+	}
+	std::cout << inputRate << "->" << outputRate << (ok ? " ok" : " failed") << std::endl;
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	const int ratios[][2] = {{16000, 44100}, {22050, 44100}, {24000, 44100}, {48000, 44100}, {16000, 48000}, {44100, 16000}};
+	int failed = 0;
+	for(size_t i=0;i<sizeof(ratios)/sizeof(ratios[0]);++i){
+		if(!testRatio(ratios[i][0], ratios[i][1])){
+			failed++;
+		}
+	}
+	if(failed != 0){
+		std::cout << failed << " ratio(s) failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * @file soundbank_test.cpp
+ * \~english
+ * @brief Tests of the preloaded sound cache
+ * \~japanese
+ * @brief 音声キャッシュ（SoundBank）の試験
+ * @details 一時ファイルに書き出した各形式の WAV/raw ファイルを読み込み、ゼロコピー参照、ダウンミックス、サンプリングレート変換、不正なヘッダの検出を確認する。
+ * 実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <stdexcept>
+#include <unistd.h>
+#include "tumbler/tumbler.h"
+#include "tumbler/soundbank.h"
+
+using namespace tumbler;
+
+static void put16(std::string& s, uint16_t v){ s.append(reinterpret_cast<const char*>(&v), 2); }
+static void put32(std::string& s, uint32_t v){ s.append(reinterpret_cast<const char*>(&v), 4); }
+
+/**
+ * @brief WAV ファイルの内容を作成する
+ * @param [in] extensible WAVE_FORMAT_EXTENSIBLE とするか
+ * @param [in] extra fmt チャンクと data チャンクの間に挿入する奇数長のチャンクの有無
+ */
+std::string wav(int channels, int rate, int bits, const std::string& pcm, bool extensible, bool extra)
+{
+	std::string fmt;
+	put16(fmt, extensible ? 0xFFFE : 1);
+	put16(fmt, channels);
+	put32(fmt, rate);
+	put32(fmt, rate * channels * bits / 8);
+	put16(fmt, channels * bits / 8);
+	put16(fmt, bits);
+	if(extensible){
+		put16(fmt, 22);
+		put16(fmt, bits);
+		put32(fmt, channels == 1 ? 0x4 : 0x3);
+		put16(fmt, 1); // KSDATAFORMAT_SUBTYPE_PCM
+		fmt.append("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 14);
+	}
+	std::string body = "WAVE";
+	body += "fmt ";
+	put32(body, fmt.size());
+	body += fmt;
+	if(extra){
+		body += "LIST";
+		put32(body, 3);
+		body.append("abc\0", 4); // 奇数長のチャンクは 1 byte のパディングを伴う
+	}
+	body += "data";
+	put32(body, pcm.size());
+	body += pcm;
+	std::string file = "RIFF";
+	put32(file, body.size());
+	return file + body;
+}
+
+std::string pcm16(const std::vector<short>& samples)
+{
+	return std::string(reinterpret_cast<const char*>(samples.data()), samples.size() * 2);
+}
+
+std::string writeTemp(const std::string& content)
+{
+	char path[] = "/tmp/soundbank_testXXXXXX";
+	const int fd = mkstemp(path);
+	if(fd < 0 || ::write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())){
+		throw std::runtime_error("could not write temporary file");
+	}
+	::close(fd);
+	return path;
+}
+
+bool check(bool condition, const std::string& message)
+{
+	if(!condition){
+		std::cout << "failed: " << message << std::endl;
+	}
+	return condition;
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	SoundBank bank(44100);
+	std::vector<std::string> paths;
+
+	std::vector<short> mono(4410);
+	for(size_t i=0;i<mono.size();++i){
+		mono[i] = static_cast<short>((i % 100) * 100 - 5000);
+	}
+
+	// モノラル 16bit 44.1kHz はゼロコピーで参照される
+	paths.push_back(writeTemp(wav(1, 44100, 16, pcm16(mono), false, false)));
+	SoundBank::Handle h = bank.loadWav("mono", paths.back());
+	failed += !check(h && h->mapped() && h->size() == mono.size() && std::memcmp(h->data(), mono.data(), mono.size() * 2) == 0, "mono 44.1kHz is mapped");
+	failed += !check(h->normalizationGain() > 32766.0F / 5001 && h->normalizationGain() < 32766.0F / 4999, "normalization gain");
+
+	// 奇数長のチャンクを挟むと data チャンクが奇数の位置となるが、正しく読み込める
+	paths.push_back(writeTemp(wav(1, 44100, 16, pcm16(mono), false, true)));
+	h = bank.loadWav("odd", paths.back());
+	failed += !check(h->size() == mono.size() && std::memcmp(h->data(), mono.data(), mono.size() * 2) == 0, "chunk padding");
+
+	// ステレオはダウンミックスされる
+	std::vector<short> stereo(mono.size() * 2);
+	for(size_t i=0;i<mono.size();++i){
+		stereo[2 * i] = mono[i] + 1000;
+		stereo[2 * i + 1] = mono[i] - 1000;
+	}
+	paths.push_back(writeTemp(wav(2, 44100, 16, pcm16(stereo), false, false)));
+	h = bank.loadWav("stereo", paths.back());
+	failed += !check(!h->mapped() && h->size() == mono.size() && std::memcmp(h->data(), mono.data(), mono.size() * 2) == 0, "stereo is downmixed");
+
+	// WAVE_FORMAT_EXTENSIBLE
+	paths.push_back(writeTemp(wav(2, 44100, 16, pcm16(stereo), true, false)));
+	h = bank.loadWav("extensible", paths.back());
+	failed += !check(h->size() == mono.size() && std::memcmp(h->data(), mono.data(), mono.size() * 2) == 0, "extensible format");
+
+	// 8bit
+	std::string u8;
+	for(size_t i=0;i<mono.size();++i){
+		u8 += static_cast<char>((mono[i] >> 8) + 128);
+	}
+	paths.push_back(writeTemp(wav(1, 44100, 8, u8, false, false)));
+	h = bank.loadWav("u8", paths.back());
+	failed += !check(h->size() == mono.size() && h->data()[10] == (static_cast<int>(static_cast<unsigned char>(u8[10])) - 128) * 256, "8bit");
+
+	// 16kHz は変換される
+	paths.push_back(writeTemp(wav(1, 16000, 16, pcm16(std::vector<short>(16000, 1000)), false, false)));
+	h = bank.loadWav("16k", paths.back());
+	failed += !check(h->rate() == 44100 && h->size() > 44000 && h->size() < 44200 && std::abs(h->data()[22050] - 1000) < 10, "16kHz is resampled");
+
+	// raw
+	paths.push_back(writeTemp(pcm16(stereo)));
+	h = bank.loadRaw("raw", paths.back(), 44100, 2);
+	failed += !check(h->size() == mono.size() && std::memcmp(h->data(), mono.data(), mono.size() * 2) == 0, "raw");
+
+	// 不正なファイル
+	std::string broken = wav(1, 44100, 16, pcm16(mono), false, false);
+	broken[8] = 'X';
+	paths.push_back(writeTemp(broken));
+	bool thrown = false;
+	try{
+		bank.loadWav("broken", paths.back());
+	}catch(const std::runtime_error& e){
+		thrown = true;
+	}
+	failed += !check(thrown && !bank.get("broken"), "broken header throws");
+	paths.push_back(writeTemp(wav(1, 44100, 24, std::string(300, '\0'), false, false)));
+	thrown = false;
+	try{
+		bank.loadWav("24bit", paths.back());
+	}catch(const std::runtime_error& e){
+		thrown = true;
+	}
+	failed += !check(thrown, "24bit throws");
+
+	// 取り除いても保持しているハンドルは有効
+	SoundBank::Handle kept = bank.get("mono");
+	bank.unload("mono");
+	failed += !check(!bank.get("mono") && kept && kept->data()[1] == mono[1], "unload keeps handle");
+	failed += !check(bank.size() == 6, "size");
+
+	for(size_t i=0;i<paths.size();++i){
+		std::remove(paths[i].c_str());
+	}
+	if(failed != 0){
+		std::cout << failed << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "ok" << std::endl;
+	return 0;
+}
@@ -30,6 +30,7 @@
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <algorithm>
 #include <unistd.h>
 
 #include "tumbler/tumbler.h"
@@ -70,10 +71,29 @@ int main(int argc, char** argv)
 		std::cout << "Batch Play..." << std::endl;
 		spk.batchPlay(ad, 44100, 0.05, Speaker::PlayBackMode::overwrite_);
 		std::cout << "Batch End..." << std::endl;
+		// 再生中の音声に、サンプリングレートの異なる短い音声を重ねて再生する（PCM デバイスは開き直さない）
+		usleep(1000*500);
+		std::vector<short> earcon(audio.begin(), audio.begin() + std::min(audio.size(), static_cast<size_t>(44100/5)));
+		spk.batchPlay(earcon, 22050, 0.05, Speaker::PlayBackMode::overlay_);
 		while(spk.state()){
 			usleep(1000*100);
 		}
     }
+    {
+		std::cout << "Streaming Play..." << std::endl;
+		Speaker& spk = Speaker::getInstance();
+		// 音声合成結果の逐次書き込みを模して 10ms 毎に書き込む
+		const size_t chunk = spk.rate() / 100;
+		for(size_t i=0;i<audio.size();i+=chunk){
+			spk.write(&audio[i], std::min(chunk, audio.size() - i));
+		}
+		spk.drain();
+		std::cout << "Streaming End... underruns = " << spk.underruns() << ", starvations = " << spk.starvations() << std::endl;
+		if(spk.state()){
+			std::cerr << "Speaker is still on play after drain()" << std::endl;
+			return 1;
+		}
+    }
 
     return 0;
 }
@@ -0,0 +1,156 @@
+/*
+ * @file speakerconfig_test.cpp
+ * \~english
+ * @brief Tests of the PCM device configuration against the ALSA file plugin
+ * \~japanese
+ * @brief PCM デバイスの設定の試験
+ * @details ALSA の file プラグイン（出力先は null プラグイン）を PCM デバイスとして、周期とバッファを指定した mmap アクセスで書き込み、
+ * ファイルに書き出された音声が書き込んだ音声と一致すること、出力遅延がバッファの長さ以内であること、出力先チャネルの指定に従って左右のチャネルに出力されること、
+ * 再生要求のハンドルで完了、位置、停止が得られること、間隔を空けた再生要求の間にアンダーランとならないことを確認する。
+ * スピーカーからは音声は出力されない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <unistd.h>
+#include "tumbler/tumbler.h"
+#include "tumbler/speaker.h"
+
+using namespace tumbler;
+
+int main(int argc, char** argv)
+{
+	const std::string path = "/tmp/speakerconfig_test.raw";
+	std::remove(path.c_str());
+	SpeakerConfig config;
+	config.device_ = "file:FILE=" + path + ",FORMAT=raw";
+	config.periodFrames_ = 256;
+	config.bufferFrames_ = 1024;
+	config.mmap_ = true;
+	Speaker& spk = Speaker::getInstance(config);
+	std::cout << "period " << spk.periodFrames() << ", buffer " << spk.bufferFrames() << ", mmap " << spk.mmap() << std::endl;
+	int failed = 0;
+	if(spk.periodFrames() == 0 || spk.bufferFrames() < spk.periodFrames()){
+		std::cout << "failed: invalid period/buffer size" << std::endl;
+		failed++;
+	}
+
+	// 0.5 秒の正弦波を 100 サンプルずつ書き込む
+	std::vector<short> audio(spk.rate() / 2);
+	for(size_t i=0;i<audio.size();++i){
+		audio[i] = static_cast<short>(8000 * std::sin(2.0 * M_PI * 440 * i / spk.rate()));
+	}
+	double maxLatency = 0;
+	for(size_t i=0;i<audio.size();i+=100){
+		spk.write(&audio[i], std::min(static_cast<size_t>(100), audio.size() - i));
+		maxLatency = std::max(maxLatency, spk.latencyMs());
+	}
+	spk.drain();
+	// 同じ音声を左チャネルに 0.5 倍、右チャネルに等倍で出力する
+	spk.setStreamRouting(SpeakerRouting(0.5F, 1.0F));
+	spk.write(audio.data(), audio.size());
+	spk.drain();
+	const double bufferMs = spk.bufferFrames() * 1000.0 / spk.rate();
+	std::cout << "max latency " << maxLatency << " ms (buffer " << bufferMs << " ms)" << std::endl;
+	if(maxLatency > bufferMs){
+		std::cout << "failed: latency exceeds buffer" << std::endl;
+		failed++;
+	}
+
+	// 周期の途中で区切った音声を再生キューで続けて再生する（左チャネルのみ）
+	const size_t cuts[4] = {0, 1001, 7777, audio.size()};
+	Playback last;
+	for(int k=0;k<3;++k){
+		last = spk.enqueue(std::vector<short>(audio.begin() + cuts[k], audio.begin() + cuts[k + 1]), spk.rate(), 1.0F, 0);
+	}
+	last.wait();
+	spk.drain(); // PCM デバイスの出力を完了させる
+
+	// ファイルに書き出されたステレオ音声の左チャネルは書き込んだ音声と一致し、右チャネルは無音である。続いて出力先チャネルを指定した音声、
+	// 再生キューで隙間なく連結された元の音声が続く
+	std::ifstream ifs(path.c_str(), std::ios::binary);
+	std::vector<short> stereo;
+	short sample;
+	while(ifs.read(reinterpret_cast<char*>(&sample), 2)){
+		stereo.push_back(sample);
+	}
+	size_t mismatch = 0;
+	for(size_t i=0;i<audio.size();++i){
+		if(2 * i + 1 >= stereo.size() || stereo[2 * i] != audio[i] || stereo[2 * i + 1] != 0){
+			mismatch++;
+		}
+		const size_t j = audio.size() + i;
+		if(2 * j + 1 >= stereo.size() || std::abs(stereo[2 * j] - audio[i] / 2) > 1 || stereo[2 * j + 1] != audio[i]){
+			mismatch++;
+		}
+		const size_t q = 2 * audio.size() + i;
+		if(2 * q + 1 >= stereo.size() || stereo[2 * q] != audio[i] || stereo[2 * q + 1] != 0){
+			mismatch++;
+		}
+	}
+	std::cout << stereo.size() / 2 << " frames written, " << mismatch << " mismatch(es), " << spk.underruns() << " underrun(s)" << std::endl;
+	if(mismatch != 0){
+		std::cout << "failed: output differs" << std::endl;
+		failed++;
+	}
+
+	// 再生要求のハンドル
+	Playback playback = spk.batchPlay(audio, spk.rate(), 0.5F, Speaker::PlayBackMode::normal_);
+	Playback cancelled = spk.batchPlay(audio, spk.rate() / 2, 0.5F, Speaker::PlayBackMode::normal_);
+	std::atomic<bool> called(false);
+	cancelled.onComplete([&called](Playback::Result result){ called.store(result == Playback::Result::cancelled_); });
+	cancelled.cancel();
+	const Playback::Result result = playback.wait();
+	std::cout << "playback result " << static_cast<int>(result) << ", position " << playback.position() << "/" << playback.length() << std::endl;
+	if(result != Playback::Result::completed_ || playback.position() != audio.size() || cancelled.wait() != Playback::Result::cancelled_){
+		std::cout << "failed: playback handle" << std::endl;
+		failed++;
+	}
+	while(spk.state()){
+		usleep(1000);
+	}
+	if(!called.load()){
+		std::cout << "failed: completion callback" << std::endl;
+		failed++;
+	}
+
+	// 間隔を空けた個別の再生要求：再生し終える度に PCM デバイスを drain するため、待機中にアンダーランとならない
+	const uint64_t underruns = spk.underruns();
+	const std::vector<short> clip(audio.begin(), audio.begin() + audio.size() / 5);
+	for(int k=0;k<5;++k){
+		spk.batchPlay(clip, spk.rate(), 1.0F, Speaker::PlayBackMode::normal_).wait();
+		usleep(100000);
+	}
+	std::cout << "isolated clips: " << spk.underruns() - underruns << " underrun(s)" << std::endl;
+	if(spk.underruns() != underruns){
+		std::cout << "failed: underrun between isolated clips" << std::endl;
+		failed++;
+	}
+	std::remove(path.c_str());
+	return failed == 0 ? 0 : 1;
+}
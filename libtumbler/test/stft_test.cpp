@@ -0,0 +1,169 @@
+/*
+ * @file stft_test.cpp
+ * \~english
+ * @brief Tests of the shared multichannel short-time Fourier transform
+ * \~japanese
+ * @brief 多チャネルの短時間フーリエ変換の試験
+ * @details 分析と合成で入力が遅延して復元されること、フレーム番号と末尾の通し番号、フレームのスペクトルが単独の FFT と一致すること、
+ * 入力の分割の仕方に依らないことを確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/stft.h"
+
+using namespace tumbler;
+
+/**
+ * @brief 分析と合成を行い、入力を size - hop サンプル遅延させたものに戻るかを確かめる
+ */
+int reconstruct(size_t size, size_t hop, StftWindow analysis, StftWindow synthesis, const std::vector<float>& x)
+{
+	StftAnalyzer analyzer(1, size, hop, analysis);
+	StftSynthesizer synthesizer(size, hop, analysis, synthesis);
+	std::vector<float> y;
+	std::vector<float> out(hop);
+	const float* in[1];
+	// 半端な長さに分けて与える
+	const size_t chunk = 333;
+	for(size_t done=0;done<x.size();done+=chunk){
+		in[0] = x.data() + done;
+		analyzer.process(in, std::min(chunk, x.size() - done), [&](const StftFrame& frame){
+			synthesizer.synthesize(frame.re(0), frame.im(0), out.data());
+			y.insert(y.end(), out.begin(), out.end());
+		});
+	}
+	const size_t delay = size - hop;
+	double error = 0;
+	for(size_t i=delay;i<y.size();++i){
+		error = std::max(error, static_cast<double>(std::abs(y[i] - x[i - delay])));
+	}
+	if(y.size() != x.size() / hop * hop || error > 1e-4){
+		std::cout << "failed: size " << size << ", hop " << hop << ", " << y.size() << " samples, reconstruction error " << error << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+	std::vector<float> x(48000);
+	for(size_t i=0;i<x.size();++i){
+		x[i] = dist(rng);
+	}
+
+	// 分析窓と合成窓の組合せ毎の復元
+	failed += reconstruct(512, 256, StftWindow::sqrtHann_, StftWindow::sqrtHann_, x);
+	failed += reconstruct(1024, 512, StftWindow::sqrtHann_, StftWindow::sqrtHann_, x);
+	failed += reconstruct(512, 128, StftWindow::hann_, StftWindow::rectangular_, x);
+	failed += reconstruct(1024, 480, StftWindow::hann_, StftWindow::hann_, x);
+	failed += reconstruct(256, 256, StftWindow::rectangular_, StftWindow::rectangular_, x);
+
+	// フレーム番号と末尾の通し番号、スペクトルが直近 size サンプルに窓をかけた FFT と一致すること
+	{
+		const size_t channels = 3;
+		const size_t size = 1024;
+		const size_t hop = 480;
+		std::vector<std::vector<float> > input(channels, std::vector<float>(x.size()));
+		std::vector<const float*> in(channels);
+		for(size_t c=0;c<channels;++c){
+			for(size_t i=0;i<x.size();++i){
+				input[c][i] = x[(i + 97 * c) % x.size()] * (c + 1);
+			}
+			in[c] = input[c].data();
+		}
+		StftAnalyzer analyzer(channels, size, hop);
+		FFT fft(size);
+		std::vector<float> window(size);
+		stftWindow(window.data(), StftWindow::hann_, size);
+		std::vector<float> work(size);
+		std::vector<float> re(fft.bins());
+		std::vector<float> im(fft.bins());
+		uint64_t expected = 0;
+		double error = 0;
+		const size_t count = analyzer.process(in.data(), x.size(), [&](const StftFrame& frame){
+			if(frame.index_ != expected || frame.end_ != (expected + 1) * hop || frame.bins() != size / 2 + 1){
+				std::cout << "failed: frame " << frame.index_ << " ends at " << frame.end_ << ", expected frame " << expected << std::endl;
+				failed++;
+			}
+			expected++;
+			for(size_t c=0;c<channels;++c){
+				for(size_t i=0;i<size;++i){
+					const int64_t t = static_cast<int64_t>(frame.end_) - static_cast<int64_t>(size) + static_cast<int64_t>(i);
+					work[i] = (t < 0 ? 0.0F : input[c][t]) * window[i];
+				}
+				fft.forward(work.data(), re.data(), im.data());
+				for(size_t k=0;k<fft.bins();++k){
+					error = std::max(error, static_cast<double>(std::abs(frame.re(c)[k] - re[k]) + std::abs(frame.im(c)[k] - im[k])));
+				}
+			}
+		});
+		if(count != x.size() / hop || expected != count || error > 1e-3){
+			std::cout << "failed: " << count << " frames, spectrum error " << error << std::endl;
+			failed++;
+		}
+		// 窓をかけたフレームの電力から、窓関数の二乗平均で入力の電力を求められること
+		double energy = 0;
+		for(size_t i=x.size()-size;i<x.size();++i){
+			energy += static_cast<double>(input[0][i]) * input[0][i];
+		}
+		const StftFrame& last = analyzer.frame();
+		double parseval = static_cast<double>(last.re(0)[0]) * last.re(0)[0] + static_cast<double>(last.re(0)[size/2]) * last.re(0)[size/2];
+		for(size_t k=1;k<size/2;++k){
+			parseval += 2.0 * (static_cast<double>(last.re(0)[k]) * last.re(0)[k] + static_cast<double>(last.im(0)[k]) * last.im(0)[k]);
+		}
+		parseval /= size * stftWindowPower(StftWindow::hann_);
+		if(std::abs(parseval / energy - 1.0) > 0.1){
+			std::cout << "failed: windowed energy " << parseval << ", input energy " << energy << std::endl;
+			failed++;
+		}
+		analyzer.reset();
+		if(analyzer.frame().end_ != 0){
+			std::cout << "failed: reset" << std::endl;
+			failed++;
+		}
+	}
+
+	try{
+		StftAnalyzer analyzer(1, 512, 1024);
+		std::cout << "failed: hop longer than the frame is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	try{
+		StftSynthesizer synthesizer(512, 512, StftWindow::hann_, StftWindow::hann_);
+		std::cout << "failed: windows without overlap are accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	if(failed == 0){
+		std::cout << "all STFT tests passed" << std::endl;
+	}
+	return failed == 0 ? 0 : 1;
+}
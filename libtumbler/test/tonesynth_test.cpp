@@ -0,0 +1,155 @@
+/*
+ * @file tonesynth_test.cpp
+ * \~english
+ * @brief Tests of the tone and earcon synthesizer
+ * \~japanese
+ * @brief 通知音合成器の試験
+ * @details 正弦波の周波数と振幅、掃引の終了時の周波数、エンベロープの形、矩形波の振幅、トーンの並びの長さ、
+ * 合成の分割の仕方によらず同じ出力が得られることを確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/tonesynth.h"
+
+using namespace tumbler;
+
+static const int k_rate = 44100;
+
+/**
+ * @brief 一括で合成する
+ */
+std::vector<short> render(const Earcon& earcon)
+{
+	ToneSynth synth(earcon, k_rate);
+	std::vector<short> out(synth.length());
+	synth.render(out.data(), out.size());
+	return out;
+}
+
+/**
+ * @brief 区間 [begin, end) の指定した周波数成分の振幅を返す
+ */
+double amplitude(const std::vector<short>& audio, size_t begin, size_t end, double frequency)
+{
+	double re = 0;
+	double im = 0;
+	for(size_t i=begin;i<end;++i){
+		re += audio[i] * std::cos(2.0 * M_PI * frequency * i / k_rate);
+		im += audio[i] * std::sin(2.0 * M_PI * frequency * i / k_rate);
+	}
+	return 2.0 * std::sqrt(re * re + im * im) / (end - begin);
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+
+	// 正弦波：周波数と振幅、エンベロープ（5ms のアタック、20ms のリリース）
+	{
+		const std::vector<short> out = render(Earcon().add(Tone(ToneWaveform::sine_, 1000, 500, 0.5F), 0));
+		const double a = amplitude(out, 4410, 17640, 1000);
+		const size_t attack = 5 * k_rate / 1000;
+		int peakAttack = 0;
+		for(size_t i=0;i<attack/2;++i){
+			peakAttack = std::max(peakAttack, std::abs(out[i]));
+		}
+		std::cout << "sine: length " << out.size() << ", amplitude " << a << ", first half of attack peak " << peakAttack << ", last " << out.back() << std::endl;
+		if(out.size() != static_cast<size_t>(k_rate / 2) || std::abs(a - 16383) > 30 || peakAttack > 8300 || std::abs(out.back()) > 100){
+			std::cout << "failed: sine" << std::endl;
+			failed++;
+		}
+	}
+
+	// 掃引：リリースの直前の周波数を、上向きのゼロ交差の間隔から求める
+	{
+		const std::vector<short> out = render(Earcon().add(Tone(ToneWaveform::sine_, 500, 1000, 0.5F).sweep(2000), 0));
+		const size_t at = out.size() - 882;
+		std::vector<double> crossings;
+		for(size_t i=at-441;i<at;++i){
+			if(out[i - 1] < 0 && out[i] >= 0){
+				crossings.push_back(i - 1 + static_cast<double>(-out[i - 1]) / (out[i] - out[i - 1]));
+			}
+		}
+		const double measured = crossings.size() < 2 ? 0 : (crossings.size() - 1) * k_rate / (crossings.back() - crossings.front());
+		const double expected = 500 * std::pow(2000.0 / 500, (at - 220.5) / (out.size() - 1));
+		std::cout << "sweep: " << measured << " Hz (expected " << expected << " Hz)" << std::endl;
+		if(std::abs(measured - expected) > expected * 0.01){
+			std::cout << "failed: sweep" << std::endl;
+			failed++;
+		}
+	}
+
+	// 矩形波：基本波の振幅は 4/π 倍となる
+	{
+		const std::vector<short> out = render(Earcon().add(Tone(ToneWaveform::square_, 441, 500, 0.25F), 0));
+		const double a = amplitude(out, 4410, 17640, 441);
+		std::cout << "square: fundamental " << a << std::endl;
+		if(std::abs(a - 8191.75 * 4 / M_PI) > 100){
+			std::cout << "failed: square" << std::endl;
+			failed++;
+		}
+	}
+
+	// トーンの並び：append() は直前のトーンの終了後に続き、add() で重ねたトーンは加算される
+	Earcon earcon;
+	earcon.append(Tone(ToneWaveform::sine_, 880, 80)).append(Tone(ToneWaveform::square_, 1320, 80).envelope(ToneEnvelope(2, 30, 0.4F, 30)), 20);
+	earcon.add(Tone(ToneWaveform::sine_, 660, 100, 0.3F), 100);
+	const std::vector<short> whole = render(earcon);
+	std::cout << "sequence: " << earcon.size() << " tones, " << earcon.durationMs() << " ms, " << whole.size() << " frames" << std::endl;
+	if(earcon.durationMs() != 200 || whole.size() != static_cast<size_t>(k_rate / 5)){
+		std::cout << "failed: sequence" << std::endl;
+		failed++;
+	}
+
+	// 分割して合成しても一括の場合と同じ出力となる
+	{
+		ToneSynth synth(earcon, k_rate);
+		std::vector<short> chunked(whole.size() + 100);
+		const size_t sizes[] = {1, 7, 333, 1024, 5};
+		size_t produced = 0;
+		for(size_t k=0;!synth.finished();++k){
+			produced += synth.render(&chunked[produced], sizes[k % 5]);
+		}
+		chunked.resize(produced);
+		synth.reset();
+		std::vector<short> again(whole.size());
+		synth.render(again.data(), again.size());
+		if(chunked != whole || again != whole){
+			std::cout << "failed: chunked output differs" << std::endl;
+			failed++;
+		}
+	}
+
+	// 範囲外の周波数
+	try{
+		ToneSynth synth(Earcon().add(Tone(ToneWaveform::sine_, 30000, 100), 0), k_rate);
+		std::cout << "failed: out of range frequency is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	return failed == 0 ? 0 : 1;
+}
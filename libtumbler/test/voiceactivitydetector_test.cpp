@@ -0,0 +1,298 @@
+/*
+ * @file voiceactivitydetector_test.cpp
+ * \~english
+ * @brief Tests of the voice activity detector and the pre-roll gate
+ * \~japanese
+ * @brief 音声区間検出器と先行区間付きゲートの試験
+ * @details 模擬した音声（調波構造と 2 つのフォルマントを持つ有声音の音節、摩擦音）と雑音（白色雑音、途中から加わる定常雑音、低域の雑音）に対する
+ * フレーム単位の適合率と再現率、処理時間、ゲートが先行区間を含めて入力を欠落、重複なく後段に渡すことを確認する。実機を必要としない。
+ * \~
+ * @date created on: 2026/10/18
+ * @copyright Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2026 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "tumbler/tumbler.h"
+#include "tumbler/voiceactivitydetector.h"
+
+using namespace tumbler;
+
+static const int k_rate = 16000;
+static const size_t k_frame = 160; // 10ms
+
+/**
+ * @brief 模擬した音声と、10ms 毎の正解ラベル（発話区間か）
+ */
+struct Speech
+{
+	std::vector<float> signal_;
+	std::vector<bool> labels_;
+};
+
+/**
+ * @brief 発話（音節の並び）と無音を交互に並べた音声を作る
+ * @param [in] seconds 長さ [s]
+ * @param [in] rms 有声音の実効値
+ */
+Speech speech(double seconds, double rms, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::normal_distribution<double> normal(0.0, 1.0);
+	const size_t total = static_cast<size_t>(seconds * k_rate);
+	Speech s;
+	s.signal_.assign(total, 0.0F);
+	std::vector<bool> active(total, false);
+	size_t t = static_cast<size_t>((0.5 + 1.5 * uniform(rng)) * k_rate);
+	while(t < total){
+		// 発話：0.8〜3 秒
+		const size_t end = std::min(total, t + static_cast<size_t>((0.8 + 2.2 * uniform(rng)) * k_rate));
+		const size_t begin = t;
+		while(t < end){
+			// 音節：150〜300ms の有声音（3 割は 60ms の摩擦音で始まる）と 30〜80ms の間
+			if(uniform(rng) < 0.3){
+				const size_t n = std::min(end - t, static_cast<size_t>(0.06 * k_rate));
+				double last = 0;
+				for(size_t i=0;i<n;++i){
+					const double w = normal(rng);
+					s.signal_[t + i] += static_cast<float>(0.5 * rms * (w - last));
+					last = w;
+				}
+				t += n;
+			}
+			const size_t n = std::min(end - t, static_cast<size_t>((0.15 + 0.15 * uniform(rng)) * k_rate));
+			const double f0 = 100 + 150 * uniform(rng);
+			const double glide = (uniform(rng) - 0.5) * 0.3;
+			const double f1 = 500 + 300 * uniform(rng);
+			const double f2 = 1000 + 1000 * uniform(rng);
+			double phase = 0;
+			std::vector<double> amplitude;
+			double power = 0;
+			for(int k=1;k*f0<4000;++k){
+				const double f = k * f0;
+				const double a = 1.0 / (1.0 + std::pow((f - f1) / 150, 2)) + 0.5 / (1.0 + std::pow((f - f2) / 200, 2)) + 0.02;
+				amplitude.push_back(a);
+				power += a * a / 2;
+			}
+			const double gain = rms / std::sqrt(power);
+			for(size_t i=0;i<n;++i){
+				const double envelope = std::sin(M_PI * (i + 0.5) / n);
+				phase += 2.0 * M_PI * f0 * (1.0 + glide * i / n) / k_rate;
+				double v = 0;
+				for(size_t k=0;k<amplitude.size();++k){
+					v += amplitude[k] * std::sin((k + 1) * phase);
+				}
+				s.signal_[t + i] += static_cast<float>(gain * envelope * v);
+			}
+			t += n;
+			t += std::min(end - t, static_cast<size_t>((0.03 + 0.05 * uniform(rng)) * k_rate));
+		}
+		std::fill(active.begin() + begin, active.begin() + end, true);
+		t = end + static_cast<size_t>((0.5 + 2.5 * uniform(rng)) * k_rate);
+	}
+	for(size_t i=0;i+k_frame<=total;i+=k_frame){
+		s.labels_.push_back(active[i + k_frame / 2]);
+	}
+	return s;
+}
+
+/**
+ * @brief 白色雑音（実効値 white）と、後半に加わる低域寄りの定常雑音（実効値 hum）を加える
+ */
+void addNoise(std::vector<float>& x, double white, double hum, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::normal_distribution<double> normal(0.0, 1.0);
+	double lowpassed = 0;
+	for(size_t i=0;i<x.size();++i){
+		lowpassed = 0.95 * lowpassed + 0.05 * normal(rng);
+		double v = white * normal(rng);
+		if(i >= x.size() / 2){
+			v += hum * (lowpassed * 3.2 + 0.3 * std::sin(2.0 * M_PI * 100.0 * i / k_rate));
+		}
+		x[i] = static_cast<float>(std::max(-32768.0, std::min(32767.0, x[i] + v)));
+	}
+}
+
+/**
+ * @brief フレーム単位の適合率と再現率
+ */
+void evaluate(const Speech& s, const std::vector<float>& x, double& precision, double& recall, double& duty)
+{
+	VoiceActivityDetector vad(1);
+	size_t tp = 0, fp = 0, fn = 0, on = 0;
+	for(size_t f=0;f<s.labels_.size();++f){
+		const float* in = x.data() + f * k_frame;
+		const bool active = vad.process(&in, k_frame);
+		tp += active && s.labels_[f];
+		fp += active && !s.labels_[f];
+		fn += !active && s.labels_[f];
+		on += active;
+	}
+	precision = tp + fp > 0 ? static_cast<double>(tp) / (tp + fp) : 0.0;
+	recall = tp + fn > 0 ? static_cast<double>(tp) / (tp + fn) : 0.0;
+	duty = static_cast<double>(on) / s.labels_.size();
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+
+	// 模擬した音声に対する適合率、再現率（静かな部屋、雑音の多い部屋）
+	{
+		const Speech s = speech(120, 1600, 1); // 有声音の実効値 約 -26dBFS
+		size_t speechFrames = 0;
+		for(size_t f=0;f<s.labels_.size();++f){
+			speechFrames += s.labels_[f];
+		}
+		const struct{ const char* name_; double white_; double hum_; double precision_; double recall_; } conditions[] = {
+				{"quiet (noise -56dBFS)", 50, 0, 0.85, 0.95},
+				{"noisy (noise -41dBFS, hum from the middle)", 280, 400, 0.8, 0.85},
+		};
+		for(const auto& c : conditions){
+			std::vector<float> x = s.signal_;
+			addNoise(x, c.white_, c.hum_, 2);
+			double precision, recall, duty;
+			evaluate(s, x, precision, recall, duty);
+			std::cout << c.name_ << ": precision " << precision << ", recall " << recall << ", active " << duty * 100 << "% of the time (speech "
+					<< 100.0 * speechFrames / s.labels_.size() << "%)" << std::endl;
+			if(precision < c.precision_ || recall < c.recall_){
+				std::cout << "failed: " << c.name_ << std::endl;
+				failed++;
+			}
+		}
+
+		// 雑音のみの場合は、定常雑音が加わっても音声区間とならない
+		std::vector<float> noise(s.signal_.size(), 0.0F);
+		addNoise(noise, 280, 400, 3);
+		VoiceActivityDetector vad(1);
+		size_t on = 0;
+		for(size_t f=0;f<s.labels_.size();++f){
+			const float* in = noise.data() + f * k_frame;
+			on += vad.process(&in, k_frame);
+		}
+		std::cout << "noise only: active " << 100.0 * on / s.labels_.size() << "% of the time" << std::endl;
+		if(on > s.labels_.size() / 100){
+			std::cout << "failed: noise only" << std::endl;
+			failed++;
+		}
+	}
+
+	// 処理時間：16kHz 1ch と 48kHz 4ch
+	{
+		std::vector<short> x(60 * 48000);
+		std::mt19937 rng(4);
+		std::normal_distribution<double> normal(0.0, 1000.0);
+		for(size_t i=0;i<x.size();++i){
+			x[i] = static_cast<short>(normal(rng));
+		}
+		VoiceActivityDetector mono(1);
+		auto begin = std::chrono::steady_clock::now();
+		for(size_t done=0;done+480<=60*16000;done+=480){
+			const short* in = x.data() + done;
+			mono.process(&in, 480);
+		}
+		const double monoMs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() * 1000 / 60;
+		VoiceActivityDetectorConfig config;
+		config.rate_ = 48000;
+		VoiceActivityDetector quad(4, config);
+		begin = std::chrono::steady_clock::now();
+		for(size_t done=0;done+480<=x.size();done+=480){
+			const short* in[4] = {x.data() + done, x.data() + done, x.data() + done, x.data() + done};
+			quad.process(in, 480);
+		}
+		const double quadMs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() * 1000 / 60;
+		std::cout << "cpu: 16kHz 1ch " << monoMs << " ms per second, 48kHz 4ch " << quadMs << " ms per second" << std::endl;
+	}
+
+	// ゲート：開いたときに先行区間を渡し、後段には入力が欠落、重複なく連続して渡される
+	{
+		const size_t preRoll = 1000;
+		VoiceActivityGate<float> gate(2, preRoll);
+		std::vector<float> a(48000);
+		std::vector<float> b(48000);
+		for(size_t i=0;i<a.size();++i){
+			a[i] = static_cast<float>(i);
+			b[i] = -static_cast<float>(i);
+		}
+		// 閉 [0, 5000)、開 [5000, 9000)、閉 [9000, 9500)、開 [9500, 20000)、閉 [20000, 48000)
+		std::vector<float> received;
+		size_t resumes = 0;
+		bool ok = true;
+		std::mt19937 rng(5);
+		std::uniform_int_distribution<size_t> chunk(1, 700);
+		for(size_t done=0;done<a.size();){
+			size_t n = std::min(chunk(rng), a.size() - done);
+			const size_t edges[] = {5000, 9000, 9500, 20000};
+			for(size_t e : edges){
+				if(done < e && done + n > e){
+					n = e - done;
+				}
+			}
+			const bool open = (done >= 5000 && done < 9000) || (done >= 9500 && done < 20000);
+			const float* in[2] = {a.data() + done, b.data() + done};
+			const size_t passed = gate.process(in, n, open, [&](const float* const* data, size_t frames, bool resumed){
+				if(resumed){
+					resumes++;
+					received.push_back(-1); // 区切り
+				}
+				for(size_t i=0;i<frames;++i){
+					ok = ok && data[1][i] == -data[0][i];
+					received.push_back(data[0][i]);
+				}
+			});
+			ok = ok && (open || passed == 0);
+			done += n;
+		}
+		// 期待値：[4000, 9000) と [9000, 20000)（2 回目の先行区間は閉じていた 500 フレームのみ）
+		std::vector<float> expected;
+		expected.push_back(-1);
+		for(size_t i=4000;i<9000;++i){
+			expected.push_back(static_cast<float>(i));
+		}
+		expected.push_back(-1);
+		for(size_t i=9000;i<20000;++i){
+			expected.push_back(static_cast<float>(i));
+		}
+		std::cout << "gate: " << received.size() - resumes << " frames passed, " << resumes << " resume(s)" << std::endl;
+		if(!ok || received != expected || resumes != 2){
+			std::cout << "failed: gate" << std::endl;
+			failed++;
+		}
+	}
+
+	// 設定の誤り
+	try{
+		VoiceActivityDetectorConfig config;
+		config.rate_ = 4000;
+		VoiceActivityDetector vad(1, config);
+		std::cout << "failed: 4kHz is accepted" << std::endl;
+		failed++;
+	}catch(const std::invalid_argument& e){
+	}
+	if(failed == 0){
+		std::cout << "all voice activity detector tests passed" << std::endl;
+	}
+	return failed == 0 ? 0 : 1;
+}